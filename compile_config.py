@@ -0,0 +1,235 @@
+import argparse, json, struct, sys, zlib
+
+# Compiles an Amp JSON config into the binary image read in place by the
+# firmware from the "config" partition (see main/include/models/config-image.h).
+#
+#   python compile_config.py config/config.json.sample -o config.bin
+#   parttool.py write_partition --partition-name config --input config.bin
+
+parser = argparse.ArgumentParser()
+parser.add_argument('input', help='JSON config')
+parser.add_argument('--output', '-o', help='Output File')
+args = parser.parse_args()
+
+MAGIC = 0x43504D41
+VERSION = 1
+PARTITION_SIZE = 0xF000
+
+HEADER_FORMAT = '<IHHIIHHHHIIIIIII'
+MOTION_FORMAT = '<BBBBBBHHHIffffff'
+CHANNEL_FORMAT = '<BBH'
+REGION_FORMAT = '<HHHH'
+SECTION_FORMAT = '<BBHHH'
+ACTION_FORMAT = '<HH'
+EFFECT_FORMAT = '<BBBB3B3BHI'
+
+# CONFIG_LOADER_KEY in hal/config-loader.h less the terminator, the firmware
+# rejects a msgpack config with longer region names
+MAX_NAME = 47
+
+# Actions enum in models/light.h
+ACTION_COUNT = 19
+GROUPS = [
+  # Group_Motion
+  { 'motion-off': 1, 'motion-neutral': 3, 'motion-brakes': 4, 'motion-acceleration': 5 },
+  # Group_Headlight
+  { 'headlight-off': 1, 'headlight-normal': 6, 'headlight-bright': 7 },
+  # Group_Turn
+  { 'turn-off': 1, 'turn-center': 8, 'turn-left': 9, 'turn-right': 10, 'turn-hazard': 11 },
+  # Group_Orientation
+  { 'orientation-off': 1, 'orientation-unknown': 12, 'orientation-top': 13, 'orientation-bottom': 14,
+    'orientation-left': 15, 'orientation-right': 16, 'orientation-front': 17, 'orientation-back': 18 }
+]
+
+# LightEffect enum in models/light.h, grouped by the arguments they take
+TRANSPARENT, OFF, STATIC, RAINBOW, RAINBOW_CYCLE, THEATER_CHASE = 0, 1, 2, 9, 10, 12
+TWO_COLOR_EFFECTS = [3, 4, 5, 6, 7, 8, 11, 13, 14]
+
+# defaults mirror DEFAULT_* in main/include/common.h
+MOTION_DEFAULTS = {
+  'autoOrientation': False,
+  'autoMotion': False,
+  'autoTurn': False,
+  'relativeTurnZero': True,
+  'motionAxis': 0,
+  'turnAxis': 0,
+  'orientation': 0,
+  'ahrsFilter': 0,
+  'orientationMinConfidence': 50,
+  'motionDwell': 60,
+  'motionMaxLatency': 100,
+  'orientationDwell': 300,
+  'parkTimeout': 300,
+  'turnThreshold': 7.0,
+  'brakeThreshold': 0.2,
+  'accelerationThreshold': 0.2,
+  'brakeJerkThreshold': 4.0,
+  'orientationUpMin': 70,
+  'orientationUpMax': 110
+}
+
+def warn(message):
+  print("warning: {0}".format(message), file=sys.stderr)
+
+def align(data):
+  while len(data) % 4 != 0:
+    data.append(0)
+
+def parse_color(data):
+  if data == 'random':
+    return (0, 0, 0), 0x01
+  if data == 'rainbow':
+    return (0, 0, 0), 0x02
+
+  hex = data.lstrip('#')
+  return (int(hex[0:2], 16), int(hex[2:4], 16), int(hex[4:6], 16)), 0
+
+# mirrors Config::parseEffect, returns None for effects the firmware rejects
+def parse_effect(data):
+  parts = data.split(',')
+  effect = int(parts[0])
+  first, second, flags, duration, layer = (0, 0, 0), (0, 0, 0), 0, 0, 0
+
+  def optional_layer(index):
+    return int(parts[index]) if len(parts) == index + 1 else 0
+
+  if effect == STATIC:
+    if len(parts) < 2:
+      return None
+    first, flags = parse_color(parts[1])
+    layer = optional_layer(2)
+  elif effect == THEATER_CHASE:
+    if len(parts) < 3:
+      return None
+    first, flags = parse_color(parts[1])
+    duration = int(parts[2])
+    layer = optional_layer(3)
+  elif effect in TWO_COLOR_EFFECTS:
+    if len(parts) < 4:
+      return None
+    first, first_flags = parse_color(parts[1])
+    second, second_flags = parse_color(parts[2])
+    flags = first_flags | (second_flags << 2)
+    duration = int(parts[3])
+    layer = optional_layer(4)
+  elif effect in [RAINBOW, RAINBOW_CYCLE]:
+    if len(parts) < 2:
+      return None
+    duration = int(parts[1])
+    layer = optional_layer(2)
+  elif effect in [TRANSPARENT, OFF]:
+    layer = optional_layer(1)
+
+  return effect, layer, flags, first, second, duration
+
+def compile_motion(motion):
+  values = dict(MOTION_DEFAULTS)
+  values.update({ key: value for key, value in motion.items() if key in MOTION_DEFAULTS })
+
+  flags = (int(values['autoOrientation']) | int(values['autoMotion']) << 1 |
+    int(values['autoTurn']) << 2 | int(values['relativeTurnZero']) << 3)
+
+  return struct.pack(MOTION_FORMAT, flags, values['motionAxis'], values['turnAxis'], values['orientation'],
+    values['ahrsFilter'], values['orientationMinConfidence'], values['motionDwell'], values['motionMaxLatency'],
+    values['orientationDwell'], values['parkTimeout'], values['turnThreshold'], values['brakeThreshold'],
+    values['accelerationThreshold'], values['brakeJerkThreshold'], values['orientationUpMin'], values['orientationUpMax'])
+
+def compile_config(config):
+  lights = config.get('lights', {})
+  channels = bytearray()
+  regions = bytearray()
+  sections = bytearray()
+  strings = bytearray()
+  region_index = {}
+  section_count = 0
+
+  for channel in lights.get('channels', []):
+    channels += struct.pack(CHANNEL_FORMAT, channel['channel'], channel['type'], channel['leds'])
+
+  for name, region_sections in lights.get('regions', {}).items():
+    if len(name.encode('utf-8')) > MAX_NAME:
+      raise ValueError("region name {0} is longer than {1} bytes".format(name, MAX_NAME))
+
+    first_section = section_count
+    count = 0
+
+    for section in region_sections:
+      if not all(key in section for key in ['channel', 'start', 'end']):
+        warn("skipping incomplete section in region {0}".format(name))
+        continue
+
+      sections += struct.pack(SECTION_FORMAT, section['channel'], 0, section['start'], section['end'], 0)
+      count += section['end'] - section['start']
+      section_count += 1
+
+    region_index[name] = len(region_index)
+    regions += struct.pack(REGION_FORMAT, len(strings), first_section, section_count - first_section, count)
+    strings += name.encode('utf-8') + b'\0'
+
+  if len(region_index) > 255:
+    raise ValueError("at most 255 regions are supported")
+
+  # every group / action slot gets an entry, unused slots have no effects
+  actions = [(0, 0)] * (len(GROUPS) * ACTION_COUNT)
+  effects = bytearray()
+  effect_count = 0
+
+  for action, region_effects in config.get('actions', {}).items():
+    slot = None
+    for group, names in enumerate(GROUPS):
+      if action in names:
+        slot = group * ACTION_COUNT + names[action]
+
+    if slot is None:
+      warn("skipping unknown action {0}".format(action))
+      continue
+
+    first_effect = effect_count
+    for region_effect in region_effects:
+      region = region_effect.get('region')
+      parsed = parse_effect(region_effect.get('effect', ''))
+
+      if region not in region_index or parsed is None:
+        warn("skipping effect {0} for {1} on {2}".format(region_effect.get('effect'), action, region))
+        continue
+
+      effect, layer, flags, first, second, duration = parsed
+      effects += struct.pack(EFFECT_FORMAT, region_index[region], effect, layer, flags, *first, *second, 0, duration)
+      effect_count += 1
+
+    actions[slot] = (first_effect, effect_count - first_effect)
+
+  action_table = bytearray()
+  for first_effect, count in actions:
+    action_table += struct.pack(ACTION_FORMAT, first_effect, count)
+
+  # lay out the tables after the header, each one 4 byte aligned
+  body = bytearray()
+  offsets = []
+  header_size = struct.calcsize(HEADER_FORMAT)
+  for table in [compile_motion(config.get('motion', {})), channels, regions, sections, action_table, effects, strings]:
+    align(body)
+    offsets.append(header_size + len(body))
+    body += table
+  align(body)
+
+  header = struct.pack(HEADER_FORMAT, MAGIC, VERSION, header_size, header_size + len(body), zlib.crc32(body),
+    len(channels) // 4, len(region_index), section_count, effect_count, *offsets)
+
+  return header + body
+
+config = json.load(open(args.input))
+image = compile_config(config)
+
+if len(image) > PARTITION_SIZE:
+  print("config image is {0} bytes, the partition holds {1}".format(len(image), PARTITION_SIZE))
+  sys.exit(1)
+
+if (not args.output):
+  filename = "config.bin"
+else:
+  filename = args.output
+
+output = open(filename, "wb")
+output.write(image)
+print("wrote {0} bytes to {1}".format(len(image), filename))
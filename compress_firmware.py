@@ -0,0 +1,40 @@
+import argparse, struct, sys, zlib
+
+# Compresses a firmware image for OTA updates. The firmware inflates it while
+# streaming to flash (see main/include/hal/updater.h), plain images are still
+# accepted as they are.
+#
+#   python compress_firmware.py build/amp.bin -o amp.bin.z
+
+parser = argparse.ArgumentParser()
+parser.add_argument('input', help='Firmware image')
+parser.add_argument('--output', '-o', help='Output File')
+args = parser.parse_args()
+
+MAGIC = 0x5A504D41
+HEADER_FORMAT = '<II'
+
+# the firmware inflates with a 32 KB window, the zlib default
+WINDOW_BITS = 15
+
+with open(args.input, 'rb') as f:
+  image = f.read()
+
+if len(image) == 0 or image[0] != 0xE9:
+  sys.exit("{0} is not an app image".format(args.input))
+
+compressor = zlib.compressobj(9, zlib.DEFLATED, WINDOW_BITS)
+compressed = compressor.compress(image) + compressor.flush()
+
+# fail here rather than on the device
+if zlib.decompress(compressed) != image:
+  sys.exit("compressed image does not round trip")
+
+if (not args.output):
+  filename = args.input + ".z"
+else:
+  filename = args.output
+
+output = open(filename, "wb")
+output.write(struct.pack(HEADER_FORMAT, MAGIC, len(image)) + compressed)
+print("wrote {0} bytes to {1} ({2} uncompressed)".format(len(compressed) + 8, filename, len(image)))
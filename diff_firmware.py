@@ -0,0 +1,158 @@
+import argparse, struct, sys, zlib
+
+# Builds a delta OTA update from the firmware running on the device to a new
+# one. The firmware patches the running partition while streaming the result
+# to the update partition (see main/include/delta-patch.h).
+#
+#   python diff_firmware.py old/amp.bin build/amp.bin -o amp.delta
+
+parser = argparse.ArgumentParser()
+parser.add_argument('source', help='Firmware image running on the device')
+parser.add_argument('target', help='New firmware image')
+parser.add_argument('--output', '-o', help='Output File')
+args = parser.parse_args()
+
+MAGIC = 0x44504D41
+HEADER_FORMAT = '<IIII'
+CONTROL_FORMAT = '<IIi'
+
+# source blocks are indexed every INDEX_STEP bytes, so runs shorter than
+# BLOCK + INDEX_STEP may be missed
+BLOCK = 16
+INDEX_STEP = 4
+MIN_MATCH = 24
+
+def index_source(source):
+  index = {}
+  for i in range(0, len(source) - BLOCK + 1, INDEX_STEP):
+    index.setdefault(source[i:i + BLOCK], i)
+  return index
+
+def match_length(source, s, target, t):
+  length = 0
+  # compare in chunks first, code mostly moves as a whole
+  while s + length + 256 <= len(source) and t + length + 256 <= len(target) and \
+    source[s + length:s + length + 256] == target[t + length:t + length + 256]:
+    length += 256
+
+  while s + length < len(source) and t + length < len(target) and source[s + length] == target[t + length]:
+    length += 1
+
+  return length
+
+def find_matches(source, target):
+  index = index_source(source)
+  matches = []
+  offset = 0
+  t = 0
+  last = 0
+
+  while t + BLOCK <= len(target):
+    # keep the current alignment while it holds, relocated code only
+    # changes a few bytes here and there
+    s = t + offset
+    if not (0 <= s and s + BLOCK <= len(source) and source[s:s + BLOCK] == target[t:t + BLOCK]):
+      s = index.get(target[t:t + BLOCK])
+
+    if s is None:
+      t += 1
+      continue
+
+    # the match may start before the indexed block
+    back = 0
+    while t - back > last and s - back > 0 and source[s - back - 1] == target[t - back - 1]:
+      back += 1
+
+    length = back + match_length(source, s, target, t)
+    if length < MIN_MATCH:
+      t += 1
+      continue
+
+    matches.append((t - back, s - back, length))
+    offset = s - t
+    t = t - back + length
+    last = t
+
+  return matches
+
+def similar(source, s, target, t, length):
+  if s < 0 or s + length > len(source):
+    return False
+
+  same = sum(1 for i in range(length) if source[s + i] == target[t + i])
+  return same * 2 >= length
+
+def make_delta(source, target):
+  records = []
+  matches = find_matches(source, target) + [(len(target), None, 0)]
+
+  # the first record copies whatever comes before the first match
+  t, s, length = 0, 0, 0
+
+  for next_t, next_s, next_length in matches:
+    gap = next_t - (t + length)
+
+    # a gap in the same alignment is cheaper as diff bytes than as extra
+    diff = length
+    if gap > 0 and similar(source, s + length, target, t + length, gap):
+      diff += gap
+      gap = 0
+
+    seek = (next_s if next_s is not None else s + diff) - (s + diff)
+    records.append((t, s, diff, gap, seek))
+    t, s, length = next_t, next_s, next_length
+
+  body = bytearray()
+  for t, s, diff, extra, seek in records:
+    body += struct.pack(CONTROL_FORMAT, diff, extra, seek)
+    body += bytes((target[t + i] - source[s + i]) & 0xff for i in range(diff))
+    body += target[t + diff:t + diff + extra]
+
+  return bytes(body)
+
+def apply_delta(source, delta):
+  # same steps as the firmware, used to check the delta before it's sent
+  target = bytearray()
+  position = 0
+  offset = 0
+  control = struct.calcsize(CONTROL_FORMAT)
+
+  while offset < len(delta):
+    diff, extra, seek = struct.unpack_from(CONTROL_FORMAT, delta, offset)
+    offset += control
+
+    if position < 0 or position + diff > len(source):
+      raise ValueError('delta reads outside the source')
+
+    target += bytes((source[position + i] + delta[offset + i]) & 0xff for i in range(diff))
+    offset += diff
+    position += diff
+
+    target += delta[offset:offset + extra]
+    offset += extra
+    position += seek
+
+  return bytes(target)
+
+source = open(args.source, 'rb').read()
+target = open(args.target, 'rb').read()
+
+if len(source) == 0 or source[0] != 0xE9 or len(target) == 0 or target[0] != 0xE9:
+  sys.exit("both images have to be app images")
+
+delta = make_delta(source, target)
+
+# fail here rather than on the device
+if apply_delta(source, delta) != target:
+  sys.exit("delta does not reproduce the target image")
+
+compressed = zlib.compress(delta, 9)
+
+if (not args.output):
+  filename = "amp.delta"
+else:
+  filename = args.output
+
+output = open(filename, "wb")
+output.write(struct.pack(HEADER_FORMAT, MAGIC, len(target), len(source), zlib.crc32(source)) + compressed)
+print("wrote {0} bytes to {1} ({2} byte image)".format(len(compressed) + struct.calcsize(HEADER_FORMAT), filename, len(target)))
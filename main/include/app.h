@@ -1,4 +1,11 @@
 #pragma once
+
+// #define LOG_EVENT_BUS_STATS
+// #define LOG_POWER_TELEMETRY
+// #define LOG_ACTION_LATENCY
+// #define LOG_BRAKE_LATENCY
+// #define LOG_TELEMETRY_STATS
+
 #include "FreeRTOS.h"
 
 #include <amp.h>
@@ -12,6 +19,9 @@
   #include <services/vehicle-service.h>
   #include <services/config-service.h>
   #include <services/update-service.h>
+  #include <services/diagnostics-service.h>
+  #include <services/stream-service.h>
+  #include <services/sensor-service.h>
 #endif
 
 static const char* APP_TAG = "app";
@@ -22,13 +32,15 @@ class App : public LifecycleBase, public ConfigListener, public MotionListener,
   AmpConfig *config;
   VehicleState vehicleState;
   bool _renderHostActive = false;
-  std::vector<RenderListener*> renderListeners;
+  unsigned long _lastStatsLog = 0;
 
   Actions _motionCommand = Actions::LightsMotionNeutral;
   Actions _headlightCommand = Actions::LightsHeadlightNormal;
   Actions _turnCommand = Actions::LightsTurnCenter;
   Actions _orientationCommand = Actions::LightsOrientationUnknown;
 
+  void applyAction(ActionGroup group, Actions command);
+
 #if defined(BLE_ENABLED)
   // services
   DeviceInfoService *deviceInfoService;
@@ -36,6 +48,9 @@ class App : public LifecycleBase, public ConfigListener, public MotionListener,
   VehicleService *vehicleService;
   ConfigService *configService;
   UpdateService *updateService;
+  DiagnosticsService *diagnosticsService;
+  StreamService *streamService;
+  SensorService *sensorService;
 #endif
   
   public:
@@ -43,9 +58,9 @@ class App : public LifecycleBase, public ConfigListener, public MotionListener,
     void onPowerUp();
     void onPowerDown();
     void process();
-    void onConfigUpdated();
+    void onConfigUpdated(uint8_t scope);
     // void setLightMode(LightMode mode);
-    void addRenderListener(RenderListener* listener) { renderListeners.push_back(listener); }
+    void addRenderListener(RenderListener* listener) { EventBus::instance()->subscribe(listener, Event_LightsChanged); }
 
     void onAccelerationStateChanged(AccelerationState state);
     void onTurnStateChanged(TurnState state);
@@ -32,6 +32,7 @@
 #define IMU_MISO            GPIO_NUM_19
 #define IMU_MOSI            GPIO_NUM_23
 #define IMU_CS              GPIO_NUM_5
+// #define IMU_INT             GPIO_NUM_xx  // LIS3DH INT1, wakes a parked board without polling when routed
 #define BLE_ENABLED
 
 #include "AddressableLED.h"
@@ -70,9 +71,16 @@ static const Color updateError(127, 0, 0);
 #define DEFAULT_TURN_THRESHOLD 7.0      // degrees
 #define DEFAULT_BRAKE_THRESHOLD 0.2     // g
 #define DEFAULT_ACCELERATION_THRESHOLD 0.2     // g
+#define DEFAULT_BRAKE_JERK_THRESHOLD 4.0 // g/s
+#define DEFAULT_MOTION_DWELL 60         // ms
+#define DEFAULT_MOTION_MAX_LATENCY 100  // ms
 
 #define DEFAULT_ORIENTATION_UP_MIN 70   // degrees
 #define DEFAULT_ORIENTATION_UP_MAX 110  // degrees
+#define DEFAULT_ORIENTATION_DWELL 300   // ms
+#define DEFAULT_ORIENTATION_MIN_CONFIDENCE 50 // percent
+
+#define DEFAULT_PARK_TIMEOUT 300        // seconds, 0 disables parking
 
 inline Color hexStringToColor(std::string fadeColorText) {
   size_t pos = fadeColorText.find_first_of('#');
@@ -147,10 +155,11 @@ inline uint8_t percentageFromReading(float reading) {
 }
 
 inline Color hexToColor(std::string hex) {
-  Color color;
-  sscanf(hex.c_str(), "#%02x%02x%02x", (uint*) &color.r, (uint*) &color.g, (uint*) &color.b);
+  // %x stores a whole unsigned int, scan into those rather than the channels
+  unsigned int r = 0, g = 0, b = 0;
+  sscanf(hex.c_str(), "#%02x%02x%02x", &r, &g, &b);
 
-  return color;
+  return Color(r, g, b);
 }
 
 inline std::vector<std::string> split(const std::string &s, char delim) {
@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary config commands, the compact form of the text commands for effect
+// previews. A write holds one or more commands, each an opcode byte, a length
+// byte and the value. Opcodes start at 0x80 so they can't be mistaken for
+// text commands. Values are decoded in place, nothing is allocated.
+//
+// Effect value:
+//   group u8, action u8 (Actions), region u8 (index in name order, as in get:config)
+//   effect u8 (LightEffect), layer u8
+//   color flags u8 (bit 0 random, bit 1 rainbow for the first color, bits 2 and 3 for the second)
+//   first color r, g, b, second color r, g, b
+//   duration, unsigned LEB128 varint in ms
+//
+// Remove value: group u8, action u8, region u8
+
+#define COMMAND_FIRST       0x80
+#define COMMAND_HEADER      2     // opcode + value length
+#define COMMAND_EFFECT_MIN  13    // effect value with a one byte duration
+
+#define COMMAND_COLOR_RANDOM   (1 << 0)
+#define COMMAND_COLOR_RAINBOW  (1 << 1)
+
+enum CommandOp : uint8_t {
+  Command_Effect = COMMAND_FIRST,   // preview, not saved
+  Command_SaveEffect,               // applied and journaled
+  Command_RemoveEffect
+};
+
+struct EffectCommand {
+  uint8_t group;
+  uint8_t action;
+  uint8_t region;
+  uint8_t effect;
+  uint8_t layer;
+  uint8_t colorFlags;
+  uint8_t first[3];
+  uint8_t second[3];
+  uint32_t duration;
+};
+
+class CommandReader {
+  const uint8_t *_data;
+  size_t _length;
+  size_t _offset = 0;
+
+  public:
+    CommandReader(const uint8_t *data, size_t length) : _data(data), _length(length) { }
+
+    static bool isBinary(const uint8_t *data, size_t length) { return length >= COMMAND_HEADER && data[0] >= COMMAND_FIRST; }
+
+    // advances to the next command, false at the end or on a malformed command
+    bool next(CommandOp *op, EffectCommand *command);
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+// Binary config patches. A patch is a list of ops, each a type byte and a
+// little endian uint16 payload length followed by the payload. Strings in a
+// payload are a length byte followed by the characters. Patches are applied
+// to the live config and appended to a journal instead of rewriting the
+// whole profile.
+
+#define PATCH_HEADER    3   // op + payload length
+
+enum PatchOp : uint8_t {
+  Patch_SetEffect = 0x01,   // action, region, effect (same format as the effect command)
+  Patch_RemoveEffect,       // action, region
+  Patch_SetMotion,          // key, float32 value
+  Patch_SetChannel,         // channel u8, leds u16, type u8
+  Patch_SetRegion,          // name, count u8, count * (channel u8, start u16, end u16), no sections removes it
+};
+
+class PatchReader {
+  const uint8_t *_data;
+  size_t _length;
+  size_t _offset = 0;
+
+  // payload of the current op
+  const uint8_t *_payload = NULL;
+  size_t _payloadLength = 0;
+  size_t _payloadOffset = 0;
+  bool _valid = true;
+
+  public:
+    PatchReader(const uint8_t *data, size_t length) : _data(data), _length(length) { }
+
+    // advances to the next op, false at the end or on a truncated op
+    bool next(PatchOp *op);
+    // every op is complete, checked before anything is applied
+    bool validate();
+
+    // payload fields of the current op, a short payload marks it invalid
+    uint8_t u8();
+    uint16_t u16();
+    float f32();
+    std::string string();
+    bool isValid() { return _valid; }
+};
+
+class PatchWriter {
+  std::string &_out;
+  size_t _start = 0;
+
+  public:
+    PatchWriter(std::string &out) : _out(out) { }
+
+    void begin(PatchOp op);
+    void end();
+
+    void u8(uint8_t value) { _out.push_back(value); }
+    void u16(uint16_t value);
+    void f32(float value);
+    void string(const std::string &value);
+};
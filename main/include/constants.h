@@ -7,6 +7,7 @@ extern std::string vehicleStateCharacteristicUUID;
 extern std::string vehicleLightsCharacteristicUUID;
 extern std::string vehicleCalibrationCharacteristicUUID;
 extern std::string vehicleRestartCharactersticUUID;
+extern std::string vehicleTelemetryCharacteristicUUID;
 
 extern std::string configServiceUUID;
 extern std::string configRxCharacteristicUUID;
@@ -16,4 +17,18 @@ extern std::string configStatusCharacteristicUUID;
 extern std::string updateServiceUUID;
 extern std::string updateControlCharacteristicUUID;
 extern std::string updateRxCharacteristicUUID;
-extern std::string updateStatusCharacteristicUUID;
\ No newline at end of file
+extern std::string updateStatusCharacteristicUUID;
+
+extern std::string diagnosticsServiceUUID;
+extern std::string diagnosticsLatencyCharacteristicUUID;
+extern std::string diagnosticsConnectionCharacteristicUUID;
+extern std::string diagnosticsTelemetryCharacteristicUUID;
+
+extern std::string streamServiceUUID;
+extern std::string streamControlCharacteristicUUID;
+extern std::string streamFrameCharacteristicUUID;
+extern std::string streamStatsCharacteristicUUID;
+
+extern std::string sensorServiceUUID;
+extern std::string sensorControlCharacteristicUUID;
+extern std::string sensorSamplesCharacteristicUUID;
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Streamed firmware deltas in the style of bsdiff. A delta is a list of
+// records, each a little endian control block followed by its data:
+//
+//   diff length u32, extra length u32, seek i32
+//   diff bytes, added to the source starting at the source position
+//   extra bytes, copied as they are
+//
+// The source position advances with the diff bytes and then moves by seek.
+// Only the control block being read is buffered, the source is read in place.
+
+#define DELTA_CONTROL_SIZE  12
+
+class DeltaPatcher {
+  enum State : uint8_t {
+    Delta_Control,
+    Delta_Diff,
+    Delta_Extra
+  };
+
+  const uint8_t *_source = NULL;
+  size_t _sourceSize = 0;
+  int64_t _position = 0;
+
+  State _state = Delta_Control;
+  uint8_t _control[DELTA_CONTROL_SIZE];
+  uint8_t _controlLength = 0;
+  uint32_t _remaining = 0;
+  uint32_t _extra = 0;
+  int32_t _seek = 0;
+
+  void beginRecord();
+  void endData();
+
+  public:
+    void begin(const uint8_t *source, size_t sourceSize);
+
+    // patches from data into output, length and outputLength hold the space
+    // available on entry and what was consumed / produced on return. False
+    // for a delta that reads outside the source.
+    bool apply(const uint8_t *data, size_t *length, uint8_t *output, size_t *outputLength);
+
+    // between records, a complete delta ends here
+    bool isComplete() { return _state == Delta_Control && _controlLength == 0; }
+};
@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <common.h>
+#include <models/power-status.h>
+#include <models/update-status.h>
+#include <models/touch-type.h>
+#include <models/motion.h>
+#include <models/light.h>
+#include <models/config-change.h>
+#include "FreeRTOS.h"
+
+#define EVENT_RING_SIZE             8
+#define EVENT_BUS_MAX_SUBSCRIBERS   16
+
+static const char* EVENT_BUS_TAG = "event-bus";
+
+enum EventType : uint8_t {
+  Event_ConfigUpdated = 0,
+  Event_PowerStatus,
+  Event_UpdateStatus,
+  Event_CalibrateXG,
+  Event_CalibrateMag,
+  Event_CalibrationRequest,
+  Event_Touch,
+  Event_TouchSequence,
+  Event_Advertising,
+  Event_LightsChanged,
+  Event_Parked,
+  Event_TypeCount
+};
+
+// Latest wins events only keep the newest pending value per subscriber,
+// fifo events are delivered in order through a bounded ring.
+enum EventPolicy : uint8_t {
+  Event_Fifo = 0,
+  Event_LatestWins
+};
+
+struct Event {
+  EventType type;
+
+  union {
+    ConfigChange config;            // Event_ConfigUpdated
+    PowerStatus powerStatus;        // Event_PowerStatus
+    UpdateStatus updateStatus;      // Event_UpdateStatus
+    CalibrationState calibration;   // Event_CalibrateXG, Event_CalibrateMag
+    uint8_t calibrationRequest;     // Event_CalibrationRequest
+    bool touched;                   // Event_Touch
+    TouchSequence touches;          // Event_TouchSequence
+    bool publicAdvertising;         // Event_Advertising
+    LightCommands lights;           // Event_LightsChanged
+    bool parked;                    // Event_Parked
+  };
+};
+
+struct EventBusStats {
+  uint32_t published;
+  uint32_t delivered;
+  uint32_t coalesced;
+  uint32_t dropped;
+  uint32_t wakeups;
+};
+
+#define EVENT_LATEST_SLOTS 5
+
+// Per subscriber inbox. The task that polls it is captured on the first poll
+// and woken with a task notification when the inbox goes from empty to
+// pending, so a task only blocks in one place no matter how many event types
+// it listens to.
+class EventSubscriber {
+  friend class EventBus;
+
+  Event _ring[EVENT_RING_SIZE];
+  uint8_t _head = 0;
+  uint8_t _count = 0;
+
+  Event _latest[EVENT_LATEST_SLOTS];
+  uint8_t _latestPending = 0;
+
+  uint32_t _mask = 0;
+  TaskHandle_t _task = NULL;
+  portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+  public:
+    // next pending event, latest wins slots first, false when empty
+    bool poll(Event &event);
+    bool subscribed(EventType type) { return _mask & (1 << type); }
+};
+
+class EventBus {
+  EventSubscriber* _subscribers[EVENT_BUS_MAX_SUBSCRIBERS];
+  std::atomic<uint8_t> _subscriberCount{0};
+  portMUX_TYPE _subscribeLock = portMUX_INITIALIZER_UNLOCKED;
+
+  std::atomic<uint32_t> _published{0};
+  std::atomic<uint32_t> _delivered{0};
+  std::atomic<uint32_t> _coalesced{0};
+  std::atomic<uint32_t> _dropped{0};
+  std::atomic<uint32_t> _wakeups{0};
+
+  public:
+    static EventBus* instance() { static EventBus bus; return &bus; }
+
+    static EventPolicy policy(EventType type);
+    static int8_t latestSlot(EventType type);
+
+    void subscribe(EventSubscriber *subscriber, EventType type);
+    void publish(const Event &event);
+
+    EventBusStats getStats();
+    void logStats();
+};
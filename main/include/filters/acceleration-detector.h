@@ -0,0 +1,76 @@
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <models/motion.h>
+
+#define BRAKE_HOLD                    1000    // ms, minimum time brake lights stay on
+#define MOTION_HYSTERESIS             0.5f    // exit threshold as a fraction of the enter threshold
+#define JERK_SAMPLES                  3       // jerk is the median of this many samples, a single spike is ignored
+#define JERK_SPAN                     2       // samples each jerk is measured across, alternating noise and repeated samples cancel out
+
+enum MotionThreshold : uint8_t {
+  BrakeEnter = 0,
+  BrakeExit,
+  AccelerationEnter,
+  AccelerationExit,
+  MotionThresholdCount
+};
+
+enum MotionComparison : uint8_t {
+  AtLeast = 0,
+  AtMost
+};
+
+struct AccelerationTransition {
+  AccelerationState from;
+  AccelerationState to;
+  MotionComparison comparison;
+  MotionThreshold threshold;
+};
+
+// Table driven brake / acceleration detector.
+//
+// A transition fires once its condition has held for the dwell time and the
+// current state has been held for its minimum time. The brake entry dwell is
+// clamped so a sustained deceleration is reported within the configured
+// latency budget, and a hard deceleration (median jerk over JERK_SAMPLES,
+// each across JERK_SPAN samples, above the jerk threshold and already past
+// the brake threshold) enters Braking without waiting for the dwell.
+class AccelerationDetector {
+  static const AccelerationTransition transitions[];
+  static const uint8_t transitionCount;
+
+  float thresholds[MotionThresholdCount];
+  float jerkThreshold = 0.0f;
+  uint32_t dwell = 0;
+  uint32_t brakeDwell = 0;
+  uint32_t maxLatency = 0;
+
+  AccelerationState state = AccelerationState::Neutral;
+  int8_t pending = -1;
+  unsigned long pendingSince = 0;
+  unsigned long stateSince = 0;
+
+  float accelerations[JERK_SPAN];
+  uint8_t accelerationCount = 0;
+  uint8_t accelerationIndex = 0;
+  float jerks[JERK_SAMPLES];
+  uint8_t jerkCount = 0;
+  uint8_t jerkIndex = 0;
+
+  float filterJerk(float jerk);
+
+  bool matches(const AccelerationTransition &transition, float acceleration);
+  uint32_t dwellFor(const AccelerationTransition &transition);
+  uint32_t holdFor(AccelerationState state);
+
+  public:
+    AccelerationDetector();
+
+    // thresholds in g, jerk in g/s, dwell + latency in ms, sample interval in seconds
+    void configure(float brakeThreshold, float accelerationThreshold, float jerk, uint32_t dwellTime, uint32_t latencyBudget, float sampleInterval = MOTION_SAMPLE_PERIOD / 1000.0f);
+    void reset(AccelerationState initial = AccelerationState::Neutral, unsigned long now = 0);
+
+    AccelerationState update(float acceleration, unsigned long now, float dt);
+    AccelerationState getState() { return state; }
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include <math.h>
+#include <models/motion.h>
+
+// Base for the quaternion based fusion filters. Implementations keep all of
+// their state inline so they can be embedded by value and switched between at
+// runtime without touching the heap.
+class AhrsFilter {
+  protected:
+    Quaternion q;
+
+    void normalize();
+
+  public:
+    virtual void reset() { q = Quaternion(); }
+
+    // gyro in rad/s, accel and mag in any consistent unit, dt in seconds
+    virtual void update(Vector3D accel, Vector3D gyro, Vector3D mag, float dt) = 0;
+    virtual void updateIMU(Vector3D accel, Vector3D gyro, float dt) = 0;
+
+    Quaternion getQuaternion() { return q; }
+
+    // roll (x), pitch (y) and yaw (z) in degrees
+    Vector3D getAHRS();
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <filters/madgwick.h>
+#include <filters/mahony.h>
+
+// Runtime selectable attitude estimator. Both filters live inline so switching
+// between them never allocates.
+class Ahrs {
+  Madgwick madgwick;
+  Mahony mahony;
+  AhrsFilterType _type = AhrsFilterType::AHRS_Madgwick;
+  AhrsFilter *filter = &madgwick;
+
+  public:
+    void setFilter(AhrsFilterType type);
+    AhrsFilterType getFilter() { return _type; }
+
+    void reset() { filter->reset(); }
+    void update(Vector3D accel, Vector3D gyro, Vector3D mag, float dt, bool useMag);
+
+    Quaternion getQuaternion() { return filter->getQuaternion(); }
+    Vector3D getAHRS() { return filter->getAHRS(); }
+};
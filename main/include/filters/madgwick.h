@@ -0,0 +1,18 @@
+#pragma once
+#include <filters/ahrs-filter.h>
+
+#define MADGWICK_DEFAULT_BETA 0.1f
+
+// Madgwick gradient descent orientation filter
+// https://x-io.co.uk/open-source-imu-and-ahrs-algorithms/
+class Madgwick : public AhrsFilter {
+  float beta;
+
+  public:
+    Madgwick(float gain = MADGWICK_DEFAULT_BETA) : beta(gain) { }
+
+    void setGain(float gain) { beta = gain; }
+
+    void update(Vector3D accel, Vector3D gyro, Vector3D mag, float dt);
+    void updateIMU(Vector3D accel, Vector3D gyro, float dt);
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <filters/ahrs-filter.h>
+
+#define MAHONY_DEFAULT_KP 1.0f
+#define MAHONY_DEFAULT_KI 0.0f
+
+// Mahony nonlinear complementary filter on SO(3) with optional integral feedback
+class Mahony : public AhrsFilter {
+  float twoKp, twoKi;
+  Vector3D integralFeedback;
+
+  void correct(Vector3D &gyro, Vector3D halfError, float dt);
+  void integrate(Vector3D gyro, float dt);
+
+  public:
+    Mahony(float kp = MAHONY_DEFAULT_KP, float ki = MAHONY_DEFAULT_KI) : twoKp(2.0f * kp), twoKi(2.0f * ki) { }
+
+    void setGains(float kp, float ki) { twoKp = 2.0f * kp; twoKi = 2.0f * ki; }
+    void reset() { AhrsFilter::reset(); integralFeedback = Vector3D(); }
+
+    void update(Vector3D accel, Vector3D gyro, Vector3D mag, float dt);
+    void updateIMU(Vector3D accel, Vector3D gyro, float dt);
+};
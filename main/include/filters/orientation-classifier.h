@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+#include <models/motion.h>
+
+#define ORIENTATION_HYSTERESIS        15.0f   // degrees added to the enter cone before a side is released
+#define ORIENTATION_MIN_MAGNITUDE     0.5f    // g, below this the gravity estimate is meaningless
+
+// Hysteresis based orientation classifier.
+//
+// A side becomes "up" once gravity has stayed inside its enter cone (derived
+// from the up min / max angles) for the dwell time and is only released after
+// leaving the wider exit cone, so riding near 45 degrees no longer chatters
+// between sides. A confidence score in [0, 1] describes how firmly gravity sits
+// in the reported cone.
+class OrientationClassifier {
+  float enterCos = 0.0f;
+  float exitCos = 0.0f;
+  uint32_t dwell = 0;
+
+  Orientation state = Orientation::UnknownSideUp;
+  Orientation pending = Orientation::UnknownSideUp;
+  unsigned long pendingSince = 0;
+  float confidence = 0.0f;
+
+  static float alignment(Orientation side, Vector3D unit);
+  static Orientation dominantAxis(Vector3D gravity);
+  float confidenceFor(Orientation side, Vector3D unit, float magnitude);
+
+  public:
+    // up angles in degrees where 90 is straight up, dwell in ms
+    void configure(float upMin, float upMax, uint32_t dwellTime);
+    void reset(Orientation initial = Orientation::UnknownSideUp);
+
+    Orientation update(Vector3D gravity, unsigned long now);
+    Orientation getOrientation() { return state; }
+    float getConfidence() { return confidence; }
+};
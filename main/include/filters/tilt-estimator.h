@@ -0,0 +1,46 @@
+#pragma once
+#include <math.h>
+#include <models/motion.h>
+
+#define TILT_DEFAULT_TIME_CONSTANT      0.5f    // seconds
+#define TILT_DEFAULT_REJECTION_BAND     0.35f   // g
+#define TILT_LOAD_TIME_CONSTANT         0.25f   // seconds
+#define TILT_LATERAL_TIME_CONSTANT      0.15f   // seconds
+#define TILT_LOAD_DEADBAND              0.01f   // g, ignores load noise below ~8 degrees of lean
+#define TILT_MIN_LEAN                   1.0f    // degrees
+
+// Lean / tilt estimator for accelerometer-only hardware (no gyro, no mag).
+//
+// Gravity is tracked with a complementary filter whose gain shrinks as the
+// measured magnitude departs from 1 g, so braking, bumps and centripetal
+// acceleration are mostly rejected. During a coordinated turn the resultant of
+// gravity and centripetal acceleration stays in the board's plane of symmetry,
+// which hides the lean from the tilt estimate, so the lean is recovered from
+// the load factor (|a| = 1 / cos(lean)) and signed from the tilt or the lateral
+// acceleration seen on turn entry.
+class TiltEstimator {
+  Vector3D _gravity = Vector3D(0.0f, 0.0f, 1.0f);
+  float _load = 1.0f;
+  float _lateral = 0.0f;
+  float _leanSign = 1.0f;
+  float _timeConstant = TILT_DEFAULT_TIME_CONSTANT;
+  float _rejectionBand = TILT_DEFAULT_REJECTION_BAND;
+  bool _initialized = false;
+
+  public:
+    void reset();
+    void setTimeConstant(float seconds) { _timeConstant = seconds; }
+    void setRejectionBand(float g) { _rejectionBand = g; }
+
+    // accel in g, dt in seconds
+    void update(Vector3D accel, float dt);
+
+    // unit gravity direction in the sensor frame
+    Vector3D getGravity() { return _gravity; }
+
+    // signed lean hidden by centripetal acceleration, in degrees
+    float getCentripetalLean();
+
+    // roll (x) and pitch (y) in degrees, yaw (z) is unobservable and left at 0
+    Vector3D getAHRS();
+};
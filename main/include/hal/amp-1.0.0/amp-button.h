@@ -2,6 +2,7 @@
 #include <common.h>
 #include <freertos/FreeRTOS.h>
 #include "driver/gpio.h"
+#include "esp_sleep.h"
 #include <interfaces/touch-listener.h>
 
 class AmpButton {
@@ -15,7 +16,7 @@ class AmpButton {
     void init(TouchTaskListener *listener);
     void deinit();
 
-    void process();
+    void process(TickType_t wait = 0);
     static void onButtonInteraction();
     static QueueHandle_t buttonEventQueue;
 };
\ No newline at end of file
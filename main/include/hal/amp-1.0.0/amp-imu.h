@@ -2,10 +2,14 @@
 
 #include "lis3dh.h"
 #include <common.h>
+#include "driver/gpio.h"
 #include <models/motion.h>
 
 static const char* IMU_TAG = "imu";
 
+// wake up threshold while parked, 16 mg per count at +/-2 g
+#define IMU_ACTIVITY_THRESHOLD  4
+
 class AmpIMU {
   static lis3dh_sensor_t* sensor;
   lis3dh_float_data_t data;
@@ -30,6 +34,12 @@ class AmpIMU {
 
     void setPowerMode(IMUState state);
 
+    // low odr wake up detection on the high pass filtered signal while parked,
+    // events latch until activityDetected reads them. The wake task is only
+    // notified from INT1 when IMU_INT names the pin it is routed to
+    void setActivityDetection(bool enabled, TaskHandle_t wakeTask = NULL);
+    bool activityDetected();
+
     void calibrateMag(Vector3D *outOffsets);
     void calibrateXG(Vector3D *outOffsets);
 
@@ -4,10 +4,15 @@
 #include <map>
 
 #include <models/light.h>
+#include <hal/latency-telemetry.h>
 
 #include <OneWireLED.h>
 #include <TwoWireLED.h>
 
+#ifdef CONFIG_PM_ENABLE
+  #include "esp_pm.h"
+#endif
+
 const uint8_t gamma8[] = {
     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,
@@ -48,12 +53,18 @@ class AmpLeds {
 
   uint8_t _brightness = 255;
   // bool statusDirty = false;
-  bool dirty;
+  bool dirty = false;
+
+#ifdef CONFIG_PM_ENABLE
+  // led timing is derived from the apb clock, keep it at max while a frame goes out
+  esp_pm_lock_handle_t apbLock = NULL;
+#endif
 
   public:
     void init();
     void deinit();
     void process();
+    bool isDirty() { return dirty; }
     void setStatus(Color color);
     void render(bool all = false, int8_t channel = -1);
     Color gammaCorrected(Color color);
@@ -62,6 +73,8 @@ class AmpLeds {
     void setPixel(uint8_t channelNumber, Color color, uint16_t index);
     Color getPixel(uint8_t channelNumber, uint16_t index);
     void setPixels(uint8_t channelNumber, Color color, uint16_t start, uint16_t end);
+    // count gamma corrected pixels from packed r, g, b
+    void writePixels(uint8_t channelNumber, const uint8_t *rgb, uint16_t start, uint16_t count);
 
     LightController* addLEDStrip(LightChannel data);
 
@@ -9,6 +9,14 @@
 #include "esp_adc_cal.h"
 #include <esp_bt.h>
 
+#ifdef CONFIG_PM_ENABLE
+  #include "esp_pm.h"
+  #include "esp32/pm.h"
+#endif
+
+// lowest cpu frequency the power manager scales down to (xtal)
+#define PM_MIN_CPU_FREQ_MHZ 40
+
 #if defined(OTA_ENABLED)
 #include <WiFi.h>
 #endif
@@ -44,4 +44,8 @@ class AmpStorage {
 
     static void saveString(std::string key, std::string value);
     static std::string getString(std::string key);
+
+    static void saveBlob(const char* key, const void *value, size_t length);
+    static bool getBlob(const char* key, void *value, size_t length);
+    static void eraseKey(const char* key);
 };
\ No newline at end of file
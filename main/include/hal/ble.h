@@ -3,6 +3,8 @@
 #include <interfaces/touch-listener.h>
 #include <interfaces/ble-listener.h>
 #include <hal/config.h>
+#include <hal/power-telemetry.h>
+#include <hal/connection-policy.h>
 #include <models/config.h>
 #include <constants.h>
 #include "FreeRTOS.h"
@@ -16,18 +18,29 @@
 
 #define PUBLIC_ADVERTISEMENT_MS   15000
 
+struct ConnectionStats {
+  BleActivity activity;
+  uint16_t interval;        // 1.25 ms units, 0 when not connected
+  uint16_t latency;
+  uint16_t timeout;         // 10 ms units
+  uint16_t mtu;
+  uint32_t throughput;      // bytes per second over the last sample
+};
+
 static const char* BLE_TAG = "ble";
 
 class BluetoothLE : public LifecycleBase, public TouchListener, public NimBLEServerCallbacks {
   NimBLEAdvertising *advertising;
   NimBLEAdvertisementData advertisementData;
   TaskHandle_t bleTaskHandle;
-  std::vector<BleListener*> listeners;
-  std::vector<TouchType> touches;
 
   bool publicAdvertising = false;
   unsigned long publicAdvertiseStart = 0;
 
+  // links are claimed by the host task on connect and updated on the ble task
+  ConnectionPolicy _policy;
+  TickType_t nextPolicyDelay();
+
   public:
     NimBLEServer *server;
     BluetoothLE();
@@ -46,12 +59,18 @@ class BluetoothLE : public LifecycleBase, public TouchListener, public NimBLESer
     void onAuthenticationComplete(ble_gap_conn_desc *conn);
 
     // TouchListener
-    void onTouchEvent(std::vector<TouchType> *touches);
+    void onTouchEvent(TouchSequence touches);
 
     void startAdvertising();
     void updateAdvertising(std::string name, bool publicAdvertise = false);
     NimBLEService* createService(std::string uuid);
 
+    // services report what they move so the policy can pick parameters,
+    // zero bytes announces a transfer before it starts
+    void traffic(BleActivity activity, size_t bytes);
+    ConnectionStats getConnectionStats();
+    BleActivity getActivity();
+
     void addAdvertisingListener(BleListener *listener);
     void notifyListeners(bool isPublic);
 
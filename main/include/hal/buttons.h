@@ -9,13 +9,14 @@
 #endif
 
 #include <hal/power.h>
+#include <hal/power-telemetry.h>
 
 #include <memory>
+#include <algorithm>
 
 static const char* BUTTONS_TAG = "buttons";
 
 class Buttons : public LifecycleBase, public TouchTaskListener {
-  std::vector<TouchListener*> touchListeners;
   std::vector<TouchType> touches;
   AmpButton ampButtons;
   TaskHandle_t inputTaskHandle;
@@ -0,0 +1,44 @@
+#pragma once
+#include <common.h>
+#include <string.h>
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+
+#include <models/config-image.h>
+#include <models/motion.h>
+
+static const char* CONFIG_IMAGE_TAG = "config-image";
+
+// Read only view of a compiled config image in memory mapped flash. Nothing
+// is copied or parsed, accessors return pointers straight into the mapping.
+class ConfigImage {
+  spi_flash_mmap_handle_t _handle = 0;
+  const uint8_t *_data = NULL;
+  const ConfigImageHeader *_header = NULL;
+
+  bool validate(const uint8_t *data, size_t size);
+
+  template <typename T>
+  const T* table(uint32_t offset) const { return (const T*)(_data + offset); }
+
+  public:
+    bool map();
+    void unmap();
+    bool isMapped() { return _header != NULL; }
+
+    uint16_t channelCount() { return _header->channelCount; }
+    const ConfigImageChannel* channels() { return table<ConfigImageChannel>(_header->channelsOffset); }
+
+    uint16_t regionCount() { return _header->regionCount; }
+    const ConfigImageRegion* regions() { return table<ConfigImageRegion>(_header->regionsOffset); }
+    const char* regionName(const ConfigImageRegion *region) { return table<char>(_header->stringsOffset + region->name); }
+    const ConfigImageSection* sections(const ConfigImageRegion *region) {
+      return table<ConfigImageSection>(_header->sectionsOffset) + region->firstSection;
+    }
+
+    // effects for an action, NULL with count 0 when the action has none
+    const ConfigImageEffect* actionEffects(ActionGroup group, Actions action, uint16_t *count);
+
+    void loadMotionConfig(MotionConfig *config);
+    void effectParameters(const ConfigImageEffect *effect, LightingParameters *params);
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <common.h>
+#include <msgpack-stream.h>
+#include <models/config.h>
+
+#define CONFIG_LOADER_KEY  48   // key buffer per level, longer region or action names invalidate the config
+
+// Builds an AmpConfig from msgpack events as they stream in. Only the value
+// being assembled (one channel, section or effect) is buffered, everything
+// else goes straight into the target config.
+class ConfigLoader : public MsgPackHandler {
+  struct Frame {
+    bool map;
+    char key[CONFIG_LOADER_KEY];
+  };
+
+  AmpConfig *_config = NULL;
+  Frame _frames[MSGPACK_MAX_DEPTH];
+  uint8_t _depth = 0;
+  bool _valid = true;
+  bool _lights = false;
+
+  // value under construction
+  LightChannel _channel;
+  LightSection _section;
+  uint8_t _sectionFields = 0;
+  LightRegion _region;
+  std::string _effectRegion;
+  std::string _effect;
+
+  bool in(const char *root, const char *child = NULL);
+  // the root and lights have to be maps, anything else invalidates the config
+  void notMap();
+  const char* key(uint8_t level) { return _frames[level].key; }
+
+  public:
+    void begin(AmpConfig *config);
+    // false when the root isn't a map or it has no lights map
+    bool isValid() { return _valid && _lights; }
+
+    static MotionConfig defaultMotionConfig();
+    static void logMotionConfig(MotionConfig *config);
+    // sets a motion value by its config key, false for unknown keys
+    static bool setMotion(MotionConfig *config, const char *name, double value);
+
+    void onMap(uint32_t size);
+    void onArray(uint32_t size);
+    void onEnd();
+    void onKey(const char *key);
+    void onString(const char *value, bool truncated);
+    void onNumber(double value);
+    void onBool(bool value);
+    void onNil() { notMap(); }
+};
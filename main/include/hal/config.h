@@ -5,14 +5,16 @@
 #include <map>
 #include <algorithm>
 
-#define ARDUINOJSON_ENABLE_STD_STRING 1
-#include <ArduinoJson.h>
-
 #include <models/light.h>
 #include <models/motion.h>
 #include <models/config.h>
 #include <interfaces/config-listener.h>
 #include <interfaces/lifecycle.h>
+#include <hal/config-image.h>
+#include <hal/config-loader.h>
+#include <msgpack-stream.h>
+#include <config-patch.h>
+#include <config-command.h>
 
 #if defined(AMP_1_0_x)
   #include <hal/amp-1.0.0/amp-storage.h>
@@ -20,27 +22,12 @@
 
 static const char* CONFIG_TAG = "config";
 
-struct MsgPackFileWriter {
-  FILE *_file;
-
-  size_t write(uint8_t c) { return fputc(c, _file); }
-  size_t write(const uint8_t *buffer, size_t length) { return fwrite(buffer, sizeof(uint8_t), length, _file); }
-
-  MsgPackFileWriter(FILE *file) : _file(file) { }
-};
-
-struct MsgPackFileReader {
-  FILE *_file;
-
-  int read() { return fgetc(_file); }
-  size_t readBytes(char* buffer, size_t length) { return fread((void*) buffer, sizeof(uint8_t), length, _file); }
-
-  MsgPackFileReader(FILE *file) : _file(file) { }
-};
+#define CONFIG_READ_CHUNK 256
+#define CONFIG_JOURNAL_MAX 4096   // journal size that triggers a full save
 
 class Config : public LifecycleBase {
-  std::vector<ConfigListener*> configListeners;
   AmpStorage ampStorage;
+  ConfigImage image;
   
   std::string rawConfig;
   std::string renderer;
@@ -48,20 +35,48 @@ class Config : public LifecycleBase {
   bool _filesystemError = false;
   bool _valid = false;
   bool _isUserConfig = false;
+  bool _imageDetached = false;
 
   std::string configPath = "/spiffs/config.mp";
   std::string userConfigPath = "/spiffs/config.user.mp";
+  std::string uploadPath = "/spiffs/config.upload.mp";
+  std::string journalPath = "/spiffs/config.journal";
 
-  JsonObject serializeEffects();
-  static bool parseEffect(std::string data, LightingParameters *params);
-  static ColorOption parseColorOption(std::string data);
-
-  StaticJsonDocument<10000> document;
+  // streaming loader, configs are built into _staged and swapped in once complete
+  MsgPackReader reader;
+  ConfigLoader loader;
+  AmpConfig _staged;
+  FILE *_upload = NULL;
 
-  bool loadConfigFile(std::string path);
+  static ColorOption parseColorOption(std::string data);
+  static std::string formatColorOption(ColorOption option);
+
+  bool loadConfigFile(std::string path, AmpConfig *target);
+  void applyConfig(AmpConfig *staged);
+  static void clearActions(AmpConfig *config);
+  void buildActionTable();
+  void loadImageConfig();
+  void detachImage();
+  void writeConfig(FILE *file);
+
+  // patches, effects, regions and the action table are edited with
+  // effectsUpdating held, readers of the action table take it too
+  // unpersisted effects are previews, they go to ampConfig.previews and
+  // are dropped with the config they were previewed on
+  uint8_t applyPatchOps(PatchReader &reader, bool persist = true);
+  bool putEffect(std::string action, std::string region, std::string data, bool persist);
+  void putEffect(const std::string &action, const LightingParameters &effect, bool persist);
+  const std::string* regionAt(uint8_t index);
+  bool dropEffect(std::string action, std::string region);
+  void putRegion(std::string name, std::vector<LightSection> sections);
+  void appendJournal(const uint8_t *data, size_t length);
+  void replayJournal();
+  void clearJournal();
 
   public:
     static AmpConfig ampConfig;
+    // bumped whenever ampConfig.actionTable is rebuilt
+    static uint32_t actionTableVersion;
     void onPowerUp();
     void onPowerDown();
 
@@ -69,24 +84,36 @@ class Config : public LifecycleBase {
 
     static DeviceInfo getDeviceInfo();
     
-    void loadConfig();
     void saveConfig();
-    void saveUserConfig(std::string data, bool load = false);
 
-    void loadActionConfig(JsonObject actionJson);
-    void loadMotionConfig(JsonObject motionJson);
-    void loadLightsConfig(JsonObject lightsJson);
+    // user configs stream in from BLE, each chunk is parsed and written to
+    // flash as it arrives and the config is only applied once it is complete
+    bool beginUserConfig();
+    bool appendUserConfig(const uint8_t *data, size_t length);
+    bool endUserConfig();
+
     std::string readFile(std::string filename);
     void addConfigListener(ConfigListener *listener);
-    void notifyConfigListeners();
+    void notifyConfigListeners(uint8_t scope = Scope_All);
 
     void updateDeviceName(std::string name);
-    bool addEffect(std::string action, std::string region, std::string data, bool updateJson = false);
-    // void removeEffect(std::string, std::string region, bool updateJson = false);
+    // applies a binary patch (see config-patch.h) to the live config, persist
+    // appends it to the journal instead of rewriting the whole profile
+    bool applyPatch(const uint8_t *data, size_t length, bool persist);
+    // applies a decoded binary command (see config-command.h), saved effects
+    // and removals are journaled like the matching patch ops
+    bool applyCommand(CommandOp op, const EffectCommand &command);
     std::vector<LightingParameters>* getActionEffects(std::string action);
 
+    static bool isAction(std::string action);
+    static bool parseEffect(std::string data, LightingParameters *params);
+    static std::string formatEffect(LightingParameters *params);
+
+    // compiled image in use, actions are looked up in the image instead of ampConfig.actions
+    ConfigImage* getImage() { return image.isMapped() && !_isUserConfig && !_imageDetached ? &image : NULL; }
+
     bool isValid() { return _valid; }
-    std::string getRawConfig() { std::string data; serializeMsgPack(document, data); return data; }
+    std::string getRawConfig();
 
     static FreeRTOS::Semaphore effectsUpdating;
 };
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+static const char* CONNECTION_POLICY_TAG = "connection-policy";
+
+#define BLE_MAX_LINKS             3       // CONFIG_BTDM_CTRL_BLE_MAX_CONN
+#define BLE_PARAMS_SETTLE         2000    // ms after connecting before asking for new parameters
+#define BLE_PARAMS_RETRY          500     // ms before retrying while an update is in progress
+#define BLE_ACTIVITY_HOLD         2000    // ms an activity lasts after its last traffic
+#define BLE_THROUGHPUT_WINDOW     1000    // ms per throughput sample
+#define BLE_DATA_LENGTH           251     // link layer payload with data length extension
+#define BLE_DATA_TIME             2120    // us to send it on the 1M PHY
+
+// NimBLE values the policy works with, checked against NimBLE in ble.cpp
+#define CONNECTION_HANDLE_NONE    0xffff  // BLE_HS_CONN_HANDLE_NONE
+#define CONNECTION_BUSY           2       // BLE_HS_EALREADY, an update is still in progress
+
+// What the link is used for, higher activities win. Each maps to a
+// connection profile: short intervals for bulk transfers, long intervals
+// with slave latency when only telemetry goes out.
+enum BleActivity : uint8_t {
+  Activity_Idle = 0,
+  Activity_Streaming,
+  Activity_Transfer,
+  Activity_Count
+};
+
+struct ConnectionProfile {
+  uint16_t minInterval;     // 1.25 ms units
+  uint16_t maxInterval;
+  uint16_t latency;         // connection events the peripheral may skip
+  uint16_t timeout;         // 10 ms units
+};
+
+// The GAP calls the policy makes, NimBLE return codes
+class ConnectionGap {
+  public:
+    virtual bool isConnected(uint16_t handle) = 0;
+    virtual int setDataLength(uint16_t handle, uint16_t octets, uint16_t time) = 0;
+    virtual int updateParams(uint16_t handle, const ConnectionProfile &profile) = 0;
+};
+
+// Picks connection parameters for what the links are used for. Services
+// report their traffic from any task, links are claimed when they connect
+// and updated from the BLE task. Faster parameters are asked for as soon as
+// the activity rises, slower ones once it has been quiet for the hold.
+class ConnectionPolicy {
+  struct Link {
+    uint16_t handle;
+    unsigned long notBefore;
+    BleActivity applied;
+    bool dataLength;
+  };
+
+  ConnectionGap *_gap;
+  portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+  Link _links[BLE_MAX_LINKS];
+  unsigned long _lastTraffic[Activity_Count] = { 0 };
+  unsigned long _windowStart = 0;
+  uint32_t _windowBytes = 0;
+  uint32_t _throughput = 0;
+
+  BleActivity currentActivity(unsigned long now);
+
+  public:
+    ConnectionPolicy(ConnectionGap *gap);
+
+    // a new link gets parameters for the current activity once it settles,
+    // false when every link is taken
+    bool connected(uint16_t handle, unsigned long now);
+    // true when the activity rose and the links should be updated right away
+    bool traffic(BleActivity activity, size_t bytes, unsigned long now);
+    // sweeps closed links and asks the open ones for the current profile
+    void apply(unsigned long now);
+    // ms until apply() has something to do, -1 when nothing is pending
+    long nextDelay(unsigned long now);
+
+    BleActivity getActivity(unsigned long now);
+    // bytes per second over the last sample, 0 once traffic stopped
+    uint32_t getThroughput(unsigned long now);
+    // the first open link, CONNECTION_HANDLE_NONE without one
+    uint16_t firstLink();
+
+    static const ConnectionProfile& profile(BleActivity activity);
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include "esp_timer.h"
+#include "FreeRTOS.h"
+
+static const char* LATENCY_TELEMETRY_TAG = "latency-telemetry";
+
+// stages of a brake from the IMU sample that triggered it to the LEDs,
+// each is measured from the sample time
+enum LatencyStage : uint8_t {
+  Latency_Detected = 0,   // acceleration detector fired
+  Latency_Overlay,        // brake overlay frame clocked out (fast path)
+  Latency_Received,       // app took the vehicle state from its mailbox
+  Latency_Applied,        // brake effect applied to the lights
+  Latency_Rendered,       // renderer painted the frame
+  Latency_Shown,          // effect frame finished clocking out to the LEDs
+  Latency_StageCount
+};
+
+#define LATENCY_BUCKETS         64
+#define LATENCY_BUCKET_WIDTH    500       // us, the histogram covers 32 ms
+#define LATENCY_TRACE_TIMEOUT   1000000   // us, traces that never reach the LEDs are dropped
+
+struct LatencyStats {
+  uint32_t p50;
+  uint32_t p99;
+  uint32_t max;
+};
+
+// Follows one brake at a time through the pipeline and aggregates the stage
+// latencies into histograms. The app path stages have to be reached in order,
+// the overlay runs on the renderer alongside them. A new brake replaces a
+// trace that is still in flight.
+class LatencyTelemetry {
+  uint32_t _histogram[Latency_StageCount][LATENCY_BUCKETS + 1] = { { 0 } };   // last bucket is overflow
+  uint32_t _max[Latency_StageCount] = { 0 };
+  uint32_t _count = 0;
+
+  // trace in flight
+  bool _tracing = false;
+  unsigned long _sampledAt = 0;
+  uint32_t _trace[Latency_StageCount];
+  uint8_t _recorded = 0;    // bit per stage
+  LatencyStage _next = Latency_Received;
+
+  portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+  void record(LatencyStage stage, uint32_t latency);
+  void complete();
+
+  public:
+    static LatencyTelemetry* instance() { static LatencyTelemetry telemetry; return &telemetry; }
+
+    // starts a trace for a brake sampled and detected at the given micros()
+    void begin(unsigned long sampledAt, unsigned long detectedAt);
+    void mark(LatencyStage stage);
+    bool waitingFor(LatencyStage stage) {
+      return _tracing && !(_recorded & (1 << stage)) && (stage == Latency_Overlay || stage == _next);
+    }
+
+    uint32_t getCount() { return _count; }
+    LatencyStats getStats(LatencyStage stage);
+    void reset();
+    void log();
+};
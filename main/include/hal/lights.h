@@ -11,6 +11,8 @@
 #include <interfaces/ble-listener.h>
 #include <interfaces/calibration-listener.h>
 #include <interfaces/update-listener.h>
+#include <interfaces/park-listener.h>
+#include <interfaces/brake-listener.h>
 #include <models/light.h>
 #include <functional>
 
@@ -20,14 +22,19 @@
 #endif
 
 #include <hal/config.h>
+#include <hal/power-telemetry.h>
+#include <hal/latency-telemetry.h>
+#include <hal/live-stream.h>
 
 #define REFRESH_NEVER   0
+#define RENDERER_PRIORITY 6   // above the app loop, a brake overlay must not wait for it
 
 static const char* LIGHTS_TAG = "lights";
 
 class Lights : public LifecycleBase,
   public PowerListener, public TouchListener, public ConfigListener, 
-  public CalibrationListener, public UpdateListener, public BleListener {
+  public CalibrationListener, public UpdateListener, public BleListener,
+  public ParkListener, public BrakeListener {
 
   AmpLeds leds;
   LightsConfig *lightsConfig;
@@ -45,11 +52,52 @@ class Lights : public LifecycleBase,
   bool advertisingToggle = false;
   TaskHandle_t advertisingLightHandle;
 
+  bool parked = false;
+
+  // brake overlay, the brake action's pixels resolved per config so the
+  // renderer can push them out ahead of the compositor
+  struct OverlaySpan {
+    uint8_t channel;
+    uint16_t start;
+    uint16_t end;
+    Color color;
+  };
+
+  std::vector<OverlaySpan> _brakeOverlay;
+  uint32_t _brakeOverlayVersion = 0;
+  volatile bool _brakeOverlayPending = false;
+  volatile bool _brakeOverlayActive = false;
+
+  void buildBrakeOverlay();
+  void paintBrakeOverlay();
+
+  // live stream from the app, it owns its region while active. Requests come
+  // from BLE, the stream is started and ended on the renderer
+  LiveStream _stream;
+  std::string _streamRegion;
+  uint8_t _streamRequest[3];            // region index, fps, depth
+  volatile bool _streamStarting = false;
+  volatile bool _streamStopping = false;
+
+  void beginStream();
+  void endStream();
+  void paintStream(const uint8_t *pixels);
+
+  // effects are applied from the app task and rendered on the renderer,
+  // both maps are only touched with effectsLock held. Other tasks ask the
+  // renderer to restart the steps instead of taking the lock.
   std::map<std::string, LightingParameters> _effects;
   std::map<std::string, RenderStep> _steps;
+  FreeRTOS::Semaphore effectsLock = FreeRTOS::Semaphore("lights");
+  volatile bool _restartPending = false;
+
+  void restartSteps();
   std::map<std::string, uint32_t> _pixelCounts;
+  std::map<uint8_t, LightChannel> _appliedChannels;
 
   static void renderer(void *args);
+  void wakeRenderer();
+  TickType_t nextRenderDelay();
   void renderLightingEffect(LightingParameters *params, RenderStep *step);
   void color(LightingParameters *params, RenderStep *step);
   void blink(LightingParameters *params, RenderStep *step);
@@ -65,16 +113,17 @@ class Lights : public LifecycleBase,
   void twinkle(LightingParameters *params, RenderStep *step);
   void sparkle(LightingParameters *params, RenderStep *step);
 
-  TaskHandle_t renderHandle;
+  TaskHandle_t renderHandle = NULL;
 
   unsigned long _lastRender = millis();
 
-  void setRegionPixel(std::string regionName, uint32_t index, Color pixel);
-  Color getRegionPixel(std::string regionName, uint32_t index);
+  // NULL for a region the config doesn't have, never adds one
+  const LightRegion* findRegion(const std::string &name);
+  void setRegionPixel(const std::string &regionName, uint32_t index, Color pixel);
+  Color getRegionPixel(const std::string &regionName, uint32_t index);
   Color blend(Color first, Color second, float weight);
 
-  void startEffect(LightingParameters parameters);
-  void endEffect(LightingParameters parameters);
+  void startEffect(const LightingParameters &parameters);
 
   Color getStepColor(RenderStep *step, ColorOption option);
 
@@ -92,12 +141,12 @@ class Lights : public LifecycleBase,
     void updateLightForPowerStatus(PowerStatus status);
 
     // TouchListener
-    void onTouchEvent(std::vector<TouchType> *touches) { }
+    void onTouchEvent(TouchSequence touches) { }
     void onTouchDown();
     void onTouchUp();
 
     // ConfigListener
-    void onConfigUpdated();
+    void onConfigUpdated(uint8_t scope);
 
     // CalibrationListener
     void onCalibrateXGStarted();
@@ -112,6 +161,13 @@ class Lights : public LifecycleBase,
     void onAdvertisingStarted();
     void onAdvertisingStopped();
 
+    // ParkListener
+    void onParked();
+    void onUnparked();
+
+    // BrakeListener
+    void onBraking(bool braking);
+
     void process();
 
     uint16_t getLEDCountForChannel(uint8_t channel);
@@ -121,8 +177,8 @@ class Lights : public LifecycleBase,
 
     void setStatus(Color color);
 
-    void colorRegion(std::string regionName, Color color);
-    void colorRegionSection(std::string regionName, uint8_t section, Color color);
+    void colorRegion(const std::string &regionName, Color color);
+    void colorRegionSection(const std::string &regionName, uint8_t section, Color color);
     void colorLEDs(uint8_t channel, uint16_t led, uint16_t count, Color color);
     void render(bool all = false, int8_t channel = -1);
 
@@ -133,10 +189,19 @@ class Lights : public LifecycleBase,
     static void startUpdateLight(void *params);
     static void startAdvertisingLight(void *params);
 
-    void applyEffect(LightingParameters parameters);
+    void applyEffect(const LightingParameters &parameters);
+    void releaseBrakeOverlay() { _brakeOverlayActive = false; }
+
+    // region is an index in name order, as listed by get:config
+    bool startStream(uint8_t region, uint8_t fps, uint8_t depth);
+    void stopStream();
+    void streamFrame(const uint8_t *data, size_t length);
+    bool isStreaming() { return _stream.isActive(); }
+    StreamStats getStreamStats() { return _stream.getStats(); }
 
     static std::map<Actions, std::string> headlightActions;
     static std::map<Actions, std::string> motionActions;
     static std::map<Actions, std::string> turnActions;
     static std::map<Actions, std::string> orientationActions;
+    static const char* getActionName(ActionGroup group, Actions action);
 };
\ No newline at end of file
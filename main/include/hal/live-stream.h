@@ -0,0 +1,119 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+// Pixel frames streamed from the app for one region. Frames are decoded as
+// they arrive on top of the previous frame, so the app only sends what
+// changed, and played out at the stream's frame rate from a jitter buffer a
+// few frames deep.
+//
+// A fragment is a header followed by pixels from start:
+//   seq u16, flags u8 (encoding in bits 0 - 1, STREAM_FRAME_KEY, STREAM_FRAME_END), start u16
+//
+//   Stream_Raw      r, g, b per pixel
+//   Stream_Rle      runs of count u8 + r, g, b, a count with bit 7 set skips that many pixels
+//   Stream_Palette  size u8, size * r, g, b, then an index per pixel, 0xff skips the pixel
+//
+// Deltas need every frame before them, after a lost frame nothing is shown
+// until the next key frame.
+
+#define STREAM_MAX_PIXELS   600
+#define STREAM_MAX_DEPTH    6
+#define STREAM_SLOTS        (STREAM_MAX_DEPTH + 2)   // buffered, showing and filling
+#define STREAM_HEADER       5
+#define STREAM_TIMEOUT      1000                      // ms without frames ends a stream
+
+#define STREAM_ENCODING     0x03
+#define STREAM_FRAME_KEY    0x40
+#define STREAM_FRAME_END    0x80
+#define STREAM_RLE_SKIP     0x80
+#define STREAM_PALETTE_SKIP 0xff
+
+enum StreamEncoding : uint8_t {
+  Stream_Raw = 0,
+  Stream_Rle,
+  Stream_Palette
+};
+
+struct StreamStats {
+  uint32_t shown;
+  uint32_t dropped;       // lost, undecodable or pushed out of a full buffer
+  uint32_t late;          // arrived after a newer frame was shown
+  uint16_t fps;           // frames shown in the last second, times 10
+  uint16_t latency;       // ms from the first fragment to the frame going out, average
+  uint16_t latencyMax;
+};
+
+class LiveStream {
+  enum SlotState : uint8_t {
+    Slot_Free = 0,
+    Slot_Filling,
+    Slot_Ready,
+    Slot_Showing
+  };
+
+  struct Slot {
+    uint8_t *pixels;
+    uint16_t seq;
+    unsigned long receivedAt;
+    SlotState state;
+  };
+
+  portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+  uint8_t *_buffer = NULL;
+  Slot _slots[STREAM_SLOTS];
+  uint16_t _pixels = 0;
+  uint8_t _depth = 0;
+  uint8_t _fps = 0;
+  volatile bool _active = false;
+  volatile bool _receiving = false;     // end() waits for a fragment in progress
+
+  // receiving, only touched by the writer
+  int8_t _filling = -1;
+  int8_t _base = -1;                    // last complete frame, what deltas apply to
+  bool _synced = false;
+  uint16_t _nextSeq = 0;
+  uint16_t _skipSeq = 0;
+  bool _skipping = false;
+  volatile unsigned long _lastReceived = 0;
+
+  // playout
+  bool _playing = false;
+  uint16_t _seqStart = 0;
+  unsigned long _playoutStart = 0;
+  bool _hasShown = false;
+  uint16_t _lastShown = 0;
+  int8_t _showing = -1;
+
+  StreamStats _stats;
+  unsigned long _fpsWindow = 0;
+  uint16_t _fpsFrames = 0;
+  uint32_t _latencyTotal = 0;
+
+  // frame times from the sequence, whole ms intervals would drift off the app's clock
+  unsigned long playoutTime(uint16_t seq) { return _playoutStart + (int32_t)(int16_t)(seq - _seqStart) * 1000 / _fps; }
+  unsigned long bufferTime() { return _depth * 1000 / _fps; }
+  int8_t acquireSlot();
+  bool receiveFragment(const uint8_t *data, size_t length, unsigned long now);
+  bool decode(uint8_t *pixels, uint8_t encoding, uint16_t start, const uint8_t *data, size_t length);
+
+  public:
+    // both on the renderer, end() can be called while fragments arrive
+    bool begin(uint16_t pixels, uint8_t fps, uint8_t depth, unsigned long now);
+    void end();
+    bool isActive() { return _active; }
+    uint16_t getPixelCount() { return _pixels; }
+
+    // writer side, one fragment from BLE, false when it was dropped
+    bool receive(const uint8_t *data, size_t length, unsigned long now);
+
+    // renderer side, the frame to show now (NULL for none) and when the next
+    // one is due (0 when nothing is buffered)
+    const uint8_t* due(unsigned long now);
+    void shown(unsigned long now);
+    unsigned long nextDue();
+    bool isTimedOut(unsigned long now) { return now - _lastReceived > STREAM_TIMEOUT; }
+
+    StreamStats getStats();
+};
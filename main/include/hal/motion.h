@@ -8,16 +8,23 @@
 // #define LOG_MOTION_AHRS_COMPENSATED
 // #define LOG_SAMPLE_RATE
 
-// #define USE_MADGWICK_FILTER
-
 #include <common.h>
 #include <interfaces/lifecycle.h>
 #include <interfaces/power-listener.h>
 #include <interfaces/config-listener.h>
 #include <interfaces/motion-listener.h>
 #include <interfaces/calibration-listener.h>
+#include <interfaces/park-listener.h>
+#include <interfaces/brake-listener.h>
 #include <models/motion.h>
 #include <models/control.h>
+#include <filters/ahrs.h>
+#include <filters/tilt-estimator.h>
+#include <filters/acceleration-detector.h>
+#include <filters/orientation-classifier.h>
+#include <hal/power-telemetry.h>
+#include <hal/latency-telemetry.h>
+#include <hal/sensor-stream.h>
 #include "FreeRTOS.h"
 
 #if defined(AMP_1_0_x)
@@ -28,28 +35,27 @@
 #include <hal/power.h>
 #include <hal/config.h>
 
-#if defined(USE_MADGWICK_FILTER)
-  #include <filters/madgwick.h>
-#elif defined(USE_SIMPLE_AHRS_FILTER)
-  #include <filters/simple-ahrs.h>
-#endif
-
 static const char* MOTION_TAG = "motion";
 
+#define MOTION_PARKED_POLL 100    // ms, latched activity source poll while parked (INT1 is not routed)
+#define MOTION_PARK_ACTIVITY 0.05f  // g of linear acceleration that counts as activity
+#define ORIENTATION_CONFIDENCE_BAND 10  // % below the minimum confidence before a confident side is released
+#define TURN_ZERO_SETTLE 1000     // ms of samples the estimators get after a new bias before the turn center is taken
+#define MOTION_PRIORITY 4         // above ble-server and ota-writer on core 0, detected brakes can't queue behind them
+
 class Motion : public LifecycleBase, public PowerListener, public ConfigListener {
   std::vector<MotionListener*> motionListeners;
-  std::vector<CalibrationListener*> calibrationListeners;
+  BrakeListener *brakeListener = NULL;
 
   Vector3D rawAccel, rawGyro, rawMag;
   Vector3D linearAcceleration, gravity, absoluteGravity, attitude;
   Vector3D accelBias, gyroBias, magBias;
   IMUState imuState = IMUState::IMU_Disabled;
   static AmpIMU ampIMU;
-#if defined(USE_MADGWICK_FILTER)
-  Madgwick *filter = nullptr;
-#elif defined(USE_SIMPLE_AHRS_FILTER)
-  SimpleAHRS *filter = nullptr;
-#endif
+  Ahrs filter;
+  TiltEstimator tilt;
+  AccelerationDetector accelerationDetector;
+  OrientationClassifier orientationClassifier;
 
   float _sampleRate = 0;
 
@@ -59,11 +65,13 @@ class Motion : public LifecycleBase, public PowerListener, public ConfigListener
 
   // turn center
   float _turnZero = 0.0f;
+  const float TURN_ZERO_TIME_CONSTANT = 10.0f;  // seconds
 
   // calibrations
   bool _calibrating = false;
 
   VehicleState _vehicleState;
+  bool _orientationConfident = true;
 
   AccelerationAxis _motionAxis;
   AttitudeAxis _turnAxis;
@@ -73,12 +81,16 @@ class Motion : public LifecycleBase, public PowerListener, public ConfigListener
   float _brakeThreshold, _accelerationThreshold, _turnThreshold, _turnCenter;
   bool _enabled = false;
 
+  // parking
+  bool _parked = false;
+  unsigned long _lastActivity = 0;
+  void updateParking();
+  void park();
+  void unpark();
+
   unsigned long _lastUpdate = micros();
   unsigned long _lastSample = micros();
-
-  unsigned long _lastMotionUpdate = millis();
-  const unsigned long MOTION_DEBOUNCE = 100;
-  const unsigned long MOTION_ACTIVE_DEBOUNCE = 1000;
+  float _sampleInterval = 0.0f;
 
   // update config
   void updateGravityFilter(float alpha);
@@ -90,12 +102,13 @@ class Motion : public LifecycleBase, public PowerListener, public ConfigListener
   float getAccelerationFromAxis(AccelerationAxis axis);
   float getAttitudeFromAxis(AttitudeAxis axis);
   TaskHandle_t samplerHandle = NULL;
+  SensorStream _sensorStream;
 
   void calibrateXG();
   void calibrateMag();
+  void wakeSampler();
 
   public:
-    static QueueHandle_t calibrationRequestQueue;
     static FreeRTOS::Semaphore holdInterface;
     Motion();
 
@@ -108,7 +121,7 @@ class Motion : public LifecycleBase, public PowerListener, public ConfigListener
     void updateMotionForPowerStatus(PowerStatus status);
 
     // config listener
-    void onConfigUpdated();
+    void onConfigUpdated(uint8_t scope);
 
     // register listeners
     void addMotionListener(MotionListener *listener);
@@ -116,6 +129,13 @@ class Motion : public LifecycleBase, public PowerListener, public ConfigListener
     void notifyMotionListeners();
 
     void addCalibrationListener(CalibrationListener *listener);
+    void notifyCalibrationListeners(EventType type, CalibrationState state);
+
+    void addParkListener(ParkListener *listener);
+    // brakes skip the mailboxes and go straight to this listener
+    void setBrakeListener(BrakeListener *listener) { brakeListener = listener; }
+    bool isParked() { return _parked; }
+    SensorStream* getSensorStream() { return &_sensorStream; }
     void process();
     void sample();
 
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include "esp_timer.h"
+#include "FreeRTOS.h"
+
+static const char* POWER_TELEMETRY_TAG = "power-telemetry";
+
+#define POWER_IDLE_WAIT 500   // ms, a consumer blocking for less than this keeps the board awake
+
+enum SleepState : uint8_t {
+  Sleep_Awake = 0,    // a consumer wakes periodically (animated lights, motion sampling, streams)
+  Sleep_Idle,         // every consumer is blocked on events or long waits, light sleep is possible
+  Sleep_Parked,       // board is parked with the sensors in low power
+  Sleep_StateCount
+};
+
+enum PowerConsumer : uint8_t {
+  Consumer_Renderer = 0,
+  Consumer_Motion,
+  Consumer_App,
+  Consumer_Ble,
+  Consumer_Buttons
+};
+
+// Accounts the time spent in each sleep state. Every task loop reports whether
+// it currently needs periodic wakeups, the board is idle and eligible for
+// automatic light sleep when none of them do. This is eligible time, not time
+// actually asleep: radio events and interrupts still wake the CPU, the time
+// spent in each power management mode is dumped with CONFIG_PM_PROFILING.
+class PowerTelemetry {
+  int64_t _timeInState[Sleep_StateCount] = { 0 };
+  int64_t _enteredAt = 0;
+  SleepState _state = Sleep_Awake;
+  uint32_t _busy = 0;
+  bool _parked = false;
+  portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+  void update();
+
+  public:
+    static PowerTelemetry* instance() { static PowerTelemetry telemetry; return &telemetry; }
+
+    void setBusy(PowerConsumer consumer, bool busy);
+    // busy when the consumer is about to block for less than POWER_IDLE_WAIT
+    void setWait(PowerConsumer consumer, TickType_t wait) { setBusy(consumer, wait < pdMS_TO_TICKS(POWER_IDLE_WAIT)); }
+    void setParked(bool parked);
+
+    SleepState getState() { return _state; }
+    // microseconds spent in the state, including the current stay
+    int64_t getTimeInState(SleepState state);
+    void log();
+};
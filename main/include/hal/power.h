@@ -11,6 +11,9 @@
 #define BATTERY_LOW 5
 #define BATTERY_CHARGED 95
 
+// battery / charger polling interval, the app loop otherwise only wakes for events
+#define POWER_POLL_INTERVAL 1000  // ms
+
 #if defined(AMP_1_0_x)
   #include <hal/amp-1.0.0/amp-power.h>
 #endif
@@ -18,9 +21,7 @@
 static const char* POWER_TAG = "power";
 
 class Power : public LifecycleBase, public TouchListener {
-  std::vector<PowerListener*> powerLevelListeners;
   std::vector<LifecycleBase*> lifecycleListeners;
-  std::vector<TouchType> touches;
   PowerStatus status;
   AmpPower ampPower;
   bool restartNext = false;
@@ -35,7 +36,7 @@ class Power : public LifecycleBase, public TouchListener {
     void onPowerDown();
     void process();
 
-    void onTouchEvent(std::vector<TouchType> *touches);
+    void onTouchEvent(TouchSequence touches);
     void shutdown(bool restart = false);
 
     void addPowerLevelListener(PowerListener *listener);
@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <models/motion.h>
+#include "FreeRTOS.h"
+
+#define SENSOR_STREAM_MAX_RATE    50      // Hz, the accelerometer's output data rate
+#define SENSOR_STREAM_SAMPLES     64      // ring size, a power of two
+#define SENSOR_ACCEL_SCALE        4096    // int16 per g, +-8 g
+#define SENSOR_ATTITUDE_SCALE     100     // int16 per degree
+
+struct SensorSample {
+  uint32_t time;          // micros()
+  int16_t values[9];      // linear acceleration, gravity, attitude xyz
+};
+
+// Hands motion samples from the sampler to a reader task. The sampler only
+// quantizes and stores a sample at the stream rate, everything else (packing,
+// notifying) happens on the reader, which is woken once a batch is waiting.
+// Single producer, single consumer.
+class SensorStream {
+  SensorSample _ring[SENSOR_STREAM_SAMPLES];
+  std::atomic<uint16_t> _head{0};         // written by the sampler
+  std::atomic<uint16_t> _tail{0};         // written by the reader
+
+  std::atomic<uint32_t> _period{0};       // us between samples, 0 when stopped
+  uint32_t _lastPushed = 0;
+  uint16_t _batch = 1;
+  uint32_t _overruns = 0;
+  TaskHandle_t _reader = NULL;
+
+  public:
+    // reader side
+    bool start(uint8_t rate, uint16_t batch, TaskHandle_t reader);
+    void stop() { _period.store(0, std::memory_order_release); }
+    bool isActive() { return _period.load(std::memory_order_acquire) != 0; }
+    uint16_t available() { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_relaxed); }
+    bool pop(SensorSample &sample);
+    uint32_t getOverruns() { return _overruns; }
+
+    // sampler side, called for every processed IMU sample
+    void push(unsigned long time, const Vector3D &linearAcceleration, const Vector3D &gravity, const Vector3D &attitude);
+};
@@ -2,28 +2,135 @@
 #include <common.h>
 #include "esp_ota_ops.h"
 #include "esp_system.h"
+#include "esp_spi_flash.h"
+#include "esp32/rom/miniz.h"
+#include "freertos/stream_buffer.h"
+#include <delta-patch.h>
 #include <vector>
 #include "interfaces/update-listener.h"
 
+#if defined(AMP_1_0_x)
+  #include <hal/amp-1.0.0/amp-storage.h>
+#endif
+
 static const char* UPDATER_TAG = "ota";
 
+#define UPDATE_BUFFER_SIZE      (4 * SPI_FLASH_SEC_SIZE)  // received data waiting for flash
+#define UPDATE_INPUT_CHUNK      1024                      // bytes the writer takes from the buffer at once
+#define UPDATE_WRITE_TIMEOUT    1000                      // ms a BLE write may wait for buffer space
+#define UPDATE_WRITER_POLL      50                        // ms, writer checks for the end of the update
+#define UPDATE_NOTIFY_BYTES     (16 * 1024)               // progress between Write status updates
+#define UPDATE_CHECKPOINT_BYTES (64 * 1024)               // progress between resume checkpoints
+#define UPDATE_ABORT_TIMEOUT    2000                      // ms to wait for the writer of a replaced update
+#define UPDATE_CHECKPOINT_KEY   "ota-resume"
+
+// compressed images and deltas start with a little endian header followed by
+// a zlib stream, anything else is written as is (app images start with 0xE9)
+#define UPDATE_DEFLATE_MAGIC    0x5A504D41                // "AMPZ"
+#define UPDATE_DELTA_MAGIC      0x44504D41                // "AMPD"
+#define UPDATE_MAGIC_SIZE       4
+#define UPDATE_DEFLATE_HEADER   8                         // magic, image size
+#define UPDATE_DELTA_HEADER     16                        // magic, image size, source size, source crc32
+
+// raw images are checkpointed to NVS so a transfer can resume after a reset,
+// the received stream is the partition contents up to offset
+struct UpdateCheckpoint {
+  uint32_t size;        // size and crc of the transfer identify the update
+  uint32_t crc;
+  uint32_t offset;      // written to flash, a sector boundary
+  uint32_t streamCrc;   // crc of the first offset bytes
+};
+
+enum UpdateFormat : uint8_t {
+  Update_Unknown = 0,   // waiting for the header
+  Update_Raw,
+  Update_Deflate,
+  Update_Delta
+};
+
+// Streams an update into the OTA partition. BLE writes only copy into a
+// ring buffer, a writer task drains it so erasing and writing overlaps with
+// reception. Raw images are written a flash sector at a time, compressed
+// ones are inflated through a 32 KB window with the ROM tinfl. Deltas are
+// inflated the same way and patched against the running partition, which is
+// mapped rather than read into memory.
+//
+// The partition is erased a sector at a time just ahead of the writes instead
+// of up front, and the image is verified when it is made the boot partition.
 class Updater {
-  std::vector<UpdateListener*> updateListeners;
   UpdateStatus status;
 
   const esp_partition_t *updatePartition;
-  esp_ota_handle_t updateHandle;
   uint16_t updatePacketsCount;
   size_t dataLength;
 
+  // transfer size and crc32, 0 when the sender doesn't announce them
+  uint32_t _size = 0;
+  uint32_t _crc = 0;
+  uint32_t _streamCrc = 0;
+  size_t _consumed = 0;
+
+  StreamBufferHandle_t _buffer = NULL;
+  TaskHandle_t _writerHandle = NULL;
+  volatile bool _ending = false;
+
+  UpdateFormat _format = Update_Unknown;
+  uint8_t _header[UPDATE_DELTA_HEADER];
+  uint8_t _headerLength = 0;
+
+  // raw and patched images
+  uint8_t *_sector = NULL;
+  size_t _sectorFilled = 0;
+
+  // compressed images, only allocated while inflating
+  tinfl_decompressor *_inflator = NULL;
+  uint8_t *_window = NULL;
+  size_t _windowFilled = 0;
+  uint32_t _imageSize = 0;
+  bool _inflated = false;
+
+  // deltas, the source is the running firmware
+  DeltaPatcher _patcher;
+  const uint8_t *_source = NULL;
+  spi_flash_mmap_handle_t _sourceHandle;
+
+  // progress, written is what reached flash
+  volatile size_t _written = 0;
+  size_t _erasedTo = 0;
+  size_t _checkpointAt = 0;
+  size_t _notifiedAt = 0;
+  int64_t _startedAt = 0;
+  volatile uint32_t _throughput = 0;   // KB/s
+
+  static void writer(void *parameters);
+  bool consume(const uint8_t *data, size_t length);
+  bool consumeHeader(const uint8_t *data, size_t length, size_t *used);
+  bool beginInflate();
+  bool beginDelta(uint32_t sourceSize, uint32_t sourceCrc);
+  bool consumeRaw(const uint8_t *data, size_t length);
+  bool inflate(const uint8_t *data, size_t length);
+  bool inflated(const uint8_t *data, size_t length);
+  bool patch(const uint8_t *data, size_t length);
+  bool flush();
+  bool writeFlash(const uint8_t *data, size_t length);
+  void finishUpdate();
+  bool abortUpdate();
+  bool resumeCheckpoint();
+  void saveCheckpoint();
+  void releaseBuffers();
   void notifyUpdateListeners();
 
   public:
     static Updater* instance() { static Updater updater; return &updater; }
 
-    void startUpdate();
+    // starts or resumes an update, returns the offset the sender continues at
+    uint32_t startUpdate(uint32_t size = 0, uint32_t crc = 0);
     void endUpdate();
-    void writeUpdate(std::string data);
+    void writeUpdate(const uint8_t *data, size_t length);
+
+    UpdateStatus getStatus() { return status; }
+    size_t getBytesWritten() { return _written; }
+    uint32_t getThroughput() { return _throughput; }
 
     void addUpdateListener(UpdateListener *listener);
-};
\ No newline at end of file
+};
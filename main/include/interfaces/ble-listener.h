@@ -1,10 +1,8 @@
 #pragma once
-#include "FreeRTOS.h"
+#include <event-bus.h>
 
-class BleListener {
+class BleListener : public virtual EventSubscriber {
   public:
-    QueueHandle_t advertisingQueue = NULL;
-
     virtual void onAdvertisingStarted() = 0;
     virtual void onAdvertisingStopped() = 0;
 };
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+
+// Called straight from the motion task whenever the acceleration state moves
+// into or out of braking, ahead of the vehicle state reaching the app.
+// Implementations must not block.
+class BrakeListener {
+  public:
+    virtual void onBraking(bool braking) = 0;
+};
@@ -1,11 +1,8 @@
 #pragma once
-#include "FreeRTOS.h"
+#include <event-bus.h>
 
-class CalibrationListener {
+class CalibrationListener : public virtual EventSubscriber {
   public:
-    QueueHandle_t calibrateXGQueue = NULL;
-    QueueHandle_t calibrateMagQueue = NULL;
-    
     virtual void onCalibrateXGStarted() = 0;
     virtual void onCalibrateXGEnded() = 0;
 
@@ -1,9 +1,9 @@
 #pragma once
 #include <models/config.h>
-#include "FreeRTOS.h"
+#include <event-bus.h>
 
-class ConfigListener {
+class ConfigListener : public virtual EventSubscriber {
   public:
-    QueueHandle_t configUpdatedQueue = NULL;
-    virtual void onConfigUpdated() = 0;
+    // scope is a mask of the ConfigScope parts that changed
+    virtual void onConfigUpdated(uint8_t scope) = 0;
 };
\ No newline at end of file
@@ -1,8 +1,9 @@
 #pragma once
 #include <models/motion.h>
+#include <mailbox.h>
 #include "FreeRTOS.h"
 
 class MotionListener {  
   public:
-    QueueHandle_t vehicleQueue = NULL;
+    Mailbox<VehicleState> vehicleMailbox;
 };
\ No newline at end of file
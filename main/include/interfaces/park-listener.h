@@ -0,0 +1,8 @@
+#pragma once
+#include <event-bus.h>
+
+class ParkListener : public virtual EventSubscriber {
+  public:
+    virtual void onParked() = 0;
+    virtual void onUnparked() = 0;
+};
\ No newline at end of file
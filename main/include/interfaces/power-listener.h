@@ -1,13 +1,11 @@
 #pragma once
 #include <models/power-status.h>
-#include "FreeRTOS.h"
+#include <event-bus.h>
 
-class PowerListener {
+class PowerListener : public virtual EventSubscriber {
   protected:
     PowerStatus _powerStatus;
 
   public:
-    QueueHandle_t powerStatusQueue = NULL;
-    
     virtual void onPowerStatusChanged(PowerStatus status) = 0;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <models/light.h>
+#include <event-bus.h>
 
 class RenderHost {    
   public:
@@ -9,8 +10,7 @@ class RenderHost {
     virtual void setOrientationLights(Actions command) = 0;
 };
 
-class RenderListener {
+class RenderListener : public virtual EventSubscriber {
   public:
-    QueueHandle_t lightsChangedQueue = NULL;
     virtual void onLightsChanged(LightCommands commands) = 0;
 };
\ No newline at end of file
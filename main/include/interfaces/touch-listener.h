@@ -1,12 +1,9 @@
 #pragma once
 #include <vector>
 #include <models/touch-type.h>
+#include <event-bus.h>
 
-class TouchListener {
-  public:
-    QueueHandle_t touchQueue = NULL;
-    QueueHandle_t touchEventQueue = NULL;
-};
+class TouchListener : public virtual EventSubscriber { };
 
 class TouchTaskListener {
   public:
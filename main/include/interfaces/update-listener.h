@@ -1,13 +1,11 @@
 #pragma once
 #include <models/update-status.h>
-#include "FreeRTOS.h"
+#include <event-bus.h>
 
-class UpdateListener {
+class UpdateListener : public virtual EventSubscriber {
   protected:
     UpdateStatus _updateStatus;
     
   public:
-    QueueHandle_t updateStatusQueue = NULL;
-
     virtual void onUpdateStatusChanged(UpdateStatus status) = 0;
 };
\ No newline at end of file
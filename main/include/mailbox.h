@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include "FreeRTOS.h"
+
+// Latest value mailbox. Writers overwrite the slot under a seqlock, readers
+// copy the newest value in O(1) and never see stale states queued behind it.
+// The sequence is odd while a write is in progress; readers retry when the
+// sequence moved underneath them. Writers are serialized with a spinlock so
+// tasks on both cores can post. An optional reader task is woken with a task
+// notification on every post.
+//
+// T must be a plain value type (no owned pointers).
+template <typename T>
+class Mailbox {
+  T _value;
+  std::atomic<uint32_t> _sequence{0};
+  uint32_t _taken = 0;
+  portMUX_TYPE _writeLock = portMUX_INITIALIZER_UNLOCKED;
+  TaskHandle_t _reader = NULL;
+
+  public:
+    // task notified on every post, NULL to disable
+    void setReader(TaskHandle_t reader) { _reader = reader; }
+
+    void post(const T &value) {
+      portENTER_CRITICAL(&_writeLock);
+      uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+      _sequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      _value = value;
+
+      _sequence.store(sequence + 2, std::memory_order_release);
+      portEXIT_CRITICAL(&_writeLock);
+
+      if (_reader != NULL)
+        xTaskNotifyGive(_reader);
+    }
+
+    // copies the newest value, false when nothing has been posted yet
+    bool peek(T &value) {
+      uint32_t before, after;
+
+      for (;;) {
+        before = _sequence.load(std::memory_order_acquire);
+        if (before & 1)
+          continue;
+
+        value = _value;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        after = _sequence.load(std::memory_order_relaxed);
+        if (before == after)
+          break;
+      }
+
+      return before != 0;
+    }
+
+    // copies the newest value only if it was posted since the last take.
+    // single consumer, every reader of a shared mailbox should use peek().
+    bool take(T &value) {
+      if (_sequence.load(std::memory_order_acquire) == _taken)
+        return false;
+
+      T newest;
+      uint32_t sequence;
+
+      for (;;) {
+        sequence = _sequence.load(std::memory_order_acquire);
+        if (sequence & 1)
+          continue;
+
+        newest = _value;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (sequence == _sequence.load(std::memory_order_relaxed))
+          break;
+      }
+
+      _taken = sequence;
+      value = newest;
+      return true;
+    }
+
+    bool pending() { return _sequence.load(std::memory_order_acquire) != _taken; }
+};
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+// parts of the config an update touched, subscribers only redo their part
+enum ConfigScope : uint8_t {
+  Scope_Motion = 1 << 0,    // ampConfig.motion
+  Scope_Lights = 1 << 1,    // channels and regions
+  Scope_Actions = 1 << 2,   // effects assigned to actions
+  Scope_All = Scope_Motion | Scope_Lights | Scope_Actions
+};
+
+struct ConfigChange {
+  bool valid;
+  uint8_t scope;
+};
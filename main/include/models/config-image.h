@@ -0,0 +1,105 @@
+#pragma once
+#include <stdint.h>
+#include <models/light.h>
+
+// Compiled configuration image, produced by compile_config.py and flashed
+// to the "config" partition. Every table is a packed array at a 4 byte
+// aligned offset from the start of the image so the firmware can use it in
+// place from memory mapped flash. All values are little endian.
+
+#define CONFIG_IMAGE_MAGIC    0x43504D41  // "AMPC"
+#define CONFIG_IMAGE_VERSION  1
+#define CONFIG_IMAGE_SUBTYPE  0x9A        // data partition subtype
+
+// motion flags
+#define CONFIG_IMAGE_AUTO_ORIENTATION   (1 << 0)
+#define CONFIG_IMAGE_AUTO_MOTION        (1 << 1)
+#define CONFIG_IMAGE_AUTO_TURN          (1 << 2)
+#define CONFIG_IMAGE_RELATIVE_TURN_ZERO (1 << 3)
+
+// color option flags, shifted by 2 for the second color
+#define CONFIG_IMAGE_COLOR_RANDOM   (1 << 0)
+#define CONFIG_IMAGE_COLOR_RAINBOW  (1 << 1)
+
+struct __attribute__((packed)) ConfigImageHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerSize;
+  uint32_t size;            // whole image, header included
+  uint32_t crc;             // crc32 of everything after the header
+  uint16_t channelCount;
+  uint16_t regionCount;
+  uint16_t sectionCount;
+  uint16_t effectCount;
+  uint32_t motionOffset;
+  uint32_t channelsOffset;
+  uint32_t regionsOffset;
+  uint32_t sectionsOffset;
+  uint32_t actionsOffset;   // Group_Count * ACTION_COUNT entries, indexed by group and Actions value
+  uint32_t effectsOffset;
+  uint32_t stringsOffset;   // null terminated region names
+};
+
+struct __attribute__((packed)) ConfigImageMotion {
+  uint8_t flags;
+  uint8_t motionAxis;
+  uint8_t turnAxis;
+  uint8_t orientationTrigger;
+  uint8_t ahrsFilter;
+  uint8_t orientationMinConfidence;
+  uint16_t motionDwell;
+  uint16_t motionMaxLatency;
+  uint16_t orientationDwell;
+  uint32_t parkTimeout;
+  float turnThreshold;
+  float brakeThreshold;
+  float accelerationThreshold;
+  float brakeJerkThreshold;
+  float orientationUpMin;
+  float orientationUpMax;
+};
+
+struct __attribute__((packed)) ConfigImageChannel {
+  uint8_t channel;
+  uint8_t type;
+  uint16_t leds;
+};
+
+struct __attribute__((packed)) ConfigImageRegion {
+  uint16_t name;            // offset into the string table
+  uint16_t firstSection;
+  uint16_t sectionCount;
+  uint16_t count;           // leds in the region
+};
+
+struct __attribute__((packed)) ConfigImageSection {
+  uint8_t channel;
+  uint8_t reserved;
+  uint16_t start;
+  uint16_t end;
+  uint16_t reserved2;
+};
+
+struct __attribute__((packed)) ConfigImageAction {
+  uint16_t firstEffect;
+  uint16_t effectCount;
+};
+
+struct __attribute__((packed)) ConfigImageEffect {
+  uint8_t region;           // index into the region table
+  uint8_t effect;           // LightEffect
+  uint8_t layer;
+  uint8_t colorFlags;
+  uint8_t first[3];
+  uint8_t second[3];
+  uint16_t reserved;
+  uint32_t duration;
+};
+
+static_assert(sizeof(ConfigImageHeader) == 52, "config image header layout");
+static_assert(sizeof(ConfigImageMotion) == 40, "config image motion layout");
+static_assert(sizeof(ConfigImageChannel) == 4, "config image channel layout");
+static_assert(sizeof(ConfigImageRegion) == 8, "config image region layout");
+static_assert(sizeof(ConfigImageSection) == 8, "config image section layout");
+static_assert(sizeof(ConfigImageAction) == 4, "config image action layout");
+static_assert(sizeof(ConfigImageEffect) == 16, "config image effect layout");
@@ -17,10 +17,18 @@ struct AmpConfig {
   MotionConfig motion;
   LightsConfig lights;
   std::map<std::string, std::vector<LightingParameters>*> actions;
+  // previewed effects, resolved over actions but never saved
+  std::map<std::string, std::vector<LightingParameters>> previews;
+
+  // effects per group and action, resolved from actions (or the compiled
+  // image) whenever the config changes so applying an action needs no lookups
+  std::vector<LightingParameters> actionTable[Group_Count][ACTION_COUNT];
   DeviceInfo info;
 };
 
 enum ConfigControl : uint8_t {
   ReceiveStart = 0x01,
-  TransmitStart
+  TransmitStart,
+  PatchResult,      // followed by 0x01 when the patch applied, 0x00 otherwise
+  TransmitEnd       // followed by bytes sent (uint32) and throughput in KB/s (uint16)
 };
\ No newline at end of file
@@ -80,6 +80,17 @@ enum Actions {
   LightsOrientationBack
 };
 
+#define ACTION_COUNT  (Actions::LightsOrientationBack + 1)
+
+// the same action (e.g. LightsOff) means something different for each group
+enum ActionGroup : uint8_t {
+  Group_Motion = 0,
+  Group_Headlight,
+  Group_Turn,
+  Group_Orientation,
+  Group_Count
+};
+
 struct LightCommands {
   Actions motionCommand;
   Actions headlightCommand;
@@ -106,7 +117,7 @@ struct LightingParameters {
 struct RenderStep {
   unsigned long step;
   unsigned long next;
-  void* data;
+  uint32_t data;    // per effect state (scan direction, sparkle pixel)
 };
 
 inline bool operator< (const LightingParameters& lhs, const LightingParameters& rhs){ return lhs.layer < rhs.layer; }
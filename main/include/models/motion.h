@@ -1,10 +1,12 @@
 #pragma once
 #include <stdint.h>
-#include <assert.h>
+#include <math.h>
 #include <map>
 #include <string>
 #include <cstring>
 
+#define MOTION_SAMPLE_PERIOD 10   // ms, the sampler's nominal period
+
 enum IMUState : uint8_t {
   IMU_Error = 0,
   IMU_Disabled,
@@ -39,11 +41,20 @@ struct VehicleState {
   AccelerationState acceleration;
   TurnState turn;
   Orientation orientation;
+  uint8_t orientationConfidence = 0;  // percent, not part of the state comparison
+
+  // micros() of the sample that changed the acceleration state and of its
+  // detection, 0 for manual changes. Not part of the state comparison.
+  unsigned long sampledAt = 0;
+  unsigned long detectedAt = 0;
 
   VehicleState& operator=(VehicleState const &other) {
     std::memcpy(&acceleration, &other.acceleration, sizeof(AccelerationState));
     std::memcpy(&turn, &other.turn, sizeof(TurnState));
     std::memcpy(&orientation, &other.orientation, sizeof(Orientation));
+    orientationConfidence = other.orientationConfidence;
+    sampledAt = other.sampledAt;
+    detectedAt = other.detectedAt;
     return *this;
   }
 };
@@ -84,31 +95,55 @@ static std::map<Orientation, std::string> OrientationMap = {
   { BackSideUp, "Back Side Up" },
 };
 
-struct Vector3D {
+// Value-semantic 3-axis vector, aligned to 16 bytes so a sample never
+// straddles a cache line.
+struct alignas(16) Vector3D {
   float x = 0.0f;
   float y = 0.0f;
   float z = 0.0f;
 
-  float& operator[](int index) {
-    assert(index >=0 && index < 3);
-    if (index == 0) return x;
-    else if (index == 1) return y;
-    else return z;
-  }
+  constexpr Vector3D() = default;
+  constexpr Vector3D(float x, float y, float z) : x(x), y(y), z(z) { }
 
-  Vector3D& operator-(Vector3D const &other) {
-    this->x = this->x - other.x;
-    this->y = this->y - other.y;
-    this->z = this->z - other.z;
-    return *this;
+  constexpr float operator[](int index) const {
+    return index == 0 ? x : (index == 1 ? y : z);
   }
 
-  Vector3D& operator=(Vector3D const &other) {
-    std::memcpy(&x, &other.x, sizeof(float));
-    std::memcpy(&y, &other.y, sizeof(float));
-    std::memcpy(&z, &other.z, sizeof(float));
-    return *this;
+  constexpr Vector3D operator+(Vector3D const &other) const { return Vector3D(x + other.x, y + other.y, z + other.z); }
+  constexpr Vector3D operator-(Vector3D const &other) const { return Vector3D(x - other.x, y - other.y, z - other.z); }
+  constexpr Vector3D operator*(float scalar) const { return Vector3D(x * scalar, y * scalar, z * scalar); }
+  constexpr Vector3D operator-() const { return Vector3D(-x, -y, -z); }
+
+  Vector3D& operator+=(Vector3D const &other) { x += other.x; y += other.y; z += other.z; return *this; }
+  Vector3D& operator-=(Vector3D const &other) { x -= other.x; y -= other.y; z -= other.z; return *this; }
+  Vector3D& operator*=(float scalar) { x *= scalar; y *= scalar; z *= scalar; return *this; }
+
+  constexpr float dot(Vector3D const &other) const { return x * other.x + y * other.y + z * other.z; }
+  constexpr Vector3D cross(Vector3D const &other) const {
+    return Vector3D(y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x);
   }
+
+  Vector3D abs() const { return Vector3D(fabsf(x), fabsf(y), fabsf(z)); }
+  float magnitude() const { return sqrtf(dot(*this)); }
+};
+
+inline bool operator==(const Vector3D& lhs, const Vector3D& rhs) {
+  return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+}
+
+inline bool operator!=(const Vector3D& lhs, const Vector3D& rhs) {
+  return !(lhs == rhs);
+}
+
+// Unit quaternion (w, x, y, z) describing the board attitude
+struct Quaternion {
+  float w = 1.0f;
+  float x = 0.0f;
+  float y = 0.0f;
+  float z = 0.0f;
+
+  constexpr Quaternion() = default;
+  constexpr Quaternion(float w, float x, float y, float z) : w(w), x(x), y(y), z(z) { }
 };
 
 enum AccelerationAxis : uint8_t {
@@ -129,6 +164,11 @@ enum AttitudeAxis : uint8_t {
   Yaw_Invert
 };
 
+enum AhrsFilterType : uint8_t {
+  AHRS_Madgwick = 0,
+  AHRS_Mahony
+};
+
 struct MotionConfig {
   bool autoOrientation;
   bool autoMotion;
@@ -138,7 +178,16 @@ struct MotionConfig {
   float turnThreshold;
   float brakeThreshold;
   float accelerationThreshold;
+  float brakeJerkThreshold;
+  uint32_t motionDwell;
+  uint32_t motionMaxLatency;
   AccelerationAxis motionAxis;
   AttitudeAxis turnAxis;
   Orientation orientationTrigger;
+  float orientationUpMin;
+  float orientationUpMax;
+  uint32_t orientationDwell;
+  uint8_t orientationMinConfidence;
+  uint32_t parkTimeout;
+  AhrsFilterType ahrsFilter;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <stdlib.h>
 
 enum PowerLevel : uint8_t {
   Unknown = 0x00,
@@ -1,6 +1,15 @@
 #pragma once
+#include <stdint.h>
+
+#define TOUCH_SEQUENCE_MAX 8
 
 enum TouchType {
   Tap,
   Hold
-};
\ No newline at end of file
+};
+
+// fixed size touch interaction so it can be copied through the event bus
+struct TouchSequence {
+  uint8_t count;
+  TouchType touches[TOUCH_SEQUENCE_MAX];
+};
@@ -7,5 +7,6 @@ enum UpdateStatus : uint8_t {
   Write,
   ErrorStart,
   ErrorEnd,
-  ErrorWrite
+  ErrorWrite,
+  Ack             // transfer acknowledgement, only sent by the update service
 };
\ No newline at end of file
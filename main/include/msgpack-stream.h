@@ -0,0 +1,104 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+
+// Streaming msgpack reader and writer. The reader is a push parser: bytes are
+// fed in chunks of any size (file reads, BLE writes) and handler callbacks
+// fire as soon as a value is complete, so memory use is fixed by the nesting
+// depth and the longest string instead of the document size.
+
+static const char* MSGPACK_TAG = "msgpack";
+
+#define MSGPACK_MAX_DEPTH   8
+#define MSGPACK_MAX_STRING  96
+
+enum MsgPackStatus : uint8_t {
+  MsgPack_Incomplete = 0,
+  MsgPack_Done,
+  MsgPack_Error
+};
+
+class MsgPackHandler {
+  public:
+    // containers, onEnd() closes the innermost one
+    virtual void onMap(uint32_t size) = 0;
+    virtual void onArray(uint32_t size) = 0;
+    virtual void onEnd() = 0;
+
+    // map keys have to be strings
+    virtual void onKey(const char *key) = 0;
+
+    // scalars, strings longer than MSGPACK_MAX_STRING are truncated and flagged
+    virtual void onString(const char *value, bool truncated) = 0;
+    virtual void onNumber(double value) = 0;
+    virtual void onBool(bool value) = 0;
+    virtual void onNil() = 0;
+};
+
+class MsgPackReader {
+  enum State : uint8_t {
+    Reader_Type,
+    Reader_Header,
+    Reader_String,
+    Reader_Skip
+  };
+
+  struct Frame {
+    uint32_t remaining;   // entries for maps, elements for arrays
+    bool map;
+    bool key;             // next value is a map key
+  };
+
+  MsgPackHandler *_handler = NULL;
+  MsgPackStatus _status = MsgPack_Incomplete;
+  State _state = Reader_Type;
+
+  Frame _stack[MSGPACK_MAX_DEPTH];
+  uint8_t _depth = 0;
+
+  uint8_t _type = 0;
+  uint8_t _header[8];
+  uint8_t _headerLength = 0;
+  uint8_t _headerRead = 0;
+
+  char _string[MSGPACK_MAX_STRING + 1];
+  uint32_t _stringLength = 0;
+  uint32_t _stringRead = 0;
+
+  uint32_t _skip = 0;
+  size_t _offset = 0;
+
+  void beginType(uint8_t type);
+  void endHeader();
+  void beginContainer(bool map, uint32_t size);
+  void beginString(uint32_t length);
+  void endString();
+  void endValue();
+  bool expectingKey();
+  void fail(const char *reason);
+
+  public:
+    void reset(MsgPackHandler *handler);
+    MsgPackStatus feed(const uint8_t *data, size_t length);
+    MsgPackStatus status() { return _status; }
+    size_t offset() { return _offset; }
+};
+
+class MsgPackWriter {
+  FILE *_file;
+
+  void write(uint8_t value) { fputc(value, _file); }
+  void write(uint8_t type, uint32_t value, uint8_t bytes);
+
+  public:
+    MsgPackWriter(FILE *file) : _file(file) { }
+
+    void map(uint32_t size);
+    void array(uint32_t size);
+    void string(const std::string &value);
+    void integer(int64_t value);
+    void number(float value);
+    void boolean(bool value);
+};
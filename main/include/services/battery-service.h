@@ -1,6 +1,7 @@
 #pragma once
 #include <NimBLEService.h>
 #include <hal/ble.h>
+#include <services/telemetry-scheduler.h>
 #include <constants.h>
 #include <interfaces/power-listener.h>
 
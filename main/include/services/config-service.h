@@ -9,6 +9,12 @@
 
 static const char* CONFIG_SERVICE_TAG = "config-service";
 
+#define CONFIG_TX_ATT_OVERHEAD  3     // opcode and handle of a notification
+#define CONFIG_TX_MBUF_RESERVE  4     // mbufs left for other traffic while transmitting
+#define CONFIG_TX_TIMEOUT       1000  // ms to wait for the host to free buffers
+#define CONFIG_TX_BULK          512   // longer transmits ask for transfer connection parameters
+#define CONFIG_TX_PRIORITY      2     // below ble-server, the host task keeps running while it waits for buffers
+
 class ConfigService : public NimBLECharacteristicCallbacks {
   Config *_config;
   NimBLEServer *_server;
@@ -22,6 +28,15 @@ class ConfigService : public NimBLECharacteristicCallbacks {
 
   uint32_t _toReceive = 0;
   uint32_t _received = 0;
+  bool _streaming = false;
+
+  // requests come in on the host task, which has to keep running to free
+  // buffers, so transmits run on their own task
+  TaskHandle_t _transmitHandle = NULL;
+  volatile bool _configRequested = false;
+
+  static void transmitter(void *parameters);
+  void transmitConfig();
 
   public:
     ConfigService(Config *config, NimBLEServer *server);
@@ -30,9 +45,9 @@ class ConfigService : public NimBLECharacteristicCallbacks {
     void onWrite(NimBLECharacteristic *characteristic);
 
     void processCommand(std::string data);
-    void transmit(std::string data);
-    void notify(uint16_t conn_id, std::string data, bool notify);
-    std::vector<std::string> buildPackets(std::string data, size_t packetSize);
+    void processBinaryCommands(const uint8_t *data, size_t length);
+    void transmit(const std::string &data);
+    int notify(uint16_t conn_id, const uint8_t *data, size_t length, bool notify);
     
     FreeRTOS::Semaphore configTransceiver = FreeRTOS::Semaphore("configEvents");
 };
\ No newline at end of file
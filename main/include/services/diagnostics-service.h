@@ -0,0 +1,37 @@
+#pragma once
+#include <NimBLEService.h>
+#include <hal/ble.h>
+#include <hal/latency-telemetry.h>
+#include <services/telemetry-scheduler.h>
+#include <constants.h>
+
+static const char* DIAGNOSTICS_SERVICE_TAG = "diagnostics-service";
+
+#define DIAGNOSTICS_RESET 0x01
+
+// Brake latency histogram. Reads return the number of traced brakes followed
+// by p50, p99 and max for every LatencyStage, all uint32 little endian
+// microseconds since the IMU sample. Writing DIAGNOSTICS_RESET clears it.
+//
+// Connection reads return the BleActivity u8, then interval (1.25 ms units),
+// slave latency, supervision timeout (10 ms units) and MTU as uint16 and the
+// measured throughput in bytes per second as uint32, all little endian.
+//
+// Telemetry reads return sent, coalesced and dropped for every
+// TelemetryChannel followed by the packed notification count, all uint32.
+class DiagnosticsService : public NimBLECharacteristicCallbacks {
+  NimBLEServer *_server;
+  NimBLECharacteristic *_latencyCharacteristic;
+  NimBLECharacteristic *_connectionCharacteristic;
+  NimBLECharacteristic *_telemetryCharacteristic;
+
+  void readConnection(NimBLECharacteristic *characteristic);
+  void readTelemetry(NimBLECharacteristic *characteristic);
+
+  public:
+    DiagnosticsService(NimBLEServer *server);
+
+    void setupService();
+    void onRead(NimBLECharacteristic *characteristic);
+    void onWrite(NimBLECharacteristic *characteristic);
+};
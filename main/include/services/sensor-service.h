@@ -0,0 +1,49 @@
+#pragma once
+#include <NimBLEService.h>
+#include <hal/ble.h>
+#include <hal/motion.h>
+#include <constants.h>
+
+static const char* SENSOR_SERVICE_TAG = "sensor-service";
+
+#define SENSOR_HEADER         7       // seq u16, count u8, time u32
+#define SENSOR_RECORD         20      // delta u16, 9 x int16
+#define SENSOR_ATT_OVERHEAD   3       // opcode and handle of a notification
+#define SENSOR_NOTIFY_RATE    10      // Hz, batches are sized to notify about this often
+#define SENSOR_NO_REQUEST     0xff
+
+// Opt-in motion telemetry for live graphs. Writing a rate in Hz (1 -
+// SENSOR_STREAM_MAX_RATE) to the control characteristic streams to the
+// connection subscribed to the samples characteristic, writing 0 stops it.
+// The stream also stops when that connection goes away.
+//
+// A notification holds seq u16, count u8 and the micros() of the first
+// sample as u32, then count records: delta u16 in 100 us since the previous
+// sample (0 for the first), linear acceleration and gravity xyz in 1/4096 g
+// and attitude xyz in 1/100 degree, all int16 little endian.
+class SensorService : public NimBLECharacteristicCallbacks {
+  Motion *_motion;
+  NimBLEServer *_server;
+  NimBLECharacteristic *_controlCharacteristic;
+  NimBLECharacteristic *_samplesCharacteristic;
+
+  // requests come from the host task, the stream is run from the app task
+  TaskHandle_t _reader;
+  volatile uint8_t _requestedRate = SENSOR_NO_REQUEST;
+
+  uint16_t _connection = BLE_HS_CONN_HANDLE_NONE;
+  uint16_t _batch = 1;
+  uint16_t _seq = 0;
+
+  void start(uint8_t rate);
+  void stop();
+  void sendBatch();
+
+  public:
+    SensorService(Motion *motion, NimBLEServer *server);
+
+    void setupService();
+    void onWrite(NimBLECharacteristic *characteristic);
+    void process();
+    bool isStreaming() { return _connection != BLE_HS_CONN_HANDLE_NONE; }
+};
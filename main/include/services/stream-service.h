@@ -0,0 +1,31 @@
+#pragma once
+#include <NimBLEService.h>
+#include <hal/ble.h>
+#include <hal/lights.h>
+#include <constants.h>
+
+static const char* STREAM_SERVICE_TAG = "stream-service";
+
+enum StreamControl : uint8_t {
+  StreamControl_Start = 0x01,   // region u8, fps u8, depth u8
+  StreamControl_Stop = 0x02
+};
+
+// Live pixel streams to a region. Frames go to the frame characteristic as
+// write without response fragments (see LiveStream). Stats reads return
+// streaming u8, then shown, dropped, late as uint32 and fps x 10, average and
+// max latency in ms as uint16, all little endian.
+class StreamService : public NimBLECharacteristicCallbacks {
+  NimBLEServer *_server;
+  Lights *_lights;
+  NimBLECharacteristic *_controlCharacteristic;
+  NimBLECharacteristic *_frameCharacteristic;
+  NimBLECharacteristic *_statsCharacteristic;
+
+  public:
+    StreamService(Lights *lights, NimBLEServer *server);
+
+    void setupService();
+    void onRead(NimBLECharacteristic *characteristic);
+    void onWrite(NimBLECharacteristic *characteristic);
+};
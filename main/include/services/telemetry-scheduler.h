@@ -0,0 +1,84 @@
+#pragma once
+#include <NimBLEService.h>
+#include <hal/ble.h>
+#include "esp_timer.h"
+#include "FreeRTOS.h"
+
+static const char* TELEMETRY_TAG = "telemetry";
+
+#define TELEMETRY_MAX_VALUE         4       // bytes per channel value
+#define TELEMETRY_STATE_INTERVAL    100     // ms between vehicle state notifications
+#define TELEMETRY_LIGHTS_INTERVAL   100     // ms between light command notifications
+#define TELEMETRY_BATTERY_INTERVAL  1000    // ms between battery notifications
+#define TELEMETRY_TRANSFER_BACKOFF  4       // intervals stretch by this while a transfer runs
+
+enum TelemetryChannel : uint8_t {
+  Telemetry_VehicleState = 0,
+  Telemetry_Lights,
+  Telemetry_Battery,
+  Telemetry_ChannelCount
+};
+
+struct TelemetryCounters {
+  uint32_t sent;
+  uint32_t coalesced;     // replaced by a newer value before going out
+  uint32_t dropped;       // changed back to the value the app already has
+};
+
+// Telemetry notifications go through here instead of straight to their
+// characteristics. A change goes out right away when its channel has been
+// quiet for the channel's interval, otherwise it waits for the interval and
+// newer changes replace it. Values flushed together are packed into one
+// notification on the packed characteristic when the app subscribed to it:
+// a channel mask u8 followed by the values of the set channels in channel
+// order (vehicle state 4 bytes, lights 4 bytes, battery 2 bytes).
+//
+// Updates and flushes happen on the app task, a timer wakes it for values
+// that are held back.
+class TelemetryScheduler {
+  struct Channel {
+    NimBLECharacteristic *characteristic;
+    uint16_t interval;
+    uint8_t length;
+    uint8_t value[TELEMETRY_MAX_VALUE];
+    uint8_t sentValue[TELEMETRY_MAX_VALUE];
+    bool sent;
+    bool pending;
+    unsigned long sentAt;
+    TelemetryCounters counters;
+  };
+
+  Channel _channels[Telemetry_ChannelCount] = { };
+  NimBLECharacteristic *_packed = NULL;
+  uint32_t _packedCount = 0;
+
+  TaskHandle_t _reader = NULL;
+  esp_timer_handle_t _timer = NULL;
+
+  unsigned long dueAt(Channel &channel, bool transfer) {
+    return channel.sentAt + channel.interval * (transfer ? TELEMETRY_TRANSFER_BACKOFF : 1);
+  }
+
+  void markSent(Channel &channel, unsigned long now);
+  void arm(unsigned long now, bool transfer);
+  static void onTimer(void *args);
+
+  public:
+    static TelemetryScheduler* instance() { static TelemetryScheduler scheduler; return &scheduler; }
+
+    // task woken when held back values are due
+    void setReader(TaskHandle_t reader);
+    void attach(TelemetryChannel channel, NimBLECharacteristic *characteristic, uint16_t interval);
+    void attachPacked(NimBLECharacteristic *characteristic) { _packed = characteristic; }
+
+    // the characteristic reads the new value right away, the notification
+    // waits for the next flush
+    void update(TelemetryChannel channel, const uint8_t *value, uint8_t length);
+    void flush();
+    // values are held back and the timer will wake the reader for them
+    bool isHolding();
+
+    TelemetryCounters getCounters(TelemetryChannel channel) { return _channels[channel].counters; }
+    uint32_t getPackedCount() { return _packedCount; }
+    void log();
+};
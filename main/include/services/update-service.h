@@ -2,11 +2,22 @@
 
 #include <hal/ble.h>
 #include <hal/updater.h>
+#include <update-window.h>
 #include <NimBLEService.h>
 #include <constants.h>
 
 static const char* UPDATE_SERVICE_TAG = "update-service";
 
+#define UPDATE_START_SIZE     11    // Start, transfer size u32, crc32 u32, block size u16
+#define UPDATE_PACKET_HEADER  8     // offset u32, crc32 u32 of the payload
+#define UPDATE_ACK_SIZE       9     // Ack, offset u32, received bitmap u32
+
+// A Start control write that announces the transfer switches the rx
+// characteristic to numbered packets. The device answers with an Ack on the
+// status characteristic holding the offset to send from, which is past the
+// data already received when a dropped transfer is started again. Acks follow
+// every half window, on gaps and for duplicates, and an Ack control write
+// asks for one. A plain Start takes unnumbered data as before.
 class UpdateService : public NimBLECharacteristicCallbacks, public UpdateListener {
   Updater *_updater;
   NimBLEServer *_server;
@@ -14,6 +25,18 @@ class UpdateService : public NimBLECharacteristicCallbacks, public UpdateListene
   NimBLECharacteristic *_updateControlCharacteristic;
   NimBLECharacteristic *_updateStatusCharacteristic;
 
+  UpdateWindow _window;
+
+  // acks go out on the host task and status changes on the app task, both
+  // write the status characteristic's value before notifying it
+  FreeRTOS::Semaphore _statusNotify = FreeRTOS::Semaphore("updateStatus");
+
+  void notifyStatus(const uint8_t *payload, size_t length);
+
+  void startTransfer(const uint8_t *data, size_t length);
+  void receivePacket(const uint8_t *data, size_t length);
+  void sendAck();
+
   public:
     UpdateService(Updater *updater, NimBLEServer *server);
 
@@ -3,6 +3,7 @@
 #include <hal/motion.h>
 #include <hal/power.h>
 #include <hal/ble.h>
+#include <services/telemetry-scheduler.h>
 #include <models/control.h>
 #include <constants.h>
 #include <interfaces/motion-listener.h>
@@ -20,6 +21,7 @@ class VehicleService : public NimBLECharacteristicCallbacks, public MotionListen
   NimBLECharacteristic *_lightCharacteristic;
   NimBLECharacteristic *_calibrationCharacteristic;
   NimBLECharacteristic *_restartCharacteristic;
+  NimBLECharacteristic *_telemetryCharacteristic;
 
   public:
     VehicleService(Motion *motion, Power *power, NimBLEServer *server, RenderHost *host);
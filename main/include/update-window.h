@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Receive window of the update transfer. The sender numbers packets by their
+// offset in the stream and keeps up to UPDATE_WINDOW_BLOCKS of them in
+// flight. Packets that arrive ahead of a gap are held until the gap is filled,
+// acks carry the first missing offset and a bitmap of what was received past
+// it so only lost packets are sent again.
+
+#define UPDATE_WINDOW_BLOCKS    32      // blocks in flight, one bit each in an ack
+#define UPDATE_MAX_BLOCK        512     // largest payload of a packet
+
+enum WindowResult : uint8_t {
+  Window_Accepted = 0,
+  Window_Duplicate,     // already received, the sender missed an ack
+  Window_Rejected       // outside the window or not on a block boundary
+};
+
+class UpdateWindow {
+  uint8_t *_blocks = NULL;              // UPDATE_WINDOW_BLOCKS out of order blocks
+  uint16_t _lengths[UPDATE_WINDOW_BLOCKS];
+  uint16_t _blockSize = 0;
+
+  uint32_t _start = 0;                  // offset the transfer (re)started at
+  uint32_t _base = 0;                   // first block not delivered yet
+  uint32_t _received = 0;               // bitmap from _base
+  uint8_t _slot = 0;                    // slot of _base
+
+  // an in order packet is handed on without being copied
+  const uint8_t *_direct = NULL;
+  uint16_t _directLength = 0;
+
+  uint8_t _sinceAck = 0;
+  bool _gap = false;
+  bool _ackDue = false;
+
+  public:
+    ~UpdateWindow() { end(); }
+
+    bool begin(uint16_t blockSize, uint32_t offset);
+    void end();
+    bool isActive() { return _blocks != NULL; }
+
+    WindowResult receive(uint32_t offset, const uint8_t *data, size_t length);
+    // in order data ready to be written, NULL once it runs into a gap
+    const uint8_t* next(size_t *length);
+
+    // acks go out every half window, on a new gap and for duplicates
+    bool isAckDue() { return _ackDue; }
+    void requestAck() { _ackDue = true; }
+    void ack(uint32_t *offset, uint32_t *received);
+
+    uint32_t getOffset() { return _start + _base * _blockSize; }
+};
@@ -44,6 +44,15 @@ void Amp::init() {
   ble->addAdvertisingListener(lights);
 #endif
 
+  // listen to calibration progress
+  motion.addCalibrationListener(lights);
+
+  // turn the lights off while parked
+  motion.addParkListener(lights);
+
+  // paint brakes straight from the motion task
+  motion.setBrakeListener(lights);
+
   // listen to ota update status changes
   updater->addUpdateListener(lights);
   
@@ -7,8 +7,13 @@ App::App(Amp *instance) {
   amp = instance;
   amp->config.addConfigListener(this);
 
-  configUpdatedQueue = xQueueCreate(1, sizeof(bool));
-  vehicleQueue = xQueueCreate(5, sizeof(VehicleState));
+  // constructed on the app loop task, new vehicle states wake it early
+  vehicleMailbox.setReader(xTaskGetCurrentTaskHandle());
+
+#ifdef BLE_ENABLED
+  // held back telemetry wakes it too
+  TelemetryScheduler::instance()->setReader(xTaskGetCurrentTaskHandle());
+#endif
 }
 
 void App::onPowerUp() { 
@@ -25,6 +30,9 @@ void App::onPowerUp() {
   vehicleService = new VehicleService(&(amp->motion), amp->power, amp->ble->server, this);
   configService = new ConfigService(&(amp->config), amp->ble->server);
   updateService = new UpdateService(amp->updater, amp->ble->server);
+  diagnosticsService = new DiagnosticsService(amp->ble->server);
+  streamService = new StreamService(amp->lights, amp->ble->server);
+  sensorService = new SensorService(&(amp->motion), amp->ble->server);
 
   // listen to power updates
   amp->power->addPowerLevelListener(batteryService);
@@ -44,40 +52,46 @@ void App::onPowerDown() {
   ESP_LOGD(APP_TAG,"App power down");
 }
 
-void App::onConfigUpdated() {
+void App::onConfigUpdated(uint8_t scope) {
   if (amp->config.isValid())
     config = &Config::ampConfig;  
 
   // reset motion detection
-  amp->motion.resetMotionDetection();
+  if (scope & Scope_Motion)
+    amp->motion.resetMotionDetection();
+
+  // new effects or regions, re-apply the current actions
+  if (!(scope & (Scope_Actions | Scope_Lights)))
+    return;
+
   setMotion(Actions::LightsReset);
   setTurnLights(Actions::LightsReset);
   setHeadlight(Actions::LightsReset);
 }
 
 void App::process() {
-  bool valid;
-
-  if (uxQueueMessagesWaiting(configUpdatedQueue)) {
-    if (xQueueReceive(configUpdatedQueue, &valid, 0) && valid)
-      onConfigUpdated();
-  }
+  Event event;
+  while (poll(event))
+    if (event.type == Event_ConfigUpdated && event.config.valid)
+      onConfigUpdated(event.config.scope);
 
   VehicleState state;
-  bool newVehicleState = false;
 
-  // consume all new vehicle states from queue
-  while (uxQueueMessagesWaiting(vehicleQueue))
-    newVehicleState = xQueueReceive(vehicleQueue, &state, 0);
+  // only the newest vehicle state matters
+  if (vehicleMailbox.take(state)) {
+    if (state.acceleration == AccelerationState::Braking && vehicleState.acceleration != state.acceleration)
+      LatencyTelemetry::instance()->mark(Latency_Received);
 
-  if (newVehicleState) {
     if (vehicleState.acceleration != state.acceleration)
       onAccelerationStateChanged(state.acceleration);
     
     if (vehicleState.turn != state.turn)
       onTurnStateChanged(state.turn);
 
-    if (vehicleState.orientation != state.orientation)
+    // hold the last confident orientation until the new side is settled
+    if (state.orientationConfidence < Config::ampConfig.motion.orientationMinConfidence)
+      state.orientation = vehicleState.orientation;
+    else if (vehicleState.orientation != state.orientation)
       onOrientationChanged(state.orientation);
 
   #ifdef BLE_ENABLED
@@ -92,6 +106,31 @@ void App::process() {
   vehicleService->process();
   batteryService->process();
   updateService->process();
+  sensorService->process();
+
+  // changes from this pass go out together
+  TelemetryScheduler::instance()->flush();
+
+  // otherwise the loop only wakes for events and the battery poll
+  PowerTelemetry::instance()->setBusy(Consumer_App, TelemetryScheduler::instance()->isHolding() || sensorService->isStreaming());
+#endif
+
+#if defined(LOG_EVENT_BUS_STATS) || defined(LOG_POWER_TELEMETRY) || defined(LOG_BRAKE_LATENCY) || defined(LOG_TELEMETRY_STATS)
+  if (millis() - _lastStatsLog >= 10000) {
+  #ifdef LOG_EVENT_BUS_STATS
+    EventBus::instance()->logStats();
+  #endif
+  #ifdef LOG_POWER_TELEMETRY
+    PowerTelemetry::instance()->log();
+  #endif
+  #ifdef LOG_BRAKE_LATENCY
+    LatencyTelemetry::instance()->log();
+  #endif
+  #if defined(LOG_TELEMETRY_STATS) && defined(BLE_ENABLED)
+    TelemetryScheduler::instance()->log();
+  #endif
+    _lastStatsLog = millis();
+  }
 #endif
 }
 
@@ -172,20 +211,37 @@ void App::onOrientationChanged(Orientation state) {
   setOrientationLights(command);
 }
 
+void App::applyAction(ActionGroup group, Actions command) {
+  // effects are resolved into the action table whenever the config changes,
+  // applying them here is a plain index without map lookups or copies
+#ifdef LOG_ACTION_LATENCY
+  auto start = micros();
+#endif
+
+  // the table is rebuilt on the BLE task when effects are edited
+  Config::effectsUpdating.take(APP_TAG);
+  for (auto& effect : config->actionTable[group][command]) {
+    ESP_LOGD(APP_TAG, "Applying effect %d to %s", effect.effect, effect.region.c_str());
+    amp->lights->applyEffect(effect);
+  }
+  Config::effectsUpdating.give();
+
+  // the configured motion effects take over from the brake overlay
+  if (group == Group_Motion)
+    amp->lights->releaseBrakeOverlay();
+
+#ifdef LOG_ACTION_LATENCY
+  ESP_LOGI(APP_TAG, "Applied action %d in %lu us", command, micros() - start);
+#endif
+}
+
 void App::setHeadlight(Actions command) {
-  auto actions = config->actions;
   if (command == Actions::LightsReset)
     command = _headlightCommand;
 
-  std::string actionName = Lights::headlightActions[command];
-  ESP_LOGI(APP_TAG, "Setting headlight - Command: %d, Action name: %s", command, actionName.c_str());
+  ESP_LOGI(APP_TAG, "Setting headlight - Command: %d, Action name: %s", command, Lights::getActionName(Group_Headlight, command));
 
-  if (actions.find(actionName) != actions.end()) {
-    for (auto effect : *actions[actionName]) {
-      ESP_LOGD(APP_TAG, "Applying effect %d to %s", effect.effect, effect.region.c_str());
-      amp->lights->applyEffect(effect);
-    }
-  }
+  applyAction(Group_Headlight, command);
 
   _headlightCommand = command;
 
@@ -194,19 +250,12 @@ void App::setHeadlight(Actions command) {
 }
 
 void App::setMotion(Actions command) {
-  auto actions = config->actions;
   if (command == Actions::LightsReset)
     command = _motionCommand;
 
-  std::string actionName = Lights::motionActions[command];
-  ESP_LOGI(APP_TAG, "Setting motion - Command: %d, Action name: %s", command, actionName.c_str());
+  ESP_LOGI(APP_TAG, "Setting motion - Command: %d, Action name: %s", command, Lights::getActionName(Group_Motion, command));
 
-  if (actions.find(actionName) != actions.end()) {
-    for (auto effect : *actions[actionName]) {
-      ESP_LOGD(APP_TAG, "Applying effect %d to %s", effect.effect, effect.region.c_str());
-      amp->lights->applyEffect(effect);
-    }
-  }
+  applyAction(Group_Motion, command);
 
   _motionCommand = command;
 
@@ -215,19 +264,12 @@ void App::setMotion(Actions command) {
 }
 
 void App::setTurnLights(Actions command) {
-  auto actions = config->actions;
   if (command == Actions::LightsReset)
     command = _turnCommand;
 
-  std::string actionName = Lights::turnActions[command];
-  ESP_LOGI(APP_TAG, "Setting indicators - Command: %d, Action name: %s", command, actionName.c_str());
-  
-  if (actions.find(actionName) != actions.end()) {
-    for (auto effect : *actions[actionName]) {
-      ESP_LOGD(APP_TAG, "Applying effect %d to %s", effect.effect, effect.region.c_str());
-      amp->lights->applyEffect(effect);
-    }
-  }
+  ESP_LOGI(APP_TAG, "Setting indicators - Command: %d, Action name: %s", command, Lights::getActionName(Group_Turn, command));
+
+  applyAction(Group_Turn, command);
 
   _turnCommand = command;
 
@@ -236,19 +278,12 @@ void App::setTurnLights(Actions command) {
 }
 
 void App::setOrientationLights(Actions command) {
-  auto actions = config->actions;
   if (command == Actions::LightsReset)
     command = _orientationCommand;
 
-  std::string actionName = Lights::orientationActions[command];
-  ESP_LOGI(APP_TAG, "Setting orientation - Command: %d, Action name: %s", command, actionName.c_str());
-  
-  if (actions.find(actionName) != actions.end()) {
-    for (auto effect : *actions[actionName]) {
-      ESP_LOGD(APP_TAG, "Applying effect %d to %s", effect.effect, effect.region.c_str());
-      amp->lights->applyEffect(effect);
-    }
-  }
+  ESP_LOGI(APP_TAG, "Setting orientation - Command: %d, Action name: %s", command, Lights::getActionName(Group_Orientation, command));
+
+  applyAction(Group_Orientation, command);
 
   _orientationCommand = command;
 
@@ -263,8 +298,8 @@ void App::notifyLightsChanged(Actions motionCommand, Actions turnCommand, Action
   commands.headlightCommand = headlightCommand == Actions::NoCommand || headlightCommand == Actions::LightsReset ? _headlightCommand : headlightCommand;
   commands.orientationCommand = orientationCommand == Actions::NoCommand || orientationCommand == Actions::LightsReset ? _orientationCommand : orientationCommand;
 
-  for (auto listener : renderListeners) {
-    if (listener->lightsChangedQueue != NULL)
-      xQueueSend(listener->lightsChangedQueue, &commands, 0);
-  }
+  Event event;
+  event.type = Event_LightsChanged;
+  event.lights = commands;
+  EventBus::instance()->publish(event);
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include <config-command.h>
+#include <string.h>
+
+static bool readVarint(const uint8_t *data, size_t length, size_t *offset, uint32_t *value) {
+  *value = 0;
+
+  for (uint8_t shift = 0; shift < 32; shift += 7) {
+    if (*offset >= length)
+      return false;
+
+    uint8_t byte = data[(*offset)++];
+    *value |= (uint32_t)(byte & 0x7f) << shift;
+
+    if (!(byte & 0x80))
+      return true;
+  }
+
+  return false;
+}
+
+bool CommandReader::next(CommandOp *op, EffectCommand *command) {
+  if (_offset + COMMAND_HEADER > _length)
+    return false;
+
+  *op = (CommandOp)_data[_offset];
+  size_t length = _data[_offset + 1];
+  auto value = &_data[_offset + COMMAND_HEADER];
+
+  if (_offset + COMMAND_HEADER + length > _length)
+    return false;
+
+  _offset += COMMAND_HEADER + length;
+
+  // the value is checked against what the op needs, extra bytes are ignored
+  // so fields can be added later
+  memset(command, 0, sizeof(EffectCommand));
+  switch (*op) {
+    case Command_Effect:
+    case Command_SaveEffect: {
+      if (length < COMMAND_EFFECT_MIN)
+        return false;
+
+      command->group = value[0];
+      command->action = value[1];
+      command->region = value[2];
+      command->effect = value[3];
+      command->layer = value[4];
+      command->colorFlags = value[5];
+      memcpy(command->first, &value[6], 3);
+      memcpy(command->second, &value[9], 3);
+
+      size_t offset = 12;
+      return readVarint(value, length, &offset, &command->duration);
+    }
+    case Command_RemoveEffect:
+      if (length < 3)
+        return false;
+
+      command->group = value[0];
+      command->action = value[1];
+      command->region = value[2];
+      return true;
+    default:
+      // unknown ops are skipped, the caller logs them
+      return true;
+  }
+}
@@ -0,0 +1,101 @@
+#include <config-patch.h>
+#include <string.h>
+#include <algorithm>
+
+bool PatchReader::next(PatchOp *op) {
+  if (_offset + PATCH_HEADER > _length)
+    return false;
+
+  uint16_t length = _data[_offset + 1] | (_data[_offset + 2] << 8);
+  if (_offset + PATCH_HEADER + length > _length)
+    return false;
+
+  *op = (PatchOp)_data[_offset];
+  _payload = &_data[_offset + PATCH_HEADER];
+  _payloadLength = length;
+  _payloadOffset = 0;
+  _valid = true;
+  _offset += PATCH_HEADER + length;
+
+  return true;
+}
+
+bool PatchReader::validate() {
+  PatchOp op;
+  size_t offset = _offset;
+  uint16_t count = 0;
+
+  while (next(&op))
+    count++;
+
+  bool valid = count > 0 && _offset == _length;
+  _offset = offset;
+  return valid;
+}
+
+uint8_t PatchReader::u8() {
+  if (_payloadOffset + 1 > _payloadLength) {
+    _valid = false;
+    return 0;
+  }
+
+  return _payload[_payloadOffset++];
+}
+
+uint16_t PatchReader::u16() {
+  uint16_t low = u8();
+  return low | (u8() << 8);
+}
+
+float PatchReader::f32() {
+  if (_payloadOffset + sizeof(float) > _payloadLength) {
+    _valid = false;
+    return 0;
+  }
+
+  float value;
+  memcpy(&value, &_payload[_payloadOffset], sizeof(float));
+  _payloadOffset += sizeof(float);
+  return value;
+}
+
+std::string PatchReader::string() {
+  uint8_t length = u8();
+  if (_payloadOffset + length > _payloadLength) {
+    _valid = false;
+    return "";
+  }
+
+  std::string value((const char*)&_payload[_payloadOffset], length);
+  _payloadOffset += length;
+  return value;
+}
+
+void PatchWriter::begin(PatchOp op) {
+  _start = _out.length();
+  _out.push_back(op);
+  _out.append(2, '\0');
+}
+
+void PatchWriter::end() {
+  uint16_t length = _out.length() - _start - PATCH_HEADER;
+  _out[_start + 1] = length & 0xff;
+  _out[_start + 2] = length >> 8;
+}
+
+void PatchWriter::u16(uint16_t value) {
+  u8(value & 0xff);
+  u8(value >> 8);
+}
+
+void PatchWriter::f32(float value) {
+  char bytes[sizeof(float)];
+  memcpy(bytes, &value, sizeof(float));
+  _out.append(bytes, sizeof(float));
+}
+
+void PatchWriter::string(const std::string &value) {
+  uint8_t length = std::min(value.length(), (size_t)0xff);
+  u8(length);
+  _out.append(value, 0, length);
+}
@@ -6,6 +6,7 @@ std::string vehicleStateCharacteristicUUID =            "561d73e5-dff4-4740-bfe8
 std::string vehicleLightsCharacteristicUUID =           "561d73e5-dff5-4740-bfe8-89e48efeef8f";
 std::string vehicleCalibrationCharacteristicUUID =      "561d73e5-dff6-4740-bfe8-89e48efeef8f";
 std::string vehicleRestartCharactersticUUID =           "561d73e5-dff7-4740-bfe8-89e48efeef8f";
+std::string vehicleTelemetryCharacteristicUUID =        "561d73e5-dff8-4740-bfe8-89e48efeef8f";
 
 std::string configServiceUUID =                         "561d73e6-dff2-4740-bfe8-89e48efeef8f";
 std::string configRxCharacteristicUUID =                "561d73e6-dff3-4740-bfe8-89e48efeef8f";
@@ -15,4 +16,18 @@ std::string configStatusCharacteristicUUID =            "561d73e6-dff5-4740-bfe8
 std::string updateServiceUUID =                         "561d73e7-dff2-4740-bfe8-89e48efeef8f";
 std::string updateControlCharacteristicUUID =           "561d73e7-dff3-4740-bfe8-89e48efeef8f";
 std::string updateRxCharacteristicUUID =                "561d73e7-dff4-4740-bfe8-89e48efeef8f";
-std::string updateStatusCharacteristicUUID =            "561d73e7-dff5-4740-bfe8-89e48efeef8f";
\ No newline at end of file
+std::string updateStatusCharacteristicUUID =            "561d73e7-dff5-4740-bfe8-89e48efeef8f";
+
+std::string diagnosticsServiceUUID =                    "561d73e8-dff2-4740-bfe8-89e48efeef8f";
+std::string diagnosticsLatencyCharacteristicUUID =      "561d73e8-dff3-4740-bfe8-89e48efeef8f";
+std::string diagnosticsConnectionCharacteristicUUID =   "561d73e8-dff4-4740-bfe8-89e48efeef8f";
+std::string diagnosticsTelemetryCharacteristicUUID =    "561d73e8-dff5-4740-bfe8-89e48efeef8f";
+
+std::string streamServiceUUID =                         "561d73e9-dff2-4740-bfe8-89e48efeef8f";
+std::string streamControlCharacteristicUUID =           "561d73e9-dff3-4740-bfe8-89e48efeef8f";
+std::string streamFrameCharacteristicUUID =             "561d73e9-dff4-4740-bfe8-89e48efeef8f";
+std::string streamStatsCharacteristicUUID =             "561d73e9-dff5-4740-bfe8-89e48efeef8f";
+
+std::string sensorServiceUUID =                         "561d73ea-dff2-4740-bfe8-89e48efeef8f";
+std::string sensorControlCharacteristicUUID =           "561d73ea-dff3-4740-bfe8-89e48efeef8f";
+std::string sensorSamplesCharacteristicUUID =           "561d73ea-dff4-4740-bfe8-89e48efeef8f";
\ No newline at end of file
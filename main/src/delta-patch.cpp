@@ -0,0 +1,81 @@
+#include <delta-patch.h>
+#include <string.h>
+#include <algorithm>
+
+void DeltaPatcher::begin(const uint8_t *source, size_t sourceSize) {
+  _source = source;
+  _sourceSize = sourceSize;
+  _position = 0;
+  _state = Delta_Control;
+  _controlLength = 0;
+}
+
+bool DeltaPatcher::apply(const uint8_t *data, size_t *length, uint8_t *output, size_t *outputLength) {
+  size_t in = 0, out = 0;
+
+  while (in < *length) {
+    if (_state == Delta_Control) {
+      _control[_controlLength++] = data[in++];
+      if (_controlLength == DELTA_CONTROL_SIZE)
+        beginRecord();
+      continue;
+    }
+
+    size_t count = std::min((size_t)_remaining, std::min(*length - in, *outputLength - out));
+    if (count == 0)
+      break;
+
+    if (_state == Delta_Diff) {
+      if (_position < 0 || _position + count > _sourceSize) {
+        *length = in;
+        *outputLength = out;
+        return false;
+      }
+
+      auto source = _source + _position;
+      for (size_t i = 0; i < count; i++)
+        output[out + i] = source[i] + data[in + i];
+
+      _position += count;
+    }
+    else
+      memcpy(&output[out], &data[in], count);
+
+    in += count;
+    out += count;
+    _remaining -= count;
+
+    if (_remaining == 0)
+      endData();
+  }
+
+  *length = in;
+  *outputLength = out;
+  return true;
+}
+
+void DeltaPatcher::beginRecord() {
+  uint32_t diff;
+  memcpy(&diff, &_control[0], sizeof(diff));
+  memcpy(&_extra, &_control[4], sizeof(_extra));
+  memcpy(&_seek, &_control[8], sizeof(_seek));
+  _controlLength = 0;
+
+  _state = Delta_Diff;
+  _remaining = diff;
+  if (_remaining == 0)
+    endData();
+}
+
+void DeltaPatcher::endData() {
+  // empty sections are skipped right away so records can end on either
+  if (_state == Delta_Diff) {
+    _state = Delta_Extra;
+    _remaining = _extra;
+    if (_remaining > 0)
+      return;
+  }
+
+  _position += _seek;
+  _state = Delta_Control;
+}
@@ -0,0 +1,135 @@
+#include <event-bus.h>
+#include <esp_log.h>
+
+EventPolicy EventBus::policy(EventType type) {
+  return latestSlot(type) >= 0 ? Event_LatestWins : Event_Fifo;
+}
+
+int8_t EventBus::latestSlot(EventType type) {
+  switch (type) {
+    case Event_ConfigUpdated: return 0;
+    case Event_PowerStatus: return 1;
+    case Event_Advertising: return 2;
+    case Event_LightsChanged: return 3;
+    case Event_Parked: return 4;
+    default: return -1;
+  }
+}
+
+void EventBus::subscribe(EventSubscriber *subscriber, EventType type) {
+  portENTER_CRITICAL(&_subscribeLock);
+  subscriber->_mask |= 1 << type;
+
+  uint8_t count = _subscriberCount.load();
+  bool known = false;
+  for (uint8_t i = 0; i < count; i++)
+    if (_subscribers[i] == subscriber)
+      known = true;
+
+  if (!known && count < EVENT_BUS_MAX_SUBSCRIBERS) {
+    _subscribers[count] = subscriber;
+    _subscriberCount.store(count + 1);
+  }
+  portEXIT_CRITICAL(&_subscribeLock);
+
+  if (!known && count >= EVENT_BUS_MAX_SUBSCRIBERS)
+    ESP_LOGE(EVENT_BUS_TAG,"Too many subscribers, dropping subscription for event %d", type);
+}
+
+void EventBus::publish(const Event &event) {
+  _published++;
+
+  int8_t slot = latestSlot(event.type);
+  uint8_t count = _subscriberCount.load();
+
+  for (uint8_t i = 0; i < count; i++) {
+    auto subscriber = _subscribers[i];
+    if (!subscriber->subscribed(event.type))
+      continue;
+
+    bool wake;
+    portENTER_CRITICAL(&subscriber->_lock);
+    wake = subscriber->_count == 0 && subscriber->_latestPending == 0;
+
+    if (slot >= 0) {
+      bool pending = subscriber->_latestPending & (1 << slot);
+      uint8_t scope = pending && event.type == Event_ConfigUpdated ? subscriber->_latest[slot].config.scope : 0;
+      if (pending)
+        _coalesced++;
+
+      subscriber->_latest[slot] = event;
+
+      // a coalesced config update still has to cover everything the
+      // replaced one touched
+      if (scope != 0)
+        subscriber->_latest[slot].config.scope |= scope;
+      subscriber->_latestPending |= 1 << slot;
+    }
+    else {
+      // full ring overwrites its oldest entry
+      if (subscriber->_count == EVENT_RING_SIZE) {
+        subscriber->_head = (subscriber->_head + 1) % EVENT_RING_SIZE;
+        subscriber->_count--;
+        _dropped++;
+      }
+
+      subscriber->_ring[(subscriber->_head + subscriber->_count) % EVENT_RING_SIZE] = event;
+      subscriber->_count++;
+    }
+
+    TaskHandle_t task = subscriber->_task;
+    portEXIT_CRITICAL(&subscriber->_lock);
+
+    _delivered++;
+
+    // the task is already awake (or about to drain) when events were pending
+    if (wake && task != NULL) {
+      xTaskNotifyGive(task);
+      _wakeups++;
+    }
+  }
+}
+
+bool EventSubscriber::poll(Event &event) {
+  bool found = false;
+
+  portENTER_CRITICAL(&_lock);
+  if (_task == NULL)
+    _task = xTaskGetCurrentTaskHandle();
+
+  if (_latestPending) {
+    for (uint8_t slot = 0; slot < EVENT_LATEST_SLOTS; slot++) {
+      if (_latestPending & (1 << slot)) {
+        event = _latest[slot];
+        _latestPending &= ~(1 << slot);
+        found = true;
+        break;
+      }
+    }
+  }
+  else if (_count > 0) {
+    event = _ring[_head];
+    _head = (_head + 1) % EVENT_RING_SIZE;
+    _count--;
+    found = true;
+  }
+  portEXIT_CRITICAL(&_lock);
+
+  return found;
+}
+
+EventBusStats EventBus::getStats() {
+  EventBusStats stats;
+  stats.published = _published.load();
+  stats.delivered = _delivered.load();
+  stats.coalesced = _coalesced.load();
+  stats.dropped = _dropped.load();
+  stats.wakeups = _wakeups.load();
+  return stats;
+}
+
+void EventBus::logStats() {
+  auto stats = getStats();
+  ESP_LOGI(EVENT_BUS_TAG,"published: %d delivered: %d coalesced: %d dropped: %d wakeups: %d",
+    stats.published, stats.delivered, stats.coalesced, stats.dropped, stats.wakeups);
+}
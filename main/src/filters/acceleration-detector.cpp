@@ -0,0 +1,118 @@
+#include <filters/acceleration-detector.h>
+
+const AccelerationTransition AccelerationDetector::transitions[] = {
+  { Neutral,      Braking,      AtLeast,  BrakeEnter },
+  { Neutral,      Accelerating, AtMost,   AccelerationEnter },
+  { Braking,      Accelerating, AtMost,   AccelerationEnter },
+  { Braking,      Neutral,      AtMost,   BrakeExit },
+  { Accelerating, Braking,      AtLeast,  BrakeEnter },
+  { Accelerating, Neutral,      AtLeast,  AccelerationExit }
+};
+
+const uint8_t AccelerationDetector::transitionCount = sizeof(transitions) / sizeof(AccelerationTransition);
+
+AccelerationDetector::AccelerationDetector() {
+  configure(0.2f, 0.2f, 0.0f, 0, 0);
+}
+
+void AccelerationDetector::configure(float brakeThreshold, float accelerationThreshold, float jerk, uint32_t dwellTime, uint32_t latencyBudget, float sampleInterval) {
+  thresholds[BrakeEnter] = brakeThreshold;
+  thresholds[BrakeExit] = brakeThreshold * MOTION_HYSTERESIS;
+  thresholds[AccelerationEnter] = -accelerationThreshold;
+  thresholds[AccelerationExit] = -accelerationThreshold * MOTION_HYSTERESIS;
+
+  jerkThreshold = jerk;
+  dwell = dwellTime;
+  maxLatency = latencyBudget;
+
+  // a sustained brake has to be reported within the latency budget, one sample is always spent seeing it
+  uint32_t samplePeriod = (uint32_t)(sampleInterval * 1000.0f);
+  brakeDwell = dwell;
+  if (maxLatency > 0)
+    brakeDwell = maxLatency > samplePeriod ? std::min(dwell, maxLatency - samplePeriod) : 0;
+}
+
+void AccelerationDetector::reset(AccelerationState initial, unsigned long now) {
+  state = initial;
+  pending = -1;
+  stateSince = now;
+  accelerationCount = 0;
+  accelerationIndex = 0;
+  jerkCount = 0;
+  jerkIndex = 0;
+}
+
+float AccelerationDetector::filterJerk(float jerk) {
+  jerks[jerkIndex] = jerk;
+  jerkIndex = (jerkIndex + 1) % JERK_SAMPLES;
+  if (jerkCount < JERK_SAMPLES)
+    jerkCount++;
+
+  // not enough history yet, don't let the first samples trigger anything
+  if (jerkCount < JERK_SAMPLES)
+    return 0.0f;
+
+  float sorted[JERK_SAMPLES];
+  std::copy(jerks, jerks + JERK_SAMPLES, sorted);
+  std::sort(sorted, sorted + JERK_SAMPLES);
+  return sorted[JERK_SAMPLES / 2];
+}
+
+bool AccelerationDetector::matches(const AccelerationTransition &transition, float acceleration) {
+  float threshold = thresholds[transition.threshold];
+  return transition.comparison == AtLeast ? acceleration >= threshold : acceleration <= threshold;
+}
+
+uint32_t AccelerationDetector::dwellFor(const AccelerationTransition &transition) {
+  return transition.to == Braking ? brakeDwell : dwell;
+}
+
+uint32_t AccelerationDetector::holdFor(AccelerationState state) {
+  return state == Braking ? BRAKE_HOLD : 0;
+}
+
+AccelerationState AccelerationDetector::update(float acceleration, unsigned long now, float dt) {
+  // the oldest kept sample is JERK_SPAN samples back
+  float jerk = 0.0f;
+  if (accelerationCount == JERK_SPAN && dt > 0)
+    jerk = filterJerk((acceleration - accelerations[accelerationIndex]) / (dt * JERK_SPAN));
+
+  accelerations[accelerationIndex] = acceleration;
+  accelerationIndex = (accelerationIndex + 1) % JERK_SPAN;
+  if (accelerationCount < JERK_SPAN)
+    accelerationCount++;
+
+  // early brake - a hard deceleration past the brake threshold skips the dwell
+  if (state != Braking && jerkThreshold > 0 && jerk >= jerkThreshold && acceleration >= thresholds[BrakeEnter]) {
+    state = Braking;
+    stateSince = now;
+    pending = -1;
+    return state;
+  }
+
+  if (now - stateSince < holdFor(state)) {
+    pending = -1;
+    return state;
+  }
+
+  int8_t candidate = -1;
+  for (uint8_t i = 0; i < transitionCount; i++) {
+    if (transitions[i].from == state && matches(transitions[i], acceleration)) {
+      candidate = i;
+      break;
+    }
+  }
+
+  if (candidate != pending) {
+    pending = candidate;
+    pendingSince = now;
+  }
+
+  if (pending >= 0 && now - pendingSince >= dwellFor(transitions[pending])) {
+    state = transitions[pending].to;
+    stateSince = now;
+    pending = -1;
+  }
+
+  return state;
+}
@@ -0,0 +1,27 @@
+#include <filters/ahrs-filter.h>
+
+#define RAD_TO_DEG 57.29577951308232f
+
+void AhrsFilter::normalize() {
+  float norm = sqrtf(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+  if (norm == 0.0f) {
+    q = Quaternion();
+    return;
+  }
+
+  float recipNorm = 1.0f / norm;
+  q.w *= recipNorm;
+  q.x *= recipNorm;
+  q.y *= recipNorm;
+  q.z *= recipNorm;
+}
+
+Vector3D AhrsFilter::getAHRS() {
+  float sinPitch = -2.0f * (q.x * q.z - q.w * q.y);
+  sinPitch = sinPitch > 1.0f ? 1.0f : (sinPitch < -1.0f ? -1.0f : sinPitch);
+
+  return Vector3D(
+    atan2f(q.w * q.x + q.y * q.z, 0.5f - q.x * q.x - q.y * q.y) * RAD_TO_DEG,
+    asinf(sinPitch) * RAD_TO_DEG,
+    atan2f(q.x * q.y + q.w * q.z, 0.5f - q.y * q.y - q.z * q.z) * RAD_TO_DEG);
+}
@@ -0,0 +1,26 @@
+#include <filters/ahrs.h>
+
+void Ahrs::setFilter(AhrsFilterType type) {
+  if (type == _type)
+    return;
+
+  _type = type;
+  switch (_type) {
+    case AhrsFilterType::AHRS_Mahony:
+      filter = &mahony;
+      break;
+    case AhrsFilterType::AHRS_Madgwick:
+    default:
+      filter = &madgwick;
+      break;
+  }
+
+  filter->reset();
+}
+
+void Ahrs::update(Vector3D accel, Vector3D gyro, Vector3D mag, float dt, bool useMag) {
+  if (useMag)
+    filter->update(accel, gyro, mag, dt);
+  else
+    filter->updateIMU(accel, gyro, dt);
+}
@@ -0,0 +1,129 @@
+#include <filters/madgwick.h>
+
+void Madgwick::update(Vector3D accel, Vector3D gyro, Vector3D mag, float dt) {
+  // fall back to the IMU algorithm if the magnetometer reading is invalid
+  if (mag.x == 0.0f && mag.y == 0.0f && mag.z == 0.0f) {
+    updateIMU(accel, gyro, dt);
+    return;
+  }
+
+  float q0 = q.w, q1 = q.x, q2 = q.y, q3 = q.z;
+
+  // rate of change of quaternion from gyroscope
+  float qDot1 = 0.5f * (-q1 * gyro.x - q2 * gyro.y - q3 * gyro.z);
+  float qDot2 = 0.5f * (q0 * gyro.x + q2 * gyro.z - q3 * gyro.y);
+  float qDot3 = 0.5f * (q0 * gyro.y - q1 * gyro.z + q3 * gyro.x);
+  float qDot4 = 0.5f * (q0 * gyro.z + q1 * gyro.y - q2 * gyro.x);
+
+  // only apply feedback if the accelerometer reading is valid
+  float accelNorm = accel.magnitude();
+  if (accelNorm > 0.0f) {
+    Vector3D a = accel * (1.0f / accelNorm);
+    Vector3D m = mag * (1.0f / mag.magnitude());
+
+    float _2q0mx = 2.0f * q0 * m.x;
+    float _2q0my = 2.0f * q0 * m.y;
+    float _2q0mz = 2.0f * q0 * m.z;
+    float _2q1mx = 2.0f * q1 * m.x;
+    float _2q0 = 2.0f * q0;
+    float _2q1 = 2.0f * q1;
+    float _2q2 = 2.0f * q2;
+    float _2q3 = 2.0f * q3;
+    float _2q0q2 = 2.0f * q0 * q2;
+    float _2q2q3 = 2.0f * q2 * q3;
+    float q0q0 = q0 * q0;
+    float q0q1 = q0 * q1;
+    float q0q2 = q0 * q2;
+    float q0q3 = q0 * q3;
+    float q1q1 = q1 * q1;
+    float q1q2 = q1 * q2;
+    float q1q3 = q1 * q3;
+    float q2q2 = q2 * q2;
+    float q2q3 = q2 * q3;
+    float q3q3 = q3 * q3;
+
+    // reference direction of earth's magnetic field
+    float hx = m.x * q0q0 - _2q0my * q3 + _2q0mz * q2 + m.x * q1q1 + _2q1 * m.y * q2 + _2q1 * m.z * q3 - m.x * q2q2 - m.x * q3q3;
+    float hy = _2q0mx * q3 + m.y * q0q0 - _2q0mz * q1 + _2q1mx * q2 - m.y * q1q1 + m.y * q2q2 + _2q2 * m.z * q3 - m.y * q3q3;
+    float _2bx = sqrtf(hx * hx + hy * hy);
+    float _2bz = -_2q0mx * q2 + _2q0my * q1 + m.z * q0q0 + _2q1mx * q3 - m.z * q1q1 + _2q2 * m.y * q3 - m.z * q2q2 + m.z * q3q3;
+    float _4bx = 2.0f * _2bx;
+    float _4bz = 2.0f * _2bz;
+
+    // gradient descent corrective step
+    float s0 = -_2q2 * (2.0f * q1q3 - _2q0q2 - a.x) + _2q1 * (2.0f * q0q1 + _2q2q3 - a.y) - _2bz * q2 * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - m.x) + (-_2bx * q3 + _2bz * q1) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - m.y) + _2bx * q2 * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - m.z);
+    float s1 = _2q3 * (2.0f * q1q3 - _2q0q2 - a.x) + _2q0 * (2.0f * q0q1 + _2q2q3 - a.y) - 4.0f * q1 * (1 - 2.0f * q1q1 - 2.0f * q2q2 - a.z) + _2bz * q3 * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - m.x) + (_2bx * q2 + _2bz * q0) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - m.y) + (_2bx * q3 - _4bz * q1) * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - m.z);
+    float s2 = -_2q0 * (2.0f * q1q3 - _2q0q2 - a.x) + _2q3 * (2.0f * q0q1 + _2q2q3 - a.y) - 4.0f * q2 * (1 - 2.0f * q1q1 - 2.0f * q2q2 - a.z) + (-_4bx * q2 - _2bz * q0) * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - m.x) + (_2bx * q1 + _2bz * q3) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - m.y) + (_2bx * q0 - _4bz * q2) * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - m.z);
+    float s3 = _2q1 * (2.0f * q1q3 - _2q0q2 - a.x) + _2q2 * (2.0f * q0q1 + _2q2q3 - a.y) + (-_4bx * q3 + _2bz * q1) * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - m.x) + (-_2bx * q0 + _2bz * q2) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - m.y) + _2bx * q1 * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - m.z);
+
+    float norm = sqrtf(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+    if (norm > 0.0f) {
+      float recipNorm = 1.0f / norm;
+      qDot1 -= beta * s0 * recipNorm;
+      qDot2 -= beta * s1 * recipNorm;
+      qDot3 -= beta * s2 * recipNorm;
+      qDot4 -= beta * s3 * recipNorm;
+    }
+  }
+
+  // integrate rate of change of quaternion
+  q.w = q0 + qDot1 * dt;
+  q.x = q1 + qDot2 * dt;
+  q.y = q2 + qDot3 * dt;
+  q.z = q3 + qDot4 * dt;
+
+  normalize();
+}
+
+void Madgwick::updateIMU(Vector3D accel, Vector3D gyro, float dt) {
+  float q0 = q.w, q1 = q.x, q2 = q.y, q3 = q.z;
+
+  // rate of change of quaternion from gyroscope
+  float qDot1 = 0.5f * (-q1 * gyro.x - q2 * gyro.y - q3 * gyro.z);
+  float qDot2 = 0.5f * (q0 * gyro.x + q2 * gyro.z - q3 * gyro.y);
+  float qDot3 = 0.5f * (q0 * gyro.y - q1 * gyro.z + q3 * gyro.x);
+  float qDot4 = 0.5f * (q0 * gyro.z + q1 * gyro.y - q2 * gyro.x);
+
+  // only apply feedback if the accelerometer reading is valid
+  float accelNorm = accel.magnitude();
+  if (accelNorm > 0.0f) {
+    Vector3D a = accel * (1.0f / accelNorm);
+
+    float _2q0 = 2.0f * q0;
+    float _2q1 = 2.0f * q1;
+    float _2q2 = 2.0f * q2;
+    float _2q3 = 2.0f * q3;
+    float _4q0 = 4.0f * q0;
+    float _4q1 = 4.0f * q1;
+    float _4q2 = 4.0f * q2;
+    float _8q1 = 8.0f * q1;
+    float _8q2 = 8.0f * q2;
+    float q0q0 = q0 * q0;
+    float q1q1 = q1 * q1;
+    float q2q2 = q2 * q2;
+    float q3q3 = q3 * q3;
+
+    // gradient descent corrective step
+    float s0 = _4q0 * q2q2 + _2q2 * a.x + _4q0 * q1q1 - _2q1 * a.y;
+    float s1 = _4q1 * q3q3 - _2q3 * a.x + 4.0f * q0q0 * q1 - _2q0 * a.y - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * a.z;
+    float s2 = 4.0f * q0q0 * q2 + _2q0 * a.x + _4q2 * q3q3 - _2q3 * a.y - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * a.z;
+    float s3 = 4.0f * q1q1 * q3 - _2q1 * a.x + 4.0f * q2q2 * q3 - _2q2 * a.y;
+
+    float norm = sqrtf(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+    if (norm > 0.0f) {
+      float recipNorm = 1.0f / norm;
+      qDot1 -= beta * s0 * recipNorm;
+      qDot2 -= beta * s1 * recipNorm;
+      qDot3 -= beta * s2 * recipNorm;
+      qDot4 -= beta * s3 * recipNorm;
+    }
+  }
+
+  // integrate rate of change of quaternion
+  q.w = q0 + qDot1 * dt;
+  q.x = q1 + qDot2 * dt;
+  q.y = q2 + qDot3 * dt;
+  q.z = q3 + qDot4 * dt;
+
+  normalize();
+}
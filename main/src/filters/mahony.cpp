@@ -0,0 +1,84 @@
+#include <filters/mahony.h>
+
+void Mahony::update(Vector3D accel, Vector3D gyro, Vector3D mag, float dt) {
+  // fall back to the IMU algorithm if the magnetometer reading is invalid
+  if (mag.x == 0.0f && mag.y == 0.0f && mag.z == 0.0f) {
+    updateIMU(accel, gyro, dt);
+    return;
+  }
+
+  float accelNorm = accel.magnitude();
+  if (accelNorm > 0.0f) {
+    Vector3D a = accel * (1.0f / accelNorm);
+    Vector3D m = mag * (1.0f / mag.magnitude());
+
+    float q0q0 = q.w * q.w;
+    float q0q1 = q.w * q.x;
+    float q0q2 = q.w * q.y;
+    float q0q3 = q.w * q.z;
+    float q1q1 = q.x * q.x;
+    float q1q2 = q.x * q.y;
+    float q1q3 = q.x * q.z;
+    float q2q2 = q.y * q.y;
+    float q2q3 = q.y * q.z;
+    float q3q3 = q.z * q.z;
+
+    // reference direction of earth's magnetic field
+    float hx = 2.0f * (m.x * (0.5f - q2q2 - q3q3) + m.y * (q1q2 - q0q3) + m.z * (q1q3 + q0q2));
+    float hy = 2.0f * (m.x * (q1q2 + q0q3) + m.y * (0.5f - q1q1 - q3q3) + m.z * (q2q3 - q0q1));
+    float bx = sqrtf(hx * hx + hy * hy);
+    float bz = 2.0f * (m.x * (q1q3 - q0q2) + m.y * (q2q3 + q0q1) + m.z * (0.5f - q1q1 - q2q2));
+
+    // estimated direction of gravity and magnetic field
+    Vector3D halfV(q1q3 - q0q2, q0q1 + q2q3, q0q0 - 0.5f + q3q3);
+    Vector3D halfW(
+      bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2),
+      bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3),
+      bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2));
+
+    // error is the sum of cross products between estimated and measured directions
+    correct(gyro, a.cross(halfV) + m.cross(halfW), dt);
+  }
+
+  integrate(gyro, dt);
+}
+
+void Mahony::updateIMU(Vector3D accel, Vector3D gyro, float dt) {
+  float accelNorm = accel.magnitude();
+  if (accelNorm > 0.0f) {
+    Vector3D a = accel * (1.0f / accelNorm);
+
+    // estimated direction of gravity
+    Vector3D halfV(
+      q.x * q.z - q.w * q.y,
+      q.w * q.x + q.y * q.z,
+      q.w * q.w - 0.5f + q.z * q.z);
+
+    correct(gyro, a.cross(halfV), dt);
+  }
+
+  integrate(gyro, dt);
+}
+
+void Mahony::correct(Vector3D &gyro, Vector3D halfError, float dt) {
+  if (twoKi > 0.0f) {
+    integralFeedback += halfError * (twoKi * dt);
+    gyro += integralFeedback;
+  }
+  else
+    integralFeedback = Vector3D();
+
+  gyro += halfError * twoKp;
+}
+
+void Mahony::integrate(Vector3D gyro, float dt) {
+  gyro *= 0.5f * dt;
+
+  float qa = q.w, qb = q.x, qc = q.y;
+  q.w += -qb * gyro.x - qc * gyro.y - q.z * gyro.z;
+  q.x += qa * gyro.x + qc * gyro.z - q.z * gyro.y;
+  q.y += qa * gyro.y - qb * gyro.z + q.z * gyro.x;
+  q.z += qa * gyro.z + qb * gyro.y - qc * gyro.x;
+
+  normalize();
+}
@@ -0,0 +1,98 @@
+#include <filters/orientation-classifier.h>
+
+#define DEG_TO_RAD 0.017453292519943295f
+
+// cosine at the midpoint between two sides, the furthest gravity gets from both cones
+#define MIDPOINT_COS 0.70710678f
+
+void OrientationClassifier::configure(float upMin, float upMax, uint32_t dwellTime) {
+  float cone = fminf(90.0f - upMin, upMax - 90.0f);
+  cone = fmaxf(1.0f, fminf(cone, 40.0f));
+
+  enterCos = cosf(cone * DEG_TO_RAD);
+  exitCos = cosf(fminf(cone + ORIENTATION_HYSTERESIS, 44.0f) * DEG_TO_RAD);
+  dwell = dwellTime;
+}
+
+void OrientationClassifier::reset(Orientation initial) {
+  state = initial;
+  pending = initial;
+  confidence = 0.0f;
+}
+
+Orientation OrientationClassifier::dominantAxis(Vector3D gravity) {
+  Vector3D a = gravity.abs();
+
+  // ties are left unknown
+  if (a.x > a.y && a.x > a.z)
+    return gravity.x > 0 ? FrontSideUp : BackSideUp;
+  else if (a.y > a.x && a.y > a.z)
+    return gravity.y > 0 ? RightSideUp : LeftSideUp;
+  else if (a.z > a.x && a.z > a.y)
+    return gravity.z > 0 ? TopSideUp : BottomSideUp;
+
+  return UnknownSideUp;
+}
+
+float OrientationClassifier::alignment(Orientation side, Vector3D unit) {
+  switch (side) {
+    case FrontSideUp: return unit.x;
+    case BackSideUp: return -unit.x;
+    case RightSideUp: return unit.y;
+    case LeftSideUp: return -unit.y;
+    case TopSideUp: return unit.z;
+    case BottomSideUp: return -unit.z;
+    default: return 0.0f;
+  }
+}
+
+float OrientationClassifier::confidenceFor(Orientation side, Vector3D unit, float magnitude) {
+  // gravity estimates far from 1 g are polluted by motion
+  float trust = 1.0f - fabsf(magnitude - 1.0f) / ORIENTATION_MIN_MAGNITUDE;
+  trust = fmaxf(0.0f, fminf(trust, 1.0f));
+
+  float score;
+  if (side == UnknownSideUp) {
+    Vector3D a = unit.abs();
+    float best = fmaxf(a.x, fmaxf(a.y, a.z));
+    score = (exitCos - best) / fmaxf(exitCos - MIDPOINT_COS, 0.01f);
+  }
+  else
+    score = (alignment(side, unit) - exitCos) / (1.0f - exitCos);
+
+  return fmaxf(0.0f, fminf(score, 1.0f)) * trust;
+}
+
+Orientation OrientationClassifier::update(Vector3D gravity, unsigned long now) {
+  float magnitude = gravity.magnitude();
+  if (magnitude < ORIENTATION_MIN_MAGNITUDE) {
+    confidence = 0.0f;
+    return state;
+  }
+
+  Vector3D unit = gravity * (1.0f / magnitude);
+  Orientation dominant = dominantAxis(unit);
+
+  Orientation candidate;
+  if (state != UnknownSideUp && alignment(state, unit) >= exitCos)
+    candidate = state;
+  else if (alignment(dominant, unit) >= enterCos)
+    candidate = dominant;
+  else
+    candidate = UnknownSideUp;
+
+  if (candidate == state)
+    pending = state;
+  else {
+    if (candidate != pending) {
+      pending = candidate;
+      pendingSince = now;
+    }
+
+    if (now - pendingSince >= dwell)
+      state = pending;
+  }
+
+  confidence = confidenceFor(state, unit, magnitude);
+  return state;
+}
@@ -0,0 +1,64 @@
+#include <filters/tilt-estimator.h>
+
+#define RAD_TO_DEG 57.29577951308232f
+
+void TiltEstimator::reset() {
+  _gravity = Vector3D(0.0f, 0.0f, 1.0f);
+  _load = 1.0f;
+  _lateral = 0.0f;
+  _leanSign = 1.0f;
+  _initialized = false;
+}
+
+void TiltEstimator::update(Vector3D accel, float dt) {
+  float norm = accel.magnitude();
+  if (norm < 0.05f || dt <= 0.0f)
+    return;
+
+  Vector3D measured = accel * (1.0f / norm);
+
+  if (!_initialized) {
+    _gravity = measured;
+    _load = norm;
+    _initialized = true;
+    return;
+  }
+
+  // trust the accelerometer less the further it is from 1 g
+  float weight = 1.0f - fabsf(norm - 1.0f) / _rejectionBand;
+  weight = weight < 0.0f ? 0.0f : weight;
+
+  float gain = weight * dt / (_timeConstant + dt);
+  _gravity += (measured - _gravity) * gain;
+
+  float length = _gravity.magnitude();
+  if (length > 0.0f)
+    _gravity *= 1.0f / length;
+
+  // load factor and lateral residual (sensor y) used to recover the hidden lean
+  _load += (norm - _load) * (dt / (TILT_LOAD_TIME_CONSTANT + dt));
+
+  Vector3D residual = accel - _gravity * norm;
+  _lateral += (residual.y - _lateral) * (dt / (TILT_LATERAL_TIME_CONSTANT + dt));
+
+  // latch the lean direction on turn entry, before the load factor builds up
+  if (_load <= 1.0f + TILT_LOAD_DEADBAND) {
+    float roll = atan2f(_gravity.y, _gravity.z) * RAD_TO_DEG;
+    float direction = fabsf(roll) >= TILT_MIN_LEAN ? roll : _lateral;
+    _leanSign = direction < 0.0f ? -1.0f : 1.0f;
+  }
+}
+
+float TiltEstimator::getCentripetalLean() {
+  if (_load <= 1.0f + TILT_LOAD_DEADBAND)
+    return 0.0f;
+
+  return _leanSign * acosf(1.0f / _load) * RAD_TO_DEG;
+}
+
+Vector3D TiltEstimator::getAHRS() {
+  float roll = atan2f(_gravity.y, _gravity.z) * RAD_TO_DEG;
+  float pitch = atan2f(-_gravity.x, sqrtf(_gravity.y * _gravity.y + _gravity.z * _gravity.z)) * RAD_TO_DEG;
+
+  return Vector3D(roll + getCentripetalLean(), pitch, 0.0f);
+}
@@ -33,6 +33,10 @@ void AmpButton::init(TouchTaskListener *listener) {
   ESP_ERROR_CHECK(ret);
   ret = gpio_isr_handler_add(BUTTON_INPUT, button_isr_handler, (void*) BUTTON_INPUT);
   ESP_ERROR_CHECK(ret);
+
+  // a press has to wake the cpu from light sleep for the edge interrupt to fire
+  gpio_wakeup_enable(BUTTON_INPUT, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
 }
 
 void AmpButton::deinit() {
@@ -40,10 +44,10 @@ void AmpButton::deinit() {
   //detachInterrupt(digitalPinToInterrupt(BUTTON_INPUT));
 }
 
-void AmpButton::process() {
+void AmpButton::process(TickType_t wait) {
   uint32_t button;
-  // process input events from queue
-  if (xQueueReceive(AmpButton::buttonEventQueue, &button, 0)) {
+  // process input events from queue, blocking up to wait for the next edge
+  if (xQueueReceive(AmpButton::buttonEventQueue, &button, wait)) {
     auto level = gpio_get_level(BUTTON_INPUT);
     if (_listener != nullptr)
       level ? _listener->onTouchUp() : _listener->onTouchDown();
@@ -2,6 +2,19 @@
 
 lis3dh_sensor_t* AmpIMU::sensor = NULL;
 
+#if defined(IMU_INT)
+static TaskHandle_t activityTask = NULL;
+
+static void IRAM_ATTR activity_isr_handler(void* args) {
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  if (activityTask != NULL)
+    vTaskNotifyGiveFromISR(activityTask, &xHigherPriorityTaskWoken);
+
+  if (xHigherPriorityTaskWoken)
+    portYIELD_FROM_ISR();
+}
+#endif
+
 AmpIMU::AmpIMU() {
   spi_bus_init(VSPI_HOST, IMU_CLK, IMU_MISO, IMU_MOSI);
   // vspi.begin(IMU_MOSI, IMU_MISO, IMU_CLK, 0);
@@ -84,4 +97,68 @@ void AmpIMU::setPowerMode(IMUState state) {
         break;
     }
   }
+}
+
+void AmpIMU::setActivityDetection(bool enabled, TaskHandle_t wakeTask) {
+  if (sensor == NULL)
+    return;
+
+  if (enabled) {
+    // 10 Hz in low power mode is enough to notice someone picking the board up
+    lis3dh_set_mode(sensor, lis3dh_odr_10, lis3dh_low_power, true, true, true);
+    lis3dh_config_hpf(sensor, lis3dh_hpf_normal, 0, false, false, true, false);
+
+    lis3dh_int_event_config_t config;
+    config.mode = lis3dh_wake_up;
+    config.threshold = IMU_ACTIVITY_THRESHOLD;
+    config.x_low_enabled = false;
+    config.x_high_enabled = true;
+    config.y_low_enabled = false;
+    config.y_high_enabled = true;
+    config.z_low_enabled = false;
+    config.z_high_enabled = true;
+    config.latch = true;
+    config.duration = 0;
+
+    lis3dh_set_int_event_config(sensor, &config, lis3dh_int_event1_gen);
+    lis3dh_enable_int(sensor, lis3dh_int_event1, lis3dh_int1_signal, true);
+
+    // clear anything latched before parking
+    lis3dh_int_event_source_t source;
+    lis3dh_get_int_event_source(sensor, &source, lis3dh_int_event1_gen);
+
+#if defined(IMU_INT)
+    activityTask = wakeTask;
+
+    gpio_config_t io_config;
+    io_config.intr_type = GPIO_INTR_POSEDGE;
+    io_config.mode = GPIO_MODE_INPUT;
+    io_config.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_config.pull_up_en = GPIO_PULLUP_DISABLE;
+    io_config.pin_bit_mask = IO_PIN_SELECT(IMU_INT);
+    gpio_config(&io_config);
+
+    gpio_isr_handler_add(IMU_INT, activity_isr_handler, NULL);
+    gpio_wakeup_enable(IMU_INT, GPIO_INTR_HIGH_LEVEL);
+#endif
+  }
+  else {
+#if defined(IMU_INT)
+    gpio_wakeup_disable(IMU_INT);
+    gpio_isr_handler_remove(IMU_INT);
+    activityTask = NULL;
+#endif
+
+    lis3dh_enable_int(sensor, lis3dh_int_event1, lis3dh_int1_signal, false);
+    lis3dh_config_hpf(sensor, lis3dh_hpf_normal, 0, false, false, false, false);
+    setPowerMode(imuStatus);
+  }
+}
+
+bool AmpIMU::activityDetected() {
+  lis3dh_int_event_source_t source;
+  if (sensor == NULL || !lis3dh_get_int_event_source(sensor, &source, lis3dh_int_event1_gen))
+    return false;
+
+  return source.active;
 }
\ No newline at end of file
@@ -6,6 +6,11 @@ void AmpLeds::init() {
   // setup the status led
   status = new OneWireLED(NeoPixel, STATUS_LED, 0, 1);
   (*status)[0] = lightOff;
+
+#ifdef CONFIG_PM_ENABLE
+  if (apbLock == NULL)
+    esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "leds", &apbLock);
+#endif
 }
 
 void AmpLeds::deinit() {
@@ -15,6 +20,12 @@ void AmpLeds::deinit() {
 void AmpLeds::process() {
   ledsReady.wait();
   if (dirty) {
+    dirty = false;
+
+#ifdef CONFIG_PM_ENABLE
+    esp_pm_lock_acquire(apbLock);
+#endif
+
     status->show();
     for (auto pair : channels) {
       if (pair.second != nullptr) {
@@ -22,6 +33,32 @@ void AmpLeds::process() {
           pair.second->show();
       }
     }
+
+    // let the frame finish before the clocks may scale down again, a traced
+    // brake also only counts as shown once the frame is clocked out
+    auto telemetry = LatencyTelemetry::instance();
+    bool traced = telemetry->waitingFor(Latency_Overlay) || telemetry->waitingFor(Latency_Shown);
+    bool finishFrame = traced;
+#ifdef CONFIG_PM_ENABLE
+    finishFrame = true;
+#endif
+
+    if (finishFrame) {
+      status->wait(5);
+      for (auto pair : channels)
+        if (pair.second != nullptr)
+          pair.second->wait(5);
+    }
+
+    // only the stage the trace is waiting for is recorded
+    if (traced) {
+      telemetry->mark(Latency_Overlay);
+      telemetry->mark(Latency_Shown);
+    }
+
+#ifdef CONFIG_PM_ENABLE
+    esp_pm_lock_release(apbLock);
+#endif
   }
   // if (statusDirty) {
   //   ESP_LOGV(LEDS_TAG,"Status is dirty. Re-rendering");
@@ -146,4 +183,15 @@ void AmpLeds::setPixels(uint8_t channelNumber, Color color, uint16_t start, uint
     else
       ESP_LOGE(LEDS_TAG, "Pixel %d exceeds channel %d led count (%d)", i, channelNumber, leds[channelNumber]);
   }
+}
+
+void AmpLeds::writePixels(uint8_t channelNumber, const uint8_t *rgb, uint16_t start, uint16_t count) {
+  ledsReady.wait();
+  auto controller = channels[channelNumber];
+  if (controller == nullptr)
+    return;
+
+  uint16_t end = std::min((uint16_t)(start + count), leds[channelNumber]);
+  for (uint16_t i = start; i < end; i++, rgb += 3)
+    (*controller)[i] = Color(gamma8[rgb[0]], gamma8[rgb[1]], gamma8[rgb[2]]);
 }
\ No newline at end of file
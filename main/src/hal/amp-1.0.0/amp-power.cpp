@@ -33,6 +33,15 @@ void AmpPower::init() {
 
   adc1_config_width(ADC_WIDTH_BIT_12);
   adc1_config_channel_atten(ADC1_CHANNEL_3, ADC_ATTEN_DB_0);
+
+#ifdef CONFIG_PM_ENABLE
+  // scale the cpu down and enter light sleep from tickless idle while every task is blocked
+  esp_pm_config_esp32_t pmConfig;
+  pmConfig.max_freq_mhz = CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ;
+  pmConfig.min_freq_mhz = PM_MIN_CPU_FREQ_MHZ;
+  pmConfig.light_sleep_enable = true;
+  ESP_ERROR_CHECK_WITHOUT_ABORT(esp_pm_configure(&pmConfig));
+#endif
 }
 
 void AmpPower::process() {
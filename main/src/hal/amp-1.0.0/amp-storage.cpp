@@ -79,9 +79,10 @@ std::string AmpStorage::readFile(std::string filename) {
   stat(filename.c_str(), &st);
   auto size = st.st_size;
 
-  char* buffer[size + 1];
-  fread((uint8_t*)&buffer, 1, size, file);
-  std::string data((char*)buffer, size + 1);
+  // configs can be far larger than the task stack, read straight into the string
+  std::string data(size, '\0');
+  data.resize(fread(&data[0], 1, size, file));
+  fclose(file);
 
   return data;
 }
@@ -211,4 +212,42 @@ std::string AmpStorage::getString(std::string key) {
   }
 
   return std::string(valueRaw);
-}
\ No newline at end of file
+}
+
+void AmpStorage::saveBlob(const char* key, const void *value, size_t length) {
+  nvs_handle handle;
+
+  auto err = nvs_open(storage, NVS_READWRITE, &handle);
+  err = nvs_set_blob(handle, key, value, length);
+  err = nvs_commit(handle);
+
+  nvs_close(handle);
+
+  if (err != ESP_OK)
+    ESP_LOGW(STORAGE_TAG, "Unable to save %s to NVS", key);
+}
+
+bool AmpStorage::getBlob(const char* key, void *value, size_t length) {
+  nvs_handle handle;
+
+  auto err = nvs_open(storage, NVS_READWRITE, &handle);
+
+  // only a value of exactly the expected size is usable
+  size_t size = length;
+  err = nvs_get_blob(handle, key, value, &size);
+
+  nvs_close(handle);
+
+  return err == ESP_OK && size == length;
+}
+
+void AmpStorage::eraseKey(const char* key) {
+  nvs_handle handle;
+
+  auto err = nvs_open(storage, NVS_READWRITE, &handle);
+  err = nvs_erase_key(handle, key);
+  if (err == ESP_OK)
+    nvs_commit(handle);
+
+  nvs_close(handle);
+}
@@ -1,9 +1,36 @@
 #include <hal/ble.h>
+#include <algorithm>
 
 FreeRTOS::Semaphore BluetoothLE::bleReady = FreeRTOS::Semaphore("ble");
 
-BluetoothLE::BluetoothLE() {
-  touchEventQueue = xQueueCreate(10, sizeof(std::vector<TouchType>));
+static_assert(CONNECTION_HANDLE_NONE == BLE_HS_CONN_HANDLE_NONE, "connection policy handle");
+static_assert(CONNECTION_BUSY == BLE_HS_EALREADY, "connection policy busy code");
+
+// the connection policy's GAP calls, straight to NimBLE
+class NimBLEConnectionGap : public ConnectionGap {
+  public:
+    bool isConnected(uint16_t handle) {
+      ble_gap_conn_desc desc;
+      return ble_gap_conn_find(handle, &desc) == 0;
+    }
+
+    int setDataLength(uint16_t handle, uint16_t octets, uint16_t time) {
+      return ble_gap_set_data_len(handle, octets, time);
+    }
+
+    int updateParams(uint16_t handle, const ConnectionProfile &profile) {
+      ble_gap_upd_params params = { };
+      params.itvl_min = profile.minInterval;
+      params.itvl_max = profile.maxInterval;
+      params.latency = profile.latency;
+      params.supervision_timeout = profile.timeout;
+      return ble_gap_update_params(handle, &params);
+    }
+};
+
+static NimBLEConnectionGap connectionGap;
+
+BluetoothLE::BluetoothLE() : _policy(&connectionGap) {
   bleReady.take();
 }
 
@@ -16,11 +43,12 @@ void BluetoothLE::onPowerDown() {
 }
 
 void BluetoothLE::process() {
-  if (uxQueueMessagesWaiting(touchEventQueue)) {
-    xQueueReceive(touchEventQueue, &touches, 0);
+  Event event;
+  while (poll(event))
+    if (event.type == Event_TouchSequence)
+      onTouchEvent(event.touches);
 
-    onTouchEvent(&touches);
-  }
+  _policy.apply(millis());
 
   if (publicAdvertising && millis() - publicAdvertiseStart >= PUBLIC_ADVERTISEMENT_MS) {
     notifyListeners(false);
@@ -47,7 +75,17 @@ void BluetoothLE::startServer(void *params) {
 
   for (;;) {
     ble->process();
-    delay(1000);
+
+    // time out to end public advertising and for connection parameters,
+    // touch events, connections and new transfers wake the task
+    TickType_t wait = ble->nextPolicyDelay();
+    if (ble->publicAdvertising) {
+      long remaining = PUBLIC_ADVERTISEMENT_MS - (long)(millis() - ble->publicAdvertiseStart);
+      wait = std::min(wait, remaining >= 0 ? (TickType_t)((remaining + portTICK_PERIOD_MS) / portTICK_PERIOD_MS) : 0);
+    }
+
+    PowerTelemetry::instance()->setWait(Consumer_Ble, wait);
+    ulTaskNotifyTake(pdTRUE, wait);
   }
 }
 
@@ -112,15 +150,21 @@ void BluetoothLE::onConnect(NimBLEServer *server, ble_gap_conn_desc *desc) {
     }
   }
 
+  // new links get parameters for the current activity once they settle
+  _policy.connected(desc->conn_handle, millis());
+  xTaskNotifyGive(bleTaskHandle);
+
   advertising->start();
 }
 
 void BluetoothLE::onDisconnect(NimBLEServer *server) {
+  // the ble task sweeps the closed link
+  xTaskNotifyGive(bleTaskHandle);
   advertising->start();
 }
 
-void BluetoothLE::onTouchEvent(std::vector<TouchType> *touches) {
-  if (touches->size() == 3) {
+void BluetoothLE::onTouchEvent(TouchSequence touches) {
+  if (touches.count == 3) {
     notifyListeners(true);
     updateAdvertising(AmpStorage::getDeviceName(), true);
     NimBLEDevice::setSecurityAuth(true, true, true);
@@ -128,14 +172,51 @@ void BluetoothLE::onTouchEvent(std::vector<TouchType> *touches) {
 }
 
 void BluetoothLE::addAdvertisingListener(BleListener *listener) {
-  listeners.push_back(listener);
+  EventBus::instance()->subscribe(listener, Event_Advertising);
 }
 
 void BluetoothLE::notifyListeners(bool isPublic) {
   publicAdvertising = isPublic;
   publicAdvertiseStart = millis();
 
-  for (auto listener : listeners)
-    if (listener->advertisingQueue != NULL)
-      xQueueSend(listener->advertisingQueue, &isPublic, 0);
+  Event event;
+  event.type = Event_Advertising;
+  event.publicAdvertising = isPublic;
+  EventBus::instance()->publish(event);
+}
+
+void BluetoothLE::traffic(BleActivity activity, size_t bytes) {
+  // faster parameters are wanted right away, slower ones wait for the hold
+  if (_policy.traffic(activity, bytes, millis()))
+    xTaskNotifyGive(bleTaskHandle);
+}
+
+TickType_t BluetoothLE::nextPolicyDelay() {
+  long delay = _policy.nextDelay(millis());
+  if (delay < 0)
+    return portMAX_DELAY;
+
+  return (delay + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+}
+
+ConnectionStats BluetoothLE::getConnectionStats() {
+  auto now = millis();
+  ConnectionStats stats = { };
+  stats.activity = _policy.getActivity(now);
+  stats.throughput = _policy.getThroughput(now);
+
+  uint16_t handle = _policy.firstLink();
+  ble_gap_conn_desc desc;
+  if (handle != BLE_HS_CONN_HANDLE_NONE && ble_gap_conn_find(handle, &desc) == 0) {
+    stats.interval = desc.conn_itvl;
+    stats.latency = desc.conn_latency;
+    stats.timeout = desc.supervision_timeout;
+    stats.mtu = server->getPeerMTU(handle);
+  }
+
+  return stats;
+}
+
+BleActivity BluetoothLE::getActivity() {
+  return _policy.getActivity(millis());
 }
\ No newline at end of file
@@ -12,14 +12,24 @@ void Buttons::onPowerDown() {
 }
 
 void Buttons::process() {
-  ampButtons.process();
+  // block on the button interrupt, only time out while a touch interaction is pending
+  TickType_t wait = portMAX_DELAY;
+  if (touches.size() > 0 && touchEnd > touchStart) {
+    long remaining = touchEventTimeout - (long)(millis() - touchEnd);
+    wait = remaining >= 0 ? (remaining + portTICK_PERIOD_MS) / portTICK_PERIOD_MS : 0;
+  }
+
+  PowerTelemetry::instance()->setWait(Consumer_Buttons, wait);
+  ampButtons.process(wait);
 
   if (touchEnd > touchStart && millis() - touchEnd > touchEventTimeout && touches.size() > 0) {
     ESP_LOGD(BUTTONS_TAG,"Touch interaction ended. Touches: %d", touches.size());
 
-    for (auto listener : touchListeners)
-      if (listener->touchEventQueue != NULL)
-        xQueueSendToBack(listener->touchEventQueue, &touches, 0);
+    Event event;
+    event.type = Event_TouchSequence;
+    event.touches.count = std::min(touches.size(), (size_t)TOUCH_SEQUENCE_MAX);
+    std::copy(touches.begin(), touches.begin() + event.touches.count, event.touches.touches);
+    EventBus::instance()->publish(event);
 
     // reset touches
     touches.clear();
@@ -30,10 +40,10 @@ void Buttons::onTouchDown() {
   touchStart = millis();
   ESP_LOGD(BUTTONS_TAG,"Primary Button: Pressed");
 
-  bool touch = true;
-  for (auto listener : touchListeners)
-    if (listener->touchQueue != NULL)
-      xQueueSendToBack(listener->touchQueue, &touch, 0);
+  Event event;
+  event.type = Event_Touch;
+  event.touched = true;
+  EventBus::instance()->publish(event);
 }
 
 void Buttons::onTouchUp() {
@@ -41,11 +51,10 @@ void Buttons::onTouchUp() {
     touchEnd = millis();
     ESP_LOGD(BUTTONS_TAG,"Primary Button: Released");
 
-    bool touch = false;
-    for (auto listener : touchListeners)
-      if (listener->touchQueue != NULL)
-        xQueueSendToBack(listener->touchQueue, &touch, 0);
-      // listener->onTouchUp();
+    Event event;
+    event.type = Event_Touch;
+    event.touched = false;
+    EventBus::instance()->publish(event);
 
     long duration = touchEnd - touchStart;
     TouchType type = duration < holdDuration ? Tap : Hold;
@@ -54,7 +63,8 @@ void Buttons::onTouchUp() {
 }
 
 void Buttons::addTouchListener(TouchListener *listener) {
-  touchListeners.push_back(listener);
+  EventBus::instance()->subscribe(listener, Event_Touch);
+  EventBus::instance()->subscribe(listener, Event_TouchSequence);
 }
 
 void Buttons::inputTask(void *parameters) {
@@ -63,6 +73,5 @@ void Buttons::inputTask(void *parameters) {
   for (;;) {
     Power::powerDown.wait("power");
     buttons->process();
-    delay(10);
   }
 }
\ No newline at end of file
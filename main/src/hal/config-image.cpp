@@ -0,0 +1,171 @@
+#include <hal/config-image.h>
+#include "esp32/rom/crc.h"
+
+bool ConfigImage::map() {
+  auto partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)CONFIG_IMAGE_SUBTYPE, "config");
+  if (partition == NULL) {
+    ESP_LOGD(CONFIG_IMAGE_TAG,"No config partition");
+    return false;
+  }
+
+  const void *data;
+  auto err = esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &data, &_handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(CONFIG_IMAGE_TAG,"Unable to map config partition: %s", esp_err_to_name(err));
+    return false;
+  }
+
+  if (!validate((const uint8_t*)data, partition->size)) {
+    spi_flash_munmap(_handle);
+    return false;
+  }
+
+  _data = (const uint8_t*)data;
+  _header = (const ConfigImageHeader*)data;
+
+  ESP_LOGI(CONFIG_IMAGE_TAG,"Mapped config image: %d bytes, %d channels, %d regions, %d effects",
+    _header->size, _header->channelCount, _header->regionCount, _header->effectCount);
+  return true;
+}
+
+void ConfigImage::unmap() {
+  if (_header == NULL)
+    return;
+
+  spi_flash_munmap(_handle);
+  _header = NULL;
+  _data = NULL;
+}
+
+// count entries of T at offset end inside size. Checked by division so
+// large offsets and counts can't wrap the 32 bit sum past the check.
+template <typename T>
+static bool fits(uint32_t offset, uint32_t count, uint32_t size) {
+  return offset <= size && count <= (size - offset) / sizeof(T);
+}
+
+bool ConfigImage::validate(const uint8_t *data, size_t size) {
+  auto header = (const ConfigImageHeader*)data;
+
+  // erased flash reads as 0xFF, don't bother logging an error for it
+  if (size < sizeof(ConfigImageHeader) || header->magic != CONFIG_IMAGE_MAGIC) {
+    ESP_LOGD(CONFIG_IMAGE_TAG,"Config partition holds no image");
+    return false;
+  }
+
+  if (header->version != CONFIG_IMAGE_VERSION || header->headerSize != sizeof(ConfigImageHeader)) {
+    ESP_LOGW(CONFIG_IMAGE_TAG,"Unsupported config image version %d", header->version);
+    return false;
+  }
+
+  if (header->size < sizeof(ConfigImageHeader) || header->size > size) {
+    ESP_LOGW(CONFIG_IMAGE_TAG,"Config image size %d does not fit the partition", header->size);
+    return false;
+  }
+
+  // tables must end inside the image, the string table runs to the end
+  uint32_t actions = Group_Count * ACTION_COUNT;
+  if (!fits<ConfigImageMotion>(header->motionOffset, 1, header->size) ||
+    !fits<ConfigImageChannel>(header->channelsOffset, header->channelCount, header->size) ||
+    !fits<ConfigImageRegion>(header->regionsOffset, header->regionCount, header->size) ||
+    !fits<ConfigImageSection>(header->sectionsOffset, header->sectionCount, header->size) ||
+    !fits<ConfigImageAction>(header->actionsOffset, actions, header->size) ||
+    !fits<ConfigImageEffect>(header->effectsOffset, header->effectCount, header->size) ||
+    header->stringsOffset >= header->size) {
+    ESP_LOGW(CONFIG_IMAGE_TAG,"Config image tables out of bounds");
+    return false;
+  }
+
+  uint32_t crc = crc32_le(0, data + sizeof(ConfigImageHeader), header->size - sizeof(ConfigImageHeader));
+  if (crc != header->crc) {
+    ESP_LOGW(CONFIG_IMAGE_TAG,"Config image crc mismatch: %08x != %08x", crc, header->crc);
+    return false;
+  }
+
+  // accessors index the tables without checks, every entry has to point
+  // inside the table it refers to
+  auto regions = (const ConfigImageRegion*)(data + header->regionsOffset);
+  for (uint16_t i = 0; i < header->regionCount; i++) {
+    uint32_t name = header->stringsOffset + regions[i].name;
+    if (regions[i].firstSection + regions[i].sectionCount > header->sectionCount ||
+      name >= header->size || memchr(data + name, '\0', header->size - name) == NULL) {
+      ESP_LOGW(CONFIG_IMAGE_TAG,"Config image region %d out of bounds", i);
+      return false;
+    }
+  }
+
+  auto entries = (const ConfigImageAction*)(data + header->actionsOffset);
+  for (uint32_t i = 0; i < actions; i++) {
+    if (entries[i].firstEffect + entries[i].effectCount > header->effectCount) {
+      ESP_LOGW(CONFIG_IMAGE_TAG,"Config image action %d out of bounds", i);
+      return false;
+    }
+  }
+
+  auto effects = (const ConfigImageEffect*)(data + header->effectsOffset);
+  for (uint16_t i = 0; i < header->effectCount; i++) {
+    if (effects[i].region >= header->regionCount) {
+      ESP_LOGW(CONFIG_IMAGE_TAG,"Config image effect %d out of bounds", i);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const ConfigImageEffect* ConfigImage::actionEffects(ActionGroup group, Actions action, uint16_t *count) {
+  *count = 0;
+  if (_header == NULL || group >= Group_Count || action >= ACTION_COUNT)
+    return NULL;
+
+  auto entry = table<ConfigImageAction>(_header->actionsOffset) + group * ACTION_COUNT + action;
+  if (entry->effectCount == 0)
+    return NULL;
+
+  *count = entry->effectCount;
+  return table<ConfigImageEffect>(_header->effectsOffset) + entry->firstEffect;
+}
+
+void ConfigImage::loadMotionConfig(MotionConfig *config) {
+  auto motion = table<ConfigImageMotion>(_header->motionOffset);
+
+  config->autoOrientation = motion->flags & CONFIG_IMAGE_AUTO_ORIENTATION;
+  config->autoMotion = motion->flags & CONFIG_IMAGE_AUTO_MOTION;
+  config->autoTurn = motion->flags & CONFIG_IMAGE_AUTO_TURN;
+  config->relativeTurnZero = motion->flags & CONFIG_IMAGE_RELATIVE_TURN_ZERO;
+
+  config->turnThreshold = motion->turnThreshold;
+  config->brakeThreshold = motion->brakeThreshold;
+  config->accelerationThreshold = motion->accelerationThreshold;
+  config->brakeJerkThreshold = motion->brakeJerkThreshold;
+  config->motionDwell = motion->motionDwell;
+  config->motionMaxLatency = motion->motionMaxLatency;
+  config->motionAxis = (AccelerationAxis)motion->motionAxis;
+  config->turnAxis = (AttitudeAxis)motion->turnAxis;
+  config->orientationTrigger = (Orientation)motion->orientationTrigger;
+  config->orientationUpMin = motion->orientationUpMin;
+  config->orientationUpMax = motion->orientationUpMax;
+  config->orientationDwell = motion->orientationDwell;
+  config->orientationMinConfidence = motion->orientationMinConfidence;
+  config->parkTimeout = motion->parkTimeout;
+  config->ahrsFilter = (AhrsFilterType)motion->ahrsFilter;
+}
+
+void ConfigImage::effectParameters(const ConfigImageEffect *effect, LightingParameters *params) {
+  auto region = regions() + effect->region;
+
+  params->region = regionName(region);
+  params->effect = (LightEffect)effect->effect;
+  params->layer = effect->layer;
+  params->duration = effect->duration;
+
+  params->first.color = Color(effect->first[0], effect->first[1], effect->first[2]);
+  params->first.random = effect->colorFlags & CONFIG_IMAGE_COLOR_RANDOM;
+  params->first.rainbow = effect->colorFlags & CONFIG_IMAGE_COLOR_RAINBOW;
+
+  params->second.color = Color(effect->second[0], effect->second[1], effect->second[2]);
+  params->second.random = (effect->colorFlags >> 2) & CONFIG_IMAGE_COLOR_RANDOM;
+  params->second.rainbow = (effect->colorFlags >> 2) & CONFIG_IMAGE_COLOR_RAINBOW;
+
+  params->third = { lightOff, false, false };
+}
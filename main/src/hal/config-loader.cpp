@@ -0,0 +1,247 @@
+#include <hal/config-loader.h>
+#include <hal/config.h>
+
+void ConfigLoader::begin(AmpConfig *config) {
+  _config = config;
+  _config->motion = defaultMotionConfig();
+  _depth = 0;
+  _valid = true;
+  _lights = false;
+}
+
+MotionConfig ConfigLoader::defaultMotionConfig() {
+  MotionConfig config;
+
+  config.autoOrientation = false;
+  config.autoMotion = false;
+  config.autoTurn = false;
+  config.relativeTurnZero = true;
+
+  config.brakeThreshold = DEFAULT_BRAKE_THRESHOLD;
+  config.accelerationThreshold = DEFAULT_ACCELERATION_THRESHOLD;
+  config.turnThreshold = DEFAULT_TURN_THRESHOLD;
+  config.brakeJerkThreshold = DEFAULT_BRAKE_JERK_THRESHOLD;
+  config.motionDwell = DEFAULT_MOTION_DWELL;
+  config.motionMaxLatency = DEFAULT_MOTION_MAX_LATENCY;
+  config.motionAxis = AccelerationAxis::X_Pos;
+  config.turnAxis = AttitudeAxis::Roll;
+  config.orientationTrigger = Orientation::UnknownSideUp;
+  config.orientationUpMin = DEFAULT_ORIENTATION_UP_MIN;
+  config.orientationUpMax = DEFAULT_ORIENTATION_UP_MAX;
+  config.orientationDwell = DEFAULT_ORIENTATION_DWELL;
+  config.orientationMinConfidence = DEFAULT_ORIENTATION_MIN_CONFIDENCE;
+  config.parkTimeout = DEFAULT_PARK_TIMEOUT;
+  config.ahrsFilter = AhrsFilterType::AHRS_Madgwick;
+
+  return config;
+}
+
+void ConfigLoader::logMotionConfig(MotionConfig *config) {
+  ESP_LOGV(CONFIG_TAG,"auto orientation config: %s", config->autoOrientation ? "true" : "false");
+  ESP_LOGV(CONFIG_TAG,"auto motion config: %s", config->autoMotion ? "true" : "false");
+  ESP_LOGV(CONFIG_TAG,"auto turn config: %s", config->autoTurn ? "true" : "false");
+
+  ESP_LOGV(CONFIG_TAG,"motion axis: %d brake threshold: %.2f acceleration threshold: %.2f", config->motionAxis, config->brakeThreshold, config->accelerationThreshold);
+  ESP_LOGV(CONFIG_TAG,"brake jerk threshold: %.2f dwell: %d ms max latency: %d ms", config->brakeJerkThreshold, config->motionDwell, config->motionMaxLatency);
+  ESP_LOGV(CONFIG_TAG,"orientation trigger: %d", config->orientationTrigger);
+  ESP_LOGV(CONFIG_TAG,"orientation up: %.0f - %.0f dwell: %d ms min confidence: %d%%", config->orientationUpMin, config->orientationUpMax, config->orientationDwell, config->orientationMinConfidence);
+  ESP_LOGV(CONFIG_TAG,"ahrs filter: %d", config->ahrsFilter);
+  ESP_LOGV(CONFIG_TAG,"park timeout: %d s", config->parkTimeout);
+}
+
+bool ConfigLoader::in(const char *root, const char *child) {
+  if (_depth < 1 || strcmp(key(0), root) != 0)
+    return false;
+
+  return child == NULL || (_depth >= 2 && strcmp(key(1), child) == 0);
+}
+
+void ConfigLoader::notMap() {
+  if (_depth == 0 || (_depth == 1 && strcmp(key(0), "lights") == 0)) {
+    ESP_LOGW(CONFIG_TAG, "Config %s is not a map", _depth == 0 ? "root" : "lights");
+    _valid = false;
+  }
+}
+
+void ConfigLoader::onMap(uint32_t size) {
+  if (_depth == 1 && strcmp(key(0), "lights") == 0)
+    _lights = true;
+
+  // a channel, section or effect starts
+  if (_depth == 3 && in("lights", "channels"))
+    _channel = { 0, 0, (LEDType)0 };
+  else if (_depth == 4 && in("lights", "regions")) {
+    _section = { 0, 0, 0 };
+    _sectionFields = 0;
+  }
+  else if (_depth == 3 && in("actions")) {
+    _effectRegion.clear();
+    _effect.clear();
+  }
+
+  _frames[_depth].map = true;
+  _frames[_depth].key[0] = '\0';
+  _depth++;
+}
+
+void ConfigLoader::onArray(uint32_t size) {
+  notMap();
+
+  // sections of a region follow
+  if (_depth == 3 && in("lights", "regions")) {
+    _region = LightRegion();
+    _region.name = key(2);
+    _region.count = 0;
+  }
+
+  _frames[_depth].map = false;
+  _frames[_depth].key[0] = '\0';
+  _depth++;
+}
+
+void ConfigLoader::onEnd() {
+  if (_depth == 4 && in("lights", "channels"))
+    _config->lights.channels[_channel.channel] = _channel;
+  else if (_depth == 5 && in("lights", "regions")) {
+    // channel, start and end are all required
+    if (_sectionFields == 0x07) {
+      _region.sections.push_back(_section);
+      uint16_t count = _section.end - _section.start;
+      _region.count += count;
+      _region.breaks.push_back(count);
+    }
+  }
+  else if (_depth == 4 && in("lights", "regions"))
+    _config->lights.regions[_region.name] = _region;
+  else if (_depth == 4 && in("actions")) {
+    std::string action = key(1);
+    LightingParameters effect;
+
+    if (_effectRegion.empty() || _effect.empty() || !Config::isAction(action) || !Config::parseEffect(_effect, &effect))
+      ESP_LOGW(CONFIG_TAG, "Unable to add effect - action: %s\tregion: %s\teffect: %s",
+        action.c_str(), _effectRegion.c_str(), _effect.c_str());
+    else {
+      effect.region = _effectRegion;
+
+      if (_config->actions.find(action) == _config->actions.end())
+        _config->actions[action] = new std::vector<LightingParameters>();
+
+      _config->actions[action]->push_back(effect);
+      ESP_LOGD(CONFIG_TAG, "Added effect - action: %s\tregion: %s\teffect: %s",
+        action.c_str(), _effectRegion.c_str(), _effect.c_str());
+    }
+  }
+
+  _depth--;
+}
+
+void ConfigLoader::onKey(const char *name) {
+  auto frame = &_frames[_depth - 1];
+
+  // a truncated region or action name would load under the wrong name
+  if (strlen(name) >= CONFIG_LOADER_KEY) {
+    ESP_LOGW(CONFIG_TAG, "Key %s is longer than %d characters", name, CONFIG_LOADER_KEY - 1);
+    _valid = false;
+  }
+
+  strncpy(frame->key, name, CONFIG_LOADER_KEY - 1);
+  frame->key[CONFIG_LOADER_KEY - 1] = '\0';
+}
+
+void ConfigLoader::onString(const char *value, bool truncated) {
+  notMap();
+
+  if (_depth != 4 || !in("actions"))
+    return;
+
+  if (truncated) {
+    ESP_LOGW(CONFIG_TAG, "Value for %s is too long", key(1));
+    return;
+  }
+
+  if (strcmp(key(3), "region") == 0)
+    _effectRegion = value;
+  else if (strcmp(key(3), "effect") == 0)
+    _effect = value;
+}
+
+void ConfigLoader::onNumber(double value) {
+  notMap();
+
+  if (_depth == 2 && in("motion"))
+    setMotion(&_config->motion, key(1), value);
+  else if (_depth == 4 && in("lights", "channels")) {
+    if (strcmp(key(3), "channel") == 0)
+      _channel.channel = value;
+    else if (strcmp(key(3), "leds") == 0)
+      _channel.leds = value;
+    else if (strcmp(key(3), "type") == 0)
+      _channel.type = (LEDType)value;
+  }
+  else if (_depth == 5 && in("lights", "regions")) {
+    if (strcmp(key(4), "channel") == 0) {
+      _section.channel = value;
+      _sectionFields |= 0x01;
+    }
+    else if (strcmp(key(4), "start") == 0) {
+      _section.start = value;
+      _sectionFields |= 0x02;
+    }
+    else if (strcmp(key(4), "end") == 0) {
+      _section.end = value;
+      _sectionFields |= 0x04;
+    }
+  }
+}
+
+void ConfigLoader::onBool(bool value) {
+  notMap();
+
+  if (_depth == 2 && in("motion"))
+    setMotion(&_config->motion, key(1), value);
+}
+
+bool ConfigLoader::setMotion(MotionConfig *config, const char *name, double value) {
+  if (strcmp(name, "autoOrientation") == 0)
+    config->autoOrientation = value != 0;
+  else if (strcmp(name, "autoMotion") == 0)
+    config->autoMotion = value != 0;
+  else if (strcmp(name, "autoTurn") == 0)
+    config->autoTurn = value != 0;
+  else if (strcmp(name, "relativeTurnZero") == 0)
+    config->relativeTurnZero = value != 0;
+  else if (strcmp(name, "brakeThreshold") == 0)
+    config->brakeThreshold = value;
+  else if (strcmp(name, "accelerationThreshold") == 0)
+    config->accelerationThreshold = value;
+  else if (strcmp(name, "turnThreshold") == 0)
+    config->turnThreshold = value;
+  else if (strcmp(name, "brakeJerkThreshold") == 0)
+    config->brakeJerkThreshold = value;
+  else if (strcmp(name, "motionDwell") == 0)
+    config->motionDwell = value;
+  else if (strcmp(name, "motionMaxLatency") == 0)
+    config->motionMaxLatency = value;
+  else if (strcmp(name, "motionAxis") == 0)
+    config->motionAxis = (AccelerationAxis)value;
+  else if (strcmp(name, "turnAxis") == 0)
+    config->turnAxis = (AttitudeAxis)value;
+  else if (strcmp(name, "orientation") == 0)
+    config->orientationTrigger = (Orientation)value;
+  else if (strcmp(name, "orientationUpMin") == 0)
+    config->orientationUpMin = value;
+  else if (strcmp(name, "orientationUpMax") == 0)
+    config->orientationUpMax = value;
+  else if (strcmp(name, "orientationDwell") == 0)
+    config->orientationDwell = value;
+  else if (strcmp(name, "orientationMinConfidence") == 0)
+    config->orientationMinConfidence = value;
+  else if (strcmp(name, "parkTimeout") == 0)
+    config->parkTimeout = value;
+  else if (strcmp(name, "ahrsFilter") == 0)
+    config->ahrsFilter = (AhrsFilterType)value;
+  else
+    return false;
+
+  return true;
+}
@@ -2,9 +2,11 @@
 #include <hal/lights.h>
 
 AmpConfig Config::ampConfig;
+uint32_t Config::actionTableVersion = 0;
 
 FreeRTOS::Semaphore Config::effectsUpdating = FreeRTOS::Semaphore("effects");
 
+
 void Config::onPowerUp() {
   if (!ampStorage.init()) {
     ESP_LOGE(CONFIG_TAG,"Unable to mount filsystem");
@@ -19,54 +21,172 @@ void Config::onPowerUp() {
   ESP_LOGI(CONFIG_TAG,"Copyright %d %s", COPYRIGHT_YEAR, ampConfig.info.manufacturer.c_str());
   ESP_LOGI(CONFIG_TAG,"IDF version: %s", esp_get_idf_version());
 
-  if (ampStorage.fileExists(userConfigPath) && loadConfigFile(userConfigPath)) {
+  if (ampStorage.fileExists(userConfigPath) && loadConfigFile(userConfigPath, &_staged)) {
     _isUserConfig = true;
     _valid = true;
-    loadConfig();
-
-    notifyConfigListeners();
+    applyConfig(&_staged);
   }
-  else if (ampStorage.fileExists(configPath) && loadConfigFile(configPath)) {
+  else if (image.map()) {
     _valid = true;
-    loadConfig();
-
-    notifyConfigListeners();
+    loadImageConfig();
   }
-  else
+  else if (ampStorage.fileExists(configPath) && loadConfigFile(configPath, &_staged)) {
+    _valid = true;
+    applyConfig(&_staged);
+  }
+
+  if (!_valid) {
     ESP_LOGW(CONFIG_TAG, "No valid configuration exists on this Amp");
+    return;
+  }
+
+  // edits made since the config was last saved
+  replayJournal();
+  notifyConfigListeners();
 }
 
 void Config::onPowerDown() {
+  image.unmap();
   ampStorage.deinit();
 }
 
 void Config::process() { }
 
 void Config::addConfigListener(ConfigListener *listener) {
-  configListeners.push_back(listener);
+  EventBus::instance()->subscribe(listener, Event_ConfigUpdated);
 }
 
-void Config::notifyConfigListeners() {
-  for (auto listener : configListeners)
-    if (listener->configUpdatedQueue != NULL)
-      xQueueSendToFront(listener->configUpdatedQueue, &_valid, 0);
+void Config::notifyConfigListeners(uint8_t scope) {
+  Event event;
+  event.type = Event_ConfigUpdated;
+  event.config.valid = _valid;
+  event.config.scope = scope;
+  EventBus::instance()->publish(event);
 }
 
-bool Config::loadConfigFile(std::string path) {
-  auto file = ampStorage.openFile(path);
+bool Config::loadConfigFile(std::string path, AmpConfig *target) {
+  if (_filesystemError) {
+    ESP_LOGE(CONFIG_TAG,"Cannot load config due to error with filesystem.");
+    return false;
+  }
 
-  if (!_filesystemError) {
-    MsgPackFileReader reader(file);
-    auto err = deserializeMsgPack(document, reader);
-    return err == DeserializationError::Ok;
+  auto file = ampStorage.openFile(path);
+  if (!file) {
+    ESP_LOGE(CONFIG_TAG,"Could not open file: %s", path.c_str());
+    return false;
   }
-  else {
-    ESP_LOGE(CONFIG_TAG,"Cannot load config due to error with filesystem.");
+
+  clearActions(target);
+  *target = AmpConfig();
+  loader.begin(target);
+  reader.reset(&loader);
+
+  uint8_t chunk[CONFIG_READ_CHUNK];
+  size_t length;
+  while (reader.status() == MsgPack_Incomplete && (length = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    reader.feed(chunk, length);
+
+  fclose(file);
+
+  if (reader.status() != MsgPack_Done || !loader.isValid()) {
+    ESP_LOGW(CONFIG_TAG,"Config %s is %s", path.c_str(), reader.status() == MsgPack_Incomplete ? "truncated" : "invalid");
+    clearActions(target);
     return false;
   }
+
+  return true;
+}
+
+void Config::applyConfig(AmpConfig *staged) {
+  effectsUpdating.wait(CONFIG_TAG);
+  effectsUpdating.take(CONFIG_TAG);
+
+  clearActions(&ampConfig);
+  ampConfig.previews.clear();
+  ampConfig.motion = staged->motion;
+  ampConfig.lights = std::move(staged->lights);
+  ampConfig.actions = std::move(staged->actions);
+  staged->actions.clear();
+  buildActionTable();
+
+  effectsUpdating.give();
+
+  ConfigLoader::logMotionConfig(&ampConfig.motion);
+  ESP_LOGD(CONFIG_TAG,"Loaded configuration");
+}
+
+void Config::clearActions(AmpConfig *config) {
+  for (auto const& [action, effects] : config->actions)
+    delete effects;
+
+  config->actions.clear();
+}
+
+void Config::buildActionTable() {
+  auto image = getImage();
+
+  for (uint8_t group = 0; group < Group_Count; group++) {
+    for (uint8_t action = 0; action < ACTION_COUNT; action++) {
+      auto& effects = ampConfig.actionTable[group][action];
+      effects.clear();
+
+      // compiled config, the image is already laid out by group and action
+      if (image != NULL) {
+        uint16_t count;
+        auto entries = image->actionEffects((ActionGroup)group, (Actions)action, &count);
+
+        effects.resize(count);
+        for (uint16_t i = 0; i < count; i++)
+          image->effectParameters(&entries[i], &effects[i]);
+
+        continue;
+      }
+
+      auto name = Lights::getActionName((ActionGroup)group, (Actions)action);
+      if (name[0] == '\0')
+        continue;
+
+      auto configured = ampConfig.actions.find(name);
+      if (configured != ampConfig.actions.end())
+        effects = *configured->second;
+
+      // a preview replaces the saved effect for its region
+      auto previewed = ampConfig.previews.find(name);
+      if (previewed == ampConfig.previews.end())
+        continue;
+
+      for (auto& preview : previewed->second) {
+        auto existing = std::find_if(effects.begin(), effects.end(),
+          [&preview](const LightingParameters &params) { return params.region == preview.region; });
+
+        if (existing != effects.end())
+          *existing = preview;
+        else
+          effects.push_back(preview);
+      }
+    }
+  }
+
+  actionTableVersion++;
+}
+
+std::string Config::getRawConfig() {
+  // the compiled image has no msgpack file of its own, serve the factory one it was built from
+  std::string path = _isUserConfig ? userConfigPath : configPath;
+  if (_filesystemError || !ampStorage.fileExists(path))
+    return "";
+
+  return ampStorage.readFile(path);
 }
 
 void Config::saveConfig() {
+  // the compiled image leaves ampConfig.actions empty, copy its actions out
+  // and save them as a user config instead of over the factory profile
+  if (image.isMapped() && !_isUserConfig) {
+    detachImage();
+    _isUserConfig = true;
+  }
+
   std::string path = _isUserConfig ? userConfigPath : configPath;
   auto file = ampStorage.writeFile(path);
 
@@ -75,163 +195,205 @@ void Config::saveConfig() {
     return;
   }
 
-  // serialize effects
   ESP_LOGD(CONFIG_TAG,"Writing config to file");
-  MsgPackFileWriter writer(file);
-  serializeMsgPack(document, writer);
-
+  writeConfig(file);
   fclose(file);
-}
 
-void Config::saveUserConfig(std::string data, bool load) {
-  auto file = ampStorage.writeFile(userConfigPath);
+  // the saved config includes every journaled edit
+  clearJournal();
+}
 
-  if (!file) {
-    ESP_LOGE(CONFIG_TAG,"Could not open file: %s", userConfigPath.c_str());
-    return;
+// previews stay out of the file, only ampConfig.actions is saved
+void Config::writeConfig(FILE *file) {
+  MsgPackWriter writer(file);
+  auto motion = &ampConfig.motion;
+
+  writer.map(3);
+
+  writer.string("motion");
+  writer.map(19);
+  writer.string("autoOrientation"); writer.boolean(motion->autoOrientation);
+  writer.string("autoMotion"); writer.boolean(motion->autoMotion);
+  writer.string("autoTurn"); writer.boolean(motion->autoTurn);
+  writer.string("relativeTurnZero"); writer.boolean(motion->relativeTurnZero);
+  writer.string("brakeThreshold"); writer.number(motion->brakeThreshold);
+  writer.string("accelerationThreshold"); writer.number(motion->accelerationThreshold);
+  writer.string("turnThreshold"); writer.number(motion->turnThreshold);
+  writer.string("brakeJerkThreshold"); writer.number(motion->brakeJerkThreshold);
+  writer.string("motionDwell"); writer.integer(motion->motionDwell);
+  writer.string("motionMaxLatency"); writer.integer(motion->motionMaxLatency);
+  writer.string("motionAxis"); writer.integer(motion->motionAxis);
+  writer.string("turnAxis"); writer.integer(motion->turnAxis);
+  writer.string("orientation"); writer.integer(motion->orientationTrigger);
+  writer.string("orientationUpMin"); writer.number(motion->orientationUpMin);
+  writer.string("orientationUpMax"); writer.number(motion->orientationUpMax);
+  writer.string("orientationDwell"); writer.integer(motion->orientationDwell);
+  writer.string("orientationMinConfidence"); writer.integer(motion->orientationMinConfidence);
+  writer.string("parkTimeout"); writer.integer(motion->parkTimeout);
+  writer.string("ahrsFilter"); writer.integer(motion->ahrsFilter);
+
+  writer.string("actions");
+  writer.map(ampConfig.actions.size());
+  for (auto const& [action, effects] : ampConfig.actions) {
+    writer.string(action);
+    writer.array(effects->size());
+
+    for (auto& effect : *effects) {
+      writer.map(2);
+      writer.string("region"); writer.string(effect.region);
+      writer.string("effect"); writer.string(formatEffect(&effect));
+    }
   }
 
-  ESP_LOGD(CONFIG_TAG, "Writing user config to file");
-  fputs(data.c_str(), file);
-  fclose(file);
+  writer.string("lights");
+  writer.map(2);
+
+  writer.string("channels");
+  writer.array(ampConfig.lights.channels.size());
+  for (auto const& [number, channel] : ampConfig.lights.channels) {
+    writer.map(3);
+    writer.string("channel"); writer.integer(channel.channel);
+    writer.string("leds"); writer.integer(channel.leds);
+    writer.string("type"); writer.integer(channel.type);
+  }
 
-  if (load) {
-    auto err = deserializeMsgPack(document, data);
-    if (err == DeserializationError::Ok) {
-      _isUserConfig = true;
-      loadConfig();
-      notifyConfigListeners();
+  writer.string("regions");
+  writer.map(ampConfig.lights.regions.size());
+  for (auto const& [name, region] : ampConfig.lights.regions) {
+    writer.string(name);
+    writer.array(region.sections.size());
+
+    for (auto& section : region.sections) {
+      writer.map(3);
+      writer.string("channel"); writer.integer(section.channel);
+      writer.string("start"); writer.integer(section.start);
+      writer.string("end"); writer.integer(section.end);
     }
   }
 }
 
-void Config::loadConfig() {
-  JsonObject configJson = document.as<JsonObject>();
+bool Config::beginUserConfig() {
+  if (_filesystemError)
+    return false;
 
-  JsonObject lightsJson = configJson["lights"].as<JsonObject>();
-  loadLightsConfig(lightsJson);
+  if (_upload != NULL)
+    fclose(_upload);
 
-  JsonObject actionsJson = configJson["actions"].as<JsonObject>();
-  loadActionConfig(actionsJson);
+  _upload = ampStorage.writeFile(uploadPath);
+  if (!_upload) {
+    ESP_LOGE(CONFIG_TAG,"Could not open file: %s", uploadPath.c_str());
+    return false;
+  }
 
-  JsonObject motionJson = configJson["motion"].as<JsonObject>();
-  loadMotionConfig(motionJson);
+  clearActions(&_staged);
+  _staged = AmpConfig();
+  loader.begin(&_staged);
+  reader.reset(&loader);
 
-  ESP_LOGD(CONFIG_TAG,"Loaded configuration");
+  ESP_LOGD(CONFIG_TAG, "Receiving user config");
+  return true;
 }
 
-void Config::loadMotionConfig(JsonObject motionJson) {
-  MotionConfig config;
-
-  config.autoOrientation = motionJson["autoOrientation"] | false;
-  config.autoMotion = motionJson["autoMotion"] | false;
-  config.autoTurn = motionJson["autoTurn"] | false;
-  config.relativeTurnZero = motionJson["relativeTurnZero"] | true;
+bool Config::appendUserConfig(const uint8_t *data, size_t length) {
+  if (_upload == NULL || reader.status() == MsgPack_Error)
+    return false;
 
-  config.brakeThreshold = motionJson["brakeThreshold"] | DEFAULT_BRAKE_THRESHOLD;
-  config.accelerationThreshold = motionJson["accelerationThreshold"] | DEFAULT_ACCELERATION_THRESHOLD;
-  config.turnThreshold = motionJson["turnThreshold"] | DEFAULT_TURN_THRESHOLD;
+  fwrite(data, 1, length, _upload);
+  return reader.feed(data, length) != MsgPack_Error;
+}
 
-  uint8_t motionAxis = (motionJson["motionAxis"].as<uint8_t>()) | AccelerationAxis::X_Pos;
-  config.motionAxis = (AccelerationAxis)motionAxis;
+bool Config::endUserConfig() {
+  if (_upload == NULL)
+    return false;
 
-  uint8_t turnAxis = (AttitudeAxis)(motionJson["turnAxis"].as<uint8_t>()) | AttitudeAxis::Roll;
-  config.turnAxis = (AttitudeAxis)turnAxis;
+  fclose(_upload);
+  _upload = NULL;
 
-  uint8_t orientationTrigger = (Orientation)(motionJson["orientation"].as<uint8_t>()) | Orientation::UnknownSideUp;
-  config.orientationTrigger = (Orientation)orientationTrigger;
+  if (reader.status() != MsgPack_Done || !loader.isValid()) {
+    ESP_LOGW(CONFIG_TAG, "Discarding invalid user config");
+    unlink(uploadPath.c_str());
+    clearActions(&_staged);
+    return false;
+  }
 
-  ESP_LOGV(CONFIG_TAG,"auto orientation config: %s", config.autoOrientation ? "true" : "false");
-  ESP_LOGV(CONFIG_TAG,"auto motion config: %s", config.autoMotion ? "true" : "false");
-  ESP_LOGV(CONFIG_TAG,"auto turn config: %s", config.autoTurn ? "true" : "false");
+  // replace the user config only once the upload parsed completely
+  ESP_LOGD(CONFIG_TAG, "Writing user config to file");
+  unlink(userConfigPath.c_str());
+  rename(uploadPath.c_str(), userConfigPath.c_str());
+  clearJournal();
 
-  ESP_LOGV(CONFIG_TAG,"motion axis: %d brake threshold: %.2f acceleration threshold: %.2f", config.motionAxis, config.brakeThreshold, config.accelerationThreshold);
-  ESP_LOGV(CONFIG_TAG,"orientation trigger: %d", config.orientationTrigger);
+  _isUserConfig = true;
+  _valid = true;
+  applyConfig(&_staged);
+  notifyConfigListeners();
 
-  ampConfig.motion = config;
+  return true;
 }
 
-void Config::loadLightsConfig(JsonObject lightsJson) {
+void Config::loadImageConfig() {
+  image.loadMotionConfig(&ampConfig.motion);
+
+  // Lights addresses regions by name, index the mapped tables once. This
+  // copies the regions and channels to the heap, about 130 bytes a region
+  // with two sections and 30 bytes a channel; the effects are copied by
+  // buildActionTable at 56 bytes each.
   LightsConfig config;
 
-  // load light channels
-  JsonArray channelsJson = lightsJson["channels"].as<JsonArray>();
-  std::map<uint8_t, LightChannel> channels;
-  for (auto channel : channelsJson) {
+  auto channels = image.channels();
+  for (uint16_t i = 0; i < image.channelCount(); i++) {
     LightChannel ch;
-    ch.channel = channel["channel"].as<uint8_t>();
-    ch.leds = channel["leds"].as<uint16_t>();
-    ch.type = channel["type"].as<LEDType>();
-    channels[ch.channel] = ch;
+    ch.channel = channels[i].channel;
+    ch.leds = channels[i].leds;
+    ch.type = (LEDType)channels[i].type;
+    config.channels[ch.channel] = ch;
   }
 
-  // load light regions
-  std::map<std::string, LightRegion> regions;
-  for (auto lightRegion : lightsJson["regions"].as<JsonObject>()) {
-    std::string regionName = std::string(lightRegion.key().c_str());
-    JsonArray sectionsJson = lightRegion.value().as<JsonArray>();
+  auto regions = image.regions();
+  for (uint16_t i = 0; i < image.regionCount(); i++) {
+    auto sections = image.sections(&regions[i]);
 
     LightRegion region;
-    std::vector<LightSection> sections;
-    region.count = 0;
-
-    for (auto sect : sectionsJson) {
-      LightSection section;
-      JsonObject sectionJson = sect.as<JsonObject>();
-
-      bool _validSection = true;
-      if (sectionJson.containsKey("channel") && sectionJson["channel"].is<uint8_t>())
-        section.channel = sectionJson["channel"].as<uint8_t>();
-      else
-        _validSection = false;
-      
-      if (sectionJson.containsKey("start") && sectionJson["start"].is<uint16_t>())
-        section.start = sectionJson["start"].as<uint16_t>();
-      else
-        _validSection = false;
-
-      if (sectionJson.containsKey("end") && sectionJson["end"].is<uint16_t>())
-        section.end = sectionJson["end"].as<uint16_t>();
-      else
-        _validSection = false;
-
-      if (_validSection) {
-        sections.push_back(section);
-        uint16_t count = section.end - section.start;
-        region.count += count;
-        region.breaks.push_back(count);
-      }
+    region.name = image.regionName(&regions[i]);
+    region.count = regions[i].count;
+
+    for (uint16_t j = 0; j < regions[i].sectionCount; j++) {
+      region.sections.push_back({ sections[j].channel, sections[j].start, sections[j].end });
+      region.breaks.push_back(sections[j].end - sections[j].start);
     }
-    region.sections = sections;
-    regions[regionName] = region;
-  }
 
-  // set lights config
-  config.channels = channels;
-  config.regions = regions;
+    config.regions[region.name] = region;
+  }
 
+  effectsUpdating.wait(CONFIG_TAG);
+  effectsUpdating.take(CONFIG_TAG);
   ampConfig.lights = config;
+  buildActionTable();
+  effectsUpdating.give();
+
+  ESP_LOGD(CONFIG_TAG,"Loaded compiled configuration");
 }
 
-void Config::loadActionConfig(JsonObject actionJson) {
-  for (auto actionPair : actionJson) {
-    std::string action = std::string(actionPair.key().c_str());
-    JsonArray regionEffects = actionPair.value().as<JsonArray>();
-    
-    // parse all regional effects for action
-    for (auto regionEffect : regionEffects) {
-      if (regionEffect.containsKey("region") && regionEffect.containsKey("effect")) {
-        std::string region = regionEffect["region"].as<std::string>();
-        std::string effect = regionEffect["effect"].as<std::string>();
-        if (!addEffect(action, region, effect))
-          ESP_LOGW(CONFIG_TAG, "Unable to add effect - action: %s\tregion: %s\teffect: %s", 
-            action.c_str(), region.c_str(), effect.c_str());
-        else
-          ESP_LOGD(CONFIG_TAG, "Added effect - action: %s\tregion: %s\teffect: %s",
-            action.c_str(), region.c_str(), effect.c_str());
-      }
+void Config::detachImage() {
+  if (getImage() == NULL)
+    return;
+
+  // live effect edits need mutable action tables, copy the image's actions
+  // into ampConfig.actions. The resolved action table stays as it is.
+  ESP_LOGI(CONFIG_TAG,"Detaching actions from compiled configuration");
+
+  clearActions(&ampConfig);
+  for (uint8_t group = 0; group < Group_Count; group++) {
+    for (uint8_t action = 0; action < ACTION_COUNT; action++) {
+      auto& effects = ampConfig.actionTable[group][action];
+      auto name = Lights::getActionName((ActionGroup)group, (Actions)action);
+      if (effects.empty() || name[0] == '\0')
+        continue;
+
+      ampConfig.actions[name] = new std::vector<LightingParameters>(effects);
     }
   }
+
+  _imageDetached = true;
 }
 
 std::string Config::readFile(std::string filename) {
@@ -251,72 +413,346 @@ DeviceInfo Config::getDeviceInfo() {
   return info;
 }
 
-bool Config::addEffect(std::string action, std::string region, std::string data, bool updateJson) {
+bool Config::isAction(std::string action) {
+  for (auto const& [command, actionName] : Lights::headlightActions)
+    if (actionName.compare(action) == 0)
+      return true;
+
+  for (auto const& [command, actionName] : Lights::turnActions)
+    if (actionName.compare(action) == 0)
+      return true;
+
+  for (auto const& [command, actionName] : Lights::motionActions)
+    if (actionName.compare(action) == 0)
+      return true;
+
+  for (auto const& [command, actionName] : Lights::orientationActions)
+    if (actionName.compare(action) == 0)
+      return true;
+
+  return false;
+}
+
+bool Config::putEffect(std::string action, std::string region, std::string data, bool persist) {
+  LightingParameters effect;
+  if (!isAction(action) || !parseEffect(data, &effect))
+    return false;
+
+  effect.region = region;
+  putEffect(action, effect, persist);
+  return true;
+}
+
+void Config::putEffect(const std::string &action, const LightingParameters &effect, bool persist) {
+  auto region = [&effect](const LightingParameters &params) { return params.region == effect.region; };
+
+  // saving an effect ends its preview
+  auto previewed = ampConfig.previews.find(action);
+  if (persist && previewed != ampConfig.previews.end()) {
+    auto& previews = previewed->second;
+    previews.erase(std::remove_if(previews.begin(), previews.end(), region), previews.end());
+  }
+
+  if (persist && ampConfig.actions.find(action) == ampConfig.actions.end())
+    ampConfig.actions[action] = new std::vector<LightingParameters>();
+
+  // an action has one effect per region
+  auto effects = persist ? ampConfig.actions[action] : &ampConfig.previews[action];
+  auto existing = std::find_if(effects->begin(), effects->end(), region);
+
+  if (existing != effects->end())
+    *existing = effect;
+  else
+    effects->push_back(effect);
+}
+
+const std::string* Config::regionAt(uint8_t index) {
+  if (index >= ampConfig.lights.regions.size())
+    return NULL;
+
+  return &std::next(ampConfig.lights.regions.begin(), index)->first;
+}
+
+bool Config::dropEffect(std::string action, std::string region) {
+  auto matches = [&region](const LightingParameters &params) { return params.region == region; };
+  bool dropped = false;
+
+  // removes the preview along with the saved effect
+  auto previewed = ampConfig.previews.find(action);
+  if (previewed != ampConfig.previews.end()) {
+    auto& previews = previewed->second;
+    auto removed = std::remove_if(previews.begin(), previews.end(), matches);
+    dropped = removed != previews.end();
+    previews.erase(removed, previews.end());
+  }
+
+  auto effects = ampConfig.actions.find(action);
+  if (effects == ampConfig.actions.end())
+    return dropped;
+
+  auto list = effects->second;
+  auto removed = std::remove_if(list->begin(), list->end(), matches);
+  dropped |= removed != list->end();
+  list->erase(removed, list->end());
+  return dropped;
+}
+
+void Config::putRegion(std::string name, std::vector<LightSection> sections) {
+  if (sections.empty()) {
+    ampConfig.lights.regions.erase(name);
+    return;
+  }
+
+  LightRegion region;
+  region.name = name;
+  region.count = 0;
+
+  for (auto& section : sections) {
+    uint16_t count = section.end - section.start;
+    region.sections.push_back(section);
+    region.breaks.push_back(count);
+    region.count += count;
+  }
+
+  ampConfig.lights.regions[name] = region;
+}
+
+bool Config::applyPatch(const uint8_t *data, size_t length, bool persist) {
+  PatchReader reader(data, length);
+  if (!reader.validate()) {
+    ESP_LOGW(CONFIG_TAG, "Invalid config patch (%d bytes)", length);
+    return false;
+  }
+
+  // effect edits need mutable actions
+  detachImage();
+
   effectsUpdating.wait(CONFIG_TAG);
   effectsUpdating.take(CONFIG_TAG);
+  uint8_t scope = applyPatchOps(reader, persist);
+  effectsUpdating.give();
 
-  bool found = false;
-
-  for (auto const& [command, actionName] : Lights::headlightActions)
-    if (actionName.compare(action) == 0) {
-      found = true;
-      break;
-    }
+  if (scope == 0)
+    return false;
 
-  if (!found)
-    for (auto const& [command, actionName] : Lights::turnActions)
-      if (actionName.compare(action) == 0) {
-        found = true;
-        break;
-      }
+  if (persist)
+    appendJournal(data, length);
 
-  if (!found)
-    for (auto const& [command, actionName] : Lights::motionActions)
-      if (actionName.compare(action) == 0) {
-        found = true;
-        break;
-      }
+  notifyConfigListeners(scope);
+  return true;
+}
 
-  if (!found)
+bool Config::applyCommand(CommandOp op, const EffectCommand &command) {
+  auto action = Lights::getActionName((ActionGroup)command.group, (Actions)command.action);
+  if (action[0] == '\0') {
+    ESP_LOGW(CONFIG_TAG, "Unknown action %d in group %d", command.action, command.group);
     return false;
+  }
+
+  detachImage();
+
+  effectsUpdating.wait(CONFIG_TAG);
+  effectsUpdating.take(CONFIG_TAG);
 
+  bool applied = false;
+  auto region = regionAt(command.region);
   LightingParameters effect;
-  if (!parseEffect(data, &effect))
+
+  if (region != NULL && op == Command_RemoveEffect)
+    applied = dropEffect(action, *region);
+  else if (region != NULL && op != Command_RemoveEffect && command.effect <= LightEffect::Sparkle) {
+    effect.region = *region;
+    effect.effect = (LightEffect)command.effect;
+    effect.layer = command.layer;
+    effect.duration = command.duration;
+
+    effect.first.color = Color(command.first[0], command.first[1], command.first[2]);
+    effect.first.random = command.colorFlags & COMMAND_COLOR_RANDOM;
+    effect.first.rainbow = command.colorFlags & COMMAND_COLOR_RAINBOW;
+
+    effect.second.color = Color(command.second[0], command.second[1], command.second[2]);
+    effect.second.random = (command.colorFlags >> 2) & COMMAND_COLOR_RANDOM;
+    effect.second.rainbow = (command.colorFlags >> 2) & COMMAND_COLOR_RAINBOW;
+
+    effect.third = { lightOff, false, false };
+
+    putEffect(action, effect, op == Command_SaveEffect);
+    applied = true;
+  }
+
+  if (applied)
+    buildActionTable();
+
+  effectsUpdating.give();
+
+  if (!applied) {
+    ESP_LOGW(CONFIG_TAG, "Unable to apply command %02x - action: %s region: %d", op, action, command.region);
     return false;
+  }
 
-  effect.region = region;
+  // saved the same way as the text commands so the journal has one format
+  if (op != Command_Effect) {
+    std::string patch;
+    PatchWriter writer(patch);
+    writer.begin(op == Command_SaveEffect ? Patch_SetEffect : Patch_RemoveEffect);
+    writer.string(action);
+    writer.string(*region);
+    if (op == Command_SaveEffect)
+      writer.string(formatEffect(&effect));
+    writer.end();
+
+    appendJournal((const uint8_t*)patch.data(), patch.length());
+  }
 
-  if (ampConfig.actions.find(action) == ampConfig.actions.end())
-    ampConfig.actions[action] = new std::vector<LightingParameters>();
+  notifyConfigListeners(Scope_Actions);
+  return true;
+}
 
-  ampConfig.actions[action]->push_back(effect);
+uint8_t Config::applyPatchOps(PatchReader &reader, bool persist) {
+  uint8_t scope = 0;
+  PatchOp op;
 
-  if (updateJson) {
-    auto actionsRoot = document["actions"].as<JsonObject>();
-    JsonArray actionRoot;
+  while (reader.next(&op)) {
+    switch (op) {
+      case Patch_SetEffect: {
+        auto action = reader.string();
+        auto region = reader.string();
+        auto effect = reader.string();
 
-    if (!actionsRoot.containsKey(action))
-      actionRoot = actionsRoot.createNestedArray(action);
-    else 
-      actionRoot = actionsRoot[action].as<JsonArray>();
+        if (reader.isValid() && putEffect(action, region, effect, persist))
+          scope |= Scope_Actions;
+        else
+          ESP_LOGW(CONFIG_TAG, "Unable to patch effect - action: %s\tregion: %s\teffect: %s", action.c_str(), region.c_str(), effect.c_str());
+        break;
+      }
+      case Patch_RemoveEffect: {
+        auto action = reader.string();
+        auto region = reader.string();
+
+        if (reader.isValid() && dropEffect(action, region))
+          scope |= Scope_Actions;
+        break;
+      }
+      case Patch_SetMotion: {
+        auto key = reader.string();
+        float value = reader.f32();
 
-    bool foundJson = false;
-    for (auto effect : actionRoot) {
-      if (effect[region].as<std::string>().compare(region) == 0) {
-        foundJson = true;
-        effect["effect"] = data.c_str();
+        if (reader.isValid() && ConfigLoader::setMotion(&ampConfig.motion, key.c_str(), value))
+          scope |= Scope_Motion;
+        else
+          ESP_LOGW(CONFIG_TAG, "Unable to patch motion %s", key.c_str());
+        break;
       }
+      case Patch_SetChannel: {
+        LightChannel channel;
+        channel.channel = reader.u8();
+        channel.leds = reader.u16();
+        channel.type = (LEDType)reader.u8();
+
+        if (reader.isValid() && channel.channel >= 1 && channel.channel <= 8) {
+          ampConfig.lights.channels[channel.channel] = channel;
+          scope |= Scope_Lights;
+        }
+        break;
+      }
+      case Patch_SetRegion: {
+        auto name = reader.string();
+        uint8_t count = reader.u8();
+        std::vector<LightSection> sections;
+
+        for (uint8_t i = 0; i < count && reader.isValid(); i++) {
+          LightSection section;
+          section.channel = reader.u8();
+          section.start = reader.u16();
+          section.end = reader.u16();
+          sections.push_back(section);
+        }
+
+        // the loader rejects a saved config with a longer name
+        if (reader.isValid() && !name.empty() && name.length() < CONFIG_LOADER_KEY) {
+          putRegion(name, sections);
+          scope |= Scope_Lights;
+        }
+        else
+          ESP_LOGW(CONFIG_TAG, "Unable to patch region %s", name.c_str());
+        break;
+      }
+      default:
+        ESP_LOGW(CONFIG_TAG, "Unknown config patch op %d", op);
+        break;
     }
-    if (!foundJson) {
-      auto effectRoot = actionRoot.createNestedObject();
-      effectRoot["region"] = region.c_str();
-      effectRoot["effect"] = data.c_str();
+  }
+
+  // regions feed the resolved effects too
+  if (scope & (Scope_Actions | Scope_Lights))
+    buildActionTable();
+
+  return scope;
+}
+
+void Config::appendJournal(const uint8_t *data, size_t length) {
+  if (_filesystemError)
+    return;
+
+  auto file = ampStorage.openFile(journalPath, "a");
+  if (!file) {
+    ESP_LOGE(CONFIG_TAG,"Could not open file: %s", journalPath.c_str());
+    return;
+  }
+
+  uint8_t header[2] = { (uint8_t)(length & 0xff), (uint8_t)(length >> 8) };
+  fwrite(header, 1, sizeof(header), file);
+  fwrite(data, 1, length, file);
+  long size = ftell(file);
+  fclose(file);
+
+  // fold a long journal into a full save, edits become a user config
+  if (size > CONFIG_JOURNAL_MAX) {
+    ESP_LOGD(CONFIG_TAG,"Compacting config journal (%ld bytes)", size);
+    _isUserConfig = true;
+    saveConfig();
+  }
+}
+
+void Config::replayJournal() {
+  if (_filesystemError || !ampStorage.fileExists(journalPath))
+    return;
+
+  auto file = ampStorage.openFile(journalPath);
+  if (!file)
+    return;
+
+  uint16_t patches = 0;
+  uint8_t header[2];
+  std::vector<uint8_t> patch;
+
+  // effect edits need mutable actions
+  detachImage();
+
+  effectsUpdating.wait(CONFIG_TAG);
+  effectsUpdating.take(CONFIG_TAG);
+
+  while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+    patch.resize(header[0] | (header[1] << 8));
+    if (fread(patch.data(), 1, patch.size(), file) != patch.size())
+      break;
+
+    PatchReader reader(patch.data(), patch.size());
+    if (reader.validate()) {
+      applyPatchOps(reader);
+      patches++;
     }
   }
 
-  effectsUpdating.give();  
+  effectsUpdating.give();
+  fclose(file);
 
-  return true;
+  ESP_LOGD(CONFIG_TAG,"Replayed %d config patches", patches);
+}
+
+void Config::clearJournal() {
+  if (!_filesystemError && ampStorage.fileExists(journalPath))
+    unlink(journalPath.c_str());
 }
 
 std::vector<LightingParameters>* Config::getActionEffects(std::string action) {
@@ -326,39 +762,6 @@ std::vector<LightingParameters>* Config::getActionEffects(std::string action) {
   return ampConfig.actions[action];
 }
 
-// void Config::removeEffect(std::string action, std::string region, bool updateJson) {
-//   effectsUpdating.wait(CONFIG_TAG);
-//   effectsUpdating.take(CONFIG_TAG);
-
-//   if (ampConfig.actions.find(action) == ampConfig.actions.end())
-//     return;
-  
-//   for (auto it = ampConfig.actions[action]->begin(); it != ampConfig.actions[action]->end(); ++it) {
-//     auto effect = *it;
-//     if (effect.region.compare(region) == 0)
-//       ampConfig.actions[action]->erase(it);
-//   }
-
-//   if (updateJson) {
-//     auto actionsRoot = document["actions"].as<JsonObject>();
-//     if (!actionsRoot.containsKey(action))
-//       return;
-
-//     auto actionRoot = actionsRoot[action];
-//     for (int i = 0; i < actionRoot.size(); i++) {
-//       auto effect = actionRoot[i];
-//       if (strcmp(effect["region"], region.c_str()) == 0) {
-//         ESP_LOGD(CONFIG_TAG, "Found effect - removing %s for %s", action.c_str(), region.c_str());
-//         actionRoot.remove(i);
-//         document.garbageCollect();
-//         break;
-//       }
-//     }
-//   }
-
-//   effectsUpdating.give();
-// }
-
 bool Config::parseEffect(std::string data, LightingParameters *params) {
   auto parts = split(data, ',');
   params->effect = (LightEffect) atoi(parts[0].c_str());
@@ -387,7 +790,7 @@ bool Config::parseEffect(std::string data, LightingParameters *params) {
       params->duration = atoll(parts[2].c_str());
 
       if (numParts == 4)
-        params->layer = atoi(parts[2].c_str());
+        params->layer = atoi(parts[3].c_str());
       break;
     case LightEffect::Scan:
     case LightEffect::ColorWipe:
@@ -446,4 +849,47 @@ ColorOption Config::parseColorOption(std::string data) {
     option.color = hexToColor(data);
 
   return option;
-}
\ No newline at end of file
+}
+
+std::string Config::formatEffect(LightingParameters *params) {
+  std::string data = std::to_string(params->effect);
+
+  switch (params->effect) {
+    case LightEffect::Static:
+      data += "," + formatColorOption(params->first);
+      break;
+    case LightEffect::TheaterChase:
+      data += "," + formatColorOption(params->first) + "," + std::to_string(params->duration);
+      break;
+    case LightEffect::Scan:
+    case LightEffect::ColorWipe:
+    case LightEffect::Blink:
+    case LightEffect::Breathe:
+    case LightEffect::Fade:
+    case LightEffect::Twinkle:
+    case LightEffect::Sparkle:
+    case LightEffect::Alternate:
+    case LightEffect::ColorChase:
+      data += "," + formatColorOption(params->first) + "," + formatColorOption(params->second) + "," + std::to_string(params->duration);
+      break;
+    case LightEffect::Rainbow:
+    case LightEffect::RainbowCycle:
+      data += "," + std::to_string(params->duration);
+      break;
+    default:
+      break;
+  }
+
+  return data + "," + std::to_string(params->layer);
+}
+
+std::string Config::formatColorOption(ColorOption option) {
+  if (option.random)
+    return "random";
+  if (option.rainbow)
+    return "rainbow";
+
+  char hex[8];
+  snprintf(hex, sizeof(hex), "#%02X%02X%02X", option.color.r, option.color.g, option.color.b);
+  return std::string(hex);
+}
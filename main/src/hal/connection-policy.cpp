@@ -0,0 +1,170 @@
+#include <hal/connection-policy.h>
+#include <esp_log.h>
+
+// within what iOS accepts: max >= min + 15 ms (or both 15 ms), max * (latency + 1) <= 2 s
+static const ConnectionProfile connectionProfiles[Activity_Count] = {
+  { 48, 60, 4, 400 },     // idle, 60 - 75 ms, replies within 375 ms
+  { 12, 24, 0, 400 },     // streaming, 15 - 30 ms
+  { 12, 12, 0, 400 }      // transfer, 15 ms
+};
+
+ConnectionPolicy::ConnectionPolicy(ConnectionGap *gap) : _gap(gap) {
+  for (auto& link : _links)
+    link.handle = CONNECTION_HANDLE_NONE;
+}
+
+const ConnectionProfile& ConnectionPolicy::profile(BleActivity activity) {
+  return connectionProfiles[activity];
+}
+
+bool ConnectionPolicy::connected(uint16_t handle, unsigned long now) {
+  portENTER_CRITICAL(&_lock);
+  Link *slot = NULL;
+  for (auto& link : _links) {
+    // handles are reused, a link that wasn't swept yet is taken over
+    if (link.handle == handle) {
+      slot = &link;
+      break;
+    }
+
+    if (link.handle == CONNECTION_HANDLE_NONE && slot == NULL)
+      slot = &link;
+  }
+
+  if (slot != NULL) {
+    slot->notBefore = now + BLE_PARAMS_SETTLE;
+    slot->applied = Activity_Count;
+    slot->dataLength = false;
+    slot->handle = handle;
+  }
+  portEXIT_CRITICAL(&_lock);
+
+  return slot != NULL;
+}
+
+bool ConnectionPolicy::traffic(BleActivity activity, size_t bytes, unsigned long now) {
+  bool raised;
+
+  portENTER_CRITICAL(&_lock);
+  raised = activity > currentActivity(now);
+  _lastTraffic[activity] = now;
+
+  _windowBytes += bytes;
+  if (now - _windowStart >= BLE_THROUGHPUT_WINDOW) {
+    _throughput = (uint64_t)_windowBytes * 1000 / (now - _windowStart);
+    _windowStart = now;
+    _windowBytes = 0;
+  }
+  portEXIT_CRITICAL(&_lock);
+
+  return raised;
+}
+
+BleActivity ConnectionPolicy::currentActivity(unsigned long now) {
+  for (uint8_t activity = Activity_Count - 1; activity > Activity_Idle; activity--)
+    if (_lastTraffic[activity] != 0 && now - _lastTraffic[activity] < BLE_ACTIVITY_HOLD)
+      return (BleActivity)activity;
+
+  return Activity_Idle;
+}
+
+void ConnectionPolicy::apply(unsigned long now) {
+  portENTER_CRITICAL(&_lock);
+  auto activity = currentActivity(now);
+  portEXIT_CRITICAL(&_lock);
+
+  for (auto& link : _links) {
+    if (link.handle == CONNECTION_HANDLE_NONE)
+      continue;
+
+    if (!_gap->isConnected(link.handle)) {
+      portENTER_CRITICAL(&_lock);
+      link.handle = CONNECTION_HANDLE_NONE;
+      portEXIT_CRITICAL(&_lock);
+      continue;
+    }
+
+    if (link.applied == activity || (long)(now - link.notBefore) < 0)
+      continue;
+
+    // longer link layer packets help every profile, ask once
+    if (!link.dataLength) {
+      int rc = _gap->setDataLength(link.handle, BLE_DATA_LENGTH, BLE_DATA_TIME);
+      if (rc != 0)
+        ESP_LOGD(CONNECTION_POLICY_TAG, "Data length extension not set: %d", rc);
+      link.dataLength = true;
+    }
+
+    auto& profile = connectionProfiles[activity];
+    int rc = _gap->updateParams(link.handle, profile);
+    if (rc == CONNECTION_BUSY) {
+      link.notBefore = now + BLE_PARAMS_RETRY;
+      continue;
+    }
+
+    // a central that rejects the request keeps its parameters, don't keep asking
+    if (rc != 0)
+      ESP_LOGW(CONNECTION_POLICY_TAG, "Connection parameter update failed: %d", rc);
+    else
+      ESP_LOGD(CONNECTION_POLICY_TAG, "Requested %s parameters: %.2f - %.2f ms, latency %d",
+        activity == Activity_Transfer ? "transfer" : activity == Activity_Streaming ? "streaming" : "idle",
+        profile.minInterval * 1.25f, profile.maxInterval * 1.25f, profile.latency);
+
+    link.applied = activity;
+  }
+}
+
+long ConnectionPolicy::nextDelay(unsigned long now) {
+  unsigned long next = 0;
+
+  portENTER_CRITICAL(&_lock);
+  auto activity = currentActivity(now);
+
+  // the current activity ends after its hold
+  if (activity != Activity_Idle)
+    next = _lastTraffic[activity] + BLE_ACTIVITY_HOLD;
+
+  for (auto& link : _links)
+    if (link.handle != CONNECTION_HANDLE_NONE && link.applied != activity && (next == 0 || (long)(link.notBefore - next) < 0))
+      next = link.notBefore;
+  portEXIT_CRITICAL(&_lock);
+
+  if (next == 0)
+    return -1;
+
+  if ((long)(next - now) <= 0)
+    return 0;
+
+  return next - now;
+}
+
+BleActivity ConnectionPolicy::getActivity(unsigned long now) {
+  portENTER_CRITICAL(&_lock);
+  auto activity = currentActivity(now);
+  portEXIT_CRITICAL(&_lock);
+
+  return activity;
+}
+
+uint32_t ConnectionPolicy::getThroughput(unsigned long now) {
+  portENTER_CRITICAL(&_lock);
+  // no traffic for a whole sample, nothing is moving
+  uint32_t throughput = now - _windowStart < 2 * BLE_THROUGHPUT_WINDOW ? _throughput : 0;
+  portEXIT_CRITICAL(&_lock);
+
+  return throughput;
+}
+
+uint16_t ConnectionPolicy::firstLink() {
+  uint16_t handle = CONNECTION_HANDLE_NONE;
+
+  portENTER_CRITICAL(&_lock);
+  for (auto& link : _links)
+    if (link.handle != CONNECTION_HANDLE_NONE) {
+      handle = link.handle;
+      break;
+    }
+  portEXIT_CRITICAL(&_lock);
+
+  return handle;
+}
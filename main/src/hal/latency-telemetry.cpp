@@ -0,0 +1,113 @@
+#include <hal/latency-telemetry.h>
+#include <esp_log.h>
+
+void LatencyTelemetry::begin(unsigned long sampledAt, unsigned long detectedAt) {
+  portENTER_CRITICAL(&_lock);
+  _tracing = true;
+  _sampledAt = sampledAt;
+  _trace[Latency_Detected] = detectedAt - sampledAt;
+  _recorded = 1 << Latency_Detected;
+  _next = Latency_Received;
+  portEXIT_CRITICAL(&_lock);
+}
+
+void LatencyTelemetry::mark(LatencyStage stage) {
+  if (!waitingFor(stage))
+    return;
+
+  unsigned long now = (unsigned long)esp_timer_get_time();
+
+  portENTER_CRITICAL(&_lock);
+  if (waitingFor(stage)) {
+    uint32_t latency = now - _sampledAt;
+
+    if (latency > LATENCY_TRACE_TIMEOUT)
+      _tracing = false;
+    else {
+      _trace[stage] = latency;
+      _recorded |= 1 << stage;
+      if (stage != Latency_Overlay)
+        _next = (LatencyStage)(stage + 1);
+
+      if (_recorded == (1 << Latency_StageCount) - 1)
+        complete();
+    }
+  }
+  portEXIT_CRITICAL(&_lock);
+}
+
+void LatencyTelemetry::complete() {
+  for (uint8_t stage = 0; stage < Latency_StageCount; stage++)
+    record((LatencyStage)stage, _trace[stage]);
+
+  _count++;
+  _tracing = false;
+}
+
+void LatencyTelemetry::record(LatencyStage stage, uint32_t latency) {
+  uint32_t bucket = latency / LATENCY_BUCKET_WIDTH;
+  if (bucket > LATENCY_BUCKETS)
+    bucket = LATENCY_BUCKETS;
+
+  _histogram[stage][bucket]++;
+  if (latency > _max[stage])
+    _max[stage] = latency;
+}
+
+LatencyStats LatencyTelemetry::getStats(LatencyStage stage) {
+  LatencyStats stats = { 0, 0, 0 };
+
+  portENTER_CRITICAL(&_lock);
+  stats.max = _max[stage];
+
+  if (_count > 0) {
+    // percentiles resolve to the upper edge of their bucket, capped at the max
+    uint32_t p50 = (_count * 50 + 99) / 100;
+    uint32_t p99 = (_count * 99 + 99) / 100;
+    uint32_t seen = 0;
+
+    for (uint8_t bucket = 0; bucket <= LATENCY_BUCKETS; bucket++) {
+      seen += _histogram[stage][bucket];
+      uint32_t edge = bucket < LATENCY_BUCKETS ? (bucket + 1) * LATENCY_BUCKET_WIDTH : stats.max;
+      if (edge > stats.max)
+        edge = stats.max;
+
+      if (stats.p50 == 0 && seen >= p50)
+        stats.p50 = edge;
+
+      if (seen >= p99) {
+        stats.p99 = edge;
+        break;
+      }
+    }
+  }
+  portEXIT_CRITICAL(&_lock);
+
+  return stats;
+}
+
+void LatencyTelemetry::reset() {
+  portENTER_CRITICAL(&_lock);
+  for (uint8_t stage = 0; stage < Latency_StageCount; stage++) {
+    for (uint8_t bucket = 0; bucket <= LATENCY_BUCKETS; bucket++)
+      _histogram[stage][bucket] = 0;
+    _max[stage] = 0;
+  }
+
+  _count = 0;
+  _tracing = false;
+  portEXIT_CRITICAL(&_lock);
+}
+
+void LatencyTelemetry::log() {
+  static const char* stages[Latency_StageCount] = { "detected", "overlay", "received", "applied", "rendered", "shown" };
+
+  if (_count == 0)
+    return;
+
+  ESP_LOGI(LATENCY_TELEMETRY_TAG,"brake latency over %d brakes (us since sample)", _count);
+  for (uint8_t stage = 0; stage < Latency_StageCount; stage++) {
+    auto stats = getStats((LatencyStage)stage);
+    ESP_LOGI(LATENCY_TELEMETRY_TAG,"  %-8s p50: %d p99: %d max: %d", stages[stage], stats.p50, stats.p99, stats.max);
+  }
+}
@@ -32,19 +32,26 @@ std::map<Actions, std::string> Lights::orientationActions = {
   std::make_pair(Actions::LightsOrientationBack, "orientation-back")
 };
 
-Lights::Lights() {
-  touchQueue = xQueueCreate(2, sizeof(bool));
-  calibrateXGQueue = xQueueCreate(1, sizeof(CalibrationState));
-  calibrateMagQueue = xQueueCreate(1, sizeof(CalibrationState));
-  configUpdatedQueue = xQueueCreate(1, sizeof(bool));
-  powerStatusQueue = xQueueCreate(1, sizeof(PowerStatus));
-  updateStatusQueue = xQueueCreate(5, sizeof(UpdateStatus));
-  advertisingQueue = xQueueCreate(1, sizeof(bool));
+Lights::Lights() { }
+
+const char* Lights::getActionName(ActionGroup group, Actions action) {
+  std::map<Actions, std::string> *names;
+
+  switch (group) {
+    case Group_Motion: names = &motionActions; break;
+    case Group_Headlight: names = &headlightActions; break;
+    case Group_Turn: names = &turnActions; break;
+    case Group_Orientation: names = &orientationActions; break;
+    default: return "";
+  }
+
+  auto name = names->find(action);
+  return name != names->end() ? name->second.c_str() : "";
 }
 
 void Lights::onPowerUp() {
   leds.init();
-  xTaskCreatePinnedToCore(renderer, "renderer", 4096, NULL, 3, &renderHandle, 1);
+  xTaskCreatePinnedToCore(renderer, "renderer", 4096, NULL, RENDERER_PRIORITY, &renderHandle, 1);
   ESP_LOGD(LIGHTS_TAG,"Lights started");
 }
 
@@ -54,48 +61,242 @@ void Lights::onPowerDown() {
 }
 
 void Lights::process() {
-  if (uxQueueMessagesWaiting(touchQueue)) {
-    bool touched;
-    if (xQueueReceive(touchQueue, &touched, 0))
-      touched ? onTouchDown() : onTouchUp();
+  Event event;
+
+  while (poll(event)) {
+    switch (event.type) {
+      case Event_Touch:
+        event.touched ? onTouchDown() : onTouchUp();
+        break;
+      case Event_CalibrateXG:
+        event.calibration == CalibrationState::Started ? onCalibrateXGStarted() : onCalibrateXGEnded();
+        break;
+      case Event_CalibrateMag:
+        event.calibration == CalibrationState::Started ? onCalibrateMagStarted() : onCalibrateMagEnded();
+        break;
+      case Event_ConfigUpdated:
+        if (event.config.valid)
+          onConfigUpdated(event.config.scope);
+        break;
+      case Event_PowerStatus:
+        onPowerStatusChanged(event.powerStatus);
+        break;
+      case Event_UpdateStatus:
+        onUpdateStatusChanged(event.updateStatus);
+        break;
+      case Event_Advertising:
+        event.publicAdvertising ? onAdvertisingStarted() : onAdvertisingStopped();
+        break;
+      case Event_Parked:
+        event.parked ? onParked() : onUnparked();
+        break;
+      default:
+        break;
+    }
   }
+}
 
-  if (uxQueueMessagesWaiting(calibrateXGQueue)) {
-    CalibrationState state;
-    if (xQueueReceive(calibrateXGQueue, &state, 0))
-      state == CalibrationState::Started ? onCalibrateXGStarted() : onCalibrateXGEnded();
+void Lights::wakeRenderer() {
+  // effects and status changes from other tasks have to wake a blocked renderer
+  if (renderHandle != NULL && xTaskGetCurrentTaskHandle() != renderHandle)
+    xTaskNotifyGive(renderHandle);
+}
+
+void Lights::restartSteps() {
+  auto now = millis();
+
+  effectsLock.take(LIGHTS_TAG);
+  for (auto& [region, step] : _steps)
+    step.next = now;
+  effectsLock.give();
+}
+
+TickType_t Lights::nextRenderDelay() {
+  // nothing animates while parked
+  if (parked)
+    return portMAX_DELAY;
+
+  auto now = millis();
+  unsigned long next = REFRESH_NEVER;
+
+  effectsLock.take(LIGHTS_TAG);
+  for (auto const& [region, step] : _steps)
+    if (step.next != REFRESH_NEVER && (next == REFRESH_NEVER || step.next < next) && region != _streamRegion)
+      next = step.next;
+  effectsLock.give();
+
+  // streamed frames keep their own time, and a silent stream has to time out
+  if (_stream.isActive()) {
+    unsigned long due = _stream.nextDue();
+    if (due == 0)
+      due = now + STREAM_TIMEOUT;
+
+    if (next == REFRESH_NEVER || due < next)
+      next = due;
   }
-  else if (uxQueueMessagesWaiting(calibrateMagQueue)) {
-    CalibrationState state;
-    if (xQueueReceive(calibrateMagQueue, &state, 0))
-      state == CalibrationState::Started ? onCalibrateMagStarted() : onCalibrateMagEnded();
+
+  // everything is static, sleep until woken
+  if (next == REFRESH_NEVER)
+    return portMAX_DELAY;
+
+  if (next <= now)
+    return 0;
+
+  // round up so we never wake before the step is due
+  return (next - now + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+}
+
+void Lights::onParked() {
+  ESP_LOGD(LIGHTS_TAG,"Parked, turning lights off");
+  parked = true;
+
+  if (init) {
+    // regions are edited on the BLE task
+    Config::effectsUpdating.take(LIGHTS_TAG);
+    for (auto const& [name, region] : lightsConfig->regions)
+      colorRegion(name, Color(0, 0, 0));
+    Config::effectsUpdating.give();
+  }
+
+  leds.setStatus(Color(0, 0, 0));
+  leds.render(true);
+}
+
+void Lights::onUnparked() {
+  ESP_LOGD(LIGHTS_TAG,"Unparked, restoring lights");
+  parked = false;
+
+  // repaint every region, static effects included
+  restartSteps();
+
+  updateLightForPowerStatus(_powerStatus);
+  wakeRenderer();
+}
+
+void Lights::buildBrakeOverlay() {
+  _brakeOverlay.clear();
+
+  // the action table and regions are rebuilt on the BLE task
+  Config::effectsUpdating.take(LIGHTS_TAG);
+  _brakeOverlayVersion = Config::actionTableVersion;
+
+  // the overlay is the brake action's first frame, effects without a fixed
+  // first color (random, rainbow) are left to the regular pipeline
+  for (auto& effect : Config::ampConfig.actionTable[Group_Motion][Actions::LightsMotionBrakes]) {
+    if (effect.effect == LightEffect::Transparent || effect.first.random || effect.first.rainbow)
+      continue;
+
+    auto region = lightsConfig->regions.find(effect.region);
+    if (region == lightsConfig->regions.end())
+      continue;
+
+    Color color = effect.effect == LightEffect::Off ? lightOff : effect.first.color;
+    for (auto& section : region->second.sections)
+      _brakeOverlay.push_back({ section.channel, section.start, section.end, leds.gammaCorrected(color) });
   }
 
-  if (uxQueueMessagesWaiting(configUpdatedQueue)) {
-    bool valid;
-    if (xQueueReceive(configUpdatedQueue, &valid, 0) && valid)
-      onConfigUpdated();
+  Config::effectsUpdating.give();
+  ESP_LOGD(LIGHTS_TAG,"Brake overlay covers %d sections", _brakeOverlay.size());
+}
+
+void Lights::paintBrakeOverlay() {
+  for (auto& span : _brakeOverlay)
+    leds.setPixels(span.channel, span.color, span.start - 1, span.end);
+}
+
+bool Lights::startStream(uint8_t region, uint8_t fps, uint8_t depth) {
+  if (!init || region >= lightsConfig->regions.size() || fps == 0 || depth > STREAM_MAX_DEPTH)
+    return false;
+
+  _streamRequest[0] = region;
+  _streamRequest[1] = fps;
+  _streamRequest[2] = depth;
+  _streamStarting = true;
+  wakeRenderer();
+  return true;
+}
+
+void Lights::stopStream() {
+  _streamStopping = true;
+  wakeRenderer();
+}
+
+void Lights::streamFrame(const uint8_t *data, size_t length) {
+  // a finished frame can be due before the renderer would wake
+  if (_stream.receive(data, length, millis()))
+    wakeRenderer();
+}
+
+void Lights::beginStream() {
+  _streamStarting = false;
+  if (_stream.isActive())
+    endStream();
+
+  auto region = lightsConfig->regions.begin();
+  std::advance(region, std::min((size_t)_streamRequest[0], lightsConfig->regions.size()));
+  if (region == lightsConfig->regions.end())
+    return;
+
+  uint16_t pixels = 0;
+  for (auto& section : region->second.sections)
+    pixels += section.end - section.start + 1;
+
+  if (!_stream.begin(pixels, _streamRequest[1], _streamRequest[2], millis())) {
+    ESP_LOGW(LIGHTS_TAG,"Unable to stream %d pixels to %s", pixels, region->first.c_str());
+    return;
   }
 
-  if (uxQueueMessagesWaiting(powerStatusQueue)) {
-    PowerStatus status;
-    if (xQueueReceive(powerStatusQueue, &status, 0))
-      onPowerStatusChanged(status);
+  _streamRegion = region->first;
+  ESP_LOGI(LIGHTS_TAG,"Streaming %d pixels to %s at %d fps, %d frames buffered", pixels, _streamRegion.c_str(), _streamRequest[1], _streamRequest[2]);
+}
+
+void Lights::endStream() {
+  auto stats = _stream.getStats();
+  _stream.end();
+
+  ESP_LOGI(LIGHTS_TAG,"Stream to %s ended: %d shown, %d dropped, %d late, %d ms latency",
+    _streamRegion.c_str(), stats.shown, stats.dropped, stats.late, stats.latency);
+
+  // hand the region back, it stays dark if no effect covers it
+  if (lightsConfig->regions.find(_streamRegion) != lightsConfig->regions.end())
+    colorRegion(_streamRegion, lightOff);
+  _streamRegion.clear();
+
+  restartSteps();
+}
+
+void Lights::paintStream(const uint8_t *pixels) {
+  auto region = lightsConfig->regions.find(_streamRegion);
+  if (region == lightsConfig->regions.end())
+    return;
+
+  for (auto& section : region->second.sections) {
+    uint16_t count = section.end - section.start + 1;
+    leds.writePixels(section.channel, pixels, section.start - 1, count);
+    pixels += count * 3;
   }
+}
 
-  if (uxQueueMessagesWaiting(updateStatusQueue)) {
-    UpdateStatus status;
-    if (xQueueReceive(updateStatusQueue, &status, 0))
-      onUpdateStatusChanged(status);
+void Lights::onBraking(bool braking) {
+  if (!braking) {
+    // hand the regions back to their effects if the app never took over,
+    // this runs on the sampler so the renderer restarts the steps
+    if (_brakeOverlayActive) {
+      _brakeOverlayActive = false;
+      _restartPending = true;
+      wakeRenderer();
+    }
+    return;
   }
 
-  if (uxQueueMessagesWaiting(advertisingQueue)) {
-    uint8_t status;
-    if (xQueueReceive(advertisingQueue, &status, 0))
-      status == 1 ? onAdvertisingStarted() : onAdvertisingStopped();
+  if (!init || parked) {
+    LatencyTelemetry::instance()->mark(Latency_Overlay);
+    return;
   }
 
-  leds.process();
+  _brakeOverlayActive = true;
+  _brakeOverlayPending = true;
+  wakeRenderer();
 }
 
 void Lights::onAdvertisingStarted() {
@@ -149,7 +350,7 @@ void Lights::onPowerStatusChanged(PowerStatus status) {
 }
 
 void Lights::updateLightForPowerStatus(PowerStatus status) {
-  if (!updating && !advertising) {
+  if (!updating && !advertising && !parked) {
     if (status.charging) {
       if (status.level != PowerLevel::Charged) {
         leds.setStatus(ampOrange);
@@ -192,6 +393,7 @@ void Lights::updateLightForPowerStatus(PowerStatus status) {
 
 void Lights::setStatus(Color color) {
   leds.setStatus(color);
+  wakeRenderer();
 }
 
 void Lights::onTouchDown() {
@@ -202,22 +404,71 @@ void Lights::onTouchUp() {
   updateLightForPowerStatus(_powerStatus);
 }
 
-void Lights::onConfigUpdated() {
+void Lights::onConfigUpdated(uint8_t scope) {
   lightsConfig = &Config::ampConfig.lights;
-  
+
+  // effects are applied by the app, only channels and regions matter here
+  if (init && !(scope & Scope_Lights))
+    return;
+
+  // regions may have moved under a running stream
+  if (_stream.isActive())
+    stopStream();
+
+  // channels and regions are edited on the BLE task, effectsUpdating goes
+  // before effectsLock like it does for the app
+  Config::effectsUpdating.take(LIGHTS_TAG);
   for (auto channel : lightsConfig->channels) {
     auto channelNum = channel.second.channel;
 
+    // keep controllers whose strip didn't change
+    auto applied = _appliedChannels.find(channel.first);
+    if (applied != _appliedChannels.end() && applied->second.leds == channel.second.leds && applied->second.type == channel.second.type)
+      continue;
+
     // don't allow channels 5 - 8 to be added if the corresponding 1 - 4 channel is a DotStar
-    if (channelNum < 5 || (channelNum >= 5 && lightsConfig->channels[channelNum - 4].type != 2))
+    auto paired = lightsConfig->channels.find(channelNum - 4);
+    if (channelNum < 5 || paired == lightsConfig->channels.end() || paired->second.type != 2) {
       controllers[channel.first] = leds.addLEDStrip(channel.second);
+      _appliedChannels[channel.first] = channel.second;
+    }
+  }
+
+  // every region gets an effect + step up front, applying an effect then only
+  // assigns into them instead of growing the maps on the hot path
+  effectsLock.take(LIGHTS_TAG);
+  for (auto it = _effects.begin(); it != _effects.end();) {
+    if (lightsConfig->regions.find(it->first) == lightsConfig->regions.end()) {
+      _steps.erase(it->first);
+      it = _effects.erase(it);
+    }
+    else
+      ++it;
+  }
+
+  for (auto const& [name, region] : lightsConfig->regions) {
+    if (_effects.find(name) != _effects.end())
+      continue;
+
+    LightingParameters effect;
+    effect.region = name;
+    effect.effect = LightEffect::Transparent;
+    effect.layer = 0;
+    effect.first = effect.second = effect.third = { lightOff, false, false };
+    effect.duration = 0;
+
+    _effects[name] = effect;
+    _steps[name] = { 0, REFRESH_NEVER, 0 };
   }
+  effectsLock.give();
+  Config::effectsUpdating.give();
 
   init = true;
 }
 
 LightRegion Lights::getLightRegion(std::string name) {
-  return lightsConfig->regions[name];
+  auto region = findRegion(name);
+  return region != NULL ? *region : LightRegion();
 }
 
 std::map<uint8_t, LightChannel> Lights::getAvailableChannels() {
@@ -228,20 +479,27 @@ std::map<std::string, LightRegion> Lights::getAvailableRegions() {
   return lightsConfig->regions;
 }
 
-void Lights::colorRegion(std::string regionName, Color color) {
-  auto region = lightsConfig->regions[regionName];
+const LightRegion* Lights::findRegion(const std::string &name) {
+  auto region = lightsConfig->regions.find(name);
+  return region != lightsConfig->regions.end() ? &region->second : NULL;
+}
+
+void Lights::colorRegion(const std::string &regionName, Color color) {
+  auto region = findRegion(regionName);
+  if (region == NULL)
+    return;
 
-  for (auto section : region.sections) {
+  for (auto section : region->sections) {
     ESP_LOGV(LIGHTS_TAG,"Color section: %d (%d - %d) -> RGB(%d, %d, %d)", section.channel, section.start, section.end, color.r, color.g, color.b);
     colorLEDs(section.channel, section.start, section.end, color);
   }
 }
 
-void Lights::colorRegionSection(std::string regionName, uint8_t sectionIndex, Color color) {
-  auto region = lightsConfig->regions[regionName];
+void Lights::colorRegionSection(const std::string &regionName, uint8_t sectionIndex, Color color) {
+  auto region = findRegion(regionName);
 
-  if (sectionIndex < region.sections.size()) {
-    auto section = region.sections[sectionIndex];
+  if (region != NULL && sectionIndex < region->sections.size()) {
+    auto section = region->sections[sectionIndex];
     colorLEDs(section.channel, section.start, section.end, color);
   }
 }
@@ -255,6 +513,7 @@ void Lights::colorLEDs(uint8_t channel, uint16_t start, uint16_t end, Color colo
 void Lights::render(bool all, int8_t channel) {
   ESP_LOGV(LIGHTS_TAG,"Rendering lights");
   leds.render(all, channel);
+  wakeRenderer();
 }
 
 void Lights::onCalibrateXGStarted() {
@@ -350,58 +609,37 @@ Color Lights::randomColor() {
   return colorWheel(rand() % 256); 
 }
 
-void Lights::applyEffect(LightingParameters parameters) {
-  auto region = parameters.region;
+void Lights::applyEffect(const LightingParameters &parameters) {
+  // replace existing effect if it exists + reset render steps. Effects and
+  // steps for every region are created in onConfigUpdated, so this only
+  // assigns into existing entries.
+  effectsLock.take(LIGHTS_TAG);
+  auto effect = _effects.find(parameters.region);
+  bool found = effect != _effects.end();
 
-  // replace existing effect if it exists + reset render steps
-  if (lightsConfig->regions.find(region) != lightsConfig->regions.end()) {
-    LightingParameters last;
-    bool replacingOldEffect = false;
-
-    // see if we've got an existing effect for this region
-    if (_effects.find(region) != _effects.end()) {
-      last = _effects[region];
-      replacingOldEffect = true;
-    }
-
-    // set the new effect
-    _effects[region] = parameters;
-
-    // do teardown of step data for the old effect
-    if (replacingOldEffect)
-      endEffect(last);
+  if (found) {
+    effect->second = parameters;
 
     // initialize step data for effect
     startEffect(parameters);
   }
-  else
-    ESP_LOGW(LIGHTS_TAG, "Cannot apply effect - Region %s does not exist.", region.c_str());
-}
+  effectsLock.give();
 
-void Lights::startEffect(LightingParameters parameters) {
-  switch (parameters.effect) {
-    case LightEffect::Sparkle:
-      _steps[parameters.region] = { 0, millis(), new uint32_t(0) };
-      break;
-    case LightEffect::Scan:
-      _steps[parameters.region] = { 0, millis(), new bool(1) };
-      break;
-    default:
-      _steps[parameters.region] = { 0, millis(), NULL };
+  if (found) {
+    LatencyTelemetry::instance()->mark(Latency_Applied);
+    wakeRenderer();
   }
+  else
+    ESP_LOGW(LIGHTS_TAG, "Cannot apply effect - Region %s does not exist.", parameters.region.c_str());
 }
 
-void Lights::endEffect(LightingParameters parameters) {
-  switch (parameters.effect) {
-    case LightEffect::Sparkle:
-      delete (uint32_t*) _steps[parameters.region].data;
-      break;
-    case LightEffect::Scan:
-      delete (bool*) _steps[parameters.region].data;
-      break;
-    default:
-      break;
-  }
+void Lights::startEffect(const LightingParameters &parameters) {
+  auto& step = _steps[parameters.region];
+
+  step.step = 0;
+  step.next = millis();
+  // scan starts moving forward, sparkle at the first pixel
+  step.data = parameters.effect == LightEffect::Scan ? 1 : 0;
 }
 
 void Lights::renderer(void *args) {
@@ -410,18 +648,66 @@ void Lights::renderer(void *args) {
   std::vector<LightingParameters> staticEffects;
 
   for (;;) {
+    // the overlay is only touched on this task, rebuild it when the brake
+    // action changed (config loads and live effect edits)
+    if (lights->init && lights->_brakeOverlayVersion != Config::actionTableVersion)
+      lights->buildBrakeOverlay();
+
+    // a detected brake goes out before anything else
+    if (lights->_brakeOverlayPending) {
+      lights->_brakeOverlayPending = false;
+
+      if (lights->_brakeOverlay.empty()) {
+        // nothing to paint, the brake goes through the regular pipeline
+        lights->_brakeOverlayActive = false;
+        LatencyTelemetry::instance()->mark(Latency_Overlay);
+      }
+      else {
+        lights->paintBrakeOverlay();
+        lights->leds.render(true);
+        lights->leds.process();
+      }
+    }
+
     // process any messages
     lights->process();
 
-    // schedule effects to be rendered
-    auto now = millis();
-    for (auto const& [region, step] : lights->_steps) {
-      auto& effect = lights->_effects[region];
+    // braking ended on the sampler before the app applied an action
+    if (lights->_restartPending) {
+      lights->_restartPending = false;
+      lights->restartSteps();
+    }
 
-      if (step.next != REFRESH_NEVER && step.next <= now)
-        compositor.push(effect);
-      else if (effect.effect == LightEffect::Static || effect.effect == LightEffect::Off)
-        staticEffects.push_back(effect);
+    // the regions are edited on the BLE task, hold them until the frame is
+    // painted. effectsUpdating goes before effectsLock like it does for the app
+    Config::effectsUpdating.take(LIGHTS_TAG);
+
+    // live streams start and end here so nothing paints from a freed frame
+    if (lights->_streamStarting)
+      lights->beginStream();
+
+    if (lights->_streamStopping || (lights->_stream.isActive() && lights->_stream.isTimedOut(millis()))) {
+      lights->_streamStopping = false;
+      if (lights->_stream.isActive())
+        lights->endStream();
+    }
+
+    // schedule effects to be rendered, parked lights stay dark
+    auto now = millis();
+    lights->effectsLock.take(LIGHTS_TAG);
+    if (!lights->parked) {
+      for (auto const& [region, step] : lights->_steps) {
+        // the stream owns its region
+        if (region == lights->_streamRegion)
+          continue;
+
+        auto& effect = lights->_effects[region];
+
+        if (step.next != REFRESH_NEVER && step.next <= now)
+          compositor.push(effect);
+        else if (effect.effect == LightEffect::Static || effect.effect == LightEffect::Off)
+          staticEffects.push_back(effect);
+      }
     }
 
     bool updatesNeeded = compositor.size() > 0;
@@ -442,16 +728,50 @@ void Lights::renderer(void *args) {
       lights->renderLightingEffect(&effect, &step);
       compositor.pop();
     }
+    lights->effectsLock.give();
+
+    // the newest due stream frame, older ones are skipped
+    auto frame = lights->parked ? NULL : lights->_stream.due(now);
+    if (frame != NULL)
+      lights->paintStream(frame);
+
+    Config::effectsUpdating.give();
+
+    // effects and frames painted until the app applies the brake action
+    // must not cover the overlay
+    if ((updatesNeeded || frame != NULL) && lights->_brakeOverlayActive)
+      lights->paintBrakeOverlay();
 
     // render lights
-    if (updatesNeeded)
+    if (updatesNeeded) {
       lights->render(true);
-      
-    delay(10);
+      LatencyTelemetry::instance()->mark(Latency_Rendered);
+    }
+    else if (frame != NULL)
+      lights->render(true);
+
+    // push out any dirty frame, including status changes from other tasks
+    lights->leds.process();
+
+    if (frame != NULL)
+      lights->_stream.shown(millis());
+
+    // block until the next animated step is due, or until woken by an event
+    // or a new effect when everything is static
+    TickType_t wait = lights->nextRenderDelay();
+    PowerTelemetry::instance()->setWait(Consumer_Renderer, wait);
+    ulTaskNotifyTake(pdTRUE, wait);
   }
 }
 
 void Lights::renderLightingEffect(LightingParameters *params, RenderStep *step) {
+  // a removed region keeps its effect until onConfigUpdated drops it, the
+  // effects below can rely on their region existing
+  if (findRegion(params->region) == NULL) {
+    step->next = REFRESH_NEVER;
+    return;
+  }
+
   switch (params->effect) {
     case LightEffect::Off:
     case LightEffect::Static:
@@ -494,40 +814,42 @@ void Lights::renderLightingEffect(LightingParameters *params, RenderStep *step)
       sparkle(params, step);
       break;
     case LightEffect::Transparent:
+      // nothing to paint, don't reschedule
+      step->next = REFRESH_NEVER;
       break;
   }
 }
 
-void Lights::setRegionPixel(std::string regionName, uint32_t index, Color pixel) {
-  auto region = lightsConfig->regions[regionName];
-  if (index > region.count)
+void Lights::setRegionPixel(const std::string &regionName, uint32_t index, Color pixel) {
+  auto region = findRegion(regionName);
+  if (region == NULL || index > region->count)
     return;
 
   uint32_t base = 0;
-  for (int i = 0; i < region.breaks.size(); i++) {
-    if (index <= base + region.breaks[i]) {
-      auto& section = region.sections[i];
+  for (int i = 0; i < region->breaks.size(); i++) {
+    if (index <= base + region->breaks[i]) {
+      auto& section = region->sections[i];
       uint16_t regionIndex = index - base;
       leds.setPixel(section.channel, pixel, regionIndex);
       break;
     }
-    base += region.breaks[i];
+    base += region->breaks[i];
   }
 }
 
-Color Lights::getRegionPixel(std::string regionName, uint32_t index) {
-  auto region = lightsConfig->regions[regionName];
-  if (index > region.count)
+Color Lights::getRegionPixel(const std::string &regionName, uint32_t index) {
+  auto region = findRegion(regionName);
+  if (region == NULL || index > region->count)
     return lightOff;
 
   uint32_t base = 0;
-  for (int i = 0; i < region.breaks.size(); i++) {
-    if (index <= base + region.breaks[i]) {
-      auto& section = region.sections[i];
+  for (int i = 0; i < region->breaks.size(); i++) {
+    if (index <= base + region->breaks[i]) {
+      auto& section = region->sections[i];
       uint16_t regionIndex = index - base;
       return leds.getPixel(section.channel, regionIndex);
     }
-    base += region.breaks[i];
+    base += region->breaks[i];
   }
 
   return lightOff;
@@ -573,7 +895,7 @@ void Lights::blink(LightingParameters *params, RenderStep *step) {
 }
 
 void Lights::colorWipe(LightingParameters *params, RenderStep *step) {
-  auto region = lightsConfig->regions[params->region];
+  auto& region = *findRegion(params->region);
   auto total = region.count;
 
   auto first = getStepColor(step, params->first);
@@ -643,12 +965,11 @@ void Lights::fade(LightingParameters *params, RenderStep *step) {
 }
 
 void Lights::scan(LightingParameters *params, RenderStep *step) {
-  auto region = lightsConfig->regions[params->region];
+  auto& region = *findRegion(params->region);
   auto first = getStepColor(step, params->first);
   auto second = getStepColor(step, params->second);
 
-  bool direction;
-  memcpy(&direction, step->data, sizeof(bool));
+  bool direction = step->data;
 
   colorRegion(params->region, first);
   setRegionPixel(params->region, step->step, second);
@@ -659,12 +980,12 @@ void Lights::scan(LightingParameters *params, RenderStep *step) {
   if (step->step == 0 || step->step >= region.count)
     direction = !direction;
 
-  memcpy(step->data, &direction, sizeof(bool));
+  step->data = direction;
   step->next = millis() + params->duration / (region.count * 2);
 }
 
 void Lights::rainbow(LightingParameters *params, RenderStep *step) {
-  auto region = lightsConfig->regions[params->region];
+  auto& region = *findRegion(params->region);
   uint8_t position = step->step % 256;
 
   for (uint32_t i = 0; i < region.count; i++) {
@@ -686,7 +1007,7 @@ void Lights::rainbowCycle(LightingParameters *params, RenderStep *step) {
 }
 
 void Lights::colorChase(LightingParameters *params, RenderStep *step) {
-  auto region = lightsConfig->regions[params->region];
+  auto& region = *findRegion(params->region);
   auto first = getStepColor(step, params->first);
   auto second = getStepColor(step, params->second);
   auto third = getStepColor(step, params->third);
@@ -709,7 +1030,7 @@ void Lights::colorChase(LightingParameters *params, RenderStep *step) {
 }
 
 void Lights::theaterChase(LightingParameters *params, RenderStep *step) {
-  auto region = lightsConfig->regions[params->region];
+  auto& region = *findRegion(params->region);
   bool on = step->step % 2 == 0;
   auto first = getStepColor(step, params->first);
 
@@ -723,7 +1044,7 @@ void Lights::theaterChase(LightingParameters *params, RenderStep *step) {
 }
 
 void Lights::twinkle(LightingParameters *params, RenderStep *step) {
-  auto region = lightsConfig->regions[params->region];
+  auto& region = *findRegion(params->region);
 
   auto first = getStepColor(step, params->first);
   auto second = getStepColor(step, params->second);
@@ -741,21 +1062,17 @@ void Lights::twinkle(LightingParameters *params, RenderStep *step) {
 }
 
 void Lights::sparkle(LightingParameters *params, RenderStep *step) {
-  auto region = lightsConfig->regions[params->region];
+  auto& region = *findRegion(params->region);
   auto first = getStepColor(step, params->first);
   auto second = getStepColor(step, params->second);
 
-  uint32_t pixel;
-
   if (step->step == 0)
     colorRegion(params->region, first);
-  else {
-    memcpy(&pixel, step->data, sizeof(uint32_t));
-    setRegionPixel(params->region, pixel, first);
-  }
+  else
+    setRegionPixel(params->region, step->data, first);
 
-  pixel = region.count > 0 ? rand() % region.count : 0;
-  memcpy(step->data, &pixel, sizeof(uint32_t));
+  uint32_t pixel = region.count > 0 ? rand() % region.count : 0;
+  step->data = pixel;
   setRegionPixel(params->region, pixel, second);
 
   step->next = millis() + region.count > 0 ? params->duration / region.count : REFRESH_NEVER;
@@ -763,7 +1080,7 @@ void Lights::sparkle(LightingParameters *params, RenderStep *step) {
 }
 
 void Lights::alternate(LightingParameters *params, RenderStep *step) {
-  auto region = lightsConfig->regions[params->region];
+  auto& region = *findRegion(params->region);
   auto first = getStepColor(step, params->first);
   auto second = getStepColor(step, params->second);
 
@@ -0,0 +1,321 @@
+#include <hal/live-stream.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/task.h"
+
+bool LiveStream::begin(uint16_t pixels, uint8_t fps, uint8_t depth, unsigned long now) {
+  if (_active || pixels == 0 || pixels > STREAM_MAX_PIXELS || fps == 0 || depth > STREAM_MAX_DEPTH)
+    return false;
+
+  _buffer = (uint8_t*)malloc(STREAM_SLOTS * pixels * 3);
+  if (_buffer == NULL)
+    return false;
+
+  for (uint8_t i = 0; i < STREAM_SLOTS; i++)
+    _slots[i] = { &_buffer[i * pixels * 3], 0, 0, Slot_Free };
+
+  _pixels = pixels;
+  _depth = depth;
+  _fps = fps;
+
+  _filling = -1;
+  _base = -1;
+  _synced = false;
+  _skipping = false;
+  _playing = false;
+  _hasShown = false;
+  _showing = -1;
+  _lastReceived = now;
+
+  _stats = { 0, 0, 0, 0, 0, 0 };
+  _fpsWindow = 0;
+  _fpsFrames = 0;
+  _latencyTotal = 0;
+
+  _active = true;
+  return true;
+}
+
+void LiveStream::end() {
+  portENTER_CRITICAL(&_lock);
+  _active = false;
+  portEXIT_CRITICAL(&_lock);
+
+  // the writer may still be decoding into a slot
+  while (_receiving)
+    vTaskDelay(1);
+
+  free(_buffer);
+  _buffer = NULL;
+}
+
+int8_t LiveStream::acquireSlot() {
+  int8_t oldest = -1;
+
+  for (int8_t i = 0; i < STREAM_SLOTS; i++) {
+    if (i == _base)
+      continue;
+
+    if (_slots[i].state == Slot_Free)
+      return i;
+
+    if (_slots[i].state == Slot_Ready && (oldest < 0 || (int16_t)(_slots[i].seq - _slots[oldest].seq) < 0))
+      oldest = i;
+  }
+
+  // the buffer is full, the app runs ahead of playout
+  if (oldest >= 0)
+    _stats.dropped++;
+
+  return oldest;
+}
+
+bool LiveStream::receive(const uint8_t *data, size_t length, unsigned long now) {
+  portENTER_CRITICAL(&_lock);
+  _receiving = _active;
+  portEXIT_CRITICAL(&_lock);
+
+  if (!_receiving)
+    return false;
+
+  bool accepted = receiveFragment(data, length, now);
+  _receiving = false;
+  return accepted;
+}
+
+bool LiveStream::receiveFragment(const uint8_t *data, size_t length, unsigned long now) {
+  if (length < STREAM_HEADER)
+    return false;
+
+  uint16_t seq, start;
+  uint8_t flags = data[2];
+  memcpy(&seq, &data[0], sizeof(seq));
+  memcpy(&start, &data[3], sizeof(start));
+  _lastReceived = now;
+
+  // the rest of a frame that was already given up on
+  if (_skipping && seq == _skipSeq)
+    return false;
+
+  _skipping = false;
+
+  // a new frame before the last one ended, the end was lost
+  if (_filling >= 0 && _slots[_filling].seq != seq) {
+    _slots[_filling].state = Slot_Free;
+    _filling = -1;
+    _synced = false;
+    _stats.dropped++;
+  }
+
+  if (_filling < 0) {
+    if (!(flags & STREAM_FRAME_KEY) && (!_synced || seq != _nextSeq)) {
+      _synced = false;
+      _skipping = true;
+      _skipSeq = seq;
+      _stats.dropped++;
+      return false;
+    }
+
+    portENTER_CRITICAL(&_lock);
+    int8_t slot = acquireSlot();
+    if (slot >= 0)
+      _slots[slot].state = Slot_Filling;
+    portEXIT_CRITICAL(&_lock);
+
+    if (slot < 0) {
+      _skipping = true;
+      _skipSeq = seq;
+      _stats.dropped++;
+      return false;
+    }
+
+    // deltas build on the last complete frame, the renderer only reads it
+    if (_base >= 0)
+      memcpy(_slots[slot].pixels, _slots[_base].pixels, _pixels * 3);
+    else
+      memset(_slots[slot].pixels, 0, _pixels * 3);
+
+    _slots[slot].seq = seq;
+    _slots[slot].receivedAt = now;
+    _filling = slot;
+  }
+
+  if (!decode(_slots[_filling].pixels, flags & STREAM_ENCODING, start, &data[STREAM_HEADER], length - STREAM_HEADER)) {
+    _slots[_filling].state = Slot_Free;
+    _filling = -1;
+    _synced = false;
+    _skipping = true;
+    _skipSeq = seq;
+    _stats.dropped++;
+    return false;
+  }
+
+  if (!(flags & STREAM_FRAME_END))
+    return true;
+
+  portENTER_CRITICAL(&_lock);
+  // a frame that would already be a buffer depth late restarts playout so
+  // the jitter buffer fills up again
+  if (!_playing || (long)(now - playoutTime(seq)) > (long)bufferTime()) {
+    _playing = true;
+    _seqStart = seq;
+    _playoutStart = now + bufferTime();
+  }
+
+  _slots[_filling].state = Slot_Ready;
+  _base = _filling;
+  portEXIT_CRITICAL(&_lock);
+
+  _filling = -1;
+  _synced = true;
+  _nextSeq = seq + 1;
+  return true;
+}
+
+bool LiveStream::decode(uint8_t *pixels, uint8_t encoding, uint16_t start, const uint8_t *data, size_t length) {
+  uint32_t pixel = start;
+  size_t i = 0;
+
+  switch (encoding) {
+    case Stream_Raw:
+      if (length % 3 != 0 || pixel + length / 3 > _pixels)
+        return false;
+
+      memcpy(&pixels[pixel * 3], data, length);
+      return true;
+    case Stream_Rle:
+      while (i < length) {
+        uint8_t count = data[i] & ~STREAM_RLE_SKIP;
+        if (data[i++] & STREAM_RLE_SKIP) {
+          pixel += count;
+          continue;
+        }
+
+        if (i + 3 > length || pixel + count > _pixels)
+          return false;
+
+        for (uint8_t j = 0; j < count; j++, pixel++)
+          memcpy(&pixels[pixel * 3], &data[i], 3);
+
+        i += 3;
+      }
+      return pixel <= _pixels;
+    case Stream_Palette: {
+      if (length < 1 || length < 1 + data[0] * 3u)
+        return false;
+
+      uint8_t size = data[0];
+      auto palette = &data[1];
+      i = 1 + size * 3;
+
+      if (pixel + (length - i) > _pixels)
+        return false;
+
+      for (; i < length; i++, pixel++) {
+        uint8_t index = data[i];
+        if (index == STREAM_PALETTE_SKIP)
+          continue;
+
+        if (index >= size)
+          return false;
+
+        memcpy(&pixels[pixel * 3], &palette[index * 3], 3);
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+const uint8_t* LiveStream::due(unsigned long now) {
+  if (!_active)
+    return NULL;
+
+  int8_t best = -1;
+
+  portENTER_CRITICAL(&_lock);
+  for (int8_t i = 0; i < STREAM_SLOTS; i++) {
+    auto& slot = _slots[i];
+    if (slot.state != Slot_Ready)
+      continue;
+
+    // older than what's on the strip already
+    if (_hasShown && (int16_t)(slot.seq - _lastShown) <= 0) {
+      slot.state = Slot_Free;
+      _stats.late++;
+      continue;
+    }
+
+    if ((long)(now - playoutTime(slot.seq)) < 0)
+      continue;
+
+    // when several are due only the newest is worth showing
+    if (best < 0 || (int16_t)(slot.seq - _slots[best].seq) > 0) {
+      if (best >= 0) {
+        _slots[best].state = Slot_Free;
+        _stats.late++;
+      }
+      best = i;
+    }
+    else {
+      slot.state = Slot_Free;
+      _stats.late++;
+    }
+  }
+
+  if (best >= 0) {
+    _slots[best].state = Slot_Showing;
+    _showing = best;
+    _lastShown = _slots[best].seq;
+    _hasShown = true;
+  }
+  portEXIT_CRITICAL(&_lock);
+
+  return best >= 0 ? _slots[best].pixels : NULL;
+}
+
+void LiveStream::shown(unsigned long now) {
+  if (_showing < 0)
+    return;
+
+  uint32_t latency = now - _slots[_showing].receivedAt;
+  _stats.shown++;
+  _latencyTotal += latency;
+  _stats.latency = _latencyTotal / _stats.shown;
+  if (latency > _stats.latencyMax)
+    _stats.latencyMax = latency;
+
+  if (_fpsWindow == 0)
+    _fpsWindow = now;
+
+  _fpsFrames++;
+  if (now - _fpsWindow >= 1000) {
+    _stats.fps = _fpsFrames * 10000 / (now - _fpsWindow);
+    _fpsWindow = now;
+    _fpsFrames = 0;
+  }
+
+  portENTER_CRITICAL(&_lock);
+  _slots[_showing].state = Slot_Free;
+  _showing = -1;
+  portEXIT_CRITICAL(&_lock);
+}
+
+unsigned long LiveStream::nextDue() {
+  unsigned long next = 0;
+  if (!_active)
+    return next;
+
+  portENTER_CRITICAL(&_lock);
+  for (auto& slot : _slots)
+    if (slot.state == Slot_Ready && (next == 0 || (long)(playoutTime(slot.seq) - next) < 0))
+      next = playoutTime(slot.seq);
+  portEXIT_CRITICAL(&_lock);
+
+  return next;
+}
+
+StreamStats LiveStream::getStats() {
+  return _stats;
+}
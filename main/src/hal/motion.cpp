@@ -1,13 +1,10 @@
 #include <hal/motion.h>
 
-QueueHandle_t Motion::calibrationRequestQueue = NULL;
 FreeRTOS::Semaphore Motion::holdInterface = FreeRTOS::Semaphore("spi");
 AmpIMU Motion::ampIMU;
 
 Motion::Motion() {
-  configUpdatedQueue = xQueueCreate(1, sizeof(bool));
-  calibrationRequestQueue = xQueueCreate(2, sizeof(uint8_t));
-  powerStatusQueue = xQueueCreate(2, sizeof(PowerStatus));
+  EventBus::instance()->subscribe(this, Event_CalibrationRequest);
 }
 
 void Motion::onPowerUp() {
@@ -22,7 +19,7 @@ void Motion::onPowerUp() {
     AmpStorage::getAccelBias(&accelBias);
 
     // start motion process
-    xTaskCreatePinnedToCore(sampleTask, "motion", 4096, this, 1, &samplerHandle, 0);    
+    xTaskCreatePinnedToCore(sampleTask, "motion", 4096, this, MOTION_PRIORITY, &samplerHandle, 0);    
   }
 }
 
@@ -31,14 +28,25 @@ void Motion::sampleTask(void *parameters) {
 
   // reset last update
   motion->_lastUpdate = micros();
+  motion->_lastActivity = millis();
 
   VehicleState old = motion->_vehicleState;
   for (;;) {
     Power::powerDown.wait("power");
     motion->process();
 
-    if (motion->_enabled && motion->imuState > IMUState::IMU_Disabled) {
+    if (motion->_parked) {
+      // the IMU is in low power activity detection, only watch for a wake up
+      holdInterface.wait("spi");
+      holdInterface.take("spi");
+      bool active = ampIMU.activityDetected();
+      holdInterface.give();
+
+      if (active)
+        motion->unpark();
+    } else if (motion->_enabled && motion->imuState > IMUState::IMU_Disabled) {
       motion->sample();
+      motion->updateParking();
       
       if (!motion->_calibrating) {
         if (motion->_autoOrientation)
@@ -52,17 +60,28 @@ void Motion::sampleTask(void *parameters) {
       }
     }
 
+    // state changes are posted to the listener mailboxes by triggerVehicleState
     if (old != motion->_vehicleState) {
       ESP_LOGD(MOTION_TAG,"vehicle state changed in motion");
-
-      for (auto listener : motion->motionListeners)
-        if (listener->vehicleQueue != NULL)
-          xQueueSendToFront(listener->vehicleQueue, (void*) &motion->_vehicleState, 0);
-
       old = motion->_vehicleState;
     }
 
-    delay(10);
+    // sample periodically while detection is running, otherwise block until
+    // an event or a detection change wakes the sampler. While parked the
+    // IMU latches wake up events and the sampler polls the event source
+    // every MOTION_PARKED_POLL. INT1 is not routed on amp-1.0.0, a board
+    // that routes it can define IMU_INT to block on the pin instead.
+    bool sampling = !motion->_parked && motion->_enabled && motion->imuState > IMUState::IMU_Disabled;
+    PowerTelemetry::instance()->setBusy(Consumer_Motion, sampling);
+
+    TickType_t wait = portMAX_DELAY;
+    if (sampling)
+      wait = pdMS_TO_TICKS(MOTION_SAMPLE_PERIOD);
+#ifndef IMU_INT
+    else if (motion->_parked)
+      wait = pdMS_TO_TICKS(MOTION_PARKED_POLL);
+#endif
+    ulTaskNotifyTake(pdTRUE, wait);
   }
 
   vTaskDelete(NULL);
@@ -70,6 +89,11 @@ void Motion::sampleTask(void *parameters) {
 
 void Motion::onPowerDown() {
   ESP_LOGD(MOTION_TAG,"Motion on power down");
+  if (_parked) {
+    ampIMU.setActivityDetection(false);
+    _parked = false;
+    PowerTelemetry::instance()->setParked(false);
+  }
   imuState = IMUState::IMU_Disabled;
   ampIMU.deinit();
 }
@@ -92,24 +116,12 @@ void Motion::updateMotionForPowerStatus(PowerStatus status) {
           imuState = IMUState::IMU_LowPower;
           ESP_LOGV(MOTION_TAG,"IMU: Low power mode");
           _sampleRate = 1500; // 1.5 kHz
-
-#if defined(USE_MADGWICK_FILTER)
-          filter = filter == nullptr ? new Madgwick() : filter;
-#elif defined(USE_SIMPLE_AHRS_FILTER)
-          filter = filter == nullptr ? new SimpleAHRS() : filter;
-#endif
           break;
         case PowerLevel::Normal:
         case PowerLevel::Charged:
           imuState = IMUState::IMU_Normal;
           ESP_LOGV(MOTION_TAG,"IMU: Normal, high power mode");
           _sampleRate = 50000;  // 50 kHz
-
-#if defined(USE_MADGWICK_FILTER)
-          filter = filter == nullptr ? new Madgwick() : filter;
-#elif defined(USE_SIMPLE_AHRS_FILTER)
-          filter = filter == nullptr ? new SimpleAHRS() : filter;
-#endif
           break;
         case PowerLevel::Critical:
         case PowerLevel::Unknown:
@@ -117,10 +129,6 @@ void Motion::updateMotionForPowerStatus(PowerStatus status) {
           imuState = IMUState::IMU_Disabled;
           ESP_LOGV(MOTION_TAG,"IMU: Disabled");
           _sampleRate = 0;
-
-#if defined(USE_MADGWICK_FILTER) or defined(USE_SIMPLE_AHRS_FILTER)
-          filter = nullptr;
-#endif
           break;
       }
     }
@@ -134,29 +142,103 @@ void Motion::updateMotionForPowerStatus(PowerStatus status) {
 }
 
 void Motion::process() {
-  if (uxQueueMessagesWaiting(configUpdatedQueue)) {
-    bool valid;
-    xQueueReceive(configUpdatedQueue, &valid, 0);
+  Event event;
 
-    if (valid)
-      onConfigUpdated();
-  }
+  while (poll(event)) {
+    switch (event.type) {
+      case Event_ConfigUpdated:
+        if (event.config.valid)
+          onConfigUpdated(event.config.scope);
+        break;
+      case Event_PowerStatus:
+        _powerStatus = event.powerStatus;
+        onPowerStatusChanged(_powerStatus);
+        break;
+      case Event_CalibrationRequest:
+        ESP_LOGD(MOTION_TAG,"calibration request: %d", event.calibrationRequest);
 
-  if (uxQueueMessagesWaiting(powerStatusQueue)) {
-    xQueueReceive(powerStatusQueue, &_powerStatus, 0);
-    onPowerStatusChanged(_powerStatus);
+        if (event.calibrationRequest == 0x01)
+          calibrateXG();
+        else if (event.calibrationRequest == 0x02)
+          calibrateMag();
+        break;
+      default:
+        break;
+    }
   }
+}
 
-  if (uxQueueMessagesWaiting(calibrationRequestQueue)) {
-    uint8_t request;
-    xQueueReceive(calibrationRequestQueue, &request, 0);
-    ESP_LOGD(MOTION_TAG,"calibration request: %d", request);
+void Motion::addCalibrationListener(CalibrationListener *listener) {
+  EventBus::instance()->subscribe(listener, Event_CalibrateXG);
+  EventBus::instance()->subscribe(listener, Event_CalibrateMag);
+}
 
-    if (request == 0x01)
-      calibrateXG();
-    else if (request == 0x02)
-      calibrateMag();
-  }
+void Motion::notifyCalibrationListeners(EventType type, CalibrationState state) {
+  Event event;
+  event.type = type;
+  event.calibration = state;
+  EventBus::instance()->publish(event);
+}
+
+void Motion::addParkListener(ParkListener *listener) {
+  EventBus::instance()->subscribe(listener, Event_Parked);
+}
+
+/*
+  Parks once the linear acceleration stayed below MOTION_PARK_ACTIVITY for the
+  configured park timeout.
+*/
+void Motion::updateParking() {
+  uint32_t timeout = Config::ampConfig.motion.parkTimeout;
+  unsigned long now = millis();
+
+  if (linearAcceleration.magnitude() > MOTION_PARK_ACTIVITY)
+    _lastActivity = now;
+
+  if (timeout == 0 || _calibrating)
+    return;
+
+  if (now - _lastActivity > timeout * 1000)
+    park();
+}
+
+void Motion::park() {
+  ESP_LOGI(MOTION_TAG,"No activity for %d s, parking", Config::ampConfig.motion.parkTimeout);
+
+  holdInterface.wait("spi");
+  holdInterface.take("spi");
+  ampIMU.setActivityDetection(true, samplerHandle);
+  holdInterface.give();
+
+  _parked = true;
+  PowerTelemetry::instance()->setParked(true);
+
+  Event event;
+  event.type = Event_Parked;
+  event.parked = true;
+  EventBus::instance()->publish(event);
+}
+
+void Motion::unpark() {
+  ESP_LOGI(MOTION_TAG,"Activity detected, unparking");
+
+  holdInterface.wait("spi");
+  holdInterface.take("spi");
+  ampIMU.setActivityDetection(false);
+  holdInterface.give();
+
+  _parked = false;
+  _lastActivity = millis();
+  _lastUpdate = micros();
+  PowerTelemetry::instance()->setParked(false);
+
+  // filters settled on the parked position, start detection from scratch
+  resetMotionDetection();
+
+  Event event;
+  event.type = Event_Parked;
+  event.parked = false;
+  EventBus::instance()->publish(event);
 }
 
 void Motion::calibrateXG() {
@@ -164,11 +246,7 @@ void Motion::calibrateXG() {
   holdInterface.take("spi");
 
   _calibrating = true;
-  CalibrationState state = CalibrationState::Started;
-
-  for (auto listener : calibrationListeners)
-    if (listener->calibrateXGQueue != NULL)
-      xQueueSendToBack(listener->calibrateXGQueue, &state, 0);
+  notifyCalibrationListeners(Event_CalibrateXG, CalibrationState::Started);
 
   Vector3D biases[2];
   ampIMU.calibrateXG(&biases[0]);
@@ -177,15 +255,31 @@ void Motion::calibrateXG() {
   AmpStorage::saveAccelBias(&accelBias);
   printf("accel bias: %.3f, %.3f, %.3f\n", accelBias.x, accelBias.y, accelBias.z);
 
-  state = CalibrationState::Ended;
+  holdInterface.give();
+
+  // the board is still held level, use it as the turn center. The attitude
+  // predates the new bias, restart the estimators and let them settle on
+  // bias corrected samples first
+  tilt.reset();
+  filter.reset();
+  _lastSample = _lastUpdate = micros();
+
+  bool settled = false;
+  for (uint16_t elapsed = 0; elapsed < TURN_ZERO_SETTLE; elapsed += MOTION_SAMPLE_PERIOD) {
+    vTaskDelay(pdMS_TO_TICKS(MOTION_SAMPLE_PERIOD));
+    auto last = _lastSample;
+    sample();
+    settled |= _lastSample != last;
+  }
 
-  for (auto listener : calibrationListeners)
-    if (listener->calibrateXGQueue != NULL)
-      xQueueSendToBack(listener->calibrateXGQueue, &state, 0);
+  if (settled)
+    updateTurnCenter(getAttitudeFromAxis(_turnAxis));
+  else
+    ESP_LOGW(MOTION_TAG,"No samples while calibrating, keeping the turn center");
+
+  notifyCalibrationListeners(Event_CalibrateXG, CalibrationState::Ended);
   
   _calibrating = false;
-
-  holdInterface.give();
 }
 
 void Motion::calibrateMag() {
@@ -193,18 +287,10 @@ void Motion::calibrateMag() {
   holdInterface.take("spi");
 
   _calibrating = true;
-  CalibrationState state = CalibrationState::Started;
-
-  for (auto listener : calibrationListeners)
-    if (listener->calibrateMagQueue != NULL)
-      xQueueSendToBack(listener->calibrateMagQueue, &state, 0);
+  notifyCalibrationListeners(Event_CalibrateMag, CalibrationState::Started);
 
   ampIMU.calibrateMag(&magBias);
-  state = CalibrationState::Ended;
-
-  for (auto listener : calibrationListeners)
-    if (listener->calibrateMagQueue != NULL)
-      xQueueSendToBack(listener->calibrateMagQueue, &state, 0);
+  notifyCalibrationListeners(Event_CalibrateMag, CalibrationState::Ended);
 
   _calibrating = false;
 
@@ -215,24 +301,15 @@ void Motion::calibrateMag() {
   Updates gravity and linear acceleration vectors
 */
 void Motion::calculateAccelerations(Vector3D raw) {
-  // gravity calculation
-  gravity.x = _alpha * gravity.x + (1 - _alpha) * raw[0];
-  gravity.y = _alpha * gravity.y + (1 - _alpha) * raw[1];
-  gravity.z = _alpha * gravity.z + (1 - _alpha) * raw[2];
-
-  absoluteGravity.x = abs(gravity.x);
-  absoluteGravity.y = abs(gravity.y);
-  absoluteGravity.z = abs(gravity.z);
+  // exponential low pass for gravity, the residual is linear acceleration
+  gravity = gravity * _alpha + raw * (1 - _alpha);
+  absoluteGravity = gravity.abs();
+  linearAcceleration = raw - gravity;
 
 #if defined(LOG_MOTION_GRAVITY)
   ESP_LOGV(MOTION_TAG,"Gravity - X: %F Y: %F Z: %F", gravity.x, gravity.y, gravity.z);
 #endif
 
-  // linear acceleration
-  linearAcceleration.x = raw[0] - gravity.x;
-  linearAcceleration.y = raw[1] - gravity.y;
-  linearAcceleration.z = raw[2] - gravity.z;
-
 #if defined(LOG_MOTION_LINEAR_ACCELERATION)
   ESP_LOGV(MOTION_TAG,"$%.2f %.2f %.2f;", linearAcceleration.x, linearAcceleration.y, linearAcceleration.z);
 #endif
@@ -254,62 +331,69 @@ void Motion::sample() {
     // printf("Raw Accel - X: %.3f Y: %.3f Z: %.3f\n", rawAccel.x, rawAccel.y, rawAccel.z);
 #endif
     calculateAccelerations(rawAccel);
-    
-    // gyro
-    rawGyro = ampIMU.getGyroData();
-    rawGyro = rawGyro - gyroBias;
+
+    bool fused = ampIMU.gyroAvailable();
+    if (fused) {
+      // gyro
+      rawGyro = ampIMU.getGyroData();
+      rawGyro = rawGyro - gyroBias;
 #if defined(LOG_MOTION_RAW_GYRO)
-    printf("Raw Gyro - X: %.3f Y: %.3f Z: %.3f\n", rawGyro.x, rawGyro.y, rawGyro.z);
+      printf("Raw Gyro - X: %.3f Y: %.3f Z: %.3f\n", rawGyro.x, rawGyro.y, rawGyro.z);
 #endif
 
-
-    // mag
-    rawMag = ampIMU.getMagData();
-    rawMag = rawMag - magBias;
+      // mag
+      if (ampIMU.magAvailable()) {
+        rawMag = ampIMU.getMagData();
+        rawMag = rawMag - magBias;
 #if defined(LOG_MOTION_RAW_MAG)
-    printf("Raw Mag - X: %.3f Y: %.3f Z: %.3f\n", rawMag.x, rawMag.y, rawMag.z);
+        printf("Raw Mag - X: %.3f Y: %.3f Z: %.3f\n", rawMag.x, rawMag.y, rawMag.z);
 #endif
+      }
+    }
 
     holdInterface.give();
     _lastSample = current;
 
-    // update AHRS
     current = micros();
+    _sampleInterval = (current - _lastUpdate) / 1000000.0f;
     _lastUpdate = current;
 
-#if defined(USE_MADGWICK_FILTER)
-    float diff = (current - _lastUpdate) / 1000000.0f;
-    filter->update(
-          rawAccel.x, rawAccel.y, rawAccel.z,
-          rawGyro.x * PI / 180.0f, rawGyro.y * PI / 180.0f, rawGyro.z * PI / 180.0f,
-          -rawMag.y, -rawMag.x, rawMag.z, diff);    
-#elif defined(USE_SIMPLE_AHRS_FILTER)
-    filter->update(rawAccel, rawMag);
-#endif
-    
-    // filter->update(rawAccel, rawMag);
-
-#if defined(USE_MADGWICK_FILTER) or defined(USE_SIMPLE_AHRS_FILTER)
-    attitude = filter->getAHRS();
+    if (fused) {
+      // update AHRS
+      filter.update(rawAccel, rawGyro * (float)(PI / 180.0f), Vector3D(-rawMag.y, -rawMag.x, rawMag.z), _sampleInterval, ampIMU.magAvailable());
+      attitude = filter.getAHRS();
 
 #if defined(LOG_MOTION_AHRS)
-    printf("%lu - Orientation: %.3f %.3f %.3f\n", millis(), attitude.x, attitude.y, attitude.z);
+      printf("%lu - Orientation: %.3f %.3f %.3f\n", millis(), attitude.x, attitude.y, attitude.z);
 #endif
 
-    // compensate roll for orientation using the gravity vector
-    if (_vehicleState.orientation != TopSideUp && _vehicleState.orientation != BottomSideUp)
-      if (absoluteGravity.x > absoluteGravity.y)
-        attitude.x += attitude.x * gravity.x;
-      else
-        attitude.x += attitude.x * gravity.y;
+      // compensate roll for orientation using the gravity vector
+      if (_vehicleState.orientation != TopSideUp && _vehicleState.orientation != BottomSideUp) {
+        if (absoluteGravity.x > absoluteGravity.y)
+          attitude.x += attitude.x * gravity.x;
+        else
+          attitude.x += attitude.x * gravity.y;
+      }
 
 #if defined(LOG_MOTION_AHRS_COMPENSATED)
-    printf("%lu - Orientation: %.3f %.3f %.3f\n", millis(), attitude.x, attitude.y, attitude.z);
+      printf("%lu - Orientation: %.3f %.3f %.3f\n", millis(), attitude.x, attitude.y, attitude.z);
 #endif
+    }
+    else {
+      // accelerometer only - lean from the gravity vector with centripetal compensation
+      tilt.update(rawAccel, _sampleInterval);
+      attitude = tilt.getAHRS();
+
+#if defined(LOG_MOTION_AHRS)
+      printf("%lu - Tilt: %.3f %.3f\n", millis(), attitude.x, attitude.y);
 #endif
+    }
 
     // printf("step:a - %.4f, %.4f, %.4f\tg - %.4f, %.4f, %.4f\tm - %.4f, %.4f, %.4f\n");
 
+    // live graphs in the app, a no-op unless a stream is running
+    _sensorStream.push(current, linearAcceleration, gravity, attitude);
+
 #if defined(LOG_SAMPLE_RATE)
     printf("Delta time: %.6f, frequency: %.2f Hz\n", diff, 1.0f / diff);
 #endif
@@ -325,8 +409,12 @@ void Motion::updateTurnCenter(float turnCenter) {
   AmpStorage::saveTurnZero(_turnZero);
 }
 
-void Motion::onConfigUpdated() {
+void Motion::onConfigUpdated(uint8_t scope) {
+  if (!(scope & Scope_Motion))
+    return;
+
   auto motion = Config::ampConfig.motion;
+  filter.setFilter(motion.ahrsFilter);
 
   // update motion detection
   if (!motion.autoMotion && !motion.autoOrientation && !motion.autoTurn)
@@ -341,6 +429,12 @@ void Motion::onConfigUpdated() {
   resetMotionDetection();
 }
 
+void Motion::wakeSampler() {
+  // detection can be toggled from other tasks while the sampler is blocked
+  if (samplerHandle != NULL && xTaskGetCurrentTaskHandle() != samplerHandle)
+    xTaskNotifyGive(samplerHandle);
+}
+
 void Motion::addMotionListener(MotionListener *listener) {
   motionListeners.push_back(listener);
 }
@@ -350,25 +444,28 @@ void Motion::removeMotionListener(MotionListener *listener) {
 }
 
 void Motion::resetMotionDetection() {
-  if (Config::ampConfig.motion.autoMotion)
+  if (Config::ampConfig.motion.autoMotion) {
     _vehicleState.acceleration = AccelerationState::Neutral;
+    accelerationDetector.reset(AccelerationState::Neutral, millis());
+  }
 
   if (Config::ampConfig.motion.autoTurn)
     _vehicleState.turn = TurnState::Center;
 
-  if (Config::ampConfig.motion.autoOrientation)
+  if (Config::ampConfig.motion.autoOrientation) {
     _vehicleState.orientation = Orientation::UnknownSideUp;
+    _vehicleState.orientationConfidence = 100;
+    _orientationConfident = true;
+    orientationClassifier.reset(Orientation::UnknownSideUp);
+  }
 
   notifyMotionListeners();
 }
 
 void Motion::notifyMotionListeners() {
-  // notify any listeners of the reset
-  for (auto listener : motionListeners) {
-    // vehicle state changed
-    if (listener->vehicleQueue != NULL)
-      xQueueSend(listener->vehicleQueue, &_vehicleState, 0);
-  }
+  // overwrite the latest vehicle state in every listener mailbox
+  for (auto listener : motionListeners)
+    listener->vehicleMailbox.post(_vehicleState);
 }
 
 void Motion::setMotionDetection(bool enabled, AccelerationAxis axis, float brakeTreshold, float accelerationTreshold) {
@@ -377,10 +474,16 @@ void Motion::setMotionDetection(bool enabled, AccelerationAxis axis, float brake
   _brakeThreshold = brakeTreshold;
   _accelerationThreshold = accelerationTreshold;
 
+  auto motion = Config::ampConfig.motion;
+  accelerationDetector.configure(_brakeThreshold, _accelerationThreshold, motion.brakeJerkThreshold,
+    motion.motionDwell, motion.motionMaxLatency, _sampleInterval > 0 ? _sampleInterval : MOTION_SAMPLE_PERIOD / 1000.0f);
+
   if (_autoMotion || _autoTurn || _autoOrientation)
     _enabled = true;
   else if (!_autoMotion && !_autoTurn && !_autoOrientation)
     _enabled = false;
+
+  wakeSampler();
 }
 
 void Motion::setTurnDetection(bool enabled, bool useRelativeTurnZero, AttitudeAxis axis, float threshold) {
@@ -393,16 +496,23 @@ void Motion::setTurnDetection(bool enabled, bool useRelativeTurnZero, AttitudeAx
     _enabled = true;
   else if (!_autoMotion && !_autoTurn && !_autoOrientation)
     _enabled = false;
+
+  wakeSampler();
 }
 
 void Motion::setOrientationDetection(bool enabled, Orientation trigger) {
   _autoOrientation = enabled;
   _orientationTrigger = trigger;
 
+  auto motion = Config::ampConfig.motion;
+  orientationClassifier.configure(motion.orientationUpMin, motion.orientationUpMax, motion.orientationDwell);
+
   if (_autoMotion || _autoTurn || _autoOrientation)
     _enabled = true;
   else if (!_autoMotion && !_autoTurn && !_autoOrientation)
     _enabled = false;
+
+  wakeSampler();
 }
 
 void Motion::triggerVehicleState(VehicleState state, bool autoMotion, bool autoTurn, bool autoOrient) {
@@ -417,6 +527,17 @@ void Motion::triggerVehicleState(VehicleState state, bool autoMotion, bool autoT
 
 void Motion::triggerAccelerationState(AccelerationState state, bool autoMotion) {
   _vehicleState.acceleration = state;
+
+  // detected changes carry the time of the sample behind them for latency tracing
+  _vehicleState.sampledAt = autoMotion ? _lastSample : 0;
+  _vehicleState.detectedAt = autoMotion ? micros() : 0;
+
+  if (autoMotion && state == AccelerationState::Braking)
+    LatencyTelemetry::instance()->begin(_vehicleState.sampledAt, _vehicleState.detectedAt);
+
+  // fast path, the brake overlay goes out before the app sees the new state
+  if (brakeListener != NULL)
+    brakeListener->onBraking(state == AccelerationState::Braking);
   triggerVehicleState(_vehicleState, autoMotion, _autoTurn, _autoOrientation);
 }
 
@@ -427,49 +548,25 @@ void Motion::triggerTurnState(TurnState state, bool autoTurn) {
 
 void Motion::triggerOrientationState(Orientation state, bool autoOrientation) {
   _vehicleState.orientation = state;
+
+  // manual triggers are authoritative
+  if (!autoOrientation) {
+    _vehicleState.orientationConfidence = 100;
+    _orientationConfident = true;
+  }
+
   triggerVehicleState(_vehicleState, _autoMotion, _autoTurn, autoOrientation);
 }
 
 bool Motion::detectMotion() {
-  AccelerationState newAcceleration;
-  unsigned long now = millis();
-  auto debounce = _vehicleState.acceleration == AccelerationState::Braking ? MOTION_ACTIVE_DEBOUNCE : MOTION_DEBOUNCE;
-  if (now - _lastMotionUpdate > debounce) {
-    float acceleration = getAccelerationFromAxis(_motionAxis);
-
-    switch (_vehicleState.acceleration) {
-      case Braking:
-        if (acceleration <= -_accelerationThreshold)
-          newAcceleration = AccelerationState::Accelerating;
-        else if (acceleration <= _brakeThreshold)
-          newAcceleration = AccelerationState::Neutral;
-        break;
-      case Accelerating:
-        if (acceleration >= _brakeThreshold)
-          newAcceleration = AccelerationState::Braking;
-        else if (acceleration >= -_accelerationThreshold)
-          newAcceleration = AccelerationState::Neutral;
-      default:
-        if (acceleration > _brakeThreshold)
-          newAcceleration = AccelerationState::Braking;
-        else if (acceleration < -_accelerationThreshold)
-          newAcceleration = AccelerationState::Accelerating;
-    }
-
-    if (acceleration >= _brakeThreshold)
-      newAcceleration = AccelerationState::Braking;
-    else if (acceleration <= -_accelerationThreshold)
-      newAcceleration = AccelerationState::Accelerating;
-    else
-      newAcceleration = AccelerationState::Neutral;
+  float acceleration = getAccelerationFromAxis(_motionAxis);
+  AccelerationState newAcceleration = accelerationDetector.update(acceleration, millis(), _sampleInterval);
 
-    // ESP_LOGV(MOTION_TAG,"%.3f, %d", acceleration, newAcceleration);
+  // ESP_LOGV(MOTION_TAG,"%.3f, %d", acceleration, newAcceleration);
 
-    if (newAcceleration != _vehicleState.acceleration) {
-      triggerAccelerationState(newAcceleration, true);
-      _lastMotionUpdate = millis();
-      return true;
-    }
+  if (newAcceleration != _vehicleState.acceleration) {
+    triggerAccelerationState(newAcceleration, true);
+    return true;
   }
 
   return false;
@@ -478,19 +575,24 @@ bool Motion::detectMotion() {
 bool Motion::detectTurning() {
   TurnState newTurn;
   float angle = getAttitudeFromAxis(_turnAxis);
-  float turnDelta = abs(_turnZero - angle);
+  float turnOffset = angle - _turnZero;
+  float turnDelta = fabsf(turnOffset);
   float threshold = _turnThreshold;
   
   if (_vehicleState.orientation == FrontSideUp || _vehicleState.orientation == BackSideUp)
     threshold *= 2.0f;
 
   if (turnDelta > threshold && turnDelta < 180 - threshold)
-    newTurn = angle < 0 ? TurnState::Right : TurnState::Left;
+    newTurn = turnOffset < 0 ? TurnState::Right : TurnState::Left;
   else
     newTurn = TurnState::Center;
 
+  // let a relative turn zero slowly follow the riding posture while going straight
+  if (_useRelativeTurnZero && newTurn == TurnState::Center && _sampleInterval > 0)
+    _turnZero += turnOffset * (_sampleInterval / (TURN_ZERO_TIME_CONSTANT + _sampleInterval));
+
 #if defined(LOG_MOTION_TURN_DETECTION)
-  ESP_LOGV(MOTION_TAG,"turn angle: abs(%F - %F) %F > %F", _turnZero, angle, abs(_turnZero - angle), _turnThreshold);
+  ESP_LOGV(MOTION_TAG,"turn angle: abs(%F - %F) %F > %F", angle, _turnZero, turnDelta, _turnThreshold);
 #endif
 
   if (newTurn != _vehicleState.turn) {
@@ -502,16 +604,22 @@ bool Motion::detectTurning() {
 }
 
 bool Motion::detectOrientation() {
-  Orientation newOrientation = Orientation::UnknownSideUp;
-
-  if (absoluteGravity.x > absoluteGravity.y && absoluteGravity.x > absoluteGravity.z)
-    newOrientation = gravity.x > 0 ? FrontSideUp : BackSideUp;
-  else if (absoluteGravity.y > absoluteGravity.x && absoluteGravity.y > absoluteGravity.z)
-    newOrientation = gravity.y > 0 ? RightSideUp : LeftSideUp;
-  else if (absoluteGravity.z > absoluteGravity.x && absoluteGravity.z > absoluteGravity.y)
-    newOrientation = gravity.z > 0 ? TopSideUp : BottomSideUp;
-
-  if (newOrientation != _vehicleState.orientation) {
+  Orientation newOrientation = orientationClassifier.update(gravity, millis());
+  uint8_t confidence = (uint8_t)(orientationClassifier.getConfidence() * 100.0f);
+
+  // confidence alone is not part of the state, only report when it crosses
+  // the minimum. A confident side is held until confidence drops a band below
+  // it, so noise around the minimum doesn't republish the state every sample
+  uint8_t minConfidence = Config::ampConfig.motion.orientationMinConfidence;
+  bool confident = confidence >= minConfidence ||
+    (_orientationConfident && confidence + ORIENTATION_CONFIDENCE_BAND >= minConfidence);
+  bool crossed = confident != _orientationConfident;
+  _orientationConfident = confident;
+
+  // listeners compare against the minimum, keep a held side above it
+  _vehicleState.orientationConfidence = confident ? std::max(confidence, minConfidence) : confidence;
+
+  if (newOrientation != _vehicleState.orientation || crossed) {
     triggerOrientationState(newOrientation, true);
     return true;
   }
@@ -520,30 +628,9 @@ bool Motion::detectOrientation() {
 }
 
 float Motion::getAccelerationFromAxis(AccelerationAxis axis) {
-  float acceleration = 0.0f;
-
-  switch (axis) {
-    case AccelerationAxis::X_Neg:
-      acceleration = -linearAcceleration.x;
-      break;
-    case AccelerationAxis::X_Pos:
-      acceleration = linearAcceleration.x;
-      break;
-    case AccelerationAxis::Y_Neg:
-      acceleration = -linearAcceleration.y;
-      break;
-    case AccelerationAxis::Y_Pos:
-      acceleration = linearAcceleration.y;
-      break;
-    case AccelerationAxis::Z_Neg:
-      acceleration = -linearAcceleration.z;
-      break;
-    case AccelerationAxis::Z_Pos:
-      acceleration = linearAcceleration.z;
-      break;
-  }
-
-  return acceleration;
+  // axes come in +/- pairs per component
+  float acceleration = linearAcceleration[axis / 2];
+  return axis % 2 == 0 ? acceleration : -acceleration;
 }
 
 float Motion::getAttitudeFromAxis(AttitudeAxis axis) {
@@ -0,0 +1,63 @@
+#include <hal/power-telemetry.h>
+#include <esp_log.h>
+#include <stdio.h>
+
+#ifdef CONFIG_PM_ENABLE
+  #include "esp_pm.h"
+#endif
+
+void PowerTelemetry::update() {
+  SleepState state = _parked ? Sleep_Parked : (_busy ? Sleep_Awake : Sleep_Idle);
+  if (state == _state)
+    return;
+
+  int64_t now = esp_timer_get_time();
+  _timeInState[_state] += now - _enteredAt;
+  _enteredAt = now;
+  _state = state;
+}
+
+void PowerTelemetry::setBusy(PowerConsumer consumer, bool busy) {
+  portENTER_CRITICAL(&_lock);
+  if (busy)
+    _busy |= 1 << consumer;
+  else
+    _busy &= ~(1 << consumer);
+
+  update();
+  portEXIT_CRITICAL(&_lock);
+}
+
+void PowerTelemetry::setParked(bool parked) {
+  portENTER_CRITICAL(&_lock);
+  _parked = parked;
+  update();
+  portEXIT_CRITICAL(&_lock);
+}
+
+int64_t PowerTelemetry::getTimeInState(SleepState state) {
+  portENTER_CRITICAL(&_lock);
+  int64_t time = _timeInState[state];
+  if (state == _state)
+    time += esp_timer_get_time() - _enteredAt;
+  portEXIT_CRITICAL(&_lock);
+
+  return time;
+}
+
+void PowerTelemetry::log() {
+  int64_t awake = getTimeInState(Sleep_Awake);
+  int64_t idle = getTimeInState(Sleep_Idle);
+  int64_t parked = getTimeInState(Sleep_Parked);
+  int64_t total = awake + idle + parked;
+  if (total <= 0)
+    return;
+
+  ESP_LOGI(POWER_TELEMETRY_TAG,"awake: %lld ms (%lld%%) idle: %lld ms (%lld%%) parked: %lld ms (%lld%%)",
+    awake / 1000, awake * 100 / total, idle / 1000, idle * 100 / total, parked / 1000, parked * 100 / total);
+
+#ifdef CONFIG_PM_PROFILING
+  // time actually spent in each power management mode
+  esp_pm_dump_locks(stdout);
+#endif
+}
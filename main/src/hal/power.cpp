@@ -2,9 +2,7 @@
 
 FreeRTOS::Semaphore Power::powerDown = FreeRTOS::Semaphore("power");
 
-Power::Power() {
-  touchEventQueue = xQueueCreate(10, sizeof(std::vector<TouchType>));
-}
+Power::Power() { }
 
 void Power::onPowerUp() {
   ampPower.init();
@@ -28,11 +26,10 @@ void Power::onPowerDown() {
 }
 
 void Power::process() {
-  if (uxQueueMessagesWaiting(touchEventQueue)) {
-    xQueueReceive(touchEventQueue, &touches, 0);
-
-    onTouchEvent(&touches);
-  }
+  Event event;
+  while (poll(event))
+    if (event.type == Event_TouchSequence)
+      onTouchEvent(event.touches);
   
   PowerStatus newStatus;
   ampPower.process();
@@ -46,7 +43,7 @@ void Power::process() {
 }
 
 void Power::addPowerLevelListener(PowerListener *listener) {
-  powerLevelListeners.push_back(listener);
+  EventBus::instance()->subscribe(listener, Event_PowerStatus);
 }
 
 void Power::addLifecycleListener(LifecycleBase *listener) {
@@ -56,9 +53,10 @@ void Power::addLifecycleListener(LifecycleBase *listener) {
 void Power::notifyPowerListeners() {
   ESP_LOGV(POWER_TAG,"Power status notification: Charging: %s, Level: %d (%d %%), Battery Present: %s", status.charging ? "true" : "false", status.level, status.percentage, status.batteryPresent ? "true" : "false");
 
-  for(auto listener : powerLevelListeners)
-    if (listener->powerStatusQueue != NULL)
-      xQueueSend(listener->powerStatusQueue, &status, 0);
+  Event event;
+  event.type = Event_PowerStatus;
+  event.powerStatus = status;
+  EventBus::instance()->publish(event);
 }
 
 PowerStatus Power::calculatePowerStatus(bool batteryPresent, bool charging, bool done, uint8_t batteryLevel) {
@@ -84,9 +82,9 @@ PowerStatus Power::calculatePowerStatus(bool batteryPresent, bool charging, bool
   return ns;
 }
 
-void Power::onTouchEvent(std::vector<TouchType> *touches) {
-  if (touches->size() == 1) {
-    if ((*touches)[0] == TouchType::Hold) {
+void Power::onTouchEvent(TouchSequence touches) {
+  if (touches.count == 1) {
+    if (touches.touches[0] == TouchType::Hold) {
       shutdown();
     }
   }
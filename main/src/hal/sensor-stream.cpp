@@ -0,0 +1,72 @@
+#include <hal/sensor-stream.h>
+#include <math.h>
+
+static inline int16_t quantize(float value, float scale) {
+  float scaled = value * scale;
+  if (scaled > INT16_MAX)
+    return INT16_MAX;
+  if (scaled < INT16_MIN)
+    return INT16_MIN;
+  return (int16_t)lroundf(scaled);
+}
+
+bool SensorStream::start(uint8_t rate, uint16_t batch, TaskHandle_t reader) {
+  if (rate == 0 || rate > SENSOR_STREAM_MAX_RATE || batch == 0 || batch > SENSOR_STREAM_SAMPLES / 2)
+    return false;
+
+  // drop what's left of an earlier stream
+  _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+  _batch = batch;
+  _reader = reader;
+  _overruns = 0;
+  _period.store(1000000 / rate, std::memory_order_release);
+  return true;
+}
+
+bool SensorStream::pop(SensorSample &sample) {
+  uint16_t tail = _tail.load(std::memory_order_relaxed);
+  if (tail == _head.load(std::memory_order_acquire))
+    return false;
+
+  sample = _ring[tail % SENSOR_STREAM_SAMPLES];
+  _tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+void SensorStream::push(unsigned long time, const Vector3D &linearAcceleration, const Vector3D &gravity, const Vector3D &attitude) {
+  uint32_t period = _period.load(std::memory_order_acquire);
+  if (period == 0)
+    return;
+
+  // the sampler ticks faster than the stream, keep samples a period apart
+  // allowing for half a sampler tick of jitter
+  uint32_t now = time;
+  if (now - _lastPushed < period - MOTION_SAMPLE_PERIOD * 500)
+    return;
+
+  _lastPushed = now;
+
+  uint16_t head = _head.load(std::memory_order_relaxed);
+  if ((uint16_t)(head - _tail.load(std::memory_order_acquire)) >= SENSOR_STREAM_SAMPLES) {
+    // the reader fell behind, newer samples matter more but the ring is
+    // single producer so the newest one is lost instead
+    _overruns++;
+    return;
+  }
+
+  auto& sample = _ring[head % SENSOR_STREAM_SAMPLES];
+  sample.time = now;
+  sample.values[0] = quantize(linearAcceleration.x, SENSOR_ACCEL_SCALE);
+  sample.values[1] = quantize(linearAcceleration.y, SENSOR_ACCEL_SCALE);
+  sample.values[2] = quantize(linearAcceleration.z, SENSOR_ACCEL_SCALE);
+  sample.values[3] = quantize(gravity.x, SENSOR_ACCEL_SCALE);
+  sample.values[4] = quantize(gravity.y, SENSOR_ACCEL_SCALE);
+  sample.values[5] = quantize(gravity.z, SENSOR_ACCEL_SCALE);
+  sample.values[6] = quantize(attitude.x, SENSOR_ATTITUDE_SCALE);
+  sample.values[7] = quantize(attitude.y, SENSOR_ATTITUDE_SCALE);
+  sample.values[8] = quantize(attitude.z, SENSOR_ATTITUDE_SCALE);
+  _head.store(head + 1, std::memory_order_release);
+
+  if ((uint16_t)(head + 1 - _tail.load(std::memory_order_relaxed)) >= _batch && _reader != NULL)
+    xTaskNotifyGive(_reader);
+}
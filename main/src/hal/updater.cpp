@@ -1,68 +1,493 @@
 #include <updater.h>
+#include "esp32/rom/crc.h"
+
+uint32_t Updater::startUpdate(uint32_t size, uint32_t crc) {
+  if (_writerHandle != NULL) {
+    // a dropped transfer picks up where it stopped
+    if (size != 0 && size == _size && crc == _crc && status != UpdateStatus::ErrorWrite) {
+      ESP_LOGI(UPDATER_TAG,"Resuming update at %d bytes", dataLength);
+      return dataLength;
+    }
+
+    if (!abortUpdate()) {
+      ESP_LOGE(UPDATER_TAG,"Update in progress did not stop");
+      return 0;
+    }
+  }
 
-void Updater::startUpdate() {
   status = UpdateStatus::Start;
   updatePacketsCount = 0;
+  dataLength = 0;
+  _size = size;
+  _crc = crc;
+  _streamCrc = 0;
+  _consumed = 0;
+  _written = 0;
+  _erasedTo = 0;
+  _checkpointAt = 0;
+  _notifiedAt = 0;
+  _throughput = 0;
+  _ending = false;
+  _format = Update_Unknown;
+  _headerLength = 0;
+  _sectorFilled = 0;
   
   // get next ota partition
   updatePartition = esp_ota_get_next_update_partition(NULL);
 
-  // start update + set update handle
-  auto error = esp_ota_begin(updatePartition, OTA_SIZE_UNKNOWN, &updateHandle);
-  if (error != ESP_OK)
+  if (updatePartition == NULL)
     status = UpdateStatus::ErrorStart;
+  else {
+    if (!resumeCheckpoint())
+      AmpStorage::eraseKey(UPDATE_CHECKPOINT_KEY);
+
+    if (_buffer == NULL)
+      _buffer = xStreamBufferCreate(UPDATE_BUFFER_SIZE, SPI_FLASH_SEC_SIZE);
+    else
+      xStreamBufferReset(_buffer);
+
+    if (_sector == NULL)
+      _sector = (uint8_t*)malloc(SPI_FLASH_SEC_SIZE);
+
+    if (_buffer == NULL || _sector == NULL)
+      status = UpdateStatus::ErrorStart;
+    else {
+      _startedAt = esp_timer_get_time();
+      xTaskCreatePinnedToCore(writer, "ota-writer", 4096, this, 2, &_writerHandle, 0);
+    }
+  }
 
   notifyUpdateListeners();
+  return dataLength;
+}
+
+bool Updater::abortUpdate() {
+  ESP_LOGW(UPDATER_TAG,"Replacing the update in progress");
+  status = UpdateStatus::ErrorWrite;
+  _ending = true;
+
+  // the writer releases everything on its way out
+  for (auto waited = 0; _writerHandle != NULL && waited < UPDATE_ABORT_TIMEOUT; waited += 10)
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+
+  return _writerHandle == NULL;
+}
+
+bool Updater::resumeCheckpoint() {
+  UpdateCheckpoint checkpoint;
+  if (_size == 0 || !AmpStorage::getBlob(UPDATE_CHECKPOINT_KEY, &checkpoint, sizeof(checkpoint)))
+    return false;
+
+  if (checkpoint.size != _size || checkpoint.crc != _crc || checkpoint.offset > _size || checkpoint.offset % SPI_FLASH_SEC_SIZE != 0)
+    return false;
+
+  // everything before the offset is in flash, the sector after it may be
+  // half written and is erased again
+  _format = Update_Raw;
+  dataLength = checkpoint.offset;
+  _consumed = checkpoint.offset;
+  _written = checkpoint.offset;
+  _erasedTo = checkpoint.offset;
+  _checkpointAt = checkpoint.offset;
+  _notifiedAt = checkpoint.offset;
+  _streamCrc = checkpoint.streamCrc;
+
+  ESP_LOGI(UPDATER_TAG,"Resuming update from checkpoint at %d bytes", checkpoint.offset);
+  return true;
+}
+
+void Updater::saveCheckpoint() {
+  UpdateCheckpoint checkpoint = { _size, _crc, (uint32_t)_written, _streamCrc };
+  AmpStorage::saveBlob(UPDATE_CHECKPOINT_KEY, &checkpoint, sizeof(checkpoint));
+  _checkpointAt = _written;
 }
 
 void Updater::endUpdate() {
-  status = UpdateStatus::End;
-  ESP_LOGV(UPDATER_TAG,"Ending update. Total written: %d bytes", dataLength);
+  if (_writerHandle == NULL)
+    return;
+
+  // the writer flushes what's left and finishes the update
+  ESP_LOGV(UPDATER_TAG,"Ending update. Total received: %d bytes", dataLength);
+  _ending = true;
+}
+
+void Updater::writeUpdate(const uint8_t *data, size_t length) {
+  if (_writerHandle == NULL || status == UpdateStatus::ErrorWrite)
+    return;
+
+  updatePacketsCount++;
+  dataLength += length;
+
+  // blocks the BLE host while flash catches up, which throttles the sender
+  size_t sent = xStreamBufferSend(_buffer, data, length, pdMS_TO_TICKS(UPDATE_WRITE_TIMEOUT));
+  if (sent != length) {
+    ESP_LOGE(UPDATER_TAG,"Update buffer overrun at packet %d", updatePacketsCount);
+    status = UpdateStatus::ErrorWrite;
+    _ending = true;
+    notifyUpdateListeners();
+  }
+}
+
+void Updater::writer(void *parameters) {
+  auto updater = (Updater*)parameters;
+  uint8_t input[UPDATE_INPUT_CHUNK];
+  bool ok = true;
+
+  for (;;) {
+    size_t received = xStreamBufferReceive(updater->_buffer, input, sizeof(input), pdMS_TO_TICKS(UPDATE_WRITER_POLL));
+    if (received > 0)
+      ok = updater->consume(input, received);
+
+    if (!ok || updater->status == UpdateStatus::ErrorWrite || (updater->_ending && xStreamBufferIsEmpty(updater->_buffer)))
+      break;
+  }
+
+  if (ok && updater->status != UpdateStatus::ErrorWrite)
+    updater->flush();
+
+  updater->finishUpdate();
+  updater->releaseBuffers();
+
+  updater->_writerHandle = NULL;
+  vTaskDelete(NULL);
+}
+
+bool Updater::consume(const uint8_t *data, size_t length) {
+  auto chunk = data;
+  auto chunkLength = length;
+  _consumed += length;
+
+  if (_format == Update_Unknown) {
+    size_t used;
+    if (!consumeHeader(data, length, &used))
+      return false;
+
+    data += used;
+    length -= used;
+  }
+
+  // raw data is added to the crc a sector at a time so checkpoints match the flash
+  if (_format == Update_Raw)
+    return consumeRaw(data, length);
+
+  _streamCrc = crc32_le(_streamCrc, chunk, chunkLength);
+  return length == 0 || inflate(data, length);
+}
+
+bool Updater::consumeHeader(const uint8_t *data, size_t length, size_t *used) {
+  *used = 0;
+
+  // plain images are recognized by their first byte
+  if (_headerLength == 0 && length > 0 && data[0] != (UPDATE_DEFLATE_MAGIC & 0xff)) {
+    _format = Update_Raw;
+    return true;
+  }
+
+  // the magic decides how long the rest of the header is
+  uint32_t magic = 0;
+  size_t headerSize = UPDATE_MAGIC_SIZE;
+  for (;;) {
+    if (_headerLength >= UPDATE_MAGIC_SIZE) {
+      memcpy(&magic, &_header[0], sizeof(magic));
+      headerSize = magic == UPDATE_DELTA_MAGIC ? UPDATE_DELTA_HEADER : UPDATE_DEFLATE_HEADER;
+    }
+
+    if (_headerLength == headerSize || *used == length)
+      break;
+
+    _header[_headerLength++] = data[(*used)++];
+  }
+
+  if (_headerLength < headerSize)
+    return true;
+
+  if (magic != UPDATE_DEFLATE_MAGIC && magic != UPDATE_DELTA_MAGIC) {
+    ESP_LOGE(UPDATER_TAG,"Unrecognized update image");
+    status = UpdateStatus::ErrorWrite;
+    notifyUpdateListeners();
+    return false;
+  }
+
+  memcpy(&_imageSize, &_header[4], sizeof(_imageSize));
+  if (_imageSize > updatePartition->size) {
+    ESP_LOGE(UPDATER_TAG,"Update of %d bytes does not fit the partition", _imageSize);
+    status = UpdateStatus::ErrorWrite;
+    notifyUpdateListeners();
+    return false;
+  }
+
+  if (magic == UPDATE_DELTA_MAGIC) {
+    uint32_t sourceSize, sourceCrc;
+    memcpy(&sourceSize, &_header[8], sizeof(sourceSize));
+    memcpy(&sourceCrc, &_header[12], sizeof(sourceCrc));
+
+    if (!beginDelta(sourceSize, sourceCrc))
+      return false;
+  }
+
+  return beginInflate();
+}
+
+bool Updater::beginInflate() {
+  _inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+  _window = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+  if (_inflator == NULL || _window == NULL) {
+    ESP_LOGE(UPDATER_TAG,"Not enough memory to inflate the update");
+    status = UpdateStatus::ErrorWrite;
+    notifyUpdateListeners();
+    return false;
+  }
+
+  tinfl_init(_inflator);
+  _windowFilled = 0;
+  _inflated = false;
+  if (_format == Update_Unknown)
+    _format = Update_Deflate;
+
+  ESP_LOGI(UPDATER_TAG,"Receiving %s update, %d bytes uncompressed", _format == Update_Delta ? "delta" : "compressed", _imageSize);
+  return true;
+}
+
+bool Updater::beginDelta(uint32_t sourceSize, uint32_t sourceCrc) {
+  auto running = esp_ota_get_running_partition();
+  if (sourceSize == 0 || sourceSize > running->size) {
+    ESP_LOGE(UPDATER_TAG,"Delta source of %d bytes does not fit the running partition", sourceSize);
+    status = UpdateStatus::ErrorWrite;
+    notifyUpdateListeners();
+    return false;
+  }
 
-  // end the ota update and verify it's good
-  auto error = esp_ota_end(updateHandle);
+  const void *source;
+  auto error = esp_partition_mmap(running, 0, sourceSize, SPI_FLASH_MMAP_DATA, &source, &_sourceHandle);
   if (error != ESP_OK) {
-    status = UpdateStatus::ErrorEnd;
-    ESP_LOGV(UPDATER_TAG,"Error ending update: %d", status);
+    ESP_LOGE(UPDATER_TAG,"Unable to map the running partition: %s", esp_err_to_name(error));
+    status = UpdateStatus::ErrorWrite;
+    notifyUpdateListeners();
+    return false;
   }
-  else {
-    // set next boot partition
-    error = esp_ota_set_boot_partition(updatePartition);
-    if (error != ESP_OK)
-      status = UpdateStatus::ErrorEnd;
+
+  _source = (const uint8_t*)source;
+
+  // a delta only applies to the exact image it was made from
+  uint32_t crc = crc32_le(0, _source, sourceSize);
+  if (crc != sourceCrc) {
+    ESP_LOGE(UPDATER_TAG,"Delta was made for a different firmware: %08x != %08x", crc, sourceCrc);
+    status = UpdateStatus::ErrorWrite;
+    notifyUpdateListeners();
+    return false;
   }
 
-  notifyUpdateListeners();
+  _patcher.begin(_source, sourceSize);
+  _format = Update_Delta;
+  return true;
 }
 
-void Updater::writeUpdate(std::string data) {
-  updatePacketsCount++;
-  ESP_LOGV(UPDATER_TAG,"Update packet %d", updatePacketsCount);
+bool Updater::consumeRaw(const uint8_t *data, size_t length) {
+  while (length > 0) {
+    size_t count = std::min(length, (size_t)SPI_FLASH_SEC_SIZE - _sectorFilled);
+    memcpy(&_sector[_sectorFilled], data, count);
+    _streamCrc = crc32_le(_streamCrc, data, count);
+    _sectorFilled += count;
+    data += count;
+    length -= count;
 
-  const char* dataC = data.data();
-  auto size = data.length();
-  dataLength += size;
+    if (_sectorFilled == SPI_FLASH_SEC_SIZE) {
+      if (!writeFlash(_sector, _sectorFilled))
+        return false;
 
-  printf("Data: ");
-  for (int i = 0; i < size; i++)
-    printf("%d ", dataC[i]);
-  printf("\n");
-  
-  auto error = esp_ota_write(updateHandle, (const void*) dataC, size);
+      _sectorFilled = 0;
+    }
+  }
+
+  return true;
+}
+
+bool Updater::inflate(const uint8_t *data, size_t length) {
+  while (!_inflated) {
+    size_t in = length;
+    size_t out = TINFL_LZ_DICT_SIZE - _windowFilled;
+
+    // the window doubles as the dictionary, it is only passed on (and
+    // reused from the start) once it is full
+    auto result = tinfl_decompress(_inflator, data, &in, _window, &_window[_windowFilled], &out,
+      TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+
+    data += in;
+    length -= in;
+    _windowFilled += out;
+
+    if (_windowFilled == TINFL_LZ_DICT_SIZE) {
+      if (!inflated(_window, _windowFilled))
+        return false;
+
+      _windowFilled = 0;
+    }
+
+    if (result < TINFL_STATUS_DONE) {
+      ESP_LOGE(UPDATER_TAG,"Corrupt compressed update (%d)", result);
+      status = UpdateStatus::ErrorWrite;
+      notifyUpdateListeners();
+      return false;
+    }
+
+    if (result == TINFL_STATUS_DONE)
+      _inflated = true;
+    else if (result == TINFL_STATUS_NEEDS_MORE_INPUT && length == 0)
+      break;
+  }
+
+  return true;
+}
+
+bool Updater::inflated(const uint8_t *data, size_t length) {
+  return _format == Update_Delta ? patch(data, length) : writeFlash(data, length);
+}
+
+bool Updater::patch(const uint8_t *data, size_t length) {
+  while (length > 0) {
+    size_t in = length;
+    size_t out = SPI_FLASH_SEC_SIZE - _sectorFilled;
+
+    if (!_patcher.apply(data, &in, &_sector[_sectorFilled], &out)) {
+      ESP_LOGE(UPDATER_TAG,"Delta reads outside the running firmware");
+      status = UpdateStatus::ErrorWrite;
+      notifyUpdateListeners();
+      return false;
+    }
+
+    data += in;
+    length -= in;
+    _sectorFilled += out;
+
+    if (_sectorFilled == SPI_FLASH_SEC_SIZE) {
+      if (!writeFlash(_sector, _sectorFilled))
+        return false;
+
+      _sectorFilled = 0;
+    }
+  }
+
+  return true;
+}
+
+bool Updater::flush() {
+  if (_size != 0 && (_consumed != _size || _streamCrc != _crc)) {
+    ESP_LOGE(UPDATER_TAG,"Update does not match its size and crc: %d of %d bytes, %08x != %08x", _consumed, _size, _streamCrc, _crc);
+    status = UpdateStatus::ErrorWrite;
+    notifyUpdateListeners();
+    return false;
+  }
+
+  if (_format == Update_Raw)
+    return _sectorFilled == 0 || writeFlash(_sector, _sectorFilled);
+
+  if (_format == Update_Unknown)
+    return true;
+
+  if (_windowFilled > 0 && !inflated(_window, _windowFilled))
+    return false;
+
+  if (_format == Update_Delta) {
+    if (_sectorFilled > 0 && !writeFlash(_sector, _sectorFilled))
+      return false;
+
+    if (!_patcher.isComplete())
+      _inflated = false;
+  }
+
+  if (!_inflated || _written != _imageSize) {
+    ESP_LOGE(UPDATER_TAG,"Update incomplete: %d of %d bytes", _written, _imageSize);
+    status = UpdateStatus::ErrorWrite;
+    notifyUpdateListeners();
+    return false;
+  }
+
+  return true;
+}
+
+bool Updater::writeFlash(const uint8_t *data, size_t length) {
+  // erase just ahead of the write, a resumed update keeps what it has
+  size_t end = _written + length;
+  if (end > _erasedTo) {
+    size_t eraseTo = (end + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1);
+    auto error = esp_partition_erase_range(updatePartition, _erasedTo, eraseTo - _erasedTo);
+    if (error != ESP_OK) {
+      ESP_LOGE(UPDATER_TAG,"Erase error: %s", esp_err_to_name(error));
+      status = UpdateStatus::ErrorWrite;
+      notifyUpdateListeners();
+      return false;
+    }
+
+    _erasedTo = eraseTo;
+  }
+
+  auto error = esp_partition_write(updatePartition, _written, data, length);
   if (error != ESP_OK) {
+    ESP_LOGE(UPDATER_TAG,"Write error: %s", esp_err_to_name(error));
     status = UpdateStatus::ErrorWrite;
-    ESP_LOGV(UPDATER_TAG,"Write error: %d", status);
+    notifyUpdateListeners();
+    return false;
   }
-  
+
+  _written += length;
+
+  if (_format == Update_Raw && _size != 0 && _written - _checkpointAt >= UPDATE_CHECKPOINT_BYTES)
+    saveCheckpoint();
+
+  int64_t elapsed = esp_timer_get_time() - _startedAt;
+  if (elapsed > 0)
+    _throughput = (uint64_t)dataLength * 1000000 / 1024 / elapsed;
+
+  // status updates blink the LED and go out over BLE, keep them rare
+  if (_written - _notifiedAt >= UPDATE_NOTIFY_BYTES) {
+    _notifiedAt = _written;
+    status = UpdateStatus::Write;
+    ESP_LOGD(UPDATER_TAG,"Written %d bytes from %d received (%d KB/s)", _written, dataLength, _throughput);
+    notifyUpdateListeners();
+  }
+
+  return true;
+}
+
+void Updater::releaseBuffers() {
+  free(_inflator);
+  free(_window);
+  _inflator = NULL;
+  _window = NULL;
+
+  if (_source != NULL) {
+    spi_flash_munmap(_sourceHandle);
+    _source = NULL;
+  }
+}
+
+void Updater::finishUpdate() {
+  AmpStorage::eraseKey(UPDATE_CHECKPOINT_KEY);
+
+  // a failed update never becomes the boot partition
+  if (status == UpdateStatus::ErrorWrite)
+    return;
+
+  status = UpdateStatus::End;
+  ESP_LOGI(UPDATER_TAG,"Update written: %d bytes from %d received in %d packets (%d KB/s)", _written, dataLength, updatePacketsCount, _throughput);
+
+  // the image is verified before it's made the boot partition
+  auto error = esp_ota_set_boot_partition(updatePartition);
+  if (error != ESP_OK) {
+    status = UpdateStatus::ErrorEnd;
+    ESP_LOGE(UPDATER_TAG,"Error ending update: %s", esp_err_to_name(error));
+  }
+
   notifyUpdateListeners();
 }
 
 void Updater::addUpdateListener(UpdateListener *listener) {
-  updateListeners.push_back(listener);
+  EventBus::instance()->subscribe(listener, Event_UpdateStatus);
 }
 
 void Updater::notifyUpdateListeners() {
-  for(auto listener : updateListeners)
-    if (listener->updateStatusQueue != NULL)
-      xQueueSend(listener->updateStatusQueue, &status, 0);
-}
\ No newline at end of file
+  Event event;
+  event.type = Event_UpdateStatus;
+  event.updateStatus = status;
+  EventBus::instance()->publish(event);
+}
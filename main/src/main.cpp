@@ -6,7 +6,9 @@ void appLoop(void *params) {
   
   for (;;) {
     amp->process();
-    delay(50);
+
+    // woken by vehicle states and events, otherwise only to poll the battery
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(POWER_POLL_INTERVAL));
   }
 
   vTaskDelete(NULL);
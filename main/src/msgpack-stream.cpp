@@ -0,0 +1,345 @@
+#include <msgpack-stream.h>
+#include <string.h>
+#include <algorithm>
+#include <esp_log.h>
+
+void MsgPackReader::reset(MsgPackHandler *handler) {
+  _handler = handler;
+  _status = MsgPack_Incomplete;
+  _state = Reader_Type;
+  _depth = 0;
+  _offset = 0;
+}
+
+MsgPackStatus MsgPackReader::feed(const uint8_t *data, size_t length) {
+  size_t i = 0;
+
+  while (i < length && _status == MsgPack_Incomplete) {
+    switch (_state) {
+      case Reader_Type:
+        beginType(data[i++]);
+        break;
+      case Reader_Header:
+        _header[_headerRead++] = data[i++];
+        if (_headerRead == _headerLength)
+          endHeader();
+        break;
+      case Reader_String: {
+        // copy as much of the string as this chunk holds
+        uint32_t count = std::min((size_t)(_stringLength - _stringRead), length - i);
+        if (_stringRead < MSGPACK_MAX_STRING) {
+          uint32_t keep = std::min(count, (uint32_t)MSGPACK_MAX_STRING - _stringRead);
+          memcpy(&_string[_stringRead], &data[i], keep);
+        }
+
+        _stringRead += count;
+        i += count;
+
+        if (_stringRead == _stringLength)
+          endString();
+        break;
+      }
+      case Reader_Skip: {
+        uint32_t count = std::min((size_t)_skip, length - i);
+        _skip -= count;
+        i += count;
+
+        if (_skip == 0) {
+          _state = Reader_Type;
+          if (expectingKey())
+            fail("non string key");
+          else {
+            _handler->onNil();
+            endValue();
+          }
+        }
+        break;
+      }
+    }
+  }
+
+  _offset += i;
+  return _status;
+}
+
+void MsgPackReader::beginType(uint8_t type) {
+  _type = type;
+  _headerRead = 0;
+  _headerLength = 0;
+
+  // single byte values
+  if (type <= 0x7f || type >= 0xe0 || (type >= 0xc0 && type <= 0xc3)) {
+    if (expectingKey()) {
+      fail("non string key");
+      return;
+    }
+
+    if (type <= 0x7f)
+      _handler->onNumber(type);
+    else if (type >= 0xe0)
+      _handler->onNumber((int8_t)type);
+    else if (type == 0xc0)
+      _handler->onNil();
+    else if (type == 0xc2 || type == 0xc3)
+      _handler->onBool(type == 0xc3);
+    else {
+      fail("reserved type");
+      return;
+    }
+
+    endValue();
+    return;
+  }
+
+  if (type <= 0x8f) {
+    beginContainer(true, type & 0x0f);
+    return;
+  }
+
+  if (type <= 0x9f) {
+    beginContainer(false, type & 0x0f);
+    return;
+  }
+
+  if (type <= 0xbf) {
+    beginString(type & 0x1f);
+    return;
+  }
+
+  // everything else carries a big endian header
+  switch (type) {
+    case 0xc4: case 0xd9: case 0xcc: case 0xd0: _headerLength = 1; break;
+    case 0xc5: case 0xda: case 0xcd: case 0xd1: case 0xdc: case 0xde: _headerLength = 2; break;
+    case 0xc6: case 0xdb: case 0xce: case 0xd2: case 0xdd: case 0xdf: case 0xca: _headerLength = 4; break;
+    case 0xcf: case 0xd3: case 0xcb: _headerLength = 8; break;
+    case 0xc7: _headerLength = 2; break;   // ext 8: length + type
+    case 0xc8: _headerLength = 3; break;   // ext 16
+    case 0xc9: _headerLength = 5; break;   // ext 32
+    case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:
+      // fixext, type byte plus 1 - 16 data bytes
+      _headerLength = 1;
+      break;
+  }
+
+  _state = Reader_Header;
+}
+
+void MsgPackReader::endHeader() {
+  uint64_t value = 0;
+  for (uint8_t i = 0; i < _headerLength; i++)
+    value = (value << 8) | _header[i];
+
+  _state = Reader_Type;
+
+  switch (_type) {
+    case 0xd9: case 0xda: case 0xdb:
+      beginString(value);
+      return;
+    case 0xdc: case 0xdd:
+      beginContainer(false, value);
+      return;
+    case 0xde: case 0xdf:
+      beginContainer(true, value);
+      return;
+    case 0xc4: case 0xc5: case 0xc6:
+      _skip = value;
+      break;
+    case 0xc7: case 0xc8: case 0xc9:
+      _skip = value >> 8;
+      break;
+    case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:
+      _skip = 1 << (_type - 0xd4);
+      break;
+    default:
+      break;
+  }
+
+  // binary and extension values are skipped and reported as nil
+  if (_type == 0xc4 || _type == 0xc5 || _type == 0xc6 || (_type >= 0xc7 && _type <= 0xc9) || (_type >= 0xd4 && _type <= 0xd8)) {
+    if (_skip > 0) {
+      _state = Reader_Skip;
+      return;
+    }
+
+    if (expectingKey()) {
+      fail("non string key");
+      return;
+    }
+
+    _handler->onNil();
+    endValue();
+    return;
+  }
+
+  if (expectingKey()) {
+    fail("non string key");
+    return;
+  }
+
+  switch (_type) {
+    case 0xca: {
+      uint32_t bits = value;
+      float number;
+      memcpy(&number, &bits, sizeof(number));
+      _handler->onNumber(number);
+      break;
+    }
+    case 0xcb: {
+      double number;
+      memcpy(&number, &value, sizeof(number));
+      _handler->onNumber(number);
+      break;
+    }
+    case 0xcc: case 0xcd: case 0xce: case 0xcf:
+      _handler->onNumber(value);
+      break;
+    case 0xd0: _handler->onNumber((int8_t)value); break;
+    case 0xd1: _handler->onNumber((int16_t)value); break;
+    case 0xd2: _handler->onNumber((int32_t)value); break;
+    case 0xd3: _handler->onNumber((int64_t)value); break;
+  }
+
+  endValue();
+}
+
+void MsgPackReader::beginContainer(bool map, uint32_t size) {
+  if (expectingKey()) {
+    fail("non string key");
+    return;
+  }
+
+  if (_depth == MSGPACK_MAX_DEPTH) {
+    fail("nested too deep");
+    return;
+  }
+
+  map ? _handler->onMap(size) : _handler->onArray(size);
+  _stack[_depth++] = { size, map, map };
+
+  // empty containers are complete right away
+  if (size == 0) {
+    _depth--;
+    _handler->onEnd();
+    endValue();
+  }
+}
+
+void MsgPackReader::beginString(uint32_t length) {
+  _stringLength = length;
+  _stringRead = 0;
+
+  if (length == 0)
+    endString();
+  else
+    _state = Reader_String;
+}
+
+void MsgPackReader::endString() {
+  _state = Reader_Type;
+
+  bool truncated = _stringLength > MSGPACK_MAX_STRING;
+  _string[truncated ? MSGPACK_MAX_STRING : _stringLength] = '\0';
+
+  if (expectingKey()) {
+    _handler->onKey(_string);
+    _stack[_depth - 1].key = false;
+    return;
+  }
+
+  _handler->onString(_string, truncated);
+  endValue();
+}
+
+void MsgPackReader::endValue() {
+  // a finished value completes map entries / array elements, which can
+  // complete their containers in turn
+  while (_depth > 0) {
+    Frame &frame = _stack[_depth - 1];
+    frame.remaining--;
+    frame.key = frame.map;
+
+    if (frame.remaining > 0)
+      return;
+
+    _depth--;
+    _handler->onEnd();
+  }
+
+  _status = MsgPack_Done;
+}
+
+bool MsgPackReader::expectingKey() {
+  return _depth > 0 && _stack[_depth - 1].key;
+}
+
+void MsgPackReader::fail(const char *reason) {
+  ESP_LOGW(MSGPACK_TAG,"Invalid msgpack near byte %d: %s", _offset, reason);
+  _status = MsgPack_Error;
+}
+
+void MsgPackWriter::write(uint8_t type, uint32_t value, uint8_t bytes) {
+  write(type);
+  for (int8_t i = bytes - 1; i >= 0; i--)
+    write((value >> (i * 8)) & 0xff);
+}
+
+void MsgPackWriter::map(uint32_t size) {
+  if (size < 16)
+    write(0x80 | size);
+  else if (size <= 0xffff)
+    write(0xde, size, 2);
+  else
+    write(0xdf, size, 4);
+}
+
+void MsgPackWriter::array(uint32_t size) {
+  if (size < 16)
+    write(0x90 | size);
+  else if (size <= 0xffff)
+    write(0xdc, size, 2);
+  else
+    write(0xdd, size, 4);
+}
+
+void MsgPackWriter::string(const std::string &value) {
+  uint32_t length = value.length();
+
+  if (length < 32)
+    write(0xa0 | length);
+  else if (length <= 0xff)
+    write(0xd9, length, 1);
+  else if (length <= 0xffff)
+    write(0xda, length, 2);
+  else
+    write(0xdb, length, 4);
+
+  fwrite(value.data(), 1, length, _file);
+}
+
+void MsgPackWriter::integer(int64_t value) {
+  if (value >= 0 && value <= 0x7f)
+    write(value);
+  else if (value < 0 && value >= -32)
+    write((uint8_t)(int8_t)value);
+  else if (value >= 0 && value <= 0xffff)
+    write(0xcd, value, 2);
+  else if (value >= 0 && value <= 0xffffffff)
+    write(0xce, value, 4);
+  else if (value < 0 && value >= INT32_MIN)
+    write(0xd2, (uint32_t)(int32_t)value, 4);
+  else {
+    write(value > 0 ? 0xcf : 0xd3, (uint64_t)value >> 32, 4);
+    for (int8_t i = 3; i >= 0; i--)
+      write(((uint64_t)value >> (i * 8)) & 0xff);
+  }
+}
+
+void MsgPackWriter::number(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  write(0xca, bits, 4);
+}
+
+void MsgPackWriter::boolean(bool value) {
+  write(value ? 0xc3 : 0xc2);
+}
@@ -2,15 +2,17 @@
 
 BatteryService::BatteryService(BLEServer *server) {
   _server = server;
-  powerStatusQueue = xQueueCreate(1, sizeof(PowerStatus));
 
   setupService();
 }
 
 void BatteryService::process() {
-  if (uxQueueMessagesWaiting(powerStatusQueue)) {
-    xQueueReceive(powerStatusQueue, &_powerStatus, 0);
-    onPowerStatusChanged(_powerStatus);
+  Event event;
+  while (poll(event)) {
+    if (event.type == Event_PowerStatus) {
+      _powerStatus = event.powerStatus;
+      onPowerStatusChanged(_powerStatus);
+    }
   }
 }
 
@@ -23,6 +25,8 @@ void BatteryService::setupService() {
     NIMBLE_PROPERTY::READ |
     NIMBLE_PROPERTY::NOTIFY);
 
+  TelemetryScheduler::instance()->attach(Telemetry_Battery, _batteryCharacteristic, TELEMETRY_BATTERY_INTERVAL);
+
   service->start();
 }
 
@@ -59,6 +63,5 @@ void BatteryService::onPowerStatusChanged(PowerStatus status) {
       break;
   }
 
-  _batteryCharacteristic->setValue(data, sizeof(data));
-  _batteryCharacteristic->notify();
+  TelemetryScheduler::instance()->update(Telemetry_Battery, data, sizeof(data));
 }
\ No newline at end of file
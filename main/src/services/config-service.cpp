@@ -1,4 +1,5 @@
 #include <services/config-service.h>
+#include "os/os_mbuf.h"
 
 ConfigService::ConfigService(Config *config, NimBLEServer *server) {
   _config = config;
@@ -36,6 +37,32 @@ void ConfigService::setupService() {
   _configStatusCharacteristic->setCallbacks(this);
 
   service->start();
+
+  xTaskCreatePinnedToCore(transmitter, "config-tx", 4096, this, CONFIG_TX_PRIORITY, &_transmitHandle, 0);
+}
+
+void ConfigService::transmitter(void *parameters) {
+  auto service = (ConfigService*)parameters;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    if (service->_configRequested) {
+      service->_configRequested = false;
+      service->transmitConfig();
+    }
+  }
+}
+
+void ConfigService::transmitConfig() {
+  std::string data = std::string("raw:").append(_config->getRawConfig());
+  uint32_t length = data.length();
+  uint8_t raw[5];
+  raw[0] = ConfigControl::TransmitStart;
+  memcpy(&raw[1], &length, sizeof(uint32_t));
+  _configStatusCharacteristic->setValue(raw);
+  _configStatusCharacteristic->notify(true);
+  transmit(data);
 }
 
 void ConfigService::onWrite(NimBLECharacteristic* characteristic) {
@@ -50,25 +77,76 @@ void ConfigService::onWrite(NimBLECharacteristic* characteristic) {
       memcpy(&_toReceive, (void*)&data[1], sizeof(uint32_t));
       rxBuffer.clear(); 
       _received = 0;
+      _streaming = false;
+      BluetoothLE::instance()->traffic(Activity_Transfer, 0);
       ESP_LOGD(CONFIG_SERVICE_TAG, "Profile receive started. Expecting %d bytes", _toReceive);
     }
   }
   else if (uuid.compare(configRxCharacteristicUUID) == 0) {
-    if (_received < _toReceive) {
-      rxBuffer.append(received);
+    // binary commands fit one write and skip the transfer start
+    if (_received >= _toReceive && CommandReader::isBinary((const uint8_t*)received.data(), received.length())) {
+      BluetoothLE::instance()->traffic(Activity_Idle, received.length());
+      processBinaryCommands((const uint8_t*)received.data(), received.length());
+    }
+    else if (_received < _toReceive) {
+      BluetoothLE::instance()->traffic(Activity_Transfer, received.length());
+      bool first = _received == 0;
       _received += received.length();
       ESP_LOGD(CONFIG_SERVICE_TAG, "Received %d bytes", _received);
 
-      if (_received == _toReceive)
-        processCommand(rxBuffer);
+      // raw profiles can be any size, stream them into the config loader
+      // instead of buffering the whole upload
+      if (first && received.compare(0, 4, "raw:") == 0) {
+        ESP_LOGV(CONFIG_SERVICE_TAG, "Raw configuration received");
+        _streaming = _config->beginUserConfig();
+        received.erase(0, 4);
+      }
+
+      if (_streaming) {
+        if (!_config->appendUserConfig((const uint8_t*)received.data(), received.length()))
+          ESP_LOGW(CONFIG_SERVICE_TAG, "Invalid configuration received");
+
+        if (_received >= _toReceive) {
+          _config->endUserConfig();
+          _streaming = false;
+        }
+      }
+      else {
+        rxBuffer.append(received);
+
+        if (_received == _toReceive)
+          processCommand(rxBuffer);
+      }
     }
     else
       ESP_LOGW(CONFIG_SERVICE_TAG, "Exceeded expected bytes %d/%d", _toReceive, _received);
   }
 }
 
+void ConfigService::processBinaryCommands(const uint8_t *data, size_t length) {
+  CommandReader reader(data, length);
+  CommandOp op;
+  EffectCommand command;
+
+  while (reader.next(&op, &command)) {
+    if (op > Command_RemoveEffect) {
+      ESP_LOGW(CONFIG_SERVICE_TAG, "Unknown binary command %02x", op);
+      continue;
+    }
+
+    _config->applyCommand(op, command);
+  }
+}
+
 void ConfigService::processCommand(std::string data) {
-  ESP_LOGD(CONFIG_SERVICE_TAG, "Parsing command: %s", data.c_str());
+  if (CommandReader::isBinary((const uint8_t*)data.data(), data.length())) {
+    processBinaryCommands((const uint8_t*)data.data(), data.length());
+    return;
+  }
+
+  // patches are binary, don't log them as text
+  if (data.compare(0, 6, "patch:") != 0)
+    ESP_LOGD(CONFIG_SERVICE_TAG, "Parsing command: %s", data.c_str());
   std::size_t command_location = data.find_first_of(":");
   if (command_location == std::string::npos)
     ESP_LOGW(CONFIG_SERVICE_TAG, "Invalid command (no key)");
@@ -76,11 +154,7 @@ void ConfigService::processCommand(std::string data) {
     std::string key = data.substr(0, command_location);
     std::string value = data.substr(command_location + 1);
 
-    if (key == "raw") {
-      ESP_LOGV(CONFIG_SERVICE_TAG, "Raw configuration received");
-      _config->saveUserConfig(value, true);
-    }
-    else if (key == "name") {
+    if (key == "name") {
       // limit to 100 characters
       std::string name = value.substr(0, std::min((int) value.length(), 100));
       AmpStorage::saveDeviceName(name);
@@ -95,37 +169,51 @@ void ConfigService::processCommand(std::string data) {
       std::string region = regionString.substr(0, regionLocation);
       std::string effect = regionString.substr(regionLocation + 1);
 
-      bool valid = _config->addEffect(action, region, effect, save);
-      if (valid) {
+      // single effect edits are a one op patch, saving only journals it
+      std::string patch;
+      PatchWriter writer(patch);
+      writer.begin(Patch_SetEffect);
+      writer.string(action);
+      writer.string(region);
+      writer.string(effect);
+      writer.end();
+
+      bool valid = _config->applyPatch((const uint8_t*)patch.data(), patch.length(), save);
+      if (valid)
         ESP_LOGI(CONFIG_SERVICE_TAG, "Effect received - action: %s region: %s effect: %s",
           action.c_str(), region.c_str(), effect.c_str());
-        
-        if (save)
-          _config->saveConfig();
-      }
       else
         ESP_LOGW(CONFIG_SERVICE_TAG, "Invalid effect received - action: %s region: %s effect: %s",
           action.c_str(), region.c_str(), effect.c_str());
     }
     else if (key == "removeEffect") {
-      // size_t actionLocation = value.find_first_of(",");
-      // std::string action = value.substr(0, actionLocation);
-      // std::string region = value.substr(actionLocation + 1);
+      size_t actionLocation = value.find_first_of(",");
+      std::string action = value.substr(0, actionLocation);
+      std::string region = value.substr(actionLocation + 1);
 
-      // _config->removeEffect(action, region, true);
-      // _config->saveConfig();
+      std::string patch;
+      PatchWriter writer(patch);
+      writer.begin(Patch_RemoveEffect);
+      writer.string(action);
+      writer.string(region);
+      writer.end();
+
+      _config->applyPatch((const uint8_t*)patch.data(), patch.length(), true);
+    }
+    else if (key == "patch") {
+      // binary op list, see config-patch.h
+      bool applied = _config->applyPatch((const uint8_t*)value.data(), value.length(), true);
+      ESP_LOGD(CONFIG_SERVICE_TAG, "Patch of %d bytes %s", value.length(), applied ? "applied" : "rejected");
+
+      uint8_t result[2] = { ConfigControl::PatchResult, applied ? (uint8_t)0x01 : (uint8_t)0x00 };
+      _configStatusCharacteristic->setValue(result, sizeof(result));
+      _configStatusCharacteristic->notify(true);
     }
     else if (key == "get") {
       if (value == "config") {
         ESP_LOGD(CONFIG_SERVICE_TAG, "Config requested");
-        std::string data = std::string("raw:").append(_config->getRawConfig());
-        uint32_t length = data.length();
-        uint8_t raw[5];
-        raw[0] = ConfigControl::TransmitStart;
-        memcpy(&raw[1], &length, sizeof(uint32_t));
-        _configStatusCharacteristic->setValue(raw);
-        _configStatusCharacteristic->notify(true);
-        transmit(data);
+        _configRequested = true;
+        xTaskNotifyGive(_transmitHandle);
       }
     }
     else if (key == "save")
@@ -133,25 +221,7 @@ void ConfigService::processCommand(std::string data) {
   }
 }
 
-std::vector<std::string> ConfigService::buildPackets(std::string data, size_t packetSize) {
-  // calculate how many packets
-  size_t packetCount = data.length() / packetSize;
-  packetCount = data.length() % packetSize == 0 ? packetCount : packetCount + 1;
-
-  std::vector<std::string> packets;
-  // construct each packet
-  for (int i = 0; i < packetCount; i++) {
-    // start of packet
-    std::string packet = i == packetCount - 1 ? data.substr(i * packetSize) : data.substr(i * packetSize, packetSize);
-    // add to vector of packets
-    packets.push_back(packet);
-  }
-
-  return packets;
-}
-
-void ConfigService::transmit(std::string data) {
-  size_t chars = data.length();
+void ConfigService::transmit(const std::string &data) {
   auto m_properties = _configTxCharacteristic->m_properties;
   auto m_subscribedVec = _configTxCharacteristic->m_subscribedVec;
   bool is_notification = true;
@@ -162,6 +232,11 @@ void ConfigService::transmit(std::string data) {
 
   _configTxCharacteristic->m_pCallbacks->onNotify(_configTxCharacteristic);
 
+  // long responses are sent on transfer parameters, the request goes out
+  // while the first packets are queued
+  auto activity = data.length() > CONFIG_TX_BULK ? Activity_Transfer : Activity_Idle;
+  BluetoothLE::instance()->traffic(activity, 0);
+
   bool reqSec = (m_properties & BLE_GATT_CHR_F_READ_AUTHEN) ||
                 (m_properties & BLE_GATT_CHR_F_READ_AUTHOR) ||
                 (m_properties & BLE_GATT_CHR_F_READ_ENC);
@@ -169,7 +244,7 @@ void ConfigService::transmit(std::string data) {
 
   for (auto &it : m_subscribedVec) {
     uint16_t _mtu = _configTxCharacteristic->getService()->getServer()->getPeerMTU(it.first);
-    uint16_t packetSize = _mtu - 3;
+    uint16_t packetSize = _mtu - CONFIG_TX_ATT_OVERHEAD;
 
     // check if connected and subscribed
     if(_mtu == 0 || it.second == 0)
@@ -193,18 +268,55 @@ void ConfigService::transmit(std::string data) {
     configTransceiver.wait("config");
     configTransceiver.take("config");
 
-    // send packets
-    auto packets = buildPackets(data, packetSize);
-    for (auto packet : packets) {
-      notify(it.first, packet, is_notification);
-      delay(10);
+    // chunks are notified straight from the source buffer as fast as the host
+    // has buffers for them, a short wait when it runs out instead of a fixed
+    // delay per packet
+    auto started = esp_timer_get_time();
+    auto bytes = (const uint8_t*)data.data();
+    size_t sent = 0;
+
+    while (sent < data.length()) {
+      size_t length = std::min((size_t)packetSize, data.length() - sent);
+
+      auto deadline = esp_timer_get_time() + CONFIG_TX_TIMEOUT * 1000;
+      for (;;) {
+        while (os_msys_num_free() < CONFIG_TX_MBUF_RESERVE && esp_timer_get_time() < deadline)
+          vTaskDelay(1);
+
+        // the host consumes the mbuf either way, retry with a new one
+        rc = notify(it.first, &bytes[sent], length, is_notification);
+        if (rc != BLE_HS_ENOMEM || esp_timer_get_time() >= deadline)
+          break;
+
+        vTaskDelay(1);
+      }
+
+      if (rc != 0) {
+        ESP_LOGW(CONFIG_SERVICE_TAG, "Transmit failed at %d/%d bytes: %d", sent, data.length(), rc);
+        break;
+      }
+
+      sent += length;
     }
-    
+
     configTransceiver.give();
+    BluetoothLE::instance()->traffic(activity, sent);
+
+    int64_t elapsed = esp_timer_get_time() - started;
+    uint16_t throughput = elapsed > 0 ? (uint64_t)sent * 1000000 / 1024 / elapsed : 0;
+    ESP_LOGD(CONFIG_SERVICE_TAG, "Transmitted %d bytes in %d byte packets (%d KB/s)", sent, packetSize, throughput);
+
+    uint8_t result[7];
+    uint32_t total = sent;
+    result[0] = ConfigControl::TransmitEnd;
+    memcpy(&result[1], &total, sizeof(total));
+    memcpy(&result[5], &throughput, sizeof(throughput));
+    _configStatusCharacteristic->setValue(result, sizeof(result));
+    _configStatusCharacteristic->notify(true);
   }
 }
 
-void ConfigService::notify(uint16_t conn_id, std::string value, bool is_notification) {
+int ConfigService::notify(uint16_t conn_id, const uint8_t *data, size_t length, bool is_notification) {
   int rc = 0;
   auto m_properties = _configTxCharacteristic->m_properties;
   auto m_handle = _configTxCharacteristic->m_handle;
@@ -212,7 +324,9 @@ void ConfigService::notify(uint16_t conn_id, std::string value, bool is_notifica
   // don't create the m_buf until we are sure to send the data or else
   // we could be allocating a buffer that doesn't get released.
   // We also must create it in each loop iteration because it is consumed with each host call.
-  os_mbuf *om = ble_hs_mbuf_from_flat((uint8_t*)value.data(), value.length());
+  os_mbuf *om = ble_hs_mbuf_from_flat(data, length);
+  if (om == NULL)
+    return BLE_HS_ENOMEM;
 
   NimBLECharacteristicCallbacks::Status statusRC;
 
@@ -248,4 +362,5 @@ void ConfigService::notify(uint16_t conn_id, std::string value, bool is_notifica
   }
 
   _configTxCharacteristic->m_pCallbacks->onStatus(_configTxCharacteristic, statusRC, rc);
+  return rc;
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include <services/diagnostics-service.h>
+
+DiagnosticsService::DiagnosticsService(NimBLEServer *server) {
+  _server = server;
+
+  setupService();
+}
+
+void DiagnosticsService::setupService() {
+  auto service = _server->createService(diagnosticsServiceUUID);
+
+  _latencyCharacteristic = service->createCharacteristic(
+    NimBLEUUID::fromString(diagnosticsLatencyCharacteristicUUID),
+    NIMBLE_PROPERTY::READ |
+    NIMBLE_PROPERTY::READ_ENC |
+    NIMBLE_PROPERTY::WRITE |
+    NIMBLE_PROPERTY::WRITE_ENC);
+
+  _connectionCharacteristic = service->createCharacteristic(
+    NimBLEUUID::fromString(diagnosticsConnectionCharacteristicUUID),
+    NIMBLE_PROPERTY::READ |
+    NIMBLE_PROPERTY::READ_ENC);
+
+  _telemetryCharacteristic = service->createCharacteristic(
+    NimBLEUUID::fromString(diagnosticsTelemetryCharacteristicUUID),
+    NIMBLE_PROPERTY::READ |
+    NIMBLE_PROPERTY::READ_ENC);
+
+  _latencyCharacteristic->setCallbacks(this);
+  _connectionCharacteristic->setCallbacks(this);
+  _telemetryCharacteristic->setCallbacks(this);
+
+  service->start();
+}
+
+void DiagnosticsService::onRead(NimBLECharacteristic *characteristic) {
+  if (characteristic == _connectionCharacteristic) {
+    readConnection(characteristic);
+    return;
+  }
+
+  if (characteristic == _telemetryCharacteristic) {
+    readTelemetry(characteristic);
+    return;
+  }
+
+  auto telemetry = LatencyTelemetry::instance();
+  uint32_t payload[1 + Latency_StageCount * 3];
+
+  payload[0] = telemetry->getCount();
+  for (uint8_t stage = 0; stage < Latency_StageCount; stage++) {
+    auto stats = telemetry->getStats((LatencyStage)stage);
+    payload[1 + stage * 3] = stats.p50;
+    payload[2 + stage * 3] = stats.p99;
+    payload[3 + stage * 3] = stats.max;
+  }
+
+  characteristic->setValue((uint8_t*)payload, sizeof(payload));
+}
+
+void DiagnosticsService::readConnection(NimBLECharacteristic *characteristic) {
+  auto stats = BluetoothLE::instance()->getConnectionStats();
+  uint8_t payload[13];
+
+  payload[0] = stats.activity;
+  memcpy(&payload[1], &stats.interval, 2);
+  memcpy(&payload[3], &stats.latency, 2);
+  memcpy(&payload[5], &stats.timeout, 2);
+  memcpy(&payload[7], &stats.mtu, 2);
+  memcpy(&payload[9], &stats.throughput, 4);
+
+  characteristic->setValue(payload, sizeof(payload));
+}
+
+void DiagnosticsService::readTelemetry(NimBLECharacteristic *characteristic) {
+  auto scheduler = TelemetryScheduler::instance();
+  uint32_t payload[Telemetry_ChannelCount * 3 + 1];
+
+  for (uint8_t channel = 0; channel < Telemetry_ChannelCount; channel++) {
+    auto counters = scheduler->getCounters((TelemetryChannel)channel);
+    payload[channel * 3] = counters.sent;
+    payload[channel * 3 + 1] = counters.coalesced;
+    payload[channel * 3 + 2] = counters.dropped;
+  }
+  payload[Telemetry_ChannelCount * 3] = scheduler->getPackedCount();
+
+  characteristic->setValue((uint8_t*)payload, sizeof(payload));
+}
+
+void DiagnosticsService::onWrite(NimBLECharacteristic *characteristic) {
+  std::string value = characteristic->getValue();
+
+  if (value.length() >= 1 && value[0] == DIAGNOSTICS_RESET) {
+    ESP_LOGD(DIAGNOSTICS_SERVICE_TAG,"Resetting latency histogram");
+    LatencyTelemetry::instance()->reset();
+  }
+}
@@ -0,0 +1,148 @@
+#include <services/sensor-service.h>
+#include <algorithm>
+#include "os/os_mbuf.h"
+
+SensorService::SensorService(Motion *motion, NimBLEServer *server) {
+  _motion = motion;
+  _server = server;
+
+  // constructed on the app task, full batches wake it
+  _reader = xTaskGetCurrentTaskHandle();
+
+  setupService();
+}
+
+void SensorService::setupService() {
+  auto service = _server->createService(sensorServiceUUID);
+
+  _controlCharacteristic = service->createCharacteristic(
+    NimBLEUUID::fromString(sensorControlCharacteristicUUID),
+    NIMBLE_PROPERTY::READ |
+    NIMBLE_PROPERTY::READ_ENC |
+    NIMBLE_PROPERTY::WRITE |
+    NIMBLE_PROPERTY::WRITE_ENC);
+
+  _samplesCharacteristic = service->createCharacteristic(
+    NimBLEUUID::fromString(sensorSamplesCharacteristicUUID),
+    NIMBLE_PROPERTY::READ |
+    NIMBLE_PROPERTY::NOTIFY);
+
+  _controlCharacteristic->setCallbacks(this);
+
+  uint8_t rate = 0;
+  _controlCharacteristic->setValue(&rate, sizeof(rate));
+
+  service->start();
+}
+
+void SensorService::onWrite(NimBLECharacteristic *characteristic) {
+  std::string value = characteristic->getValue();
+  if (value.length() < 1)
+    return;
+
+  _requestedRate = value[0];
+  xTaskNotifyGive(_reader);
+}
+
+void SensorService::process() {
+  auto stream = _motion->getSensorStream();
+
+  if (_requestedRate != SENSOR_NO_REQUEST) {
+    uint8_t rate = _requestedRate;
+    _requestedRate = SENSOR_NO_REQUEST;
+    rate == 0 ? stop() : start(rate);
+  }
+
+  if (!stream->isActive())
+    return;
+
+  // nobody is listening anymore
+  ble_gap_conn_desc desc;
+  if (ble_gap_conn_find(_connection, &desc) != 0) {
+    ESP_LOGD(SENSOR_SERVICE_TAG,"Connection closed, stopping sensor stream");
+    stop();
+    return;
+  }
+
+  while (stream->available() >= _batch)
+    sendBatch();
+}
+
+void SensorService::start(uint8_t rate) {
+  uint16_t connection = BLE_HS_CONN_HANDLE_NONE;
+  for (auto& it : _samplesCharacteristic->m_subscribedVec)
+    if (it.second & 0x0001) {
+      connection = it.first;
+      break;
+    }
+
+  if (connection == BLE_HS_CONN_HANDLE_NONE) {
+    ESP_LOGW(SENSOR_SERVICE_TAG,"Subscribe to samples before starting the stream");
+    return;
+  }
+
+  // as many records as one notification holds, fewer at low rates so they
+  // don't wait long for a batch
+  uint16_t mtu = _server->getPeerMTU(connection);
+  uint16_t fit = mtu > SENSOR_ATT_OVERHEAD + SENSOR_HEADER ? (mtu - SENSOR_ATT_OVERHEAD - SENSOR_HEADER) / SENSOR_RECORD : 0;
+  fit = std::min(fit, (uint16_t)(SENSOR_STREAM_SAMPLES / 2));
+  if (fit == 0) {
+    ESP_LOGW(SENSOR_SERVICE_TAG,"MTU %d is too small for sensor samples", mtu);
+    return;
+  }
+
+  uint16_t batch = std::max(1, std::min((int)fit, rate / SENSOR_NOTIFY_RATE));
+  if (!_motion->getSensorStream()->start(rate, batch, _reader)) {
+    ESP_LOGW(SENSOR_SERVICE_TAG,"Unable to stream at %d Hz, %d Hz at most", rate, SENSOR_STREAM_MAX_RATE);
+    return;
+  }
+
+  _connection = connection;
+  _batch = batch;
+  _seq = 0;
+  _controlCharacteristic->setValue(&rate, sizeof(rate));
+  ESP_LOGD(SENSOR_SERVICE_TAG,"Streaming sensors at %d Hz, %d samples per notification", rate, batch);
+}
+
+void SensorService::stop() {
+  _motion->getSensorStream()->stop();
+  _connection = BLE_HS_CONN_HANDLE_NONE;
+
+  uint8_t rate = 0;
+  _controlCharacteristic->setValue(&rate, sizeof(rate));
+}
+
+void SensorService::sendBatch() {
+  auto stream = _motion->getSensorStream();
+  uint8_t payload[SENSOR_HEADER + SENSOR_STREAM_SAMPLES / 2 * SENSOR_RECORD];
+  size_t length = SENSOR_HEADER;
+  uint8_t count = 0;
+  uint32_t first = 0, previous = 0;
+  SensorSample sample;
+
+  while (count < _batch && stream->pop(sample)) {
+    uint16_t delta = count == 0 ? 0 : std::min((sample.time - previous) / 100, (uint32_t)UINT16_MAX);
+    if (count == 0)
+      first = sample.time;
+    previous = sample.time;
+
+    memcpy(&payload[length], &delta, sizeof(delta));
+    memcpy(&payload[length + 2], sample.values, sizeof(sample.values));
+    length += SENSOR_RECORD;
+    count++;
+  }
+
+  memcpy(&payload[0], &_seq, sizeof(_seq));
+  payload[2] = count;
+  memcpy(&payload[3], &first, sizeof(first));
+  _seq++;
+
+  // only the connection that started the stream gets the samples, notify()
+  // would send them to every subscriber
+  os_mbuf *om = ble_hs_mbuf_from_flat(payload, length);
+  int rc = om != NULL ? ble_gattc_notify_custom(_connection, _samplesCharacteristic->m_handle, om) : BLE_HS_ENOMEM;
+
+  // a dropped batch shows up as a gap in seq
+  if (rc != 0)
+    ESP_LOGV(SENSOR_SERVICE_TAG,"Dropped sensor batch %d: %d", _seq - 1, rc);
+}
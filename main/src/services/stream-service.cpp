@@ -0,0 +1,69 @@
+#include <services/stream-service.h>
+
+StreamService::StreamService(Lights *lights, NimBLEServer *server) {
+  _lights = lights;
+  _server = server;
+
+  setupService();
+}
+
+void StreamService::setupService() {
+  auto service = _server->createService(streamServiceUUID);
+
+  _controlCharacteristic = service->createCharacteristic(
+    NimBLEUUID::fromString(streamControlCharacteristicUUID),
+    NIMBLE_PROPERTY::WRITE |
+    NIMBLE_PROPERTY::WRITE_ENC);
+
+  _frameCharacteristic = service->createCharacteristic(
+    NimBLEUUID::fromString(streamFrameCharacteristicUUID),
+    NIMBLE_PROPERTY::WRITE |
+    NIMBLE_PROPERTY::WRITE_NR |
+    NIMBLE_PROPERTY::WRITE_ENC);
+
+  _statsCharacteristic = service->createCharacteristic(
+    NimBLEUUID::fromString(streamStatsCharacteristicUUID),
+    NIMBLE_PROPERTY::READ |
+    NIMBLE_PROPERTY::READ_ENC);
+
+  _controlCharacteristic->setCallbacks(this);
+  _frameCharacteristic->setCallbacks(this);
+  _statsCharacteristic->setCallbacks(this);
+
+  service->start();
+}
+
+void StreamService::onRead(NimBLECharacteristic *characteristic) {
+  auto stats = _lights->getStreamStats();
+  uint8_t payload[19];
+
+  payload[0] = _lights->isStreaming();
+  memcpy(&payload[1], &stats.shown, 4);
+  memcpy(&payload[5], &stats.dropped, 4);
+  memcpy(&payload[9], &stats.late, 4);
+  memcpy(&payload[13], &stats.fps, 2);
+  memcpy(&payload[15], &stats.latency, 2);
+  memcpy(&payload[17], &stats.latencyMax, 2);
+
+  characteristic->setValue(payload, sizeof(payload));
+}
+
+void StreamService::onWrite(NimBLECharacteristic *characteristic) {
+  std::string value = characteristic->getValue();
+  auto data = (const uint8_t*)value.data();
+
+  // frames are the hot path, hand them straight to the jitter buffer
+  if (characteristic == _frameCharacteristic) {
+    BluetoothLE::instance()->traffic(Activity_Streaming, value.length());
+    _lights->streamFrame(data, value.length());
+    return;
+  }
+
+  if (value.length() >= 4 && data[0] == StreamControl_Start) {
+    BluetoothLE::instance()->traffic(Activity_Streaming, 0);
+    if (!_lights->startStream(data[1], data[2], data[3]))
+      ESP_LOGW(STREAM_SERVICE_TAG,"Unable to stream to region %d at %d fps", data[1], data[2]);
+  }
+  else if (value.length() >= 1 && data[0] == StreamControl_Stop)
+    _lights->stopStream();
+}
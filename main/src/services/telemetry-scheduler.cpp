@@ -0,0 +1,155 @@
+#include <services/telemetry-scheduler.h>
+#include <string.h>
+#include <algorithm>
+
+void TelemetryScheduler::setReader(TaskHandle_t reader) {
+  _reader = reader;
+
+  if (_timer != NULL)
+    return;
+
+  esp_timer_create_args_t args = { };
+  args.callback = onTimer;
+  args.arg = this;
+  args.name = "telemetry";
+  esp_timer_create(&args, &_timer);
+}
+
+void TelemetryScheduler::onTimer(void *args) {
+  auto scheduler = (TelemetryScheduler*)args;
+  if (scheduler->_reader != NULL)
+    xTaskNotifyGive(scheduler->_reader);
+}
+
+void TelemetryScheduler::attach(TelemetryChannel channel, NimBLECharacteristic *characteristic, uint16_t interval) {
+  _channels[channel].characteristic = characteristic;
+  _channels[channel].interval = interval;
+}
+
+void TelemetryScheduler::update(TelemetryChannel channel, const uint8_t *value, uint8_t length) {
+  auto& entry = _channels[channel];
+  length = std::min(length, (uint8_t)TELEMETRY_MAX_VALUE);
+
+  if (entry.characteristic != NULL)
+    entry.characteristic->setValue(value, length);
+
+  // chatter that settles back on what the app already has never goes out
+  if (entry.sent && entry.length == length && memcmp(entry.sentValue, value, length) == 0) {
+    if (entry.pending) {
+      entry.pending = false;
+      entry.counters.dropped++;
+    }
+    return;
+  }
+
+  if (entry.pending) {
+    if (memcmp(entry.value, value, length) == 0)
+      return;
+
+    entry.counters.coalesced++;
+  }
+
+  memcpy(entry.value, value, length);
+  entry.length = length;
+  entry.pending = true;
+}
+
+void TelemetryScheduler::flush() {
+  auto now = millis();
+
+  // config and update transfers get the link, telemetry backs off
+  bool transfer = BluetoothLE::instance()->getActivity() == Activity_Transfer;
+  bool due = false;
+
+  for (auto& channel : _channels)
+    if (channel.pending && (!channel.sent || (long)(now - dueAt(channel, transfer)) >= 0))
+      due = true;
+
+  if (!due) {
+    arm(now, transfer);
+    return;
+  }
+
+  if (_packed != NULL && _packed->m_subscribedVec.size() > 0) {
+    // everything pending rides along with the channel that is due
+    uint8_t payload[1 + Telemetry_ChannelCount * TELEMETRY_MAX_VALUE];
+    size_t length = 1;
+    payload[0] = 0;
+
+    for (uint8_t i = 0; i < Telemetry_ChannelCount; i++) {
+      auto& channel = _channels[i];
+      if (!channel.pending)
+        continue;
+
+      payload[0] |= 1 << i;
+      memcpy(&payload[length], channel.value, channel.length);
+      length += channel.length;
+      markSent(channel, now);
+    }
+
+    _packed->setValue(payload, length);
+    _packed->notify();
+    _packedCount++;
+  }
+  else {
+    for (auto& channel : _channels) {
+      if (!channel.pending || (channel.sent && (long)(now - dueAt(channel, transfer)) < 0))
+        continue;
+
+      if (channel.characteristic != NULL)
+        channel.characteristic->notify();
+      markSent(channel, now);
+    }
+  }
+
+  arm(now, transfer);
+}
+
+void TelemetryScheduler::markSent(Channel &channel, unsigned long now) {
+  memcpy(channel.sentValue, channel.value, channel.length);
+  channel.sent = true;
+  channel.pending = false;
+  channel.sentAt = now;
+  channel.counters.sent++;
+}
+
+void TelemetryScheduler::arm(unsigned long now, bool transfer) {
+  if (_timer == NULL)
+    return;
+
+  unsigned long next = 0;
+  bool pending = false;
+
+  for (auto& channel : _channels) {
+    if (!channel.pending)
+      continue;
+
+    auto due = dueAt(channel, transfer);
+    if (!pending || (long)(due - next) < 0)
+      next = due;
+    pending = true;
+  }
+
+  esp_timer_stop(_timer);
+  if (pending)
+    esp_timer_start_once(_timer, (long)(next - now) > 0 ? (next - now) * 1000 : 1000);
+}
+
+bool TelemetryScheduler::isHolding() {
+  for (auto& channel : _channels)
+    if (channel.pending)
+      return true;
+
+  return false;
+}
+
+void TelemetryScheduler::log() {
+  static const char *names[Telemetry_ChannelCount] = { "state", "lights", "battery" };
+
+  for (uint8_t i = 0; i < Telemetry_ChannelCount; i++) {
+    auto& counters = _channels[i].counters;
+    ESP_LOGI(TELEMETRY_TAG,"%s: %d sent, %d coalesced, %d dropped", names[i], counters.sent, counters.coalesced, counters.dropped);
+  }
+
+  ESP_LOGI(TELEMETRY_TAG,"%d packed notifications", _packedCount);
+}
@@ -1,11 +1,11 @@
 #include "update-service.h"
+#include "esp32/rom/crc.h"
 
 UpdateService::UpdateService(Updater *updater, NimBLEServer *server) {
   _updater = updater;
   _server = server;  
 
   // listen to ota status updates
-  updateStatusQueue = xQueueCreate(5, sizeof(UpdateStatus));
   updater->addUpdateListener(this);
 
   setupService();
@@ -43,11 +43,10 @@ void UpdateService::setupService() {
 }
 
 void UpdateService::process() {
-  if (uxQueueMessagesWaiting(updateStatusQueue)) {
-    UpdateStatus status;
-    xQueueReceive(updateStatusQueue, &status, 0);
-    onUpdateStatusChanged(status);
-  }
+  Event event;
+  while (poll(event))
+    if (event.type == Event_UpdateStatus)
+      onUpdateStatusChanged(event.updateStatus);
 }
 
 void UpdateService::onWrite(NimBLECharacteristic* characteristic) {
@@ -57,33 +56,131 @@ void UpdateService::onWrite(NimBLECharacteristic* characteristic) {
   if (uuid.equals(_updateControlCharacteristic->getUUID())) {
     ESP_LOGD(UPDATE_SERVICE_TAG,"update control");
     const char* data = dataStr.data();
-    size_t len = sizeof(data);
+    size_t len = dataStr.length();
 
     if (len >= 1) {
       switch (data[0]) {
         case UpdateStatus::Start:
           ESP_LOGD(UPDATE_SERVICE_TAG,"Start update");
-          _updater->startUpdate();
+          BluetoothLE::instance()->traffic(Activity_Transfer, 0);
+          startTransfer((const uint8_t*)data, len);
           break;
         case UpdateStatus::End:
           ESP_LOGD(UPDATE_SERVICE_TAG,"End update");
+          _window.end();
           _updater->endUpdate();
           break;
+        case UpdateStatus::Ack:
+          if (_window.isActive()) {
+            _window.requestAck();
+            sendAck();
+          }
+          break;
         default: break;
       }
     }
   }
   if (uuid.equals(_updateRxCharacteristic->getUUID())) {
-    ESP_LOGD(UPDATE_SERVICE_TAG,"update data - length: %d", dataStr.length());
-    _updater->writeUpdate(dataStr);
+    ESP_LOGV(UPDATE_SERVICE_TAG,"update data - length: %d", dataStr.length());
+    BluetoothLE::instance()->traffic(Activity_Transfer, dataStr.length());
+    if (_window.isActive())
+      receivePacket((const uint8_t*)dataStr.data(), dataStr.length());
+    else
+      _updater->writeUpdate((const uint8_t*)dataStr.data(), dataStr.length());
+  }
+}
+
+void UpdateService::startTransfer(const uint8_t *data, size_t length) {
+  if (length < UPDATE_START_SIZE) {
+    _window.end();
+    _updater->startUpdate();
+    return;
+  }
+
+  uint32_t size, crc;
+  uint16_t blockSize;
+  memcpy(&size, &data[1], sizeof(size));
+  memcpy(&crc, &data[5], sizeof(crc));
+  memcpy(&blockSize, &data[9], sizeof(blockSize));
+
+  auto offset = _updater->startUpdate(size, crc);
+  auto status = _updater->getStatus();
+  if (status == UpdateStatus::ErrorStart || status == UpdateStatus::ErrorWrite) {
+    // the error status has gone out, there is nothing to acknowledge
+    ESP_LOGE(UPDATE_SERVICE_TAG,"Update did not start, rejecting the transfer");
+    _window.end();
+    return;
+  }
+
+  if (!_window.begin(blockSize, offset)) {
+    ESP_LOGE(UPDATE_SERVICE_TAG,"Unable to receive %d byte blocks", blockSize);
+    _updater->endUpdate();
+    return;
   }
+
+  // tells the sender where to start
+  _window.requestAck();
+  sendAck();
+}
+
+void UpdateService::receivePacket(const uint8_t *data, size_t length) {
+  if (length <= UPDATE_PACKET_HEADER)
+    return;
+
+  uint32_t offset, crc;
+  memcpy(&offset, &data[0], sizeof(offset));
+  memcpy(&crc, &data[4], sizeof(crc));
+
+  auto payload = &data[UPDATE_PACKET_HEADER];
+  auto payloadLength = length - UPDATE_PACKET_HEADER;
+
+  // a corrupt packet is dropped and shows up as a gap in the next ack
+  if (crc32_le(0, payload, payloadLength) != crc)
+    ESP_LOGW(UPDATE_SERVICE_TAG,"Dropped packet at %d: crc mismatch", offset);
+  else if (_window.receive(offset, payload, payloadLength) == Window_Accepted) {
+    const uint8_t *block;
+    size_t blockLength;
+    while ((block = _window.next(&blockLength)) != NULL)
+      _updater->writeUpdate(block, blockLength);
+  }
+
+  if (_window.isAckDue())
+    sendAck();
+}
+
+void UpdateService::sendAck() {
+  uint32_t offset, received;
+  _window.ack(&offset, &received);
+
+  uint8_t payload[UPDATE_ACK_SIZE];
+  payload[0] = UpdateStatus::Ack;
+  memcpy(&payload[1], &offset, sizeof(offset));
+  memcpy(&payload[5], &received, sizeof(received));
+
+  notifyStatus(payload, sizeof(payload));
+}
+
+void UpdateService::notifyStatus(const uint8_t *payload, size_t length) {
+  _statusNotify.take(UPDATE_SERVICE_TAG);
+  _updateStatusCharacteristic->setValue(payload, length);
+  _updateStatusCharacteristic->notify();
+  _statusNotify.give();
 }
 
 void UpdateService::onUpdateStatusChanged(UpdateStatus status) {
-  if (_updateStatus != status) {
-    _updateStatusCharacteristic->setValue<UpdateStatus>(status);
-    _updateStatusCharacteristic->notify();
+  // progress updates are already throttled by the updater, repeat them
+  if (_updateStatus != status || status == UpdateStatus::Write) {
+    // status, bytes written to flash (uint32) and throughput in KB/s (uint16)
+    uint8_t payload[7];
+    uint32_t written = _updater->getBytesWritten();
+    uint16_t throughput = _updater->getThroughput();
+
+    payload[0] = status;
+    memcpy(&payload[1], &written, sizeof(written));
+    memcpy(&payload[5], &throughput, sizeof(throughput));
+
+    notifyStatus(payload, sizeof(payload));
 
     _updateStatus = status;
   }
-}
\ No newline at end of file
+}
@@ -6,9 +6,8 @@ VehicleService::VehicleService(Motion *motion, Power *power, NimBLEServer *serve
   _power = power;
   _renderHost = host;
   
-  calibrateXGQueue = xQueueCreate(2, sizeof(CalibrationState));
-  calibrateMagQueue = xQueueCreate(2, sizeof(CalibrationState));
-  lightsChangedQueue = xQueueCreate(4, sizeof(LightCommands));
+  // listen to calibration progress
+  _motion->addCalibrationListener(this);
 
   setupService();
 }
@@ -69,6 +68,17 @@ void VehicleService::setupService() {
   
   _restartCharacteristic->setCallbacks(this);
 
+  // state, lights and battery changes packed into one notification
+  _telemetryCharacteristic = service->createCharacteristic(
+    NimBLEUUID::fromString(vehicleTelemetryCharacteristicUUID),
+    NIMBLE_PROPERTY::READ |
+    NIMBLE_PROPERTY::NOTIFY);
+
+  auto telemetry = TelemetryScheduler::instance();
+  telemetry->attach(Telemetry_VehicleState, _stateCharacteristic, TELEMETRY_STATE_INTERVAL);
+  telemetry->attach(Telemetry_Lights, _lightCharacteristic, TELEMETRY_LIGHTS_INTERVAL);
+  telemetry->attachPacked(_telemetryCharacteristic);
+
   service->start();
 }
 
@@ -150,42 +160,43 @@ void VehicleService::onWrite(NimBLECharacteristic *characteristic) {
   else if (uuid.equals(_calibrationCharacteristic->getUUID())) {
     ESP_LOGD(VEHICLE_SERVICE_TAG,"vehicle calibration onwrite");
     if (len >= 1) {
-      xQueueSendToBack(_motion->calibrationRequestQueue, &data[0], 0);
+      Event event;
+      event.type = Event_CalibrationRequest;
+      event.calibrationRequest = data[0];
+      EventBus::instance()->publish(event);
     }
   }
 }
 
 void VehicleService::onVehicleStateChanged(VehicleState state) {
   // ESP_LOGD(VEHICLE_SERVICE_TAG,"broadcast vehicle state changed");
-  uint8_t value[3];
+  uint8_t value[4];
   value[0] = state.acceleration;
   value[1] = state.turn;
   value[2] = state.orientation;
-  
-  _stateCharacteristic->setValue((uint8_t*)value, sizeof(state));
-  _stateCharacteristic->notify();
+  value[3] = state.orientationConfidence;
+
+  // chattering detectors are coalesced and rate limited
+  TelemetryScheduler::instance()->update(Telemetry_VehicleState, value, sizeof(value));
 }
 
 void VehicleService::process() {
-  if (uxQueueMessagesWaiting(calibrateXGQueue)) {
-    CalibrationState state;
-    xQueueReceive(calibrateXGQueue, &state, 0);
-
-    state == CalibrationState::Started ? onCalibrateXGStarted() : onCalibrateXGEnded();
-  }
-  
-  if (uxQueueMessagesWaiting(calibrateMagQueue)) {
-    CalibrationState state;
-    xQueueReceive(calibrateMagQueue, &state, 0);
-
-    state == CalibrationState::Started ? onCalibrateMagStarted() : onCalibrateMagEnded();
-  }
-
-  if (uxQueueMessagesWaiting(lightsChangedQueue)) {
-    LightCommands commands;
-    xQueueReceive(lightsChangedQueue, &commands, 0);
-
-    onLightsChanged(commands);
+  Event event;
+
+  while (poll(event)) {
+    switch (event.type) {
+      case Event_CalibrateXG:
+        event.calibration == CalibrationState::Started ? onCalibrateXGStarted() : onCalibrateXGEnded();
+        break;
+      case Event_CalibrateMag:
+        event.calibration == CalibrationState::Started ? onCalibrateMagStarted() : onCalibrateMagEnded();
+        break;
+      case Event_LightsChanged:
+        onLightsChanged(event.lights);
+        break;
+      default:
+        break;
+    }
   }
 }
 
@@ -196,8 +207,7 @@ void VehicleService::onLightsChanged(LightCommands commands) {
   payload[2] = commands.turnCommand;
   payload[3] = commands.orientationCommand;
 
-  _lightCharacteristic->setValue(&payload[0], sizeof(payload));
-  _lightCharacteristic->notify(true);
+  TelemetryScheduler::instance()->update(Telemetry_Lights, payload, sizeof(payload));
 }
 
 void VehicleService::onCalibrateXGStarted() {
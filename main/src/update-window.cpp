@@ -0,0 +1,102 @@
+#include <update-window.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool UpdateWindow::begin(uint16_t blockSize, uint32_t offset) {
+  if (blockSize == 0 || blockSize > UPDATE_MAX_BLOCK)
+    return false;
+
+  if (_blocks == NULL || blockSize > _blockSize) {
+    free(_blocks);
+    _blocks = (uint8_t*)malloc(UPDATE_WINDOW_BLOCKS * blockSize);
+    if (_blocks == NULL)
+      return false;
+  }
+
+  _blockSize = blockSize;
+  _start = offset;
+  _base = 0;
+  _received = 0;
+  _slot = 0;
+  _direct = NULL;
+  _sinceAck = 0;
+  _gap = false;
+  _ackDue = false;
+  return true;
+}
+
+void UpdateWindow::end() {
+  free(_blocks);
+  _blocks = NULL;
+  _direct = NULL;
+}
+
+WindowResult UpdateWindow::receive(uint32_t offset, const uint8_t *data, size_t length) {
+  if (_blocks == NULL || offset < _start || (offset - _start) % _blockSize != 0 || length == 0 || length > _blockSize)
+    return Window_Rejected;
+
+  uint32_t block = (offset - _start) / _blockSize;
+  if (block < _base || (block < _base + UPDATE_WINDOW_BLOCKS && (_received & (1u << (block - _base))))) {
+    _ackDue = true;
+    return Window_Duplicate;
+  }
+
+  if (block >= _base + UPDATE_WINDOW_BLOCKS)
+    return Window_Rejected;
+
+  uint8_t index = block - _base;
+
+  if (index == 0 && _direct == NULL) {
+    _direct = data;
+    _directLength = length;
+  }
+  else {
+    // report a gap once, the ack after it repeats it if still open
+    if (index > 0 && !_gap) {
+      _gap = true;
+      _ackDue = true;
+    }
+
+    uint8_t slot = (_slot + index) % UPDATE_WINDOW_BLOCKS;
+    memcpy(&_blocks[slot * _blockSize], data, length);
+    _lengths[slot] = length;
+  }
+
+  _received |= 1u << index;
+  return Window_Accepted;
+}
+
+const uint8_t* UpdateWindow::next(size_t *length) {
+  if (!(_received & 1))
+    return NULL;
+
+  const uint8_t *data;
+  if (_direct != NULL) {
+    data = _direct;
+    *length = _directLength;
+    _direct = NULL;
+  }
+  else {
+    data = &_blocks[_slot * _blockSize];
+    *length = _lengths[_slot];
+  }
+
+  // slide the window, the returned block stays valid until the next receive
+  _received >>= 1;
+  _base++;
+  _slot = (_slot + 1) % UPDATE_WINDOW_BLOCKS;
+  _gap = false;
+
+  if (++_sinceAck >= UPDATE_WINDOW_BLOCKS / 2)
+    _ackDue = true;
+
+  return data;
+}
+
+void UpdateWindow::ack(uint32_t *offset, uint32_t *received) {
+  *offset = getOffset();
+  *received = _received;
+
+  _sinceAck = 0;
+  _ackDue = false;
+}
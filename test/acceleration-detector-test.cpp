@@ -0,0 +1,114 @@
+#include "test.h"
+#include <filters/acceleration-detector.h>
+
+#define DT (MOTION_SAMPLE_PERIOD / 1000.0f)
+
+// replays a trace at the sampler's period, returns the time Braking was
+// first reported or -1
+struct Replay {
+  AccelerationDetector detector;
+  unsigned long now = 0;
+
+  Replay(float jerk = 4.0f, uint32_t dwell = 60, uint32_t latency = 100) {
+    detector.configure(0.2f, 0.2f, jerk, dwell, latency);
+    detector.reset(Neutral, 0);
+  }
+
+  AccelerationState step(float acceleration) {
+    auto state = detector.update(acceleration, now, DT);
+    now += MOTION_SAMPLE_PERIOD;
+    return state;
+  }
+
+  long until(AccelerationState wanted, float (*trace)(int), int samples) {
+    for (int i = 0; i < samples; i++) {
+      unsigned long at = now;
+      if (step(trace(i)) == wanted)
+        return at;
+    }
+    return -1;
+  }
+};
+
+TEST(rampIsReportedAfterTheDwell) {
+  Replay replay;
+  // 0.5 g/s, crosses 0.2 g at 400 ms
+  long detected = replay.until(Braking, [](int i) { return i * 0.005f + 0.0025f; }, 200);
+  CHECK(detected == 400 + 60);
+}
+
+TEST(latencyBudgetClampsTheDwell) {
+  Replay replay(0.0f, 300, 100);
+  long detected = replay.until(Braking, [](int i) { return 0.3f; }, 100);
+
+  // one sample of the budget is spent seeing the brake
+  CHECK(detected == 100 - MOTION_SAMPLE_PERIOD);
+}
+
+TEST(hardBrakeSkipsTheDwell) {
+  Replay replay;
+  // 10 g/s from 100 ms, reaches the threshold at 110 ms
+  long detected = replay.until(Braking, [](int i) { return i < 10 ? 0.0f : (i - 9) * 0.1f; }, 100);
+  CHECK(detected == 110);
+}
+
+// the LIS3DH runs at 50 Hz, so the sampler reads every value twice
+TEST(hardBrakeSkipsTheDwellOnRepeatedSamples) {
+  Replay replay;
+  long detected = replay.until(Braking, [](int i) { return i < 10 ? 0.0f : ((i - 10) / 2 + 1) * 0.2f; }, 100);
+  CHECK(detected == 110);
+}
+
+TEST(jerkAloneIsNotABrake) {
+  Replay replay;
+  // the same jerk topping out below the brake threshold
+  long detected = replay.until(Braking, [](int i) { return i < 10 ? 0.0f : fminf((i - 9) * 0.05f, 0.15f); }, 100);
+  CHECK(detected == -1);
+}
+
+TEST(singleSpikeIsIgnored) {
+  Replay replay;
+  long detected = replay.until(Braking, [](int i) { return i == 20 ? 0.5f : 0.0f; }, 100);
+  CHECK(detected == -1);
+}
+
+TEST(chatterDoesntFlip) {
+  Replay replay;
+  int flips = 0;
+  AccelerationState previous = Neutral;
+
+  // straddles the enter threshold without ever holding it for the dwell
+  for (int i = 0; i < 400; i++) {
+    auto state = replay.step(i % 2 ? 0.21f : 0.15f);
+    flips += state != previous;
+    previous = state;
+  }
+
+  CHECK(flips == 0);
+}
+
+TEST(brakesHoldForASecond) {
+  Replay replay(0.0f, 0, 0);
+  CHECK(replay.step(0.3f) == Braking);
+
+  unsigned long braked = replay.now - MOTION_SAMPLE_PERIOD;
+  long released = replay.until(Neutral, [](int i) { return 0.0f; }, 200);
+  CHECK(released == (long)(braked + BRAKE_HOLD));
+}
+
+TEST(hysteresisHoldsBrakesUntilHalfTheThreshold) {
+  Replay replay(0.0f, 0, 0);
+  replay.step(0.3f);
+
+  long released = replay.until(Neutral, [](int i) { return i < 150 ? 0.11f : 0.09f; }, 300);
+  CHECK(released == 150 * MOTION_SAMPLE_PERIOD + MOTION_SAMPLE_PERIOD);
+}
+
+TEST(accelerationEntersAndExits) {
+  Replay replay(0.0f, 60, 0);
+  long accelerating = replay.until(Accelerating, [](int i) { return -0.3f; }, 100);
+  CHECK(accelerating == 60);
+
+  long neutral = replay.until(Neutral, [](int i) { return 0.0f; }, 100);
+  CHECK(neutral == 70 + 60);
+}
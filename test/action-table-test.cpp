@@ -0,0 +1,111 @@
+#include "test.h"
+#include <common.h>
+#include <models/config.h>
+
+// Applying an action used to copy the whole actions map, look the action up
+// by name and copy every effect on the way to Lights::applyEffect. It is now
+// an index into AmpConfig::actionTable. This compares the two resolutions
+// on the host. The time from the event to the LEDs needs the board, define
+// LOG_ACTION_LATENCY in app.h to log it there.
+
+#define EFFECTS_PER_ACTION 4
+
+static std::map<Actions, std::string> motionActions = {
+  std::make_pair(Actions::LightsOff, "motion-off"),
+  std::make_pair(Actions::LightsMotionNeutral, "motion-neutral"),
+  std::make_pair(Actions::LightsMotionBrakes, "motion-brakes"),
+  std::make_pair(Actions::LightsMotionAcceleration, "motion-acceleration")
+};
+
+// the rest of a typical profile, only there to fill the map
+static const char *otherActions[] = {
+  "headlight-off", "headlight-normal", "headlight-bright",
+  "turn-center", "turn-left", "turn-right", "turn-hazard",
+  "orientation-top", "orientation-bottom"
+};
+
+static uint32_t applied = 0;
+
+// stands in for Lights::applyEffect
+__attribute__((noinline)) static void applyEffect(const LightingParameters &effect) {
+  applied += effect.effect + effect.region.length();
+}
+
+struct Configured {
+  AmpConfig config;
+
+  static std::vector<LightingParameters>* effects() {
+    auto effects = new std::vector<LightingParameters>();
+    for (int i = 0; i < EFFECTS_PER_ACTION; i++) {
+      LightingParameters effect = {};
+      effect.region = "region-name-" + std::to_string(i);
+      effect.effect = Blink;
+      effect.duration = 100;
+      effects->push_back(effect);
+    }
+    return effects;
+  }
+
+  Configured() {
+    for (auto &action : motionActions)
+      config.actions[action.second] = effects();
+    for (auto name : otherActions)
+      config.actions[name] = effects();
+
+    // what Config::buildActionTable does for the msgpack config
+    for (auto &action : motionActions)
+      config.actionTable[Group_Motion][action.first] = *config.actions[action.second];
+  }
+
+  ~Configured() {
+    for (auto &action : config.actions)
+      delete action.second;
+  }
+
+  // before, App::setMotion and App::applyAction
+  void applyByName(Actions command) {
+    std::string actionName = motionActions[command];
+
+    auto actions = config.actions;
+    if (actions.find(actionName) != actions.end())
+      for (auto effect : *actions[actionName])
+        applyEffect(effect);
+  }
+
+  // now
+  void applyByIndex(ActionGroup group, Actions command) {
+    for (auto &effect : config.actionTable[group][command])
+      applyEffect(effect);
+  }
+};
+
+TEST(bothResolveTheSameEffects) {
+  Configured configured;
+  for (auto &action : motionActions) {
+    applied = 0;
+    configured.applyByName(action.first);
+    uint32_t byName = applied;
+
+    applied = 0;
+    configured.applyByIndex(Group_Motion, action.first);
+    CHECK(applied == byName);
+    CHECK(applied != 0);
+  }
+
+  // an action without effects does nothing either way
+  applied = 0;
+  configured.applyByName(LightsTurnLeft);
+  configured.applyByIndex(Group_Motion, LightsTurnLeft);
+  CHECK(applied == 0);
+}
+
+TEST(resolutionCost) {
+  Configured configured;
+  const int iterations = 200000;
+
+  double byName = nanosPer(iterations, [&](int i) { configured.applyByName(LightsMotionBrakes); });
+  double byIndex = nanosPer(iterations, [&](int i) { configured.applyByIndex(Group_Motion, LightsMotionBrakes); });
+
+  printf("%zu actions, %d effects each: by name %.1f ns, by index %.1f ns\n",
+    configured.config.actions.size(), EFFECTS_PER_ACTION, byName, byIndex);
+}
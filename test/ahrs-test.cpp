@@ -0,0 +1,68 @@
+#include "test.h"
+#include <filters/ahrs.h>
+
+#define DT 0.02f
+#define RADIANS(degrees) ((degrees) * (float)M_PI / 180.0f)
+
+static const AhrsFilterType filters[] = { AHRS_Madgwick, AHRS_Mahony };
+
+// gravity seen by the board for a roll, rotating about x
+static Vector3D rolled(float degrees) {
+  return Vector3D(0, sinf(RADIANS(degrees)), cosf(RADIANS(degrees)));
+}
+
+TEST(convergesToStaticRoll) {
+  for (auto type : filters) {
+    Ahrs ahrs;
+    ahrs.setFilter(type);
+
+    for (int i = 0; i < 2000; i++)
+      ahrs.update(rolled(30), Vector3D(), Vector3D(), DT, false);
+
+    auto attitude = ahrs.getAHRS();
+    CHECK_NEAR(attitude.x, 30.0, 0.5);
+    CHECK_NEAR(attitude.y, 0.0, 0.5);
+  }
+}
+
+TEST(integratesYawRate) {
+  for (auto type : filters) {
+    Ahrs ahrs;
+    ahrs.setFilter(type);
+
+    // 20 deg/s about z for 2 s with gravity along z
+    for (int i = 0; i < 100; i++)
+      ahrs.update(Vector3D(0, 0, 1), Vector3D(0, 0, RADIANS(20)), Vector3D(), DT, false);
+
+    CHECK_NEAR(ahrs.getAHRS().z, 40.0, 0.5);
+  }
+}
+
+TEST(followsMagneticHeading) {
+  for (auto type : filters) {
+    Ahrs ahrs;
+    ahrs.setFilter(type);
+
+    // level board with the field 0.5 rad off north and some dip
+    Vector3D mag(cosf(0.5f), -sinf(0.5f), 0.3f);
+    for (int i = 0; i < 3000; i++)
+      ahrs.update(Vector3D(0, 0, 1), Vector3D(), mag, DT, true);
+
+    CHECK_NEAR(ahrs.getAHRS().z, 0.5 * 180.0 / M_PI, 0.5);
+  }
+}
+
+// a switched in filter starts level instead of from whatever it held before
+TEST(switchingResetsTheFilter) {
+  Ahrs ahrs;
+  ahrs.setFilter(AHRS_Mahony);
+  for (int i = 0; i < 500; i++)
+    ahrs.update(rolled(30), Vector3D(), Vector3D(), DT, false);
+
+  ahrs.setFilter(AHRS_Madgwick);
+  ahrs.setFilter(AHRS_Mahony);
+  CHECK(ahrs.getFilter() == AHRS_Mahony);
+
+  auto q = ahrs.getQuaternion();
+  CHECK(q.w == 1.0f && q.x == 0.0f && q.y == 0.0f && q.z == 0.0f);
+}
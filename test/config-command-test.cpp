@@ -0,0 +1,157 @@
+#include "test.h"
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <config-command.h>
+
+// motion brakes on region 2, blink on layer 1, red then green, 200 ms
+static const uint8_t effect[] = {
+  Command_Effect, 14,
+  0, 4, 2,
+  3, 1, COMMAND_COLOR_RAINBOW << 2,
+  0xff, 0, 0,
+  0, 0xff, 0,
+  0xc8, 0x01
+};
+
+TEST(decodesAnEffect) {
+  CommandReader reader(effect, sizeof(effect));
+  CommandOp op;
+  EffectCommand command;
+
+  CHECK(reader.next(&op, &command));
+  CHECK(op == Command_Effect);
+  CHECK(command.group == 0);
+  CHECK(command.action == 4);
+  CHECK(command.region == 2);
+  CHECK(command.effect == 3);
+  CHECK(command.layer == 1);
+  CHECK(command.colorFlags == COMMAND_COLOR_RAINBOW << 2);
+  CHECK(command.first[0] == 0xff && command.first[1] == 0 && command.first[2] == 0);
+  CHECK(command.second[0] == 0 && command.second[1] == 0xff && command.second[2] == 0);
+  CHECK(command.duration == 200);
+
+  CHECK(!reader.next(&op, &command));
+}
+
+TEST(decodesSeveralCommandsPerWrite) {
+  std::vector<uint8_t> data(effect, effect + sizeof(effect));
+  data[0] = Command_SaveEffect;
+  // remove with a byte it doesn't know yet, then an unknown op
+  const uint8_t more[] = { Command_RemoveEffect, 4, 1, 2, 3, 99, 0xf0, 1, 0 };
+  data.insert(data.end(), more, more + sizeof(more));
+
+  CommandReader reader(data.data(), data.size());
+  CommandOp op;
+  EffectCommand command;
+
+  CHECK(reader.next(&op, &command));
+  CHECK(op == Command_SaveEffect);
+  CHECK(command.duration == 200);
+
+  CHECK(reader.next(&op, &command));
+  CHECK(op == Command_RemoveEffect);
+  CHECK(command.group == 1 && command.action == 2 && command.region == 3);
+  CHECK(command.duration == 0);
+
+  CHECK(reader.next(&op, &command));
+  CHECK(op == 0xf0);
+
+  CHECK(!reader.next(&op, &command));
+}
+
+TEST(durationIsAVarint) {
+  std::vector<uint8_t> data(effect, effect + sizeof(effect) - 2);
+  for (uint32_t duration : { 0u, 127u, 128u, 16384u, 0xffffffffu }) {
+    std::vector<uint8_t> command = data;
+    uint32_t value = duration;
+    do {
+      command.push_back((value & 0x7f) | (value > 0x7f ? 0x80 : 0));
+      value >>= 7;
+    } while (value > 0);
+    command[1] = command.size() - COMMAND_HEADER;
+
+    CommandReader reader(command.data(), command.size());
+    CommandOp op;
+    EffectCommand decoded;
+    CHECK(reader.next(&op, &decoded));
+    CHECK(decoded.duration == duration);
+  }
+}
+
+TEST(rejectsMalformedCommands) {
+  CommandOp op;
+  EffectCommand command;
+
+  // truncated anywhere
+  for (size_t length = 0; length < sizeof(effect); length++) {
+    CommandReader reader(effect, length);
+    CHECK(!reader.next(&op, &command));
+  }
+
+  // too short for an effect, with a length that says so
+  std::vector<uint8_t> shortEffect(effect, effect + COMMAND_HEADER + COMMAND_EFFECT_MIN - 1);
+  shortEffect[1] = COMMAND_EFFECT_MIN - 1;
+  CommandReader shortReader(shortEffect.data(), shortEffect.size());
+  CHECK(!shortReader.next(&op, &command));
+
+  // a duration that doesn't end
+  std::vector<uint8_t> endless(effect, effect + sizeof(effect));
+  endless[sizeof(effect) - 1] = 0x81;
+  CommandReader endlessReader(endless.data(), endless.size());
+  CHECK(!endlessReader.next(&op, &command));
+
+  const uint8_t shortRemove[] = { Command_RemoveEffect, 2, 1, 2 };
+  CommandReader removeReader(shortRemove, sizeof(shortRemove));
+  CHECK(!removeReader.next(&op, &command));
+}
+
+TEST(tellsBinaryFromText) {
+  const char *text = "effect:motion-brakes,rear,3,#FF0000,#00FF00,200,1";
+  CHECK(!CommandReader::isBinary((const uint8_t*)text, strlen(text)));
+  CHECK(CommandReader::isBinary(effect, sizeof(effect)));
+  CHECK(!CommandReader::isBinary(effect, 1));
+}
+
+static std::vector<std::string> split(const std::string &value, char delimiter) {
+  std::vector<std::string> parts;
+  std::stringstream stream(value);
+  std::string part;
+  while (std::getline(stream, part, delimiter))
+    parts.push_back(part);
+  return parts;
+}
+
+static volatile uint32_t sink;
+
+TEST(decodeCost) {
+  const int iterations = 200000;
+  std::string text = "effect:motion-brakes,rear,3,#FF0000,#00FF00,200,1";
+
+  // the steps the text command takes before it has the same values
+  double byText = nanosPer(iterations, [&](int i) {
+    std::string data = text;
+    auto colon = data.find_first_of(":");
+    std::string value = data.substr(colon + 1);
+    auto comma = value.find_first_of(",");
+    std::string action = value.substr(0, comma);
+    std::string rest = value.substr(comma + 1);
+    comma = rest.find_first_of(",");
+    std::string region = rest.substr(0, comma);
+    auto parts = split(rest.substr(comma + 1), ',');
+    sink = atoi(parts[0].c_str()) + strtol(parts[1].c_str() + 1, NULL, 16) + atoll(parts[3].c_str())
+      + action.length() + region.length();
+  });
+
+  double byBinary = nanosPer(iterations, [&](int i) {
+    CommandReader reader(effect, sizeof(effect));
+    CommandOp op;
+    EffectCommand command;
+    reader.next(&op, &command);
+    sink = command.duration + command.effect;
+  });
+
+  printf("effect command: text %.0f ns, binary %.0f ns\n", byText, byBinary);
+}
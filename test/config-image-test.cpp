@@ -0,0 +1,151 @@
+#include "test.h"
+#include <vector>
+#include <hal/config-image.h>
+#include "esp32/rom/crc.h"
+
+#define PARTITION_SIZE  (16 * 1024)
+
+// The config partition in host memory, map() validates whatever is in it
+static esp_partition_t partition = { ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)CONFIG_IMAGE_SUBTYPE, 0x3F0000, PARTITION_SIZE, "config", false };
+static std::vector<uint8_t> flash(PARTITION_SIZE, 0xff);
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label) {
+  return &partition;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+  spi_flash_mmap_memory_t memory, const void **out_ptr, spi_flash_mmap_handle_t *out_handle) {
+  *out_ptr = flash.data() + offset;
+  *out_handle = 1;
+  return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle) { }
+
+// An image laid out the way compile_config.py lays it out: one channel, one
+// region with one section, every action empty except motion-brakes.
+static std::vector<uint8_t> image() {
+  uint32_t actions = Group_Count * ACTION_COUNT;
+  ConfigImageHeader header = { };
+  header.magic = CONFIG_IMAGE_MAGIC;
+  header.version = CONFIG_IMAGE_VERSION;
+  header.headerSize = sizeof(ConfigImageHeader);
+  header.channelCount = 1;
+  header.regionCount = 1;
+  header.sectionCount = 1;
+  header.effectCount = 1;
+  header.motionOffset = sizeof(ConfigImageHeader);
+  header.channelsOffset = header.motionOffset + sizeof(ConfigImageMotion);
+  header.regionsOffset = header.channelsOffset + sizeof(ConfigImageChannel);
+  header.sectionsOffset = header.regionsOffset + sizeof(ConfigImageRegion);
+  header.actionsOffset = header.sectionsOffset + sizeof(ConfigImageSection);
+  header.effectsOffset = header.actionsOffset + actions * sizeof(ConfigImageAction);
+  header.stringsOffset = header.effectsOffset + sizeof(ConfigImageEffect);
+  header.size = header.stringsOffset + 8;
+
+  std::vector<uint8_t> data(header.size, 0);
+  auto channel = (ConfigImageChannel*)&data[header.channelsOffset];
+  *channel = { 0, 0, 60 };
+  auto region = (ConfigImageRegion*)&data[header.regionsOffset];
+  *region = { 0, 0, 1, 60 };
+  auto section = (ConfigImageSection*)&data[header.sectionsOffset];
+  *section = { 0, 0, 0, 59, 0 };
+  auto action = (ConfigImageAction*)&data[header.actionsOffset] + Group_Motion * ACTION_COUNT + Actions::LightsMotionBrakes;
+  *action = { 0, 1 };
+  auto effect = (ConfigImageEffect*)&data[header.effectsOffset];
+  effect->duration = 500;
+  strcpy((char*)&data[header.stringsOffset], "tail");
+
+  memcpy(data.data(), &header, sizeof(header));
+  return data;
+}
+
+static ConfigImageHeader* header(std::vector<uint8_t> &data) { return (ConfigImageHeader*)data.data(); }
+
+// flashes the image with a fresh crc, so only the bounds checks can reject it
+static void flashImage(std::vector<uint8_t> data) {
+  auto h = header(data);
+  h->crc = crc32_le(0, data.data() + sizeof(ConfigImageHeader), h->size - sizeof(ConfigImageHeader));
+  std::fill(flash.begin(), flash.end(), 0xff);
+  std::copy(data.begin(), data.end(), flash.begin());
+}
+
+static bool maps() {
+  ConfigImage config;
+  bool mapped = config.map();
+  config.unmap();
+  return mapped;
+}
+
+TEST(mapsAValidImage) {
+  flashImage(image());
+
+  ConfigImage config;
+  CHECK(config.map());
+  CHECK(config.regionCount() == 1);
+  CHECK(strcmp(config.regionName(config.regions()), "tail") == 0);
+
+  uint16_t count;
+  auto effects = config.actionEffects(Group_Motion, Actions::LightsMotionBrakes, &count);
+  CHECK(count == 1);
+  CHECK(effects != NULL && effects->duration == 500);
+  CHECK(config.actionEffects(Group_Turn, Actions::LightsTurnLeft, &count) == NULL && count == 0);
+  config.unmap();
+}
+
+TEST(rejectsErasedFlash) {
+  std::fill(flash.begin(), flash.end(), 0xff);
+  CHECK(!maps());
+}
+
+TEST(rejectsTablesPastTheEnd) {
+  auto data = image();
+  header(data)->effectCount = 2;
+  flashImage(data);
+  CHECK(!maps());
+
+  data = image();
+  header(data)->motionOffset = header(data)->size - sizeof(ConfigImageMotion) + 1;
+  flashImage(data);
+  CHECK(!maps());
+}
+
+// On the ESP32 offset + count * sizeof is 32 bit and these offsets wrapped
+// it back under size. The host computes it in 64 bits, so this guards the
+// division form of the check rather than reproducing the wrap.
+TEST(rejectsOffsetsThatWrap) {
+  auto data = image();
+  header(data)->channelsOffset = 0xFFFFFFFC;
+  header(data)->channelCount = 2;
+  flashImage(data);
+  CHECK(!maps());
+
+  data = image();
+  header(data)->effectsOffset = 0xFFFFFFF0;
+  flashImage(data);
+  CHECK(!maps());
+
+  data = image();
+  header(data)->actionsOffset = 0xFFFFFFFF;
+  flashImage(data);
+  CHECK(!maps());
+}
+
+TEST(rejectsEntriesOutsideTheirTables) {
+  auto data = image();
+  ((ConfigImageEffect*)&data[header(data)->effectsOffset])->region = 1;
+  flashImage(data);
+  CHECK(!maps());
+
+  data = image();
+  ((ConfigImageRegion*)&data[header(data)->regionsOffset])->sectionCount = 2;
+  flashImage(data);
+  CHECK(!maps());
+}
+
+TEST(rejectsACorruptImage) {
+  auto data = image();
+  flashImage(data);
+  flash[header(data)->stringsOffset] = 'T';
+  CHECK(!maps());
+}
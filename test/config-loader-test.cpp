@@ -0,0 +1,349 @@
+#include "test.h"
+#include <hal/config.h>
+
+// Config's effect parsing lives with the lights and storage code, which
+// doesn't build on the host. The loader only needs these two, so they are
+// stood in for here: actions are the firmware's names and an effect keeps
+// its type and the last field as duration.
+
+static const char *actionNames[] = {
+  "motion-off", "motion-neutral", "motion-brakes", "motion-accelerating",
+  "headlight-off", "headlight-normal", "headlight-bright",
+  "turn-center", "turn-left", "turn-right", "turn-hazard",
+  "orientation-top", "orientation-bottom"
+};
+
+bool Config::isAction(std::string action) {
+  for (auto name : actionNames)
+    if (action == name)
+      return true;
+  return false;
+}
+
+bool Config::parseEffect(std::string data, LightingParameters *params) {
+  if (data.empty() || data[0] < '0' || data[0] > '9')
+    return false;
+
+  params->effect = (LightEffect)atoi(data.c_str());
+  params->layer = 0;
+  params->duration = atoll(data.substr(data.find_last_of(',') + 1).c_str());
+  return true;
+}
+
+#define REGIONS   1200
+#define EFFECTS   1000
+
+static std::vector<uint8_t> written(void (*write)(MsgPackWriter &writer)) {
+  char *buffer = NULL;
+  size_t size = 0;
+  FILE *file = open_memstream(&buffer, &size);
+  MsgPackWriter writer(file);
+  write(writer);
+  fclose(file);
+
+  std::vector<uint8_t> data(buffer, buffer + size);
+  free(buffer);
+  return data;
+}
+
+static std::string regionName(int index) {
+  char name[32];
+  snprintf(name, sizeof(name), "region-%04d", index);
+  return name;
+}
+
+// a profile far past the 10 KB document the loader replaced
+static void largeConfig(MsgPackWriter &writer) {
+  writer.map(4);
+
+  writer.string("motion");
+  writer.map(4);
+  writer.string("autoMotion");
+  writer.boolean(true);
+  writer.string("brakeThreshold");
+  writer.number(0.35f);
+  writer.string("motionDwell");
+  writer.integer(40);
+  writer.string("somethingNew");
+  writer.string("ignored");
+
+  writer.string("lights");
+  writer.map(2);
+  writer.string("channels");
+  writer.array(4);
+  for (int channel = 0; channel < 4; channel++) {
+    writer.map(3);
+    writer.string("channel");
+    writer.integer(channel);
+    writer.string("leds");
+    writer.integer(300);
+    writer.string("type");
+    writer.integer(channel % 2);
+  }
+
+  writer.string("regions");
+  writer.map(REGIONS);
+  for (int region = 0; region < REGIONS; region++) {
+    writer.string(regionName(region));
+    writer.array(2);
+    for (int section = 0; section < 2; section++) {
+      writer.map(3);
+      writer.string("channel");
+      writer.integer(region % 4);
+      writer.string("start");
+      writer.integer(section * 150 + region % 100);
+      writer.string("end");
+      writer.integer(section * 150 + region % 100 + 10 + section);
+    }
+  }
+
+  int actions = sizeof(actionNames) / sizeof(actionNames[0]);
+  writer.string("actions");
+  writer.map(actions);
+  for (int action = 0; action < actions; action++) {
+    writer.string(actionNames[action]);
+
+    int count = EFFECTS / actions + (action < EFFECTS % actions ? 1 : 0);
+    writer.array(count);
+    for (int effect = 0; effect < count; effect++) {
+      writer.map(2);
+      writer.string("region");
+      writer.string(regionName(effect));
+      writer.string("effect");
+      writer.string("3,#000000,#FFFF00," + std::to_string(action * 1000 + effect));
+    }
+  }
+
+  writer.string("unknown");
+  writer.array(2);
+  writer.integer(1);
+  writer.integer(2);
+}
+
+struct Loaded {
+  AmpConfig config;
+  MsgPackStatus status;
+  bool valid;
+
+  ~Loaded() {
+    for (auto &action : config.actions)
+      delete action.second;
+  }
+};
+
+static void load(const std::vector<uint8_t> &data, size_t chunk, Loaded &loaded) {
+  MsgPackReader reader;
+  ConfigLoader loader;
+  loader.begin(&loaded.config);
+  reader.reset(&loader);
+
+  loaded.status = MsgPack_Incomplete;
+  for (size_t offset = 0; offset < data.size() && loaded.status == MsgPack_Incomplete; offset += chunk)
+    loaded.status = reader.feed(&data[offset], std::min(chunk, data.size() - offset));
+  loaded.valid = loader.isValid();
+}
+
+static bool sameRegions(AmpConfig &a, AmpConfig &b) {
+  if (a.lights.regions.size() != b.lights.regions.size())
+    return false;
+
+  for (auto &entry : a.lights.regions) {
+    auto other = b.lights.regions.find(entry.first);
+    if (other == b.lights.regions.end())
+      return false;
+
+    auto &region = entry.second;
+    if (region.name != other->second.name || region.count != other->second.count || region.breaks != other->second.breaks)
+      return false;
+
+    for (size_t i = 0; i < region.sections.size(); i++) {
+      auto &section = region.sections[i], &otherSection = other->second.sections[i];
+      if (section.channel != otherSection.channel || section.start != otherSection.start || section.end != otherSection.end)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+static bool sameActions(AmpConfig &a, AmpConfig &b) {
+  if (a.actions.size() != b.actions.size())
+    return false;
+
+  for (auto &entry : a.actions) {
+    auto other = b.actions.find(entry.first);
+    if (other == b.actions.end() || entry.second->size() != other->second->size())
+      return false;
+
+    for (size_t i = 0; i < entry.second->size(); i++) {
+      auto &effect = (*entry.second)[i], &otherEffect = (*other->second)[i];
+      if (effect.region != otherEffect.region || effect.effect != otherEffect.effect || effect.duration != otherEffect.duration)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+TEST(largeConfigLoads) {
+  auto data = written(largeConfig);
+  printf("config: %zu bytes, %d regions, %d effects\n", data.size(), REGIONS, EFFECTS);
+  CHECK(data.size() >= 100 * 1024);
+
+  Loaded loaded;
+  load(data, data.size(), loaded);
+  CHECK(loaded.status == MsgPack_Done);
+  CHECK(loaded.valid);
+
+  auto &config = loaded.config;
+  CHECK(config.motion.autoMotion);
+  CHECK_NEAR(config.motion.brakeThreshold, 0.35, 1e-6);
+  CHECK(config.motion.motionDwell == 40);
+  CHECK(config.motion.motionMaxLatency == DEFAULT_MOTION_MAX_LATENCY);
+
+  CHECK(config.lights.channels.size() == 4);
+  CHECK(config.lights.channels[3].leds == 300);
+  CHECK(config.lights.channels[3].type == (LEDType)1);
+
+  CHECK(config.lights.regions.size() == REGIONS);
+  auto &region = config.lights.regions[regionName(1117)];
+  CHECK(region.sections.size() == 2);
+  CHECK(region.sections[1].channel == 1 && region.sections[1].start == 167 && region.sections[1].end == 178);
+  CHECK(region.count == 21);
+
+  size_t effects = 0;
+  for (auto &action : config.actions)
+    effects += action.second->size();
+  CHECK(effects == EFFECTS);
+
+  auto &brakes = *config.actions["motion-brakes"];
+  CHECK(brakes[5].region == regionName(5));
+  CHECK(brakes[5].effect == Blink);
+  CHECK(brakes[5].duration == 2005);
+}
+
+TEST(anyChunkSizeLoadsTheSame) {
+  auto data = written(largeConfig);
+
+  Loaded whole;
+  load(data, data.size(), whole);
+
+  for (size_t chunk : { 1, 2, 3, 7, 20, 244, 256, 4096 }) {
+    Loaded loaded;
+    load(data, chunk, loaded);
+
+    CHECK(loaded.status == MsgPack_Done && loaded.valid);
+    CHECK(sameRegions(loaded.config, whole.config));
+    CHECK(sameActions(loaded.config, whole.config));
+  }
+}
+
+// the reader and loader are all the state a load needs, however large the document
+TEST(stateIsFixed) {
+  printf("reader %zu bytes, loader %zu bytes\n", sizeof(MsgPackReader), sizeof(ConfigLoader));
+  CHECK(sizeof(MsgPackReader) < 256);
+}
+
+TEST(truncatedConfigIsIncomplete) {
+  auto data = written(largeConfig);
+  data.resize(data.size() / 2);
+
+  Loaded loaded;
+  load(data, 244, loaded);
+  CHECK(loaded.status == MsgPack_Incomplete);
+}
+
+TEST(rootHasToBeAMap) {
+  Loaded loaded;
+  load(written([](MsgPackWriter &writer) { writer.array(0); }), 1, loaded);
+  CHECK(loaded.status == MsgPack_Done);
+  CHECK(!loaded.valid);
+}
+
+TEST(lightsHaveToBeAMap) {
+  Loaded loaded;
+  load(written([](MsgPackWriter &writer) {
+    writer.map(1);
+    writer.string("lights");
+    writer.array(0);
+  }), 1, loaded);
+  CHECK(!loaded.valid);
+
+  Loaded missing;
+  load(written([](MsgPackWriter &writer) {
+    writer.map(1);
+    writer.string("motion");
+    writer.map(0);
+  }), 1, missing);
+  CHECK(missing.status == MsgPack_Done);
+  CHECK(!missing.valid);
+}
+
+TEST(invalidEffectsAreSkipped) {
+  Loaded loaded;
+  load(written([](MsgPackWriter &writer) {
+    writer.map(2);
+    writer.string("lights");
+    writer.map(0);
+    writer.string("actions");
+    writer.map(2);
+    writer.string("not-an-action");
+    writer.array(1);
+    writer.map(2);
+    writer.string("region");
+    writer.string("rear");
+    writer.string("effect");
+    writer.string("1");
+    writer.string("turn-left");
+    writer.array(3);
+    writer.map(1);
+    writer.string("effect");
+    writer.string("1");
+    writer.map(2);
+    writer.string("region");
+    writer.string("rear");
+    writer.string("effect");
+    writer.string("x");
+    writer.map(2);
+    writer.string("region");
+    writer.string("rear");
+    writer.string("effect");
+    writer.string("2,#FF0000,1");
+  }), 5, loaded);
+
+  CHECK(loaded.valid);
+  CHECK(loaded.config.actions.size() == 1);
+  CHECK(loaded.config.actions["turn-left"]->size() == 1);
+  CHECK((*loaded.config.actions["turn-left"])[0].effect == Static);
+}
+
+static std::string longName;
+
+static void namedRegion(MsgPackWriter &writer) {
+  writer.map(1);
+  writer.string("lights");
+  writer.map(1);
+  writer.string("regions");
+  writer.map(1);
+  writer.string(longName);
+  writer.array(1);
+  writer.map(3);
+  writer.string("channel"); writer.integer(1);
+  writer.string("start"); writer.integer(0);
+  writer.string("end"); writer.integer(10);
+}
+
+// a longer name can't be kept whole and loading it truncated would rename it
+TEST(longRegionNamesInvalidateTheConfig) {
+  longName = std::string(CONFIG_LOADER_KEY - 1, 'r');
+  Loaded longest;
+  load(written(namedRegion), 7, longest);
+  CHECK(longest.valid);
+  CHECK(longest.config.lights.regions.count(longName) == 1);
+
+  longName += "r";
+  Loaded tooLong;
+  load(written(namedRegion), 7, tooLong);
+  CHECK(tooLong.status == MsgPack_Done);
+  CHECK(!tooLong.valid);
+}
@@ -0,0 +1,125 @@
+#include "test.h"
+#include <config-patch.h>
+
+static std::string patch() {
+  std::string out;
+  PatchWriter writer(out);
+
+  writer.begin(Patch_SetEffect);
+  writer.string("motion-brakes");
+  writer.string("tail");
+  writer.string("2,255,0,0");
+  writer.end();
+
+  writer.begin(Patch_SetMotion);
+  writer.string("brakeThreshold");
+  writer.f32(0.35f);
+  writer.end();
+
+  writer.begin(Patch_SetRegion);
+  writer.string("tail");
+  writer.u8(1);
+  writer.u8(2);
+  writer.u16(1);
+  writer.u16(300);
+  writer.end();
+
+  return out;
+}
+
+static PatchReader reader(const std::string &data, size_t length) {
+  return PatchReader((const uint8_t*)data.data(), length);
+}
+
+TEST(roundTrip) {
+  std::string data = patch();
+  PatchReader patch = reader(data, data.length());
+  CHECK(patch.validate());
+
+  PatchOp op;
+  CHECK(patch.next(&op));
+  CHECK(op == Patch_SetEffect);
+  CHECK(patch.string() == "motion-brakes");
+  CHECK(patch.string() == "tail");
+  CHECK(patch.string() == "2,255,0,0");
+  CHECK(patch.isValid());
+
+  CHECK(patch.next(&op));
+  CHECK(op == Patch_SetMotion);
+  CHECK(patch.string() == "brakeThreshold");
+  CHECK(patch.f32() == 0.35f);
+  CHECK(patch.isValid());
+
+  CHECK(patch.next(&op));
+  CHECK(op == Patch_SetRegion);
+  CHECK(patch.string() == "tail");
+  CHECK(patch.u8() == 1);
+  CHECK(patch.u8() == 2);
+  CHECK(patch.u16() == 1);
+  CHECK(patch.u16() == 300);
+  CHECK(patch.isValid());
+
+  CHECK(!patch.next(&op));
+}
+
+TEST(headerHoldsThePayloadLength) {
+  std::string data = patch();
+  // op, length 14 + 5 + 10
+  CHECK((uint8_t)data[0] == Patch_SetEffect);
+  CHECK((uint8_t)data[1] == 29 && data[2] == 0);
+  CHECK(data.length() == 3 * PATCH_HEADER + 29 + 19 + 11);
+}
+
+TEST(readingPastThePayloadMarksTheOpInvalid) {
+  std::string data = patch();
+  PatchReader patch = reader(data, data.length());
+
+  PatchOp op;
+  CHECK(patch.next(&op));
+  CHECK(patch.string() == "motion-brakes");
+  CHECK(patch.string() == "tail");
+  CHECK(patch.string() == "2,255,0,0");
+  CHECK(patch.u8() == 0);
+  CHECK(patch.f32() == 0);
+  CHECK(patch.string() == "");
+  CHECK(!patch.isValid());
+
+  // does not spill into the next op, which starts valid again
+  CHECK(patch.next(&op));
+  CHECK(op == Patch_SetMotion);
+  CHECK(patch.isValid());
+  CHECK(patch.string() == "brakeThreshold");
+}
+
+TEST(truncatedPatchesAreRejectedWhole) {
+  std::string data = patch();
+  size_t first = PATCH_HEADER + 29;
+  size_t second = first + PATCH_HEADER + 19;
+
+  // cutting between ops leaves a shorter valid patch, anywhere else is invalid
+  for (size_t length = 0; length < data.length(); length++)
+    CHECK(reader(data, length).validate() == (length == first || length == second));
+
+  // validate leaves the reader at the start
+  PatchReader patch = reader(data, data.length());
+  CHECK(patch.validate());
+  PatchOp op;
+  CHECK(patch.next(&op) && op == Patch_SetEffect);
+}
+
+TEST(longStringsAreCut) {
+  std::string data;
+  PatchWriter writer(data);
+  writer.begin(Patch_RemoveEffect);
+  writer.string(std::string(300, 'a'));
+  writer.string("tail");
+  writer.end();
+
+  PatchReader patch = reader(data, data.length());
+  CHECK(patch.validate());
+  PatchOp op;
+  CHECK(patch.next(&op));
+  CHECK(patch.string() == std::string(255, 'a'));
+  CHECK(patch.string() == "tail");
+  CHECK(patch.isValid());
+}
@@ -0,0 +1,284 @@
+#include "test.h"
+#include <string.h>
+#include <hal/config.h>
+#include <hal/lights.h>
+
+// Config against a SPIFFS kept in memory. fakes/hal/lights.h stands in for
+// the LED drivers, the action names are the firmware's. Config unlinks and
+// renames with the plain C calls, the test links with --wrap for both.
+
+std::map<Actions, std::string> Lights::headlightActions = {
+  std::make_pair(Actions::LightsOff, "headlight-off"),
+  std::make_pair(Actions::LightsHeadlightNormal, "headlight-normal"),
+  std::make_pair(Actions::LightsHeadlightBright, "headlight-bright")
+};
+
+std::map<Actions, std::string> Lights::motionActions = {
+  std::make_pair(Actions::LightsOff, "motion-off"),
+  std::make_pair(Actions::LightsMotionNeutral, "motion-neutral"),
+  std::make_pair(Actions::LightsMotionBrakes, "motion-brakes"),
+  std::make_pair(Actions::LightsMotionAcceleration, "motion-acceleration")
+};
+
+std::map<Actions, std::string> Lights::turnActions = {
+  std::make_pair(Actions::LightsOff, "turn-off"),
+  std::make_pair(Actions::LightsTurnCenter, "turn-center"),
+  std::make_pair(Actions::LightsTurnLeft, "turn-left"),
+  std::make_pair(Actions::LightsTurnRight, "turn-right"),
+  std::make_pair(Actions::LightsTurnHazard, "turn-hazard")
+};
+
+std::map<Actions, std::string> Lights::orientationActions = {
+  std::make_pair(Actions::LightsOff, "orientation-off")
+};
+
+const char* Lights::getActionName(ActionGroup group, Actions action) {
+  std::map<Actions, std::string> *names;
+
+  switch (group) {
+    case Group_Motion: names = &motionActions; break;
+    case Group_Headlight: names = &headlightActions; break;
+    case Group_Turn: names = &turnActions; break;
+    case Group_Orientation: names = &orientationActions; break;
+    default: return "";
+  }
+
+  auto name = names->find(action);
+  return name != names->end() ? name->second.c_str() : "";
+}
+
+// SPIFFS, a file's content is replaced when it is closed
+static std::map<std::string, std::string> files;
+
+struct MemoryFile {
+  std::string path;
+  std::string data;
+  size_t position;
+  bool write;
+};
+
+static ssize_t readMemory(void *cookie, char *buffer, size_t size) {
+  auto file = (MemoryFile*)cookie;
+  size = std::min(size, file->data.size() - file->position);
+  memcpy(buffer, file->data.data() + file->position, size);
+  file->position += size;
+  return size;
+}
+
+static ssize_t writeMemory(void *cookie, const char *buffer, size_t size) {
+  auto file = (MemoryFile*)cookie;
+  file->data.append(buffer, size);
+  file->position = file->data.size();
+  return size;
+}
+
+static int seekMemory(void *cookie, off64_t *offset, int whence) {
+  auto file = (MemoryFile*)cookie;
+  if (whence == SEEK_CUR)
+    *offset += file->position;
+  else if (whence == SEEK_END)
+    *offset += file->data.size();
+
+  file->position = *offset;
+  return 0;
+}
+
+static int closeMemory(void *cookie) {
+  auto file = (MemoryFile*)cookie;
+  if (file->write)
+    files[file->path] = file->data;
+  delete file;
+  return 0;
+}
+
+static FILE* openMemory(std::string path, std::string mode) {
+  auto existing = files.find(path);
+  if (mode[0] == 'r' && existing == files.end())
+    return NULL;
+
+  auto file = new MemoryFile { path, "", 0, mode[0] != 'r' };
+  if (mode[0] != 'w' && existing != files.end())
+    file->data = existing->second;
+  if (mode[0] == 'a')
+    file->position = file->data.size();
+
+  return fopencookie(file, mode.c_str(), { readMemory, writeMemory, seekMemory, closeMemory });
+}
+
+extern "C" int __wrap_unlink(const char *path) { return files.erase(path) == 1 ? 0 : -1; }
+
+extern "C" int __wrap_rename(const char *from, const char *to) {
+  auto file = files.find(from);
+  if (file == files.end())
+    return -1;
+
+  files[to] = file->second;
+  files.erase(file);
+  return 0;
+}
+
+bool AmpStorage::init() { return true; }
+void AmpStorage::deinit() { }
+bool AmpStorage::fileExists(std::string filename) { return files.count(filename) == 1; }
+FILE* AmpStorage::openFile(std::string filename, std::string attributes) { return openMemory(filename, attributes); }
+FILE* AmpStorage::writeFile(std::string filename) { return openMemory(filename, "w"); }
+std::string AmpStorage::readFile(std::string filename) { return files.count(filename) == 1 ? files[filename] : ""; }
+std::string AmpStorage::getHardwareRevision() { return "1.0.0"; }
+std::string AmpStorage::getSerialNumber() { return "host"; }
+std::string AmpStorage::getDeviceName() { return "Amp"; }
+
+// no compiled image, the factory msgpack config is used
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label) { return NULL; }
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+  spi_flash_mmap_memory_t memory, const void **out_ptr, spi_flash_mmap_handle_t *out_handle) { return ESP_FAIL; }
+void spi_flash_munmap(spi_flash_mmap_handle_t handle) { }
+
+#define FACTORY  "/spiffs/config.mp"
+#define JOURNAL  "/spiffs/config.journal"
+
+// front and rear regions, the brakes turn the rear red
+static void factoryConfig() {
+  files.clear();
+
+  FILE *file = openMemory(FACTORY, "w");
+  MsgPackWriter writer(file);
+  writer.map(2);
+  writer.string("actions");
+  writer.map(1);
+  writer.string("motion-brakes");
+  writer.array(1);
+  writer.map(2);
+  writer.string("region"); writer.string("rear");
+  writer.string("effect"); writer.string("2,#FF0000");
+
+  writer.string("lights");
+  writer.map(2);
+  writer.string("channels");
+  writer.array(1);
+  writer.map(3);
+  writer.string("channel"); writer.integer(1);
+  writer.string("leds"); writer.integer(20);
+  writer.string("type"); writer.integer(0);
+  writer.string("regions");
+  writer.map(2);
+  for (auto name : { "front", "rear" }) {
+    writer.string(name);
+    writer.array(1);
+    writer.map(3);
+    writer.string("channel"); writer.integer(1);
+    writer.string("start"); writer.integer(name[0] == 'f' ? 0 : 10);
+    writer.string("end"); writer.integer(name[0] == 'f' ? 10 : 20);
+  }
+  fclose(file);
+}
+
+static std::vector<LightingParameters>& brakes() { return Config::ampConfig.actionTable[Group_Motion][LightsMotionBrakes]; }
+
+static const LightingParameters* brakesOn(const std::string &region) {
+  for (auto& effect : brakes())
+    if (effect.region == region)
+      return &effect;
+  return NULL;
+}
+
+static bool brakesAre(const std::string &region, uint8_t r, uint8_t g, uint8_t b) {
+  auto effect = brakesOn(region);
+  return effect != NULL && effect->first.color.r == r && effect->first.color.g == g && effect->first.color.b == b;
+}
+
+// what ConfigService sends for effect: and saveEffect:
+static bool effect(Config &config, const char *region, const char *effect, bool save) {
+  std::string patch;
+  PatchWriter writer(patch);
+  writer.begin(Patch_SetEffect);
+  writer.string("motion-brakes");
+  writer.string(region);
+  writer.string(effect);
+  writer.end();
+  return config.applyPatch((const uint8_t*)patch.data(), patch.length(), save);
+}
+
+static EffectCommand blueFront() {
+  EffectCommand command = {};
+  command.group = Group_Motion;
+  command.action = LightsMotionBrakes;
+  command.region = 0;   // front, regions are indexed in name order
+  command.effect = Static;
+  command.first[2] = 0xff;
+  return command;
+}
+
+static void reboot(Config &config) {
+  config.onPowerDown();
+  config.onPowerUp();
+}
+
+TEST(previewsAreResolvedButNotSaved) {
+  factoryConfig();
+  Config config;
+  config.onPowerUp();
+  CHECK(config.isValid());
+  CHECK(brakesAre("rear", 0xff, 0, 0));
+
+  CHECK(effect(config, "rear", "2,#00FF00", false));
+  CHECK(config.applyCommand(Command_Effect, blueFront()));
+  CHECK(brakes().size() == 2);
+  CHECK(brakesAre("rear", 0, 0xff, 0));
+  CHECK(brakesAre("front", 0, 0, 0xff));
+  CHECK(files.count(JOURNAL) == 0);
+
+  config.saveConfig();
+  reboot(config);
+  CHECK(brakes().size() == 1);
+  CHECK(brakesAre("rear", 0xff, 0, 0));
+  CHECK(brakesOn("front") == NULL);
+}
+
+TEST(savingAnEffectEndsItsPreview) {
+  factoryConfig();
+  Config config;
+  config.onPowerUp();
+
+  CHECK(effect(config, "rear", "2,#00FF00", false));
+  CHECK(effect(config, "rear", "2,#FFFF00", true));
+  CHECK(brakesAre("rear", 0xff, 0xff, 0));
+
+  // a later preview of another region still isn't saved with it
+  CHECK(config.applyCommand(Command_Effect, blueFront()));
+  config.saveConfig();
+  reboot(config);
+  CHECK(brakes().size() == 1);
+  CHECK(brakesAre("rear", 0xff, 0xff, 0));
+}
+
+TEST(journaledEditsLeavePreviewsOut) {
+  factoryConfig();
+  Config config;
+  config.onPowerUp();
+
+  CHECK(config.applyCommand(Command_Effect, blueFront()));
+  auto saved = blueFront();
+  saved.region = 1;
+  saved.first[0] = 0xff;
+  CHECK(config.applyCommand(Command_SaveEffect, saved));
+  CHECK(files.count(JOURNAL) == 1);
+
+  reboot(config);
+  CHECK(brakes().size() == 1);
+  CHECK(brakesAre("rear", 0xff, 0, 0xff));
+}
+
+TEST(removingAnEffectRemovesItsPreview) {
+  factoryConfig();
+  Config config;
+  config.onPowerUp();
+
+  CHECK(effect(config, "rear", "2,#00FF00", false));
+  CHECK(config.applyCommand(Command_Effect, blueFront()));
+
+  EffectCommand remove = blueFront();
+  CHECK(config.applyCommand(Command_RemoveEffect, remove));
+  remove.region = 1;
+  CHECK(config.applyCommand(Command_RemoveEffect, remove));
+  CHECK(brakes().empty());
+}
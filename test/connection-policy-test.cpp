@@ -0,0 +1,214 @@
+#include "test.h"
+#include <vector>
+#include <hal/connection-policy.h>
+
+// The policy against a GAP that records what it was asked for. Time is
+// passed in ms like millis() on the board.
+
+struct Request {
+  uint16_t handle;
+  uint16_t minInterval;
+};
+
+struct RecordingGap : ConnectionGap {
+  std::vector<uint16_t> open;
+  std::vector<Request> requests;
+  std::vector<uint16_t> dataLength;
+  std::vector<int> results;    // next updateParams return codes, 0 once empty
+
+  bool isConnected(uint16_t handle) {
+    for (auto link : open)
+      if (link == handle)
+        return true;
+    return false;
+  }
+
+  int setDataLength(uint16_t handle, uint16_t octets, uint16_t time) {
+    dataLength.push_back(handle);
+    return 0;
+  }
+
+  int updateParams(uint16_t handle, const ConnectionProfile &profile) {
+    requests.push_back({ handle, profile.minInterval });
+    if (results.empty())
+      return 0;
+
+    int rc = results.front();
+    results.erase(results.begin());
+    return rc;
+  }
+
+  bool lastRequestIs(uint16_t handle, BleActivity activity) {
+    return !requests.empty() && requests.back().handle == handle &&
+      requests.back().minInterval == ConnectionPolicy::profile(activity).minInterval;
+  }
+};
+
+// one link that settled on the idle profile at 2000 ms
+struct Connected {
+  RecordingGap gap;
+  ConnectionPolicy policy = ConnectionPolicy(&gap);
+
+  Connected() {
+    gap.open.push_back(1);
+    policy.connected(1, 0);
+    policy.apply(BLE_PARAMS_SETTLE);
+    gap.requests.clear();
+  }
+};
+
+TEST(newLinksSettleFirst) {
+  RecordingGap gap;
+  ConnectionPolicy policy(&gap);
+  gap.open.push_back(1);
+
+  CHECK(policy.nextDelay(0) == -1);
+  CHECK(policy.connected(1, 0));
+  CHECK(policy.nextDelay(0) == BLE_PARAMS_SETTLE);
+
+  policy.apply(BLE_PARAMS_SETTLE - 1);
+  CHECK(gap.requests.empty());
+
+  policy.apply(BLE_PARAMS_SETTLE);
+  CHECK(gap.requests.size() == 1 && gap.lastRequestIs(1, Activity_Idle));
+  CHECK(gap.dataLength.size() == 1);
+  CHECK(policy.nextDelay(BLE_PARAMS_SETTLE) == -1);
+}
+
+TEST(raisesRightAwayAndDropsAfterTheHold) {
+  Connected link;
+  auto &policy = link.policy;
+  auto &gap = link.gap;
+
+  CHECK(policy.traffic(Activity_Transfer, 0, 3000));
+  policy.apply(3000);
+  CHECK(gap.requests.size() == 1 && gap.lastRequestIs(1, Activity_Transfer));
+
+  // more of the same activity doesn't wake the task again
+  CHECK(!policy.traffic(Activity_Transfer, 244, 3500));
+  CHECK(!policy.traffic(Activity_Streaming, 244, 3500));
+  CHECK(policy.getActivity(3500) == Activity_Transfer);
+  CHECK(policy.nextDelay(3500) == BLE_ACTIVITY_HOLD);
+
+  policy.apply(3500 + BLE_ACTIVITY_HOLD - 1);
+  CHECK(gap.requests.size() == 1);
+
+  CHECK(policy.getActivity(3500 + BLE_ACTIVITY_HOLD) == Activity_Idle);
+  policy.apply(3500 + BLE_ACTIVITY_HOLD);
+  CHECK(gap.requests.size() == 2 && gap.lastRequestIs(1, Activity_Idle));
+
+  // data length is only asked for once per link
+  CHECK(gap.dataLength.size() == 1);
+}
+
+TEST(lowerActivityHoldsUntilItEnds) {
+  Connected link;
+  auto &policy = link.policy;
+
+  CHECK(policy.traffic(Activity_Streaming, 100, 3000));
+  policy.apply(3000);
+  CHECK(link.gap.lastRequestIs(1, Activity_Streaming));
+
+  CHECK(!policy.traffic(Activity_Streaming, 100, 4500));
+  policy.apply(3000 + BLE_ACTIVITY_HOLD);
+  CHECK(link.gap.requests.size() == 1);
+
+  policy.apply(4500 + BLE_ACTIVITY_HOLD);
+  CHECK(link.gap.lastRequestIs(1, Activity_Idle));
+}
+
+TEST(retriesWhileAnUpdateIsInProgress) {
+  Connected link;
+  auto &policy = link.policy;
+  auto &gap = link.gap;
+
+  gap.results = { CONNECTION_BUSY, CONNECTION_BUSY };
+  policy.traffic(Activity_Transfer, 0, 3000);
+  policy.apply(3000);
+  CHECK(gap.requests.size() == 1);
+  CHECK(policy.nextDelay(3000) == BLE_PARAMS_RETRY);
+
+  policy.apply(3000 + BLE_PARAMS_RETRY - 1);
+  CHECK(gap.requests.size() == 1);
+
+  policy.apply(3000 + BLE_PARAMS_RETRY);
+  CHECK(gap.requests.size() == 2);
+
+  policy.apply(3000 + 2 * BLE_PARAMS_RETRY);
+  CHECK(gap.requests.size() == 3 && gap.lastRequestIs(1, Activity_Transfer));
+
+  // accepted, nothing left until the hold ends
+  policy.apply(3000 + 3 * BLE_PARAMS_RETRY);
+  CHECK(gap.requests.size() == 3);
+}
+
+TEST(rejectedRequestsArentRepeated) {
+  Connected link;
+  auto &policy = link.policy;
+  auto &gap = link.gap;
+
+  gap.results = { 13 };
+  policy.traffic(Activity_Transfer, 0, 3000);
+  policy.apply(3000);
+  CHECK(gap.requests.size() == 1);
+
+  policy.apply(3100);
+  policy.apply(3600);
+  CHECK(gap.requests.size() == 1);
+  CHECK(policy.nextDelay(3600) == 3000 + BLE_ACTIVITY_HOLD - 3600);
+
+  // the next activity asks again
+  policy.apply(3000 + BLE_ACTIVITY_HOLD);
+  CHECK(gap.requests.size() == 2 && gap.lastRequestIs(1, Activity_Idle));
+}
+
+TEST(reusedHandleTakesOverItsLink) {
+  Connected link;
+  auto &policy = link.policy;
+  auto &gap = link.gap;
+
+  // the link closed and the handle came back before the ble task swept it
+  CHECK(policy.connected(1, 5000));
+  CHECK(policy.connected(2, 5000));
+  CHECK(policy.connected(3, 5000));
+  gap.open = { 1, 2, 3 };
+
+  policy.apply(5000 + BLE_PARAMS_SETTLE);
+  CHECK(gap.requests.size() == 3);
+  CHECK(gap.dataLength.size() == 4);
+
+  // every link is taken
+  CHECK(!policy.connected(4, 6000));
+}
+
+TEST(closedLinksAreSwept) {
+  Connected link;
+  auto &policy = link.policy;
+  auto &gap = link.gap;
+
+  CHECK(policy.connected(2, 100));
+  CHECK(policy.connected(3, 100));
+  CHECK(!policy.connected(4, 100));
+  CHECK(policy.firstLink() == 1);
+
+  gap.open.clear();
+  policy.apply(3000);
+  CHECK(gap.requests.empty());
+  CHECK(policy.firstLink() == CONNECTION_HANDLE_NONE);
+  CHECK(policy.nextDelay(3000) == -1);
+  CHECK(policy.connected(4, 3000));
+}
+
+TEST(throughputIsSampledPerWindow) {
+  RecordingGap gap;
+  ConnectionPolicy policy(&gap);
+
+  policy.traffic(Activity_Transfer, 0, 1000);
+  for (unsigned long now = 1000; now < 2000; now += 10)
+    policy.traffic(Activity_Transfer, 244, now);
+  policy.traffic(Activity_Transfer, 244, 2000);
+
+  CHECK(policy.getThroughput(2000) == 244 * 101);
+  CHECK(policy.getThroughput(2000 + 2 * BLE_THROUGHPUT_WINDOW - 1) == 244 * 101);
+  CHECK(policy.getThroughput(2000 + 2 * BLE_THROUGHPUT_WINDOW) == 0);
+}
@@ -0,0 +1,216 @@
+#include "test.h"
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <delta-patch.h>
+
+#define SECTOR_SIZE 4096
+
+static uint32_t seed = 1;
+
+static uint8_t randomByte() {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+// builds a delta record by record along with the target it should produce
+struct Delta {
+  const std::vector<uint8_t> &source;
+  std::vector<uint8_t> body;
+  std::vector<uint8_t> target;
+  int64_t position = 0;
+
+  Delta(const std::vector<uint8_t> &source) : source(source) { }
+
+  // diff bytes change every changeEvery'th source byte, like relocated addresses
+  void record(uint32_t diff, uint32_t extra, int32_t seek, int changeEvery = 0) {
+    uint8_t control[DELTA_CONTROL_SIZE];
+    memcpy(&control[0], &diff, sizeof(diff));
+    memcpy(&control[4], &extra, sizeof(extra));
+    memcpy(&control[8], &seek, sizeof(seek));
+    body.insert(body.end(), control, control + DELTA_CONTROL_SIZE);
+
+    for (uint32_t i = 0; i < diff; i++) {
+      uint8_t change = changeEvery && i % changeEvery == 0 ? randomByte() : 0;
+      body.push_back(change);
+      target.push_back(source[position + i] + change);
+    }
+
+    for (uint32_t i = 0; i < extra; i++) {
+      uint8_t value = randomByte();
+      body.push_back(value);
+      target.push_back(value);
+    }
+
+    position += diff;
+    position += seek;
+  }
+};
+
+static std::vector<uint8_t> sourceImage() {
+  std::vector<uint8_t> source(256 * 1024);
+  for (auto &value : source)
+    value = randomByte();
+  return source;
+}
+
+static Delta typicalDelta(const std::vector<uint8_t> &source) {
+  Delta delta(source);
+  delta.record(40000, 0, 0, 97);        // relocated code
+  delta.record(1000, 300, 200, 0);      // new code, 200 bytes removed
+  delta.record(0, 5000, 0);             // only new bytes
+  delta.record(60000, 0, -30000, 13);   // code moved back
+  delta.record(30000, 0, 50000);        // unchanged, then a skip
+  delta.record(2000, 0, 0);
+  return delta;
+}
+
+// feeds the delta in chunks of random size the way the writer task does,
+// flushing whole sectors
+static bool patch(const std::vector<uint8_t> &source, const std::vector<uint8_t> &body,
+  size_t maxChunk, std::vector<uint8_t> &partition) {
+  DeltaPatcher patcher;
+  patcher.begin(source.data(), source.size());
+
+  uint8_t sector[SECTOR_SIZE];
+  size_t filled = 0;
+
+  for (size_t offset = 0; offset < body.size(); ) {
+    size_t chunk = std::min(body.size() - offset, (size_t)(1 + rand() % maxChunk));
+    const uint8_t *data = &body[offset];
+    offset += chunk;
+
+    while (chunk > 0) {
+      size_t length = chunk, outputLength = SECTOR_SIZE - filled;
+      if (!patcher.apply(data, &length, &sector[filled], &outputLength))
+        return false;
+
+      data += length;
+      chunk -= length;
+      filled += outputLength;
+
+      if (filled == SECTOR_SIZE) {
+        partition.insert(partition.end(), sector, sector + SECTOR_SIZE);
+        filled = 0;
+      }
+    }
+  }
+
+  partition.insert(partition.end(), sector, sector + filled);
+  return patcher.isComplete();
+}
+
+TEST(reproducesTheTarget) {
+  auto source = sourceImage();
+  auto delta = typicalDelta(source);
+
+  // from single bytes, which split every control block, to whole packets
+  for (size_t maxChunk : { 1, 7, 12, 512, 40000 }) {
+    srand(maxChunk);
+    for (int run = 0; run < 5; run++) {
+      std::vector<uint8_t> partition;
+      CHECK(patch(source, delta.body, maxChunk, partition));
+      CHECK(partition == delta.target);
+    }
+  }
+}
+
+TEST(emptySectionsAreSkipped) {
+  auto source = sourceImage();
+  Delta delta(source);
+  delta.record(0, 0, 100);
+  delta.record(100, 0, 0);
+  delta.record(0, 0, -200);
+  delta.record(0, 10, 0);
+  delta.record(50, 0, 0);
+
+  std::vector<uint8_t> partition;
+  CHECK(patch(source, delta.body, 3, partition));
+  CHECK(partition == delta.target);
+  CHECK(partition.size() == 160);
+}
+
+TEST(incompleteUntilTheRecordEnds) {
+  auto source = sourceImage();
+  Delta delta(source);
+  delta.record(100, 100, 0);
+
+  DeltaPatcher patcher;
+  patcher.begin(source.data(), source.size());
+  uint8_t output[256];
+
+  size_t length = 5, outputLength = sizeof(output);
+  CHECK(patcher.apply(delta.body.data(), &length, output, &outputLength));
+  CHECK(length == 5 && outputLength == 0);
+  CHECK(!patcher.isComplete());
+
+  length = delta.body.size() - 6;
+  outputLength = sizeof(output);
+  CHECK(patcher.apply(&delta.body[5], &length, output, &outputLength));
+  CHECK(!patcher.isComplete());
+
+  length = 1;
+  outputLength = sizeof(output) - outputLength;
+  CHECK(patcher.apply(&delta.body[delta.body.size() - 1], &length, output, &outputLength));
+  CHECK(patcher.isComplete());
+}
+
+TEST(stopsWhenTheOutputIsFull) {
+  auto source = sourceImage();
+  Delta delta(source);
+  delta.record(100, 0, 0, 3);
+
+  DeltaPatcher patcher;
+  patcher.begin(source.data(), source.size());
+  uint8_t output[100];
+
+  size_t length = delta.body.size(), outputLength = 40;
+  CHECK(patcher.apply(delta.body.data(), &length, output, &outputLength));
+  CHECK(length == DELTA_CONTROL_SIZE + 40 && outputLength == 40);
+
+  size_t rest = delta.body.size() - length;
+  outputLength = 60;
+  CHECK(patcher.apply(&delta.body[length], &rest, &output[40], &outputLength));
+  CHECK(outputLength == 60);
+  CHECK(memcmp(output, delta.target.data(), 100) == 0);
+}
+
+TEST(rejectsReadsOutsideTheSource) {
+  auto source = sourceImage();
+
+  // past the end
+  Delta past(source);
+  past.record(source.size() - 10, 0, 0);
+  uint8_t control[DELTA_CONTROL_SIZE] = { 20 };
+  past.body.insert(past.body.end(), control, control + DELTA_CONTROL_SIZE);
+  past.body.insert(past.body.end(), 20, 0);
+
+  std::vector<uint8_t> partition;
+  CHECK(!patch(source, past.body, 512, partition));
+
+  // before the start
+  Delta before(source);
+  before.record(10, 0, -20);
+  before.body.insert(before.body.end(), control, control + DELTA_CONTROL_SIZE);
+  before.body.insert(before.body.end(), 20, 0);
+
+  partition.clear();
+  CHECK(!patch(source, before.body, 512, partition));
+}
+
+TEST(patchCost) {
+  auto source = sourceImage();
+  auto delta = typicalDelta(source);
+  std::vector<uint8_t> partition;
+  partition.reserve(delta.target.size());
+
+  srand(1);
+  double nanos = nanosPer(20, [&](int i) {
+    partition.clear();
+    patch(source, delta.body, 512, partition);
+  });
+  printf("%zu byte image from a %zu byte delta: %.0f MB/s\n", delta.target.size(), delta.body.size(),
+    delta.target.size() / nanos * 1000);
+}
@@ -0,0 +1,193 @@
+#include "test.h"
+#include <event-bus.h>
+
+// The bus is a process wide singleton that keeps subscriber pointers, so
+// every subscriber here is static and each test uses its own.
+
+static Event touch(bool touched) {
+  Event event;
+  event.type = Event_Touch;
+  event.touched = touched;
+  return event;
+}
+
+static Event config(uint8_t scope) {
+  Event event;
+  event.type = Event_ConfigUpdated;
+  event.config.valid = true;
+  event.config.scope = scope;
+  return event;
+}
+
+static Event power(uint8_t level) {
+  Event event;
+  event.type = Event_PowerStatus;
+  event.powerStatus = PowerStatus();
+  event.powerStatus.percentage = level;
+  return event;
+}
+
+TEST(policies) {
+  CHECK(EventBus::policy(Event_ConfigUpdated) == Event_LatestWins);
+  CHECK(EventBus::policy(Event_PowerStatus) == Event_LatestWins);
+  CHECK(EventBus::policy(Event_Advertising) == Event_LatestWins);
+  CHECK(EventBus::policy(Event_LightsChanged) == Event_LatestWins);
+  CHECK(EventBus::policy(Event_Parked) == Event_LatestWins);
+  CHECK(EventBus::policy(Event_Touch) == Event_Fifo);
+  CHECK(EventBus::policy(Event_UpdateStatus) == Event_Fifo);
+  CHECK(EventBus::policy(Event_CalibrateXG) == Event_Fifo);
+
+  // every latest wins type has its own slot
+  bool used[EVENT_LATEST_SLOTS] = {};
+  for (int type = 0; type < Event_TypeCount; type++) {
+    int8_t slot = EventBus::latestSlot((EventType)type);
+    if (slot < 0)
+      continue;
+
+    CHECK(slot < EVENT_LATEST_SLOTS);
+    CHECK(!used[slot]);
+    used[slot] = true;
+  }
+}
+
+TEST(onlySubscribedTypesArrive) {
+  static EventSubscriber subscriber;
+  auto bus = EventBus::instance();
+  bus->subscribe(&subscriber, Event_Touch);
+
+  Event event;
+  bus->publish(power(50));
+  CHECK(!subscriber.poll(event));
+
+  bus->publish(touch(true));
+  CHECK(subscriber.poll(event));
+  CHECK(event.type == Event_Touch && event.touched);
+  CHECK(!subscriber.poll(event));
+}
+
+TEST(fifoKeepsOrderAndDropsTheOldest) {
+  static EventSubscriber subscriber;
+  auto bus = EventBus::instance();
+  bus->subscribe(&subscriber, Event_UpdateStatus);
+  uint32_t dropped = bus->getStats().dropped;
+
+  for (int i = 0; i < EVENT_RING_SIZE + 3; i++) {
+    Event event;
+    event.type = Event_UpdateStatus;
+    event.updateStatus = (UpdateStatus)(i % 4);
+    bus->publish(event);
+  }
+
+  CHECK(bus->getStats().dropped - dropped == 3);
+
+  Event event;
+  int count = 0;
+  while (subscriber.poll(event)) {
+    CHECK(event.updateStatus == (UpdateStatus)((count + 3) % 4));
+    count++;
+  }
+  CHECK(count == EVENT_RING_SIZE);
+}
+
+TEST(latestWinsCoalesces) {
+  static EventSubscriber subscriber;
+  auto bus = EventBus::instance();
+  bus->subscribe(&subscriber, Event_PowerStatus);
+  uint32_t coalesced = bus->getStats().coalesced;
+
+  for (uint8_t level = 1; level <= 20; level++)
+    bus->publish(power(level));
+
+  CHECK(bus->getStats().coalesced - coalesced == 19);
+
+  Event event;
+  CHECK(subscriber.poll(event));
+  CHECK(event.powerStatus.percentage == 20);
+  CHECK(!subscriber.poll(event));
+}
+
+TEST(coalescedConfigUpdatesKeepEveryScope) {
+  static EventSubscriber subscriber;
+  auto bus = EventBus::instance();
+  bus->subscribe(&subscriber, Event_ConfigUpdated);
+
+  bus->publish(config(Scope_Motion));
+  bus->publish(config(Scope_Actions));
+
+  Event event;
+  CHECK(subscriber.poll(event));
+  CHECK(event.config.scope == (Scope_Motion | Scope_Actions));
+  CHECK(!subscriber.poll(event));
+
+  // a new update after the poll starts from its own scope
+  bus->publish(config(Scope_Lights));
+  CHECK(subscriber.poll(event));
+  CHECK(event.config.scope == Scope_Lights);
+}
+
+TEST(latestWinsBeforeFifo) {
+  static EventSubscriber subscriber;
+  auto bus = EventBus::instance();
+  bus->subscribe(&subscriber, Event_Touch);
+  bus->subscribe(&subscriber, Event_PowerStatus);
+
+  bus->publish(touch(true));
+  bus->publish(power(10));
+
+  Event event;
+  CHECK(subscriber.poll(event) && event.type == Event_PowerStatus);
+  CHECK(subscriber.poll(event) && event.type == Event_Touch);
+  CHECK(!subscriber.poll(event));
+}
+
+// the polling task is only woken when its inbox goes from empty to pending.
+// Uses types no other test subscribes to, their subscribers share this task.
+TEST(wakesOncePerDrain) {
+  static EventSubscriber subscriber;
+  auto bus = EventBus::instance();
+  bus->subscribe(&subscriber, Event_Advertising);
+  bus->subscribe(&subscriber, Event_CalibrateMag);
+
+  Event event, advertising, calibration;
+  advertising.type = Event_Advertising;
+  advertising.publicAdvertising = true;
+  calibration.type = Event_CalibrateMag;
+  calibration.calibration = Started;
+
+  subscriber.poll(event);
+  auto task = xTaskGetCurrentTaskHandle();
+  uint32_t before = ulTaskNotifyCount(task);
+
+  for (int i = 0; i < 5; i++) {
+    bus->publish(advertising);
+    bus->publish(calibration);
+  }
+  CHECK(ulTaskNotifyCount(task) - before == 1);
+
+  while (subscriber.poll(event)) { }
+  bus->publish(calibration);
+  CHECK(ulTaskNotifyCount(task) - before == 2);
+  while (subscriber.poll(event)) { }
+}
+
+TEST(publishCost) {
+  static EventSubscriber subscribers[6];
+  auto bus = EventBus::instance();
+  for (auto &subscriber : subscribers) {
+    bus->subscribe(&subscriber, Event_Parked);
+    bus->subscribe(&subscriber, Event_CalibrationRequest);
+  }
+
+  Event event, parked, request;
+  parked.type = Event_Parked;
+  parked.parked = false;
+  request.type = Event_CalibrationRequest;
+  request.calibrationRequest = 1;
+
+  double nanos = nanosPer(1000000, [&](int i) {
+    bus->publish(i & 1 ? parked : request);
+    for (auto &subscriber : subscribers)
+      while (subscriber.poll(event)) { }
+  });
+  printf("publish and drain to 6 subscribers: %.1f ns/event\n", nanos);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <common.h>
+#include <hal/connection-policy.h>
+
+// Stands in for the BLE service host so services can be tested without
+// NimBLE, only what the services ask it for
+
+class BluetoothLE {
+  public:
+    static BluetoothLE* instance() { static BluetoothLE ble; return &ble; }
+
+    BleActivity activity = Activity_Idle;
+    BleActivity getActivity() { return activity; }
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include <map>
+#include <string>
+#include <common.h>
+#include <models/light.h>
+#include <hal/config.h>
+
+// Stands in for Lights so Config can be tested without the LED drivers, only
+// the action names Config resolves actions by
+
+class Lights {
+  public:
+    static std::map<Actions, std::string> headlightActions;
+    static std::map<Actions, std::string> motionActions;
+    static std::map<Actions, std::string> turnActions;
+    static std::map<Actions, std::string> orientationActions;
+    static const char* getActionName(ActionGroup group, Actions action);
+};
@@ -0,0 +1,164 @@
+#include "test.h"
+#include <hal/latency-telemetry.h>
+
+// Traces on the host clock, every stage is given in us since the sample
+
+#define SAMPLED_AT  1000
+
+static void at(unsigned long us) { esp_timer_host_set_time(SAMPLED_AT + us); }
+
+static void mark(LatencyTelemetry &telemetry, LatencyStage stage, unsigned long us) {
+  at(us);
+  telemetry.mark(stage);
+}
+
+// one brake through the whole pipeline, the overlay ahead of the app path
+static void trace(LatencyTelemetry &telemetry, uint32_t detected, uint32_t overlay, uint32_t received,
+  uint32_t applied, uint32_t rendered, uint32_t shown) {
+  telemetry.begin(SAMPLED_AT, SAMPLED_AT + detected);
+  mark(telemetry, Latency_Overlay, overlay);
+  mark(telemetry, Latency_Received, received);
+  mark(telemetry, Latency_Applied, applied);
+  mark(telemetry, Latency_Rendered, rendered);
+  mark(telemetry, Latency_Shown, shown);
+}
+
+static bool statsAre(LatencyTelemetry &telemetry, LatencyStage stage, uint32_t p50, uint32_t p99, uint32_t max) {
+  auto stats = telemetry.getStats(stage);
+  if (stats.p50 == p50 && stats.p99 == p99 && stats.max == max)
+    return true;
+
+  printf("stage %d: p50 %u p99 %u max %u\n", stage, stats.p50, stats.p99, stats.max);
+  return false;
+}
+
+TEST(completeTraceRecordsEveryStage) {
+  LatencyTelemetry telemetry;
+  trace(telemetry, 200, 1800, 2600, 3100, 4700, 9300);
+
+  CHECK(telemetry.getCount() == 1);
+  CHECK(!telemetry.waitingFor(Latency_Overlay));
+
+  // a single brake is its own p50, p99 and max
+  CHECK(statsAre(telemetry, Latency_Detected, 200, 200, 200));
+  CHECK(statsAre(telemetry, Latency_Overlay, 1800, 1800, 1800));
+  CHECK(statsAre(telemetry, Latency_Received, 2600, 2600, 2600));
+  CHECK(statsAre(telemetry, Latency_Applied, 3100, 3100, 3100));
+  CHECK(statsAre(telemetry, Latency_Rendered, 4700, 4700, 4700));
+  CHECK(statsAre(telemetry, Latency_Shown, 9300, 9300, 9300));
+}
+
+TEST(appStagesHaveToBeInOrder) {
+  LatencyTelemetry telemetry;
+  telemetry.begin(SAMPLED_AT, SAMPLED_AT + 200);
+
+  CHECK(!telemetry.waitingFor(Latency_Applied));
+  mark(telemetry, Latency_Applied, 500);
+  mark(telemetry, Latency_Received, 1000);
+  mark(telemetry, Latency_Applied, 1500);
+  mark(telemetry, Latency_Received, 1600);
+  mark(telemetry, Latency_Rendered, 2000);
+  mark(telemetry, Latency_Shown, 3000);
+  CHECK(telemetry.getCount() == 0);
+
+  // the overlay can land anywhere, here after the LEDs showed the effect
+  CHECK(telemetry.waitingFor(Latency_Overlay));
+  mark(telemetry, Latency_Overlay, 3500);
+  CHECK(telemetry.getCount() == 1);
+
+  CHECK(statsAre(telemetry, Latency_Received, 1000, 1000, 1000));
+  CHECK(statsAre(telemetry, Latency_Applied, 1500, 1500, 1500));
+  CHECK(statsAre(telemetry, Latency_Overlay, 3500, 3500, 3500));
+}
+
+TEST(overlayIsOnlyRecordedOnce) {
+  LatencyTelemetry telemetry;
+  telemetry.begin(SAMPLED_AT, SAMPLED_AT + 200);
+  mark(telemetry, Latency_Overlay, 700);
+  mark(telemetry, Latency_Overlay, 900);
+  mark(telemetry, Latency_Received, 1000);
+  mark(telemetry, Latency_Applied, 1100);
+  mark(telemetry, Latency_Rendered, 1200);
+  mark(telemetry, Latency_Shown, 1300);
+
+  CHECK(statsAre(telemetry, Latency_Overlay, 700, 700, 700));
+}
+
+TEST(staleTracesAreDropped) {
+  LatencyTelemetry telemetry;
+  telemetry.begin(SAMPLED_AT, SAMPLED_AT + 200);
+  mark(telemetry, Latency_Overlay, 800);
+  mark(telemetry, Latency_Received, LATENCY_TRACE_TIMEOUT + 1);
+
+  CHECK(!telemetry.waitingFor(Latency_Received));
+  mark(telemetry, Latency_Applied, LATENCY_TRACE_TIMEOUT + 2);
+  CHECK(telemetry.getCount() == 0);
+  CHECK(statsAre(telemetry, Latency_Overlay, 0, 0, 0));
+
+  // the next brake traces as usual
+  trace(telemetry, 200, 1800, 2600, 3100, 4700, 9300);
+  CHECK(telemetry.getCount() == 1);
+}
+
+TEST(newBrakeReplacesTraceInFlight) {
+  LatencyTelemetry telemetry;
+  telemetry.begin(SAMPLED_AT, SAMPLED_AT + 200);
+  mark(telemetry, Latency_Received, 1000);
+  mark(telemetry, Latency_Applied, 1500);
+
+  trace(telemetry, 300, 1800, 2600, 3100, 4700, 9300);
+  CHECK(telemetry.getCount() == 1);
+  CHECK(statsAre(telemetry, Latency_Detected, 300, 300, 300));
+}
+
+TEST(longLatenciesOverflowIntoTheLastBucket) {
+  LatencyTelemetry telemetry;
+  uint32_t covered = LATENCY_BUCKETS * LATENCY_BUCKET_WIDTH;
+
+  trace(telemetry, 200, 1800, 2600, 3100, 4700, covered + 8000);
+  trace(telemetry, 200, 1800, 2600, 3100, 4700, covered + 30000);
+
+  // overflowed percentiles report the max seen
+  CHECK(statsAre(telemetry, Latency_Shown, covered + 30000, covered + 30000, covered + 30000));
+}
+
+TEST(percentilesResolveToBucketEdges) {
+  LatencyTelemetry telemetry;
+  CHECK(statsAre(telemetry, Latency_Shown, 0, 0, 0));
+
+  // 97 brakes shown in the 1000-1500 us bucket, 3 at 20.2 ms
+  for (int i = 0; i < 97; i++)
+    trace(telemetry, 200, 300, 400, 500, 600, 1000 + i * 5);
+  for (int i = 0; i < 3; i++)
+    trace(telemetry, 200, 300, 400, 500, 600, 20200);
+
+  CHECK(telemetry.getCount() == 100);
+  CHECK(statsAre(telemetry, Latency_Shown, 1500, 20200, 20200));
+
+  // the 50th and 99th brakes are the last ones counted in their buckets
+  LatencyTelemetry edges;
+  for (int i = 0; i < 50; i++)
+    trace(edges, 200, 300, 400, 500, 600, 900);
+  for (int i = 0; i < 49; i++)
+    trace(edges, 200, 300, 400, 500, 600, 2100);
+  trace(edges, 200, 300, 400, 500, 600, 7000);
+
+  CHECK(statsAre(edges, Latency_Shown, 1000, 2500, 7000));
+}
+
+TEST(resetClearsStatsAndTrace) {
+  LatencyTelemetry telemetry;
+  trace(telemetry, 200, 1800, 2600, 3100, 4700, 9300);
+  telemetry.begin(SAMPLED_AT, SAMPLED_AT + 200);
+  mark(telemetry, Latency_Received, 1000);
+
+  telemetry.reset();
+  CHECK(telemetry.getCount() == 0);
+  CHECK(!telemetry.waitingFor(Latency_Applied));
+  for (uint8_t stage = 0; stage < Latency_StageCount; stage++)
+    CHECK(statsAre(telemetry, (LatencyStage)stage, 0, 0, 0));
+
+  trace(telemetry, 100, 1100, 1200, 1300, 1400, 1500);
+  CHECK(telemetry.getCount() == 1);
+  CHECK(statsAre(telemetry, Latency_Shown, 1500, 1500, 1500));
+}
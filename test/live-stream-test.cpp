@@ -0,0 +1,337 @@
+#include "test.h"
+#include <string.h>
+#include <vector>
+#include <deque>
+#include <random>
+#include <hal/live-stream.h>
+
+#define PIXELS  10
+
+static std::vector<uint8_t> fragment(uint16_t seq, uint8_t flags, uint16_t start, std::vector<uint8_t> body) {
+  std::vector<uint8_t> data(STREAM_HEADER + body.size());
+  memcpy(&data[0], &seq, sizeof(seq));
+  data[2] = flags;
+  memcpy(&data[3], &start, sizeof(start));
+  std::copy(body.begin(), body.end(), data.begin() + STREAM_HEADER);
+  return data;
+}
+
+static bool receive(LiveStream &stream, const std::vector<uint8_t> &data, unsigned long now) {
+  return stream.receive(data.data(), data.size(), now);
+}
+
+// a key frame of one raw color
+static std::vector<uint8_t> keyFrame(uint16_t seq, uint8_t value) {
+  return fragment(seq, Stream_Raw | STREAM_FRAME_KEY | STREAM_FRAME_END, 0, std::vector<uint8_t>(PIXELS * 3, value));
+}
+
+static bool pixelIs(const uint8_t *pixels, int pixel, uint8_t r, uint8_t g, uint8_t b) {
+  return pixels[pixel * 3] == r && pixels[pixel * 3 + 1] == g && pixels[pixel * 3 + 2] == b;
+}
+
+// with depth 0 a frame is due as soon as it is complete
+static const uint8_t* show(LiveStream &stream, unsigned long now) {
+  auto pixels = stream.due(now);
+  if (pixels != NULL)
+    stream.shown(now);
+  return pixels;
+}
+
+TEST(rejectsBadStreams) {
+  LiveStream stream;
+  CHECK(!stream.begin(0, 30, 2, 0));
+  CHECK(!stream.begin(STREAM_MAX_PIXELS + 1, 30, 2, 0));
+  CHECK(!stream.begin(PIXELS, 0, 2, 0));
+  CHECK(!stream.begin(PIXELS, 30, STREAM_MAX_DEPTH + 1, 0));
+  CHECK(!receive(stream, keyFrame(0, 1), 0));
+
+  CHECK(stream.begin(PIXELS, 30, 2, 0));
+  CHECK(!stream.begin(PIXELS, 30, 2, 0));
+  stream.end();
+  CHECK(!stream.isActive());
+}
+
+TEST(decodesRawFragments) {
+  LiveStream stream;
+  stream.begin(PIXELS, 10, 0, 0);
+
+  // two fragments, the second from pixel 5
+  CHECK(receive(stream, fragment(0, Stream_Raw | STREAM_FRAME_KEY, 0, std::vector<uint8_t>(15, 1)), 0));
+  CHECK(show(stream, 0) == NULL);
+  CHECK(receive(stream, fragment(0, Stream_Raw | STREAM_FRAME_KEY | STREAM_FRAME_END, 5, std::vector<uint8_t>(15, 2)), 0));
+
+  auto pixels = show(stream, 0);
+  CHECK(pixels != NULL);
+  CHECK(pixelIs(pixels, 0, 1, 1, 1) && pixelIs(pixels, 4, 1, 1, 1));
+  CHECK(pixelIs(pixels, 5, 2, 2, 2) && pixelIs(pixels, 9, 2, 2, 2));
+
+  // past the end of the region or not whole pixels
+  CHECK(!receive(stream, fragment(1, Stream_Raw | STREAM_FRAME_KEY | STREAM_FRAME_END, 8, std::vector<uint8_t>(9, 2)), 0));
+  CHECK(!receive(stream, fragment(2, Stream_Raw | STREAM_FRAME_KEY | STREAM_FRAME_END, 0, std::vector<uint8_t>(4, 2)), 0));
+  stream.end();
+}
+
+TEST(deltasApplyOnTheLastFrame) {
+  LiveStream stream;
+  stream.begin(PIXELS, 10, 0, 0);
+  receive(stream, keyFrame(0, 1), 0);
+  show(stream, 0);
+
+  // 2 pixels of red, skip 3, 1 of green
+  CHECK(receive(stream, fragment(1, Stream_Rle | STREAM_FRAME_END, 1, { 2, 255, 0, 0, STREAM_RLE_SKIP | 3, 1, 0, 255, 0 }), 100));
+  auto pixels = show(stream, 100);
+  CHECK(pixels != NULL);
+  CHECK(pixelIs(pixels, 0, 1, 1, 1));
+  CHECK(pixelIs(pixels, 1, 255, 0, 0) && pixelIs(pixels, 2, 255, 0, 0));
+  CHECK(pixelIs(pixels, 3, 1, 1, 1) && pixelIs(pixels, 5, 1, 1, 1));
+  CHECK(pixelIs(pixels, 6, 0, 255, 0));
+  CHECK(pixelIs(pixels, 7, 1, 1, 1));
+
+  // palette of two, index 0xff keeps the pixel
+  CHECK(receive(stream, fragment(2, Stream_Palette | STREAM_FRAME_END, 6, { 2, 9, 9, 9, 7, 7, 7, 1, STREAM_PALETTE_SKIP, 0 }), 200));
+  pixels = show(stream, 200);
+  CHECK(pixels != NULL);
+  CHECK(pixelIs(pixels, 1, 255, 0, 0));
+  CHECK(pixelIs(pixels, 6, 7, 7, 7));
+  CHECK(pixelIs(pixels, 7, 1, 1, 1));
+  CHECK(pixelIs(pixels, 8, 9, 9, 9));
+  stream.end();
+}
+
+TEST(rejectsMalformedRunsAndPalettes) {
+  LiveStream stream;
+  stream.begin(PIXELS, 10, 0, 0);
+
+  uint16_t seq = 0;
+  // a run past the end, a run without its color, an index past the palette,
+  // a palette cut short
+  for (auto body : std::vector<std::vector<uint8_t>>{ { 11, 1, 1, 1 }, { 2, 1 }, { 1, 1, 1, 1, 1 }, { 2, 1, 1, 1 } }) {
+    uint8_t encoding = seq < 2 ? Stream_Rle : Stream_Palette;
+    CHECK(!receive(stream, fragment(seq++, encoding | STREAM_FRAME_KEY | STREAM_FRAME_END, 0, body), 0));
+  }
+  CHECK(stream.getStats().dropped == 4);
+  CHECK(show(stream, 0) == NULL);
+  stream.end();
+}
+
+TEST(deltasWaitForAKeyFrame) {
+  LiveStream stream;
+  stream.begin(PIXELS, 10, 0, 0);
+
+  // nothing to apply a delta to yet
+  CHECK(!receive(stream, fragment(0, Stream_Rle | STREAM_FRAME_END, 0, { 1, 5, 5, 5 }), 0));
+  CHECK(receive(stream, keyFrame(1, 1), 0));
+  CHECK(show(stream, 0) != NULL);
+
+  // frame 2 is lost, 3 can't be applied, nor the rest of it
+  CHECK(!receive(stream, fragment(3, Stream_Rle, 0, { 1, 5, 5, 5 }), 300));
+  CHECK(!receive(stream, fragment(3, Stream_Rle | STREAM_FRAME_END, 1, { 1, 5, 5, 5 }), 300));
+  CHECK(!receive(stream, fragment(4, Stream_Rle | STREAM_FRAME_END, 0, { 1, 5, 5, 5 }), 400));
+  CHECK(show(stream, 400) == NULL);
+
+  CHECK(receive(stream, keyFrame(5, 2), 500));
+  auto pixels = show(stream, 500);
+  CHECK(pixels != NULL && pixelIs(pixels, 0, 2, 2, 2));
+  CHECK(receive(stream, fragment(6, Stream_Rle | STREAM_FRAME_END, 0, { 1, 5, 5, 5 }), 600));
+  CHECK(show(stream, 600) != NULL);
+  stream.end();
+}
+
+TEST(lostFrameEndDropsTheFrame) {
+  LiveStream stream;
+  stream.begin(PIXELS, 10, 0, 0);
+  receive(stream, keyFrame(0, 1), 0);
+  show(stream, 0);
+
+  CHECK(receive(stream, fragment(1, Stream_Rle, 0, { 1, 5, 5, 5 }), 100));
+  // the end of 1 never came, 2 is a delta on a frame that isn't there
+  CHECK(!receive(stream, fragment(2, Stream_Rle | STREAM_FRAME_END, 0, { 1, 6, 6, 6 }), 200));
+  CHECK(show(stream, 200) == NULL);
+  CHECK(stream.getStats().dropped == 2);
+  stream.end();
+}
+
+TEST(playsOutOneBufferBehind) {
+  LiveStream stream;
+  // 100 ms frames, two deep
+  stream.begin(PIXELS, 10, 2, 1000);
+
+  receive(stream, keyFrame(0, 0), 1000);
+  receive(stream, keyFrame(1, 1), 1150);
+  receive(stream, keyFrame(2, 2), 1190);
+  CHECK(stream.nextDue() == 1200);
+
+  // arrival jitter doesn't show, frames go out every 100 ms
+  CHECK(stream.due(1199) == NULL);
+  for (uint8_t seq = 0; seq < 3; seq++) {
+    unsigned long now = 1200 + seq * 100;
+    auto pixels = stream.due(now);
+    CHECK(pixels != NULL && pixels[0] == seq);
+    stream.shown(now);
+    CHECK(stream.due(now + 99) == NULL);
+  }
+  CHECK(stream.nextDue() == 0);
+
+  auto stats = stream.getStats();
+  CHECK(stats.shown == 3);
+  CHECK(stats.latency == (200 + 150 + 210) / 3);
+  CHECK(stats.latencyMax == 210);
+  stream.end();
+}
+
+TEST(showsTheNewestDueFrame) {
+  LiveStream stream;
+  stream.begin(PIXELS, 10, 2, 0);
+  receive(stream, keyFrame(0, 0), 0);
+  receive(stream, keyFrame(1, 1), 10);
+  receive(stream, keyFrame(2, 2), 20);
+
+  // the renderer was busy until 2 was due
+  auto pixels = stream.due(400);
+  CHECK(pixels != NULL && pixels[0] == 2);
+  stream.shown(400);
+  CHECK(stream.getStats().late == 2);
+
+  // a frame older than the one shown is late too
+  receive(stream, keyFrame(1, 1), 410);
+  CHECK(stream.due(410) == NULL);
+  CHECK(stream.getStats().late == 3);
+  stream.end();
+}
+
+TEST(fallingBehindRestartsPlayout) {
+  LiveStream stream;
+  stream.begin(PIXELS, 10, 2, 0);
+  receive(stream, keyFrame(0, 0), 0);
+  CHECK(stream.nextDue() == 200);
+  show(stream, 200);
+
+  // frame 1 was due at 300, arriving a full buffer after that restarts
+  receive(stream, keyFrame(1, 1), 600);
+  CHECK(stream.nextDue() == 800);
+  stream.end();
+}
+
+TEST(fullBufferDropsTheOldestFrame) {
+  LiveStream stream;
+  stream.begin(PIXELS, 10, 2, 0);
+
+  // nothing is played, the app runs ahead
+  for (uint16_t seq = 0; seq < STREAM_SLOTS + 2; seq++)
+    CHECK(receive(stream, keyFrame(seq, seq), 0));
+  CHECK(stream.getStats().dropped == 2);
+
+  auto pixels = stream.due(10000);
+  CHECK(pixels != NULL && pixels[0] == STREAM_SLOTS + 1);
+  CHECK(stream.getStats().late == STREAM_SLOTS - 1);
+  stream.end();
+}
+
+TEST(timesOutWithoutFragments) {
+  LiveStream stream;
+  stream.begin(PIXELS, 10, 2, 0);
+  CHECK(!stream.isTimedOut(STREAM_TIMEOUT));
+  receive(stream, keyFrame(0, 0), 500);
+  CHECK(!stream.isTimedOut(500 + STREAM_TIMEOUT));
+  CHECK(stream.isTimedOut(501 + STREAM_TIMEOUT));
+  stream.end();
+}
+
+// Streaming over a modelled link: connection events every interval carry up
+// to 4 writes of 239 pixel bytes, a lost event is retried on the next one.
+// The renderer is busy for the WS2812 frame time after each frame. Key frames
+// are raw, deltas every other frame change a tenth of the pixels in runs.
+struct Simulation {
+  int pixels;
+  int fps;
+  double interval;
+  double loss;
+  bool deltas;
+  size_t backlog = 0;
+
+  Simulation(int pixels, int fps, double interval, double loss, bool deltas)
+    : pixels(pixels), fps(fps), interval(interval), loss(loss), deltas(deltas) { }
+
+  StreamStats run() {
+    LiveStream stream;
+    stream.begin(pixels, fps, 2, 0);
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::deque<std::vector<uint8_t>> queue;
+
+    const int payload = (244 - STREAM_HEADER) / 3 * 3;
+    double renderMs = pixels * 0.03 + 0.3;
+    double nextFrame = 0, nextEvent = 0, rendererFree = 0;
+    uint16_t seq = 0;
+
+    for (double t = 0; t < 20000; t += 0.1) {
+      if (t >= nextFrame) {
+        bool key = !deltas || seq % 30 == 0;
+        if (key) {
+          std::vector<uint8_t> body(pixels * 3, seq);
+          for (size_t offset = 0; offset < body.size(); offset += payload) {
+            size_t length = std::min(body.size() - offset, (size_t)payload);
+            uint8_t flags = Stream_Raw | STREAM_FRAME_KEY | (offset + length == body.size() ? STREAM_FRAME_END : 0);
+            queue.push_back(fragment(seq, flags, offset / 3,
+              std::vector<uint8_t>(body.begin() + offset, body.begin() + offset + length)));
+          }
+        }
+        else {
+          std::vector<uint8_t> body;
+          for (int pixel = 0; pixel < pixels; pixel += 20) {
+            uint8_t run[] = { 2, (uint8_t)seq, 0, 0, STREAM_RLE_SKIP | 18 };
+            body.insert(body.end(), run, run + sizeof(run));
+          }
+          queue.push_back(fragment(seq, Stream_Rle | STREAM_FRAME_END, 0, body));
+        }
+
+        seq++;
+        nextFrame += 1000.0 / fps;
+      }
+
+      if (t >= nextEvent) {
+        nextEvent += interval;
+        if (uniform(random) >= loss)
+          for (int i = 0; i < 4 && !queue.empty(); i++) {
+            receive(stream, queue.front(), t);
+            queue.pop_front();
+          }
+      }
+
+      if (t >= rendererFree && stream.due(t) != NULL) {
+        rendererFree = t + renderMs;
+        stream.shown(rendererFree);
+      }
+    }
+
+    backlog = queue.size();
+    auto stats = stream.getStats();
+    stream.end();
+
+    printf("%3d px %2d fps, %4.1f ms interval, %2.0f%% lost, %s: %4.1f fps, latency %3u ms, max %3u ms, %u dropped, %u late\n",
+      pixels, fps, interval, loss * 100, deltas ? "deltas" : "raw   ", stats.fps / 10.0,
+      stats.latency, stats.latencyMax, stats.dropped, stats.late);
+    return stats;
+  }
+};
+
+TEST(keepsTheFrameRateOverTheLink) {
+  for (int pixels : { 60, 300 })
+    for (double interval : { 7.5, 15.0, 30.0 }) {
+      Simulation simulation(pixels, 30, interval, 0, false);
+      auto stats = simulation.run();
+      CHECK(stats.fps >= 295);
+      CHECK(stats.latencyMax < 100);
+    }
+
+  Simulation lossy(300, 30, 15, 0.1, true);
+  CHECK(lossy.run().fps >= 295);
+
+  // raw frames at 60 fps are more than a 30 ms interval carries, deltas aren't
+  Simulation raw(300, 60, 30, 0, false);
+  CHECK(raw.run().fps < 590);
+  CHECK(raw.backlog > 0);
+  Simulation deltas(300, 60, 30, 0, true);
+  CHECK(deltas.run().fps >= 590);
+}
@@ -0,0 +1,86 @@
+#include "test.h"
+#include <thread>
+#include <models/motion.h>
+#include <mailbox.h>
+
+TEST(emptyMailbox) {
+  Mailbox<VehicleState> mailbox;
+  VehicleState state;
+
+  CHECK(!mailbox.pending());
+  CHECK(!mailbox.take(state));
+  CHECK(!mailbox.peek(state));
+}
+
+TEST(takeReturnsOnlyTheNewest) {
+  Mailbox<VehicleState> mailbox;
+  VehicleState state = {};
+
+  state.turn = Left;
+  mailbox.post(state);
+  state.turn = Right;
+  mailbox.post(state);
+
+  VehicleState taken = {};
+  CHECK(mailbox.take(taken));
+  CHECK(taken.turn == Right);
+  CHECK(!mailbox.pending());
+  CHECK(!mailbox.take(taken));
+
+  // peek still sees the last value
+  VehicleState peeked = {};
+  CHECK(mailbox.peek(peeked));
+  CHECK(peeked.turn == Right);
+}
+
+TEST(postWakesTheReader) {
+  Mailbox<VehicleState> mailbox;
+  auto reader = xTaskGetCurrentTaskHandle();
+  uint32_t before = ulTaskNotifyCount(reader);
+
+  mailbox.setReader(reader);
+  mailbox.post(VehicleState());
+  mailbox.post(VehicleState());
+
+  CHECK(ulTaskNotifyCount(reader) - before == 2);
+}
+
+struct Sample {
+  uint32_t values[8];
+};
+
+// a reader on another core never sees half a write
+TEST(readsAreNeverTorn) {
+  Mailbox<Sample> mailbox;
+  std::atomic<bool> done(false);
+
+  std::thread writer([&]() {
+    Sample sample;
+    for (uint32_t i = 1; i <= 200000; i++) {
+      for (auto &value : sample.values)
+        value = i;
+      mailbox.post(sample);
+    }
+    done = true;
+  });
+
+  uint32_t torn = 0, taken = 0, last = 0;
+  bool ordered = true;
+  Sample sample;
+  while (!done || mailbox.pending()) {
+    if (!mailbox.take(sample))
+      continue;
+
+    taken++;
+    for (auto &value : sample.values)
+      torn += value != sample.values[0];
+    ordered &= sample.values[0] > last;
+    last = sample.values[0];
+  }
+  writer.join();
+
+  CHECK(torn == 0);
+  CHECK(ordered);
+  CHECK(taken > 0);
+  CHECK(last == 200000);
+}
@@ -0,0 +1,180 @@
+#include "test.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <filters/acceleration-detector.h>
+
+// The Vector3D rework against the type it replaced, through the gravity
+// split Motion::calculateAccelerations does for every sample and the
+// detector it feeds. Motion itself needs the IMU driver, so both versions
+// of its body are restated here.
+
+// the baseline type: operator- mutates the left side, memcpy assignment and
+// a branchy index
+struct LegacyVector3D {
+  float x = 0.0f;
+  float y = 0.0f;
+  float z = 0.0f;
+
+  float& operator[](int index) {
+    if (index == 0) return x;
+    else if (index == 1) return y;
+    else return z;
+  }
+
+  LegacyVector3D& operator-(LegacyVector3D const &other) {
+    this->x = this->x - other.x;
+    this->y = this->y - other.y;
+    this->z = this->z - other.z;
+    return *this;
+  }
+
+  LegacyVector3D& operator=(LegacyVector3D const &other) {
+    memcpy(&x, &other.x, sizeof(float));
+    memcpy(&y, &other.y, sizeof(float));
+    memcpy(&z, &other.z, sizeof(float));
+    return *this;
+  }
+};
+
+#define ALPHA 0.8f
+
+struct LegacyMotion {
+  LegacyVector3D accelBias, gravity, absoluteGravity, linearAcceleration;
+
+  __attribute__((noinline)) float sample(LegacyVector3D raw) {
+    raw = raw - accelBias;
+
+    gravity.x = ALPHA * gravity.x + (1 - ALPHA) * raw[0];
+    gravity.y = ALPHA * gravity.y + (1 - ALPHA) * raw[1];
+    gravity.z = ALPHA * gravity.z + (1 - ALPHA) * raw[2];
+
+    absoluteGravity.x = fabsf(gravity.x);
+    absoluteGravity.y = fabsf(gravity.y);
+    absoluteGravity.z = fabsf(gravity.z);
+
+    linearAcceleration.x = raw[0] - gravity.x;
+    linearAcceleration.y = raw[1] - gravity.y;
+    linearAcceleration.z = raw[2] - gravity.z;
+
+    // the Y_Neg motion axis
+    return -linearAcceleration[1];
+  }
+};
+
+struct Motion {
+  Vector3D accelBias, gravity, absoluteGravity, linearAcceleration;
+
+  __attribute__((noinline)) float sample(Vector3D raw) {
+    raw = raw - accelBias;
+
+    gravity = gravity * ALPHA + raw * (1 - ALPHA);
+    absoluteGravity = gravity.abs();
+    linearAcceleration = raw - gravity;
+
+    return -linearAcceleration[1];
+  }
+};
+
+// 10 minutes of riding at the sampler's rate: noise, bumps, and a brake or
+// a push every few seconds
+static std::vector<Vector3D> ride() {
+  std::vector<Vector3D> samples;
+  srand(3);
+  auto noise = []() { return (rand() % 2001 - 1000) / 1000.0f * 0.03f; };
+
+  for (int i = 0; i < 60000; i++) {
+    int phase = i % 700;
+    float longitudinal = 0;
+    if (phase >= 200 && phase < 300)
+      longitudinal = 0.45f;
+    else if (phase >= 500 && phase < 560)
+      longitudinal = -0.3f;
+
+    float bump = i % 937 == 0 ? 0.8f : 0;
+    samples.push_back(Vector3D(0.02f + noise(), -longitudinal + noise(), 1.0f + bump + noise()));
+  }
+  return samples;
+}
+
+static AccelerationDetector detector() {
+  AccelerationDetector detector;
+  detector.configure(0.2f, 0.2f, 4.0f, 60, 100);
+  detector.reset(Neutral, 0);
+  return detector;
+}
+
+TEST(detectsTheSameAsTheLegacyVector) {
+  auto samples = ride();
+  LegacyMotion legacy;
+  Motion motion;
+  legacy.accelBias.x = motion.accelBias.x = 0.01f;
+  legacy.accelBias.z = motion.accelBias.z = -0.02f;
+
+  auto legacyDetector = detector();
+  auto newDetector = detector();
+  const float dt = MOTION_SAMPLE_PERIOD / 1000.0f;
+
+  int changes = 0, mismatches = 0, differences = 0;
+  AccelerationState last = Neutral;
+
+  for (size_t i = 0; i < samples.size(); i++) {
+    LegacyVector3D raw;
+    raw.x = samples[i].x;
+    raw.y = samples[i].y;
+    raw.z = samples[i].z;
+
+    float legacyAcceleration = legacy.sample(raw);
+    float acceleration = motion.sample(samples[i]);
+    if (memcmp(&legacyAcceleration, &acceleration, sizeof(float)) != 0 ||
+      legacy.gravity.x != motion.gravity.x || legacy.gravity.y != motion.gravity.y || legacy.gravity.z != motion.gravity.z)
+      differences++;
+
+    unsigned long now = i * MOTION_SAMPLE_PERIOD;
+    auto legacyState = legacyDetector.update(legacyAcceleration, now, dt);
+    auto state = newDetector.update(acceleration, now, dt);
+    if (state != legacyState)
+      mismatches++;
+    if (state != last)
+      changes++;
+    last = state;
+  }
+
+  // bit for bit the same values, so the same states
+  CHECK(differences == 0);
+  CHECK(mismatches == 0);
+  // the ride has something to detect
+  CHECK(changes > 100);
+}
+
+TEST(sampleCost) {
+  auto samples = ride();
+  std::vector<LegacyVector3D> legacySamples(samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    legacySamples[i].x = samples[i].x;
+    legacySamples[i].y = samples[i].y;
+    legacySamples[i].z = samples[i].z;
+  }
+
+  LegacyMotion legacy;
+  Motion motion;
+  auto legacyDetector = detector();
+  auto newDetector = detector();
+  volatile int sink = 0;
+  const float dt = MOTION_SAMPLE_PERIOD / 1000.0f;
+
+  float legacySum = 0, sum = 0;
+  double legacySplit = nanosPer(samples.size(), [&](int i) { legacySum += legacy.sample(legacySamples[i]); });
+  double split = nanosPer(samples.size(), [&](int i) { sum += motion.sample(samples[i]); });
+  sink += legacySum + sum;
+
+  double legacyNanos = nanosPer(samples.size(), [&](int i) {
+    sink += legacyDetector.update(legacy.sample(legacySamples[i]), i * MOTION_SAMPLE_PERIOD, dt);
+  });
+  double nanos = nanosPer(samples.size(), [&](int i) {
+    sink += newDetector.update(motion.sample(samples[i]), i * MOTION_SAMPLE_PERIOD, dt);
+  });
+
+  printf("per sample, legacy / value type: gravity split %.1f / %.1f ns, with detection %.1f / %.1f ns\n",
+    legacySplit, split, legacyNanos, nanos);
+}
@@ -0,0 +1,160 @@
+#include "test.h"
+#include <string>
+#include <vector>
+#include <msgpack-stream.h>
+
+// records every callback as text so whole parses can be compared
+class Trace : public MsgPackHandler {
+  public:
+    std::string events;
+
+    void onMap(uint32_t size) { events += "{" + std::to_string(size) + " "; }
+    void onArray(uint32_t size) { events += "[" + std::to_string(size) + " "; }
+    void onEnd() { events += "} "; }
+    void onKey(const char *key) { events += std::string(key) + ": "; }
+    void onString(const char *value, bool truncated) { events += "\"" + std::string(value) + (truncated ? "\"... " : "\" "); }
+    void onNumber(double value) { char text[32]; snprintf(text, sizeof(text), "%.10g ", value); events += text; }
+    void onBool(bool value) { events += value ? "true " : "false "; }
+    void onNil() { events += "nil "; }
+};
+
+static std::vector<uint8_t> written(void (*write)(MsgPackWriter &writer)) {
+  char *buffer = NULL;
+  size_t size = 0;
+  FILE *file = open_memstream(&buffer, &size);
+  MsgPackWriter writer(file);
+  write(writer);
+  fclose(file);
+
+  std::vector<uint8_t> data(buffer, buffer + size);
+  free(buffer);
+  return data;
+}
+
+static MsgPackStatus parse(const std::vector<uint8_t> &data, size_t chunk, Trace &trace) {
+  MsgPackReader reader;
+  reader.reset(&trace);
+
+  MsgPackStatus status = MsgPack_Incomplete;
+  for (size_t offset = 0; offset < data.size() && status == MsgPack_Incomplete; offset += chunk)
+    status = reader.feed(&data[offset], std::min(chunk, data.size() - offset));
+  return status;
+}
+
+static void document(MsgPackWriter &writer) {
+  writer.map(5);
+  writer.string("name");
+  writer.string("amp");
+  writer.string("numbers");
+  writer.array(11);
+  writer.integer(0);
+  writer.integer(127);
+  writer.integer(-32);
+  writer.integer(-33);
+  writer.integer(300);
+  writer.integer(70000);
+  writer.integer(-70000);
+  writer.number(0.25f);
+  writer.integer(0xffffffffLL);
+  writer.integer(0x100000001LL);
+  writer.integer(-0x100000001LL);
+  writer.string("flags");
+  writer.array(2);
+  writer.boolean(true);
+  writer.boolean(false);
+  writer.string("empty");
+  writer.map(0);
+  writer.string("long");
+  writer.string(std::string(40, 'x'));
+}
+
+static const char *expected =
+  "{5 name: \"amp\" numbers: [11 0 127 -32 -33 300 70000 -70000 0.25 4294967295 4294967297 -4294967297 } "
+  "flags: [2 true false } empty: {0 } long: \"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\" } ";
+
+TEST(writerRoundTrips) {
+  auto data = written(document);
+  Trace trace;
+  CHECK(parse(data, data.size(), trace) == MsgPack_Done);
+  CHECK(trace.events == expected);
+}
+
+TEST(anyChunkSizeParsesTheSame) {
+  auto data = written(document);
+  for (size_t chunk = 1; chunk <= data.size(); chunk++) {
+    Trace trace;
+    if (parse(data, chunk, trace) != MsgPack_Done || trace.events != expected) {
+      printf("chunk size %zu\n", chunk);
+      CHECK(trace.events == expected);
+      break;
+    }
+  }
+}
+
+TEST(truncatedInputIsIncomplete) {
+  auto data = written(document);
+  data.pop_back();
+
+  Trace trace;
+  CHECK(parse(data, 3, trace) == MsgPack_Incomplete);
+}
+
+TEST(readerStopsAtTheEndOfTheDocument) {
+  auto data = written(document);
+  size_t size = data.size();
+  data.push_back(0xc0);
+
+  MsgPackReader reader;
+  Trace trace;
+  reader.reset(&trace);
+  CHECK(reader.feed(data.data(), data.size()) == MsgPack_Done);
+  CHECK(reader.offset() == size);
+}
+
+TEST(keysHaveToBeStrings) {
+  std::vector<uint8_t> data = { 0x81, 0x01, 0x02 };
+  Trace trace;
+  CHECK(parse(data, 1, trace) == MsgPack_Error);
+
+  // a key can't be a container either
+  data = { 0x81, 0x90, 0x02 };
+  CHECK(parse(data, 1, trace) == MsgPack_Error);
+}
+
+TEST(nestingIsLimited) {
+  std::vector<uint8_t> data(MSGPACK_MAX_DEPTH, 0x91);
+  data.push_back(0x01);
+
+  Trace trace;
+  CHECK(parse(data, data.size(), trace) == MsgPack_Done);
+
+  data.insert(data.begin(), 0x91);
+  CHECK(parse(data, data.size(), trace) == MsgPack_Error);
+}
+
+TEST(longStringsAreTruncated) {
+  std::string value(MSGPACK_MAX_STRING + 50, 'y');
+  auto data = written([](MsgPackWriter &writer) {
+    writer.array(2);
+    writer.string(std::string(MSGPACK_MAX_STRING + 50, 'y'));
+    writer.integer(1);
+  });
+
+  Trace trace;
+  CHECK(parse(data, 7, trace) == MsgPack_Done);
+  CHECK(trace.events == "[2 \"" + value.substr(0, MSGPACK_MAX_STRING) + "\"... 1 } ");
+}
+
+TEST(binaryAndExtensionsAreNil) {
+  std::vector<uint8_t> data = {
+    0x94,
+    0xc4, 0x03, 1, 2, 3,          // bin 8
+    0xd4, 0x01, 0x05,             // fixext 1
+    0xc7, 0x02, 0x01, 9, 9,       // ext 8
+    0xcb, 0x3f, 0xf8, 0, 0, 0, 0, 0, 0   // float 64, 1.5
+  };
+
+  Trace trace;
+  CHECK(parse(data, 1, trace) == MsgPack_Done);
+  CHECK(trace.events == "[4 nil nil nil 1.5 } ");
+}
@@ -0,0 +1,91 @@
+#include "test.h"
+#include <filters/orientation-classifier.h>
+
+#define RADIANS(degrees) ((degrees) * (float)M_PI / 180.0f)
+
+// gravity tilted from the top side towards the front
+static Vector3D tilted(float degrees) {
+  return Vector3D(sinf(RADIANS(degrees)), 0, cosf(RADIANS(degrees)));
+}
+
+struct Replay {
+  OrientationClassifier classifier;
+  unsigned long now = 0;
+
+  Replay() { classifier.configure(70, 110, 300); }
+
+  Orientation hold(Vector3D gravity, int milliseconds) {
+    Orientation orientation = classifier.getOrientation();
+    for (int i = 0; i < milliseconds; i += 10, now += 10)
+      orientation = classifier.update(gravity, now);
+    return orientation;
+  }
+};
+
+TEST(sidesNeedTheDwell) {
+  Replay replay;
+  CHECK(replay.hold(Vector3D(0, 0, 1), 290) == UnknownSideUp);
+  CHECK(replay.hold(Vector3D(0, 0, 1), 20) == TopSideUp);
+  CHECK_NEAR(replay.classifier.getConfidence(), 1.0, 1e-6);
+}
+
+TEST(everySide) {
+  struct { Vector3D gravity; Orientation side; } sides[] = {
+    { Vector3D(0, 0, 1), TopSideUp },
+    { Vector3D(0, 0, -1), BottomSideUp },
+    { Vector3D(1, 0, 0), FrontSideUp },
+    { Vector3D(-1, 0, 0), BackSideUp },
+    { Vector3D(0, 1, 0), RightSideUp },
+    { Vector3D(0, -1, 0), LeftSideUp },
+  };
+
+  for (auto &side : sides) {
+    Replay replay;
+    CHECK(replay.hold(side.gravity, 400) == side.side);
+  }
+}
+
+// riding near 45 degrees no longer chatters between the top and front
+TEST(noiseAt45DegreesDoesntChatter) {
+  Replay replay;
+  replay.hold(tilted(0), 400);
+
+  int flips = 0;
+  Orientation previous = TopSideUp;
+  for (int i = 0; i < 300; i++) {
+    Orientation orientation = replay.hold(tilted(i % 2 ? 43 : 47), 10);
+    flips += orientation != previous;
+    previous = orientation;
+  }
+
+  CHECK(flips <= 1);
+}
+
+TEST(hysteresisReleasesPastTheExitCone) {
+  Replay replay;
+  replay.hold(tilted(0), 400);
+
+  // the enter cone is 20 degrees, the exit cone 35
+  CHECK(replay.hold(tilted(30), 1000) == TopSideUp);
+  CHECK(replay.classifier.getConfidence() > 0.0f);
+  CHECK(replay.hold(tilted(40), 1000) == UnknownSideUp);
+  CHECK(replay.hold(tilted(80), 1000) == FrontSideUp);
+}
+
+TEST(freeFallKeepsTheSide) {
+  Replay replay;
+  replay.hold(tilted(0), 400);
+
+  CHECK(replay.hold(Vector3D(0.1f, 0, 0.1f), 1000) == TopSideUp);
+  CHECK(replay.classifier.getConfidence() == 0.0f);
+}
+
+TEST(motionLowersConfidence) {
+  Replay replay;
+  replay.hold(tilted(0), 400);
+  float level = replay.classifier.getConfidence();
+
+  replay.hold(tilted(0) * 1.3f, 10);
+  CHECK(replay.classifier.getConfidence() < level);
+  CHECK(replay.classifier.getOrientation() == TopSideUp);
+}
@@ -0,0 +1,167 @@
+#include "test.h"
+#include <random>
+#include <hal/sensor-stream.h>
+
+// The sampler ticks every MOTION_SAMPLE_PERIOD ms, give or take, and pushes
+// every processed sample. Times are micros().
+
+#define TICK      (MOTION_SAMPLE_PERIOD * 1000)
+#define JITTER    2000    // us either way around the nominal tick
+#define STARTED   1000000
+
+static const Vector3D still(0, 0, 0);
+static const Vector3D level(0, 0, 1);
+
+static void push(SensorStream &stream, unsigned long time) { stream.push(time, still, level, still); }
+
+// a minute of jittered sampler ticks with a reader that keeps up
+static void decimates(uint8_t rate) {
+  SensorStream stream;
+  CHECK(stream.start(rate, 1, NULL));
+
+  std::mt19937 random(rate);
+  std::uniform_int_distribution<int> jitter(-JITTER, JITTER);
+  uint32_t period = 1000000 / rate, first = 0, last = 0, shortest = UINT32_MAX, longest = 0, count = 0;
+  SensorSample sample;
+
+  for (int tick = 0; tick < 6000; tick++) {
+    push(stream, STARTED + tick * TICK + jitter(random));
+
+    while (stream.pop(sample)) {
+      if (count++ == 0)
+        first = sample.time;
+      else {
+        shortest = std::min(shortest, sample.time - last);
+        longest = std::max(longest, sample.time - last);
+      }
+      last = sample.time;
+    }
+  }
+
+  double achieved = (count - 1) * 1e6 / (last - first);
+  printf("%d Hz stream: %.2f Hz achieved, %u - %u us apart\n", rate, achieved, shortest, longest);
+
+  CHECK_NEAR(achieved, rate, 0.01);
+  CHECK(shortest > period - TICK / 2);
+  CHECK(longest < period + TICK / 2);
+  CHECK(stream.getOverruns() == 0);
+}
+
+TEST(decimatesJitteredTicksToTheRate) {
+  decimates(10);
+  decimates(25);
+  decimates(50);
+}
+
+TEST(rejectsRatesAndBatchesItCantKeep) {
+  SensorStream stream;
+  CHECK(!stream.start(0, 1, NULL));
+  CHECK(!stream.start(SENSOR_STREAM_MAX_RATE + 1, 1, NULL));
+  CHECK(!stream.start(10, 0, NULL));
+  CHECK(!stream.start(10, SENSOR_STREAM_SAMPLES / 2 + 1, NULL));
+  CHECK(!stream.isActive());
+
+  // nothing is kept while stopped
+  push(stream, STARTED);
+  CHECK(stream.available() == 0);
+}
+
+TEST(wakesTheReaderOnceABatchIsWaiting) {
+  SensorStream stream;
+  TaskHandle_t reader = xTaskGetCurrentTaskHandle();
+  uint32_t before = ulTaskNotifyCount(reader);
+  CHECK(stream.start(50, 4, reader));
+
+  for (int sample = 0; sample < 3; sample++)
+    push(stream, STARTED + sample * 20000);
+  CHECK(ulTaskNotifyCount(reader) == before);
+
+  push(stream, STARTED + 3 * 20000);
+  CHECK(ulTaskNotifyCount(reader) - before == 1);
+  CHECK(stream.available() == 4);
+}
+
+TEST(stalledReaderCountsOverruns) {
+  SensorStream stream;
+  CHECK(stream.start(50, 16, NULL));
+
+  for (int sample = 0; sample < SENSOR_STREAM_SAMPLES + 16; sample++)
+    push(stream, STARTED + sample * 20000);
+  CHECK(stream.available() == SENSOR_STREAM_SAMPLES);
+  CHECK(stream.getOverruns() == 16);
+
+  // the newest samples were lost, the reader catches up from the oldest
+  SensorSample sample;
+  CHECK(stream.pop(sample));
+  CHECK(sample.time == STARTED);
+  while (stream.pop(sample)) { }
+  CHECK(sample.time == STARTED + (SENSOR_STREAM_SAMPLES - 1) * 20000);
+
+  push(stream, STARTED + (SENSOR_STREAM_SAMPLES + 16) * 20000);
+  CHECK(stream.available() == 1);
+  CHECK(stream.getOverruns() == 16);
+}
+
+TEST(restartDropsStaleSamples) {
+  SensorStream stream;
+  CHECK(stream.start(50, 1, NULL));
+  for (int sample = 0; sample < 5; sample++)
+    push(stream, STARTED + sample * 20000);
+  for (int sample = 5; sample < SENSOR_STREAM_SAMPLES + 5; sample++)
+    push(stream, STARTED + sample * 20000);
+  CHECK(stream.getOverruns() == 5);
+
+  stream.stop();
+  push(stream, STARTED + 100 * 20000);
+  CHECK(!stream.isActive());
+  CHECK(stream.available() == SENSOR_STREAM_SAMPLES);
+
+  CHECK(stream.start(25, 1, NULL));
+  CHECK(stream.available() == 0);
+  CHECK(stream.getOverruns() == 0);
+
+  SensorSample sample;
+  push(stream, STARTED + 101 * 20000);
+  CHECK(stream.pop(sample));
+  CHECK(sample.time == STARTED + 101 * 20000);
+  CHECK(!stream.pop(sample));
+}
+
+TEST(quantizeClampsToInt16) {
+  SensorStream stream;
+  CHECK(stream.start(50, 1, NULL));
+
+  // +-8 g is the accelerometer's range, 8 g is one past INT16_MAX
+  stream.push(STARTED, Vector3D(9, -9, 1.5f), Vector3D(8, -8, 0.00012f), Vector3D(400, -400, 12.34f));
+  stream.push(STARTED + 20000, Vector3D(-1.25f / SENSOR_ACCEL_SCALE, 0, 0), level, still);
+
+  SensorSample sample;
+  CHECK(stream.pop(sample));
+  CHECK(sample.values[0] == INT16_MAX);
+  CHECK(sample.values[1] == INT16_MIN);
+  CHECK(sample.values[2] == 6144);
+  CHECK(sample.values[3] == INT16_MAX);
+  CHECK(sample.values[4] == INT16_MIN);
+  CHECK(sample.values[5] == 0);
+  CHECK(sample.values[6] == INT16_MAX);
+  CHECK(sample.values[7] == INT16_MIN);
+  CHECK(sample.values[8] == 1234);
+
+  // rounded half away from zero
+  CHECK(stream.pop(sample));
+  CHECK(sample.values[0] == -1);
+  CHECK(sample.values[5] == SENSOR_ACCEL_SCALE);
+}
+
+TEST(pushAndDrainCost) {
+  SensorStream stream;
+  CHECK(stream.start(50, 1, NULL));
+  SensorSample sample;
+
+  double nanos = nanosPer(1000000, [&](int tick) {
+    push(stream, STARTED + (unsigned long)tick * TICK);
+    while (stream.pop(sample)) { }
+  });
+  printf("push and drain at 50 Hz from 100 Hz ticks: %.1f ns/tick\n", nanos);
+  CHECK(stream.getOverruns() == 0);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+// Host stand-in for the AddressableLED component types the firmware uses,
+// common.h maps Color onto Rgb
+
+enum LEDType : uint8_t {
+  NeoPixel = 0,
+  WS2813,
+  SK6812,
+  DotStar
+};
+
+union Rgb {
+  struct {
+    uint8_t r, g, b, a;
+  };
+  uint32_t value;
+
+  Rgb(uint8_t r = 0, uint8_t g = 0, uint8_t b = 0, uint8_t a = 255) : r(r), g(g), b(b), a(a) { }
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// the IDF headers this stands in for bring the timer along
+#include "esp_timer.h"
+
+// Host stand-in for the cpp_utils FreeRTOS wrapper, only the binary
+// semaphore the firmware uses as a lock
+class FreeRTOS {
+  public:
+    class Semaphore {
+      std::mutex _mutex;
+      std::condition_variable _released;
+      bool _taken = false;
+
+      public:
+        Semaphore(std::string name = "semaphore") { }
+        Semaphore(const Semaphore&) { }
+
+        void give() {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _taken = false;
+          _released.notify_all();
+        }
+
+        void take(std::string owner = "<Unknown>") {
+          std::unique_lock<std::mutex> lock(_mutex);
+          _released.wait(lock, [this]() { return !_taken; });
+          _taken = true;
+        }
+
+        bool take(uint32_t timeoutMs, std::string owner = "<Unknown>") {
+          std::unique_lock<std::mutex> lock(_mutex);
+          if (!_released.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return !_taken; }))
+            return false;
+          _taken = true;
+          return true;
+        }
+
+        uint32_t wait(std::string owner = "<Unknown>") {
+          std::unique_lock<std::mutex> lock(_mutex);
+          _released.wait(lock, [this]() { return !_taken; });
+          return 0;
+        }
+    };
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include <utility>
+
+// Host stand-in for a NimBLE characteristic, it keeps the value and counts
+// notifications
+class NimBLECharacteristic {
+  public:
+    std::vector<std::pair<uint16_t, uint16_t>> m_subscribedVec;
+
+    uint8_t value[32];
+    size_t length = 0;
+    uint32_t notifications = 0;
+
+    void setValue(const uint8_t *data, size_t size) {
+      length = size < sizeof(value) ? size : sizeof(value);
+      memcpy(value, data, length);
+    }
+
+    void notify(bool is_notification = true) { notifications++; }
+};
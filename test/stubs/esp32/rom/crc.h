@@ -0,0 +1,8 @@
+#pragma once
+#include <stdint.h>
+#include <zlib.h>
+
+// the ROM crc32 is the zlib one, the update tools compute it with zlib.crc32
+inline uint32_t crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+  return crc32(crc, buf, len);
+}
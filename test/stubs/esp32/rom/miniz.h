@@ -0,0 +1,76 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <zlib.h>
+
+// Host stand-in for the ROM tinfl, on top of zlib. zlib keeps its own
+// dictionary, so the output buffer doesn't have to be the 32 KB window. Its
+// allocations come out of the decompressor so freeing that releases them,
+// as with the ROM version.
+
+#define TINFL_LZ_DICT_SIZE              32768
+#define TINFL_FLAG_PARSE_ZLIB_HEADER    1
+#define TINFL_FLAG_HAS_MORE_INPUT       2
+
+typedef enum {
+  TINFL_STATUS_BAD_PARAM = -3,
+  TINFL_STATUS_ADLER32_MISMATCH = -2,
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+struct tinfl_decompressor {
+  z_stream stream;
+  size_t used;
+  uint8_t arena[64 * 1024];     // inflate state and its 32 KB window
+};
+
+inline voidpf tinfl_host_alloc(voidpf opaque, uInt items, uInt size) {
+  auto decompressor = (tinfl_decompressor*)opaque;
+  size_t length = ((size_t)items * size + 15) & ~(size_t)15;
+  if (decompressor->used + length > sizeof(decompressor->arena))
+    return Z_NULL;
+
+  voidpf memory = &decompressor->arena[decompressor->used];
+  decompressor->used += length;
+  return memory;
+}
+
+inline void tinfl_host_free(voidpf opaque, voidpf address) { }
+
+inline void tinfl_init(tinfl_decompressor *decompressor) {
+  decompressor->used = 0;
+  decompressor->stream = z_stream();
+  decompressor->stream.zalloc = tinfl_host_alloc;
+  decompressor->stream.zfree = tinfl_host_free;
+  decompressor->stream.opaque = decompressor;
+  inflateInit(&decompressor->stream);
+}
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor *decompressor, const uint8_t *in, size_t *in_size,
+  uint8_t *out_start, uint8_t *out_next, size_t *out_size, uint32_t flags) {
+  auto& stream = decompressor->stream;
+  stream.next_in = (Bytef*)in;
+  stream.avail_in = *in_size;
+  stream.next_out = out_next;
+  stream.avail_out = *out_size;
+
+  int result = inflate(&stream, Z_NO_FLUSH);
+  *in_size -= stream.avail_in;
+  *out_size -= stream.avail_out;
+
+  switch (result) {
+    case Z_STREAM_END:
+      return TINFL_STATUS_DONE;
+    case Z_OK:
+    case Z_BUF_ERROR:
+      return stream.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+    case Z_DATA_ERROR:
+      return stream.msg != NULL && strcmp(stream.msg, "incorrect data check") == 0 ? TINFL_STATUS_ADLER32_MISMATCH : TINFL_STATUS_FAILED;
+    default:
+      return TINFL_STATUS_FAILED;
+  }
+}
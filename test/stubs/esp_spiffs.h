@@ -0,0 +1,9 @@
+#pragma once
+#include <stddef.h>
+
+typedef struct {
+  const char* base_path;
+  const char* partition_label;
+  size_t max_files;
+  bool format_if_mount_failed;
+} esp_vfs_spiffs_conf_t;
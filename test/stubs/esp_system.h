@@ -0,0 +1,3 @@
+#pragma once
+
+inline const char* esp_get_idf_version() { return "host"; }
@@ -0,0 +1,75 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <vector>
+#include "esp_err.h"
+
+// Real time by default. Tests that step time themselves set the host clock,
+// which also fires the one shot timers that came due.
+
+inline int64_t& esp_timer_host_clock() {
+  static int64_t time = -1;
+  return time;
+}
+
+// microseconds since the first call, or the host clock once it is set
+inline int64_t esp_timer_get_time() {
+  static auto start = std::chrono::steady_clock::now();
+  if (esp_timer_host_clock() >= 0)
+    return esp_timer_host_clock();
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum {
+  ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+
+typedef struct {
+  esp_timer_cb_t callback;
+  void *arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char *name;
+} esp_timer_create_args_t;
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  int64_t alarm;      // -1 when stopped
+};
+
+typedef esp_timer* esp_timer_handle_t;
+
+inline std::vector<esp_timer_handle_t>& esp_timer_host_timers() {
+  static std::vector<esp_timer_handle_t> timers;
+  return timers;
+}
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle) {
+  *handle = new esp_timer { args->callback, args->arg, -1 };
+  esp_timer_host_timers().push_back(*handle);
+  return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout) {
+  timer->alarm = esp_timer_get_time() + timeout;
+  return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  timer->alarm = -1;
+  return ESP_OK;
+}
+
+inline void esp_timer_host_set_time(int64_t time) {
+  esp_timer_host_clock() = time;
+
+  for (auto timer : esp_timer_host_timers())
+    if (timer->alarm >= 0 && timer->alarm <= time) {
+      timer->alarm = -1;
+      timer->callback(timer->arg);
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Host stand-in for the FreeRTOS types the tested modules use. Critical
+// sections are real spinlocks so tests can run producers on other threads.
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdTRUE                1
+#define pdFALSE               0
+#define portMAX_DELAY         (TickType_t)0xffffffffUL
+#define portTICK_PERIOD_MS    1
+#define pdMS_TO_TICKS(ms)     ((TickType_t)(ms))
+
+struct portMUX_TYPE {
+  std::atomic<bool> locked;
+
+  portMUX_TYPE() : locked(false) { }
+  portMUX_TYPE(const portMUX_TYPE&) : locked(false) { }
+  portMUX_TYPE& operator=(const portMUX_TYPE&) { return *this; }
+};
+
+#define portMUX_INITIALIZER_UNLOCKED portMUX_TYPE()
+
+inline void portENTER_CRITICAL(portMUX_TYPE *mux) {
+  while (mux->locked.exchange(true, std::memory_order_acquire)) { }
+}
+
+inline void portEXIT_CRITICAL(portMUX_TYPE *mux) {
+  mux->locked.store(false, std::memory_order_release);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <algorithm>
+
+// Host stream buffer. As on the device a blocked sender waits for room for
+// all of its data and a blocked reader for the trigger level, and both take
+// what there is when they time out.
+
+struct StreamBufferDef_t {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<uint8_t> data;
+  size_t size;
+  size_t trigger;
+};
+
+typedef StreamBufferDef_t* StreamBufferHandle_t;
+
+inline StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger) {
+  auto buffer = new StreamBufferDef_t();
+  buffer->size = size;
+  buffer->trigger = trigger;
+  return buffer;
+}
+
+inline void vStreamBufferDelete(StreamBufferHandle_t buffer) { delete buffer; }
+
+inline size_t xStreamBufferSend(StreamBufferHandle_t buffer, const void *data, size_t length, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(buffer->mutex);
+  buffer->changed.wait_for(lock, std::chrono::milliseconds(ticks), [&]() { return buffer->size - buffer->data.size() >= length; });
+
+  size_t count = std::min(length, buffer->size - buffer->data.size());
+  buffer->data.insert(buffer->data.end(), (const uint8_t*)data, (const uint8_t*)data + count);
+  buffer->changed.notify_all();
+  return count;
+}
+
+inline size_t xStreamBufferReceive(StreamBufferHandle_t buffer, void *data, size_t length, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(buffer->mutex);
+  if (buffer->data.empty())
+    buffer->changed.wait_for(lock, std::chrono::milliseconds(ticks), [&]() { return buffer->data.size() >= buffer->trigger; });
+
+  size_t count = std::min(length, buffer->data.size());
+  std::copy(buffer->data.begin(), buffer->data.begin() + count, (uint8_t*)data);
+  buffer->data.erase(buffer->data.begin(), buffer->data.begin() + count);
+  buffer->changed.notify_all();
+  return count;
+}
+
+inline BaseType_t xStreamBufferIsEmpty(StreamBufferHandle_t buffer) {
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  return buffer->data.empty() ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xStreamBufferReset(StreamBufferHandle_t buffer) {
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  buffer->data.clear();
+  buffer->changed.notify_all();
+  return pdTRUE;
+}
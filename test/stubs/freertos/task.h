@@ -0,0 +1,55 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include <thread>
+#include <chrono>
+
+// Every host thread is a task. Notifications are only counted, tests read
+// them back with ulTaskNotifyCount(). Created tasks are detached threads that
+// end when their function returns, so vTaskDelete(NULL) as the last statement
+// of a task does nothing. uxTaskHostRunning() counts the ones still running.
+
+struct tskTaskControlBlock {
+  std::atomic<uint32_t> notifications;
+
+  tskTaskControlBlock() : notifications(0) { }
+};
+
+typedef tskTaskControlBlock* TaskHandle_t;
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+  static thread_local tskTaskControlBlock task;
+  return &task;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t task) { task->notifications++; }
+inline uint32_t ulTaskNotifyCount(TaskHandle_t task) { return task->notifications.load(); }
+
+typedef void (*TaskFunction_t)(void *parameters);
+
+inline std::atomic<int>& uxTaskHostRunning() {
+  static std::atomic<int> running(0);
+  return running;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack,
+  void *parameters, uint32_t priority, TaskHandle_t *handle, BaseType_t core) {
+  auto task = new tskTaskControlBlock();
+  if (handle != NULL)
+    *handle = task;
+
+  uxTaskHostRunning()++;
+  std::thread([function, parameters]() {
+    function(parameters);
+    uxTaskHostRunning()--;
+  }).detach();
+  return pdTRUE;
+}
+
+inline void vTaskDelete(TaskHandle_t task) { }
+
+inline void vTaskDelay(TickType_t ticks) {
+  if (ticks == 0)
+    std::this_thread::yield();
+  else
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
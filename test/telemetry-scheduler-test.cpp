@@ -0,0 +1,220 @@
+#include "test.h"
+#include <services/telemetry-scheduler.h>
+
+// A scheduler with its three channels and the packed characteristic, on a
+// clock the test steps in ms. The reader is the test's own task, woken by
+// the scheduler's timer.
+struct Telemetry {
+  TelemetryScheduler scheduler;
+  NimBLECharacteristic state, lights, battery, packed;
+  TaskHandle_t reader = xTaskGetCurrentTaskHandle();
+  uint32_t wakes = ulTaskNotifyCount(reader);
+  unsigned long now = 1000;
+
+  Telemetry() {
+    esp_timer_host_set_time(now * 1000);
+    scheduler.setReader(reader);
+    scheduler.attach(Telemetry_VehicleState, &state, TELEMETRY_STATE_INTERVAL);
+    scheduler.attach(Telemetry_Lights, &lights, TELEMETRY_LIGHTS_INTERVAL);
+    scheduler.attach(Telemetry_Battery, &battery, TELEMETRY_BATTERY_INTERVAL);
+    scheduler.attachPacked(&packed);
+  }
+
+  ~Telemetry() {
+    // the scheduler goes away with its timer still registered
+    for (auto timer : esp_timer_host_timers())
+      esp_timer_stop(timer);
+    BluetoothLE::instance()->activity = Activity_Idle;
+  }
+
+  void update(TelemetryChannel channel, uint8_t value) {
+    uint8_t data[4] = { 0, 0, 0, value };
+    scheduler.update(channel, data, sizeof(data));
+  }
+
+  // true when the timer woke the reader
+  bool advance(unsigned long ms) {
+    now += ms;
+    esp_timer_host_set_time(now * 1000);
+
+    uint32_t count = ulTaskNotifyCount(reader);
+    bool woken = count != wakes;
+    wakes = count;
+    return woken;
+  }
+
+  uint32_t runUntilWoken(unsigned long limit) {
+    for (unsigned long ms = 1; ms <= limit; ms++)
+      if (advance(1))
+        return ms;
+    return 0;
+  }
+};
+
+TEST(firstChangeGoesOutAtOnce) {
+  Telemetry telemetry;
+  telemetry.update(Telemetry_VehicleState, 1);
+  CHECK(telemetry.state.value[3] == 1);
+  CHECK(telemetry.state.notifications == 0);
+
+  telemetry.scheduler.flush();
+  CHECK(telemetry.state.notifications == 1);
+  CHECK(!telemetry.scheduler.isHolding());
+}
+
+TEST(changesWithinTheIntervalAreCoalesced) {
+  Telemetry telemetry;
+  telemetry.update(Telemetry_VehicleState, 1);
+  telemetry.scheduler.flush();
+
+  telemetry.advance(10);
+  telemetry.update(Telemetry_VehicleState, 2);
+  telemetry.scheduler.flush();
+  telemetry.update(Telemetry_VehicleState, 3);
+  telemetry.scheduler.flush();
+  CHECK(telemetry.state.notifications == 1);
+  CHECK(telemetry.scheduler.isHolding());
+
+  // the timer wakes the reader when the interval is up
+  CHECK(telemetry.runUntilWoken(200) == TELEMETRY_STATE_INTERVAL - 10);
+  telemetry.scheduler.flush();
+  CHECK(telemetry.state.notifications == 2);
+  CHECK(telemetry.state.value[3] == 3);
+  CHECK(!telemetry.scheduler.isHolding());
+
+  auto counters = telemetry.scheduler.getCounters(Telemetry_VehicleState);
+  CHECK(counters.sent == 2);
+  CHECK(counters.coalesced == 1);
+  CHECK(counters.dropped == 0);
+}
+
+TEST(changesBackAreDropped) {
+  Telemetry telemetry;
+  telemetry.update(Telemetry_Lights, 1);
+  telemetry.scheduler.flush();
+
+  telemetry.advance(10);
+  telemetry.update(Telemetry_Lights, 2);
+  telemetry.update(Telemetry_Lights, 2);
+  telemetry.update(Telemetry_Lights, 1);
+  telemetry.scheduler.flush();
+  CHECK(!telemetry.scheduler.isHolding());
+  CHECK(telemetry.runUntilWoken(200) == 0);
+
+  auto counters = telemetry.scheduler.getCounters(Telemetry_Lights);
+  CHECK(counters.sent == 1);
+  CHECK(counters.coalesced == 0);
+  CHECK(counters.dropped == 1);
+}
+
+TEST(channelsKeepTheirOwnIntervals) {
+  Telemetry telemetry;
+  telemetry.update(Telemetry_Battery, 80);
+  telemetry.update(Telemetry_VehicleState, 1);
+  telemetry.scheduler.flush();
+
+  telemetry.advance(TELEMETRY_STATE_INTERVAL);
+  telemetry.update(Telemetry_Battery, 79);
+  telemetry.update(Telemetry_VehicleState, 2);
+  telemetry.scheduler.flush();
+  CHECK(telemetry.state.notifications == 2);
+  CHECK(telemetry.battery.notifications == 1);
+
+  CHECK(telemetry.runUntilWoken(2000) == TELEMETRY_BATTERY_INTERVAL - TELEMETRY_STATE_INTERVAL);
+  telemetry.scheduler.flush();
+  CHECK(telemetry.battery.notifications == 2);
+}
+
+TEST(transfersStretchTheIntervals) {
+  Telemetry telemetry;
+  BluetoothLE::instance()->activity = Activity_Transfer;
+  telemetry.update(Telemetry_VehicleState, 1);
+  telemetry.scheduler.flush();
+  telemetry.update(Telemetry_VehicleState, 2);
+  telemetry.scheduler.flush();
+
+  CHECK(telemetry.runUntilWoken(1000) == TELEMETRY_STATE_INTERVAL * TELEMETRY_TRANSFER_BACKOFF);
+  telemetry.scheduler.flush();
+  CHECK(telemetry.state.notifications == 2);
+}
+
+TEST(packsEverythingPending) {
+  Telemetry telemetry;
+  telemetry.packed.m_subscribedVec.push_back(std::make_pair(0, 1));
+
+  telemetry.update(Telemetry_VehicleState, 1);
+  telemetry.update(Telemetry_Lights, 2);
+  uint8_t battery[2] = { 80, 1 };
+  telemetry.scheduler.update(Telemetry_Battery, battery, sizeof(battery));
+  telemetry.scheduler.flush();
+
+  CHECK(telemetry.packed.notifications == 1);
+  CHECK(telemetry.state.notifications == 0);
+  CHECK(telemetry.packed.length == 1 + 4 + 4 + 2);
+  CHECK(telemetry.packed.value[0] == 0x07);
+  CHECK(telemetry.packed.value[4] == 1);
+  CHECK(telemetry.packed.value[8] == 2);
+  CHECK(telemetry.packed.value[9] == 80 && telemetry.packed.value[10] == 1);
+
+  // battery is held back for its interval but rides along with state
+  telemetry.advance(TELEMETRY_STATE_INTERVAL);
+  telemetry.scheduler.update(Telemetry_Battery, battery, 1);
+  telemetry.update(Telemetry_VehicleState, 3);
+  telemetry.scheduler.flush();
+  CHECK(telemetry.packed.notifications == 2);
+  CHECK(telemetry.packed.value[0] == 0x05);
+  CHECK(telemetry.packed.length == 1 + 4 + 1);
+  CHECK(telemetry.scheduler.getPackedCount() == 2);
+}
+
+// 2 s of orientation chatter at 50 Hz, each flip also changing the light
+// command, and a battery reading every 500 ms flipping between two values.
+// The app loop flushes after every change and when the timer wakes it.
+static uint32_t chatter(Telemetry &telemetry, uint32_t *changes) {
+  *changes = 0;
+  for (unsigned long ms = 1; ms < 3000; ms++) {
+    bool woken = telemetry.advance(1);
+    bool changed = false;
+
+    if (ms < 2000 && ms % 20 == 0) {
+      uint8_t state[4] = { 0, 0, (uint8_t)(ms / 20 % 2), 90 };
+      uint8_t lights[4] = { 1, 1, 1, (uint8_t)(3 + ms / 20 % 2) };
+      telemetry.scheduler.update(Telemetry_VehicleState, state, sizeof(state));
+      telemetry.scheduler.update(Telemetry_Lights, lights, sizeof(lights));
+      *changes += 2;
+      changed = true;
+    }
+
+    if (ms < 2000 && ms % 500 == 0) {
+      uint8_t battery[2] = { (uint8_t)(80 - ms / 500 % 2), 0xaa };
+      telemetry.scheduler.update(Telemetry_Battery, battery, sizeof(battery));
+      (*changes)++;
+      changed = true;
+    }
+
+    if (changed || woken)
+      telemetry.scheduler.flush();
+  }
+
+  return telemetry.state.notifications + telemetry.lights.notifications + telemetry.battery.notifications
+    + telemetry.packed.notifications;
+}
+
+TEST(chatterIsRateLimited) {
+  uint32_t changes;
+
+  Telemetry separate;
+  uint32_t notifications = chatter(separate, &changes);
+  CHECK(notifications * 4 < changes);
+  CHECK(!separate.scheduler.isHolding());
+  // the app ends up with the final values
+  CHECK(separate.state.value[2] == 1999 / 20 % 2);
+  CHECK(separate.lights.value[3] == 3 + 1999 / 20 % 2);
+
+  Telemetry packed;
+  packed.packed.m_subscribedVec.push_back(std::make_pair(0, 1));
+  uint32_t packedNotifications = chatter(packed, &changes);
+  printf("%u changes: %u notifications, %u packed\n", changes, notifications, packedNotifications);
+  CHECK(packedNotifications < notifications);
+  CHECK(!packed.scheduler.isHolding());
+}
@@ -0,0 +1,26 @@
+#include "test.h"
+
+int testFailures = 0;
+static TestCase *tests = NULL;
+static TestCase *last = NULL;
+
+TestCase::TestCase(const char *name, TestFunction function) : name(name), function(function), next(NULL) {
+  if (last == NULL)
+    tests = this;
+  else
+    last->next = this;
+  last = this;
+}
+
+int main() {
+  int count = 0;
+  for (auto test = tests; test != NULL; test = test->next) {
+    int failures = testFailures;
+    test->function();
+    printf("%s %s\n", testFailures == failures ? "ok  " : "FAIL", test->name);
+    count++;
+  }
+
+  printf("%d tests, %d failed checks\n", count, testFailures);
+  return testFailures == 0 ? 0 : 1;
+}
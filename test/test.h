@@ -0,0 +1,50 @@
+#pragma once
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+// Minimal host test harness. Each test file registers its cases with TEST()
+// and links test-main.cpp, which runs them all and fails on any CHECK.
+
+typedef void (*TestFunction)();
+
+struct TestCase {
+  const char *name;
+  TestFunction function;
+  TestCase *next;
+
+  TestCase(const char *name, TestFunction function);
+};
+
+extern int testFailures;
+
+#define TEST(name) \
+  static void name(); \
+  static TestCase name##Case(#name, name); \
+  static void name()
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      testFailures++; \
+    } \
+  } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) do { \
+    double _actual = (actual), _expected = (expected); \
+    if (fabs(_actual - _expected) > (tolerance)) { \
+      printf("%s:%d: CHECK_NEAR(%s, %s) failed: %f != %f\n", __FILE__, __LINE__, #actual, #expected, _actual, _expected); \
+      testFailures++; \
+    } \
+  } while (0)
+
+// host timings only compare two implementations on the same machine, they
+// are printed rather than checked
+template <typename F>
+double nanosPer(int iterations, F function) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++)
+    function(i);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
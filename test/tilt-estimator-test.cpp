@@ -0,0 +1,76 @@
+#include "test.h"
+#include <filters/tilt-estimator.h>
+
+#define DT 0.02f
+#define RADIANS(degrees) ((degrees) * (float)M_PI / 180.0f)
+
+static void hold(TiltEstimator &tilt, Vector3D accel, int samples) {
+  for (int i = 0; i < samples; i++)
+    tilt.update(accel, DT);
+}
+
+// a coordinated turn after a short lateral push to one side
+static float turn(float lateral, float lean) {
+  TiltEstimator tilt;
+  hold(tilt, Vector3D(0, 0, 1), 100);
+  hold(tilt, Vector3D(0, lateral, 1.02f), 5);
+  hold(tilt, Vector3D(0, 0, 1 / cosf(RADIANS(lean))), 100);
+  return tilt.getAHRS().x;
+}
+
+TEST(staticTilt) {
+  TiltEstimator tilt;
+  hold(tilt, Vector3D(0, sinf(RADIANS(20)), cosf(RADIANS(20))), 200);
+
+  CHECK_NEAR(tilt.getAHRS().x, 20.0, 0.1);
+  CHECK_NEAR(tilt.getAHRS().z, 0.0, 1e-6);
+}
+
+TEST(coordinatedTurnLeanFollowsEntry) {
+  float left = turn(-0.2f, 25);
+  float right = turn(0.2f, 25);
+
+  CHECK_NEAR(fabsf(left), 25.0, 0.5);
+  CHECK_NEAR(left, -right, 0.1);
+}
+
+TEST(leanClearsWhenStraight) {
+  TiltEstimator tilt;
+  hold(tilt, Vector3D(0, 0, 1), 100);
+  hold(tilt, Vector3D(0, -0.2f, 1.02f), 5);
+  hold(tilt, Vector3D(0, 0, 1 / cosf(RADIANS(25))), 100);
+  hold(tilt, Vector3D(0, 0, 1), 100);
+
+  CHECK_NEAR(tilt.getAHRS().x, 0.0, 0.5);
+}
+
+// bumps past the rejection band don't move the gravity estimate at all
+TEST(rejectsBumps) {
+  TiltEstimator tilt;
+  hold(tilt, Vector3D(0, 0, 1), 100);
+  hold(tilt, Vector3D(-0.6f, 0.4f, 1.3f), 10);
+
+  CHECK(tilt.getGravity() == Vector3D(0, 0, 1));
+  CHECK_NEAR(tilt.getAHRS().y, 0.0, 1e-6);
+}
+
+// hard braking is only partly trusted, the estimate lags far behind the
+// 39 degrees a 0.8 g deceleration would fake
+TEST(dampsBraking) {
+  TiltEstimator tilt;
+  hold(tilt, Vector3D(0, 0, 1), 100);
+  hold(tilt, Vector3D(-0.8f, 0, 1), 25);
+
+  CHECK(tilt.getAHRS().y > 0.0f);
+  CHECK(tilt.getAHRS().y < 15.0f);
+}
+
+TEST(sampleCost) {
+  TiltEstimator tilt;
+  volatile float sink = 0;
+  double nanos = nanosPer(1000000, [&](int i) {
+    tilt.update(Vector3D(0.01f * (i % 7), 0.1f, 1), DT);
+    sink += tilt.getAHRS().x;
+  });
+  printf("tilt estimator: %.1f ns/sample\n", nanos);
+}
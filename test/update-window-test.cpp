@@ -0,0 +1,251 @@
+#include "test.h"
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <deque>
+#include <set>
+#include <update-window.h>
+
+#define BLOCK 4
+
+static const uint8_t blocks[][BLOCK] = {
+  { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 8, 9, 10, 11 }, { 12, 13, 14, 15 }
+};
+
+static std::vector<uint8_t> drain(UpdateWindow &window) {
+  std::vector<uint8_t> data;
+  const uint8_t *block;
+  size_t length;
+  while ((block = window.next(&length)) != NULL)
+    data.insert(data.end(), block, block + length);
+  return data;
+}
+
+TEST(inOrderBlocksAreNotCopied) {
+  UpdateWindow window;
+  CHECK(window.begin(BLOCK, 0));
+
+  CHECK(window.receive(0, blocks[0], BLOCK) == Window_Accepted);
+  size_t length;
+  CHECK(window.next(&length) == blocks[0]);
+  CHECK(length == BLOCK);
+  CHECK(window.next(&length) == NULL);
+  CHECK(window.getOffset() == BLOCK);
+  CHECK(!window.isAckDue());
+}
+
+TEST(blocksPastAGapAreHeld) {
+  UpdateWindow window;
+  window.begin(BLOCK, 0);
+
+  CHECK(window.receive(2 * BLOCK, blocks[2], BLOCK) == Window_Accepted);
+  CHECK(window.receive(3 * BLOCK, blocks[3], 2) == Window_Accepted);
+  CHECK(drain(window).empty());
+  // the first gap asks for an ack, the second doesn't
+  CHECK(window.isAckDue());
+
+  uint32_t offset, received;
+  window.ack(&offset, &received);
+  CHECK(offset == 0);
+  CHECK(received == 0xc);
+
+  CHECK(window.receive(BLOCK, blocks[1], BLOCK) == Window_Accepted);
+  CHECK(!window.isAckDue());
+  CHECK(drain(window).empty());
+
+  CHECK(window.receive(0, blocks[0], BLOCK) == Window_Accepted);
+  auto data = drain(window);
+  CHECK(data.size() == 3 * BLOCK + 2);
+  for (size_t i = 0; i < data.size(); i++)
+    CHECK(data[i] == i);
+
+  window.ack(&offset, &received);
+  CHECK(offset == 3 * BLOCK + 2 + 2);
+  CHECK(received == 0);
+}
+
+TEST(duplicatesAskForAnAck) {
+  UpdateWindow window;
+  window.begin(BLOCK, 0);
+
+  window.receive(0, blocks[0], BLOCK);
+  drain(window);
+  CHECK(window.receive(0, blocks[0], BLOCK) == Window_Duplicate);
+  CHECK(window.isAckDue());
+
+  uint32_t offset, received;
+  window.ack(&offset, &received);
+  window.receive(2 * BLOCK, blocks[2], BLOCK);
+  window.ack(&offset, &received);
+  CHECK(window.receive(2 * BLOCK, blocks[2], BLOCK) == Window_Duplicate);
+  CHECK(window.isAckDue());
+}
+
+TEST(rejectsBlocksOutsideTheWindow) {
+  UpdateWindow window;
+  CHECK(window.receive(0, blocks[0], BLOCK) == Window_Rejected);
+
+  CHECK(!window.begin(0, 0));
+  CHECK(!window.begin(UPDATE_MAX_BLOCK + 1, 0));
+  CHECK(window.begin(BLOCK, 100));
+
+  CHECK(window.receive(0, blocks[0], BLOCK) == Window_Rejected);
+  CHECK(window.receive(101, blocks[0], BLOCK) == Window_Rejected);
+  CHECK(window.receive(100, blocks[0], 0) == Window_Rejected);
+  CHECK(window.receive(100, blocks[0], BLOCK + 1) == Window_Rejected);
+  CHECK(window.receive(100 + UPDATE_WINDOW_BLOCKS * BLOCK, blocks[0], BLOCK) == Window_Rejected);
+  CHECK(window.receive(100 + (UPDATE_WINDOW_BLOCKS - 1) * BLOCK, blocks[0], BLOCK) == Window_Accepted);
+}
+
+TEST(acksEveryHalfWindow) {
+  UpdateWindow window;
+  window.begin(BLOCK, 0);
+
+  for (uint32_t block = 0; block < UPDATE_WINDOW_BLOCKS / 2; block++) {
+    CHECK(!window.isAckDue());
+    window.receive(block * BLOCK, blocks[block % 4], BLOCK);
+    drain(window);
+  }
+  CHECK(window.isAckDue());
+}
+
+TEST(resumesAtAnOffset) {
+  UpdateWindow window;
+  window.begin(BLOCK, 0);
+  window.receive(BLOCK, blocks[1], BLOCK);
+
+  // a restart forgets what was held
+  CHECK(window.begin(BLOCK, 64));
+  CHECK(window.getOffset() == 64);
+  CHECK(window.receive(64, blocks[2], BLOCK) == Window_Accepted);
+  auto data = drain(window);
+  CHECK(data.size() == BLOCK && data[0] == 8);
+  CHECK(window.getOffset() == 68);
+}
+
+// Transfer over a simulated link: a 15 ms connection interval with up to 6
+// packets per event, packets and acks lost at random and acks arriving one
+// interval later. The sender resends what an ack reports missing and, when
+// no ack came for 4 intervals, asks for one and resends the first block.
+#define INTERVAL_MS     15
+#define PER_INTERVAL    6
+#define PAYLOAD         240
+#define ACK_TIMEOUT     4
+
+struct Transfer {
+  const std::vector<uint8_t> &image;
+  double loss;
+  uint32_t intervals = 0;
+  uint32_t packets = 0;
+  std::vector<uint8_t> written;
+
+  Transfer(const std::vector<uint8_t> &image, double loss) : image(image), loss(loss) { }
+
+  bool lost() { return (double)rand() / RAND_MAX < loss; }
+
+  void run() {
+    UpdateWindow window;
+    window.begin(PAYLOAD, 0);
+
+    uint32_t count = (image.size() + PAYLOAD - 1) / PAYLOAD;
+    uint32_t base = 0, next = 0;
+    uint32_t sinceAck = 0;
+    std::deque<uint32_t> resend;
+    std::set<uint32_t> queued;
+    std::vector<std::pair<uint32_t, uint32_t>> acks;
+
+    while (written.size() < image.size() && intervals < 100000) {
+      intervals++;
+
+      // acks sent during the last interval
+      for (auto &ack : acks) {
+        uint32_t acked = ack.first / PAYLOAD;
+        if (acked < base)
+          continue;
+
+        base = acked;
+        sinceAck = 0;
+
+        // blocks missing below the highest one received
+        int highest = 31;
+        while (highest >= 0 && !(ack.second & (1u << highest)))
+          highest--;
+        for (int i = 0; i < highest; i++)
+          if (!(ack.second & (1u << i)) && queued.insert(base + i).second)
+            resend.push_back(base + i);
+      }
+      acks.clear();
+
+      for (int i = 0; i < PER_INTERVAL; i++) {
+        while (!resend.empty() && resend.front() < base) {
+          queued.erase(resend.front());
+          resend.pop_front();
+        }
+
+        uint32_t block;
+        if (!resend.empty()) {
+          block = resend.front();
+          resend.pop_front();
+          queued.erase(block);
+        }
+        else if (next < count && next < base + UPDATE_WINDOW_BLOCKS)
+          block = next++;
+        else
+          break;
+
+        packets++;
+        if (lost())
+          continue;
+
+        size_t length = std::min((size_t)PAYLOAD, image.size() - block * PAYLOAD);
+        if (window.receive(block * PAYLOAD, &image[block * PAYLOAD], length) == Window_Accepted) {
+          auto data = drain(window);
+          written.insert(written.end(), data.begin(), data.end());
+        }
+
+        if (window.isAckDue()) {
+          uint32_t offset, received;
+          window.ack(&offset, &received);
+          if (!lost())
+            acks.push_back(std::make_pair(offset, received));
+        }
+      }
+
+      if (++sinceAck > ACK_TIMEOUT) {
+        sinceAck = 0;
+        window.requestAck();
+        uint32_t offset, received;
+        window.ack(&offset, &received);
+        acks.push_back(std::make_pair(offset, received));
+        if (base < count && queued.insert(base).second)
+          resend.push_front(base);
+      }
+    }
+  }
+
+  double kilobytesPerSecond() { return image.size() / 1024.0 / (intervals * INTERVAL_MS / 1000.0); }
+};
+
+TEST(transfersThroughLoss) {
+  std::vector<uint8_t> image(400000);
+  srand(1);
+  for (auto &value : image)
+    value = rand();
+
+  double lossless = 0;
+  for (double loss : { 0.0, 0.01, 0.05, 0.10, 0.20 }) {
+    srand(7);
+    Transfer transfer(image, loss);
+    transfer.run();
+
+    CHECK(transfer.written == image);
+    if (loss == 0)
+      lossless = transfer.kilobytesPerSecond();
+    // losing packets shouldn't stall the window
+    CHECK(transfer.kilobytesPerSecond() >= lossless * (1 - 2 * loss));
+
+    printf("%2.0f%% loss: %5.1f KB/s, %u packets for %zu blocks\n", loss * 100, transfer.kilobytesPerSecond(),
+      transfer.packets, (image.size() + PAYLOAD - 1) / PAYLOAD);
+  }
+  printf("link: %.1f KB/s\n", PER_INTERVAL * PAYLOAD / 1024.0 / (INTERVAL_MS / 1000.0));
+}
@@ -0,0 +1,377 @@
+#include "test.h"
+#include <stdlib.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <updater.h>
+#include "esp32/rom/crc.h"
+
+#define PARTITION_SIZE  (512 * 1024)
+#define PACKET          244
+
+// Two app partitions in host memory. Writes clear bits like NOR flash, so a
+// sector that wasn't erased first ends up corrupt.
+static esp_partition_t running = { ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, 0x10000, PARTITION_SIZE, "ota_0", false };
+static esp_partition_t update = { ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, 0x90000, PARTITION_SIZE, "ota_1", false };
+static std::map<const esp_partition_t*, std::vector<uint8_t>> flash = {
+  { &running, std::vector<uint8_t>(PARTITION_SIZE, 0xff) },
+  { &update, std::vector<uint8_t>(PARTITION_SIZE, 0xff) }
+};
+static size_t erased = 0;
+static const esp_partition_t *booted = NULL;
+static bool mapped = false;
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t *start_from) { return &update; }
+const esp_partition_t* esp_ota_get_running_partition() { return &running; }
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition) {
+  if (flash[partition][0] != 0xE9)
+    return ESP_ERR_OTA_VALIDATE_FAILED;
+
+  booted = partition;
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+  if (offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0 || offset + size > partition->size)
+    return ESP_ERR_INVALID_ARG;
+
+  std::fill(flash[partition].begin() + offset, flash[partition].begin() + offset + size, 0xff);
+  erased += size;
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size) {
+  if (offset + size > partition->size)
+    return ESP_ERR_INVALID_SIZE;
+
+  for (size_t i = 0; i < size; i++)
+    flash[partition][offset + i] &= ((const uint8_t*)src)[i];
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+  spi_flash_mmap_memory_t memory, const void **out_ptr, spi_flash_mmap_handle_t *out_handle) {
+  *out_ptr = &flash[partition][offset];
+  *out_handle = 1;
+  mapped = true;
+  return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle) { mapped = false; }
+
+// NVS, where the resume checkpoint goes
+static std::map<std::string, std::vector<uint8_t>> nvs;
+
+void AmpStorage::saveBlob(const char* key, const void *value, size_t length) {
+  nvs[key] = std::vector<uint8_t>((const uint8_t*)value, (const uint8_t*)value + length);
+}
+
+bool AmpStorage::getBlob(const char* key, void *value, size_t length) {
+  auto entry = nvs.find(key);
+  if (entry == nvs.end() || entry->second.size() != length)
+    return false;
+
+  memcpy(value, entry->second.data(), length);
+  return true;
+}
+
+void AmpStorage::eraseKey(const char* key) { nvs.erase(key); }
+
+static void reset() {
+  for (auto& partition : flash)
+    std::fill(partition.second.begin(), partition.second.end(), 0xff);
+  erased = 0;
+  booted = NULL;
+  nvs.clear();
+}
+
+static std::vector<uint8_t> appImage(size_t size, int seed) {
+  std::vector<uint8_t> image(size);
+  srand(seed);
+  for (auto &value : image)
+    value = rand();
+  image[0] = 0xE9;
+  return image;
+}
+
+static uint32_t crc(const std::vector<uint8_t> &data) {
+  return crc32_le(0, data.data(), data.size());
+}
+
+// BLE writes as the update service makes them
+static void send(Updater &updater, const std::vector<uint8_t> &data, size_t from = 0, size_t to = 0) {
+  to = to == 0 ? data.size() : to;
+  for (size_t offset = from; offset < to; offset += PACKET)
+    updater.writeUpdate(&data[offset], std::min((size_t)PACKET, to - offset));
+}
+
+// waits for the writer task to finish the update
+static UpdateStatus finish(Updater &updater) {
+  updater.endUpdate();
+  for (int waited = 0; uxTaskHostRunning() > 0 && waited < 5000; waited++)
+    vTaskDelay(1);
+  return updater.getStatus();
+}
+
+static bool written(const std::vector<uint8_t> &image) {
+  return std::equal(image.begin(), image.end(), flash[&update].begin());
+}
+
+TEST(writesARawImage) {
+  reset();
+  auto image = appImage(300 * 1024 + 100, 1);
+
+  Updater updater;
+  CHECK(updater.startUpdate() == 0);
+  CHECK(updater.getStatus() == UpdateStatus::Start);
+  send(updater, image);
+
+  CHECK(finish(updater) == UpdateStatus::End);
+  CHECK(updater.getBytesWritten() == image.size());
+  CHECK(written(image));
+  CHECK(booted == &update);
+
+  // erased a sector at a time as the writes got there, not the partition
+  CHECK(erased == (image.size() + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE);
+}
+
+TEST(checksTheAnnouncedSizeAndCrc) {
+  reset();
+  auto image = appImage(100 * 1024, 2);
+
+  Updater updater;
+  updater.startUpdate(image.size(), crc(image));
+  send(updater, image);
+  CHECK(finish(updater) == UpdateStatus::End);
+  CHECK(written(image));
+
+  // one byte changed on the way
+  reset();
+  updater.startUpdate(image.size(), crc(image));
+  image[5000]++;
+  send(updater, image);
+  CHECK(finish(updater) == UpdateStatus::ErrorWrite);
+  CHECK(booted == NULL);
+
+  // cut short
+  reset();
+  image[5000]--;
+  updater.startUpdate(image.size(), crc(image));
+  send(updater, image, 0, image.size() - 1);
+  CHECK(finish(updater) == UpdateStatus::ErrorWrite);
+  CHECK(booted == NULL);
+}
+
+TEST(resumesFromACheckpointAfterAReset) {
+  reset();
+  auto image = appImage(200 * 1024, 3);
+
+  // the first attempt gets past the first checkpoint
+  Updater first;
+  first.startUpdate(image.size(), crc(image));
+  send(first, image, 0, 100 * 1024);
+  for (int waited = 0; first.getBytesWritten() < 96 * 1024 && waited < 5000; waited++)
+    vTaskDelay(1);
+  auto saved = nvs;
+
+  // the device resets, flash and NVS keep what they had
+  CHECK(finish(first) == UpdateStatus::ErrorWrite);
+  nvs = saved;
+
+  Updater second;
+  uint32_t offset = second.startUpdate(image.size(), crc(image));
+  CHECK(offset == UPDATE_CHECKPOINT_BYTES);
+  send(second, image, offset);
+
+  CHECK(finish(second) == UpdateStatus::End);
+  CHECK(written(image));
+  CHECK(booted == &update);
+  CHECK(nvs.empty());
+}
+
+TEST(rejectsUnknownImages) {
+  reset();
+  auto image = appImage(10 * 1024, 4);
+  // starts like a compressed image but isn't one
+  memcpy(&image[0], "AMPX", 4);
+
+  Updater updater;
+  updater.startUpdate();
+  send(updater, image);
+  CHECK(finish(updater) == UpdateStatus::ErrorWrite);
+  CHECK(booted == NULL);
+}
+
+// what compress_firmware.py makes: magic, image size, zlib stream
+static std::vector<uint8_t> compressed(const std::vector<uint8_t> &image) {
+  uLongf length = compressBound(image.size());
+  std::vector<uint8_t> data(UPDATE_DEFLATE_HEADER + length);
+  compress2(&data[UPDATE_DEFLATE_HEADER], &length, image.data(), image.size(), 9);
+  data.resize(UPDATE_DEFLATE_HEADER + length);
+
+  uint32_t header[2] = { UPDATE_DEFLATE_MAGIC, (uint32_t)image.size() };
+  memcpy(&data[0], header, sizeof(header));
+  return data;
+}
+
+// firmware compresses to about half, runs of repeated code and constants
+static std::vector<uint8_t> compressibleImage(size_t size, int seed) {
+  auto image = appImage(size, seed);
+  for (size_t i = 256; i < size; i++)
+    if (i / 128 % 2 != 0)
+      image[i] = image[i - 256];
+  return image;
+}
+
+TEST(inflatesACompressedImage) {
+  reset();
+  auto image = compressibleImage(300 * 1024 + 100, 5);
+  auto data = compressed(image);
+  CHECK(data.size() < image.size() * 2 / 3);
+
+  Updater updater;
+  updater.startUpdate(data.size(), crc(data));
+  // the header split over writes
+  for (size_t i = 0; i < UPDATE_DEFLATE_HEADER; i++)
+    updater.writeUpdate(&data[i], 1);
+  send(updater, data, UPDATE_DEFLATE_HEADER);
+
+  CHECK(finish(updater) == UpdateStatus::End);
+  CHECK(updater.getBytesWritten() == image.size());
+  CHECK(written(image));
+  CHECK(booted == &update);
+}
+
+TEST(rejectsBrokenCompressedImages) {
+  auto image = compressibleImage(100 * 1024, 6);
+  auto data = compressed(image);
+  Updater updater;
+
+  // corrupt in the middle
+  reset();
+  auto corrupt = data;
+  for (size_t i = data.size() / 2; i < data.size() / 2 + 16; i++)
+    corrupt[i] ^= 0x55;
+  updater.startUpdate();
+  send(updater, corrupt);
+  CHECK(finish(updater) == UpdateStatus::ErrorWrite);
+  CHECK(booted == NULL);
+
+  // ends early
+  reset();
+  updater.startUpdate();
+  send(updater, data, 0, data.size() - 100);
+  CHECK(finish(updater) == UpdateStatus::ErrorWrite);
+  CHECK(booted == NULL);
+
+  // inflates to less than the header said
+  reset();
+  auto longer = data;
+  uint32_t size = image.size() + 1;
+  memcpy(&longer[4], &size, sizeof(size));
+  updater.startUpdate();
+  send(updater, longer);
+  CHECK(finish(updater) == UpdateStatus::ErrorWrite);
+  CHECK(booted == NULL);
+
+  // doesn't fit the partition
+  reset();
+  size = PARTITION_SIZE + 1;
+  memcpy(&longer[4], &size, sizeof(size));
+  updater.startUpdate();
+  send(updater, longer);
+  CHECK(finish(updater) == UpdateStatus::ErrorWrite);
+  CHECK(erased == 0);
+}
+
+// a delta record as diff_firmware.py writes them
+static void record(std::vector<uint8_t> &body, const std::vector<uint8_t> &source, size_t position,
+  const std::vector<uint8_t> &target, size_t from, uint32_t diff, uint32_t extra, int32_t seek) {
+  uint8_t control[DELTA_CONTROL_SIZE];
+  memcpy(&control[0], &diff, sizeof(diff));
+  memcpy(&control[4], &extra, sizeof(extra));
+  memcpy(&control[8], &seek, sizeof(seek));
+  body.insert(body.end(), control, control + DELTA_CONTROL_SIZE);
+
+  for (uint32_t i = 0; i < diff; i++)
+    body.push_back(target[from + i] - source[position + i]);
+  body.insert(body.end(), target.begin() + from + diff, target.begin() + from + diff + extra);
+}
+
+// magic, image size, source size, source crc, zlib stream of the records
+static std::vector<uint8_t> delta(const std::vector<uint8_t> &body, size_t imageSize, const std::vector<uint8_t> &source) {
+  uLongf length = compressBound(body.size());
+  std::vector<uint8_t> data(UPDATE_DELTA_HEADER + length);
+  compress2(&data[UPDATE_DELTA_HEADER], &length, body.data(), body.size(), 9);
+  data.resize(UPDATE_DELTA_HEADER + length);
+
+  uint32_t header[4] = { UPDATE_DELTA_MAGIC, (uint32_t)imageSize, (uint32_t)source.size(), crc(source) };
+  memcpy(&data[0], header, sizeof(header));
+  return data;
+}
+
+// the running firmware and a new one with relocated code and a new function
+struct Release {
+  std::vector<uint8_t> source = compressibleImage(200 * 1024, 7);
+  std::vector<uint8_t> target;
+  std::vector<uint8_t> body;
+
+  Release() {
+    target.assign(source.begin(), source.begin() + 80000);
+    for (size_t i = 100; i < target.size(); i += 97)
+      target[i] += 4;
+    for (int i = 0; i < 3000; i++)
+      target.push_back(rand());
+    target.insert(target.end(), source.begin() + 80000, source.end());
+
+    record(body, source, 0, target, 0, 80000, 3000, 0);
+    record(body, source, 80000, target, 83000, source.size() - 80000, 0, 0);
+
+    std::copy(source.begin(), source.end(), flash[&running].begin());
+  }
+};
+
+TEST(patchesTheRunningFirmware) {
+  reset();
+  Release release;
+  auto data = delta(release.body, release.target.size(), release.source);
+  CHECK(data.size() < release.target.size() / 10);
+
+  Updater updater;
+  updater.startUpdate(data.size(), crc(data));
+  send(updater, data);
+
+  CHECK(finish(updater) == UpdateStatus::End);
+  CHECK(updater.getBytesWritten() == release.target.size());
+  CHECK(written(release.target));
+  CHECK(booted == &update);
+  CHECK(!mapped);
+}
+
+TEST(rejectsDeltasForOtherFirmware) {
+  reset();
+  Release release;
+  Updater updater;
+
+  // made from a different build
+  auto other = release.source;
+  other[1000]++;
+  updater.startUpdate();
+  send(updater, delta(release.body, release.target.size(), other));
+  CHECK(finish(updater) == UpdateStatus::ErrorWrite);
+  CHECK(erased == 0);
+  CHECK(!mapped);
+
+  // reads past the end of the running firmware
+  reset();
+  Release shorter;
+  std::vector<uint8_t> body;
+  record(body, shorter.source, 0, shorter.target, 0, 1000, 0, shorter.source.size());
+  record(body, shorter.source, 0, shorter.target, 0, 1000, 0, 0);
+  updater.startUpdate();
+  send(updater, delta(body, 2000, shorter.source));
+  CHECK(finish(updater) == UpdateStatus::ErrorWrite);
+  CHECK(booted == NULL);
+  CHECK(!mapped);
+}
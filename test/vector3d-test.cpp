@@ -0,0 +1,72 @@
+#include "test.h"
+#include <models/motion.h>
+
+// constexpr arithmetic is usable at compile time
+static constexpr Vector3D folded = Vector3D(1, 2, 3) - Vector3D(1, 1, 1) * 2.0f;
+static_assert(folded[0] == -1.0f && folded[1] == 0.0f && folded[2] == 1.0f, "constexpr Vector3D arithmetic");
+static_assert(alignof(Vector3D) == 16 && sizeof(Vector3D) == 16, "Vector3D is one aligned 16 byte slot");
+
+TEST(operatorsDontMutate) {
+  Vector3D a(1, 2, 3);
+  Vector3D b(0.5f, 0.5f, 0.5f);
+
+  Vector3D difference = a - b;
+  Vector3D sum = a + b;
+  Vector3D scaled = a * 2.0f;
+  Vector3D negated = -a;
+
+  CHECK(a == Vector3D(1, 2, 3));
+  CHECK(b == Vector3D(0.5f, 0.5f, 0.5f));
+  CHECK(difference == Vector3D(0.5f, 1.5f, 2.5f));
+  CHECK(sum == Vector3D(1.5f, 2.5f, 3.5f));
+  CHECK(scaled == Vector3D(2, 4, 6));
+  CHECK(negated == Vector3D(-1, -2, -3));
+}
+
+TEST(compoundAssignment) {
+  Vector3D a(1, 2, 3);
+  a += Vector3D(1, 1, 1);
+  CHECK(a == Vector3D(2, 3, 4));
+  a -= Vector3D(2, 2, 2);
+  CHECK(a == Vector3D(0, 1, 2));
+  a *= -2.0f;
+  CHECK(a == Vector3D(0, -2, -4));
+}
+
+TEST(indexSelectsAxis) {
+  Vector3D a(4, 5, 6);
+  CHECK(a[0] == 4 && a[1] == 5 && a[2] == 6);
+}
+
+TEST(products) {
+  Vector3D x(1, 0, 0), y(0, 1, 0);
+  CHECK(x.dot(y) == 0.0f);
+  CHECK(x.cross(y) == Vector3D(0, 0, 1));
+  CHECK(y.cross(x) == Vector3D(0, 0, -1));
+  CHECK(Vector3D(3, -4, 0).abs() == Vector3D(3, 4, 0));
+  CHECK_NEAR(Vector3D(3, -4, 0).magnitude(), 5.0, 1e-6);
+  CHECK(Vector3D() == Vector3D(0, 0, 0));
+}
+
+// Motion::calculateAccelerations splits a sample into a low passed gravity
+// and the linear residual with these operators
+TEST(gravitySplit) {
+  const float alpha = 0.9f;
+  Vector3D gravity;
+  Vector3D raw(0.1f, -0.2f, 1.0f);
+  Vector3D linear;
+
+  for (int i = 0; i < 200; i++) {
+    gravity = gravity * alpha + raw * (1 - alpha);
+    linear = raw - gravity;
+
+    // the split always adds back up to the sample
+    Vector3D sum = gravity + linear;
+    CHECK_NEAR(sum.x, raw.x, 1e-6);
+    CHECK_NEAR(sum.y, raw.y, 1e-6);
+    CHECK_NEAR(sum.z, raw.z, 1e-6);
+  }
+
+  CHECK_NEAR(gravity.z, 1.0, 1e-4);
+  CHECK_NEAR(linear.magnitude(), 0.0, 1e-4);
+}